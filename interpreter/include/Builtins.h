@@ -177,6 +177,24 @@ namespace interpreter {
         static Value jsonPatch(const std::vector<Value>& args);
     };
 
+    // The builtins in a fixed order, so compiled code can call them by index
+    class NativeTable {
+    public:
+        NativeTable();
+
+        // Index of the builtin called `name`, or -1
+        int indexOf(const std::string& name) const;
+
+        size_t size() const { return functions.size(); }
+        const std::string& name(size_t index) const { return names[index]; }
+        const BuiltinFunction& function(size_t index) const { return functions[index]; }
+
+    private:
+        std::vector<std::string> names;
+        std::vector<BuiltinFunction> functions;
+        std::unordered_map<std::string, int> indices;
+    };
+
 } // namespace interpreter
 
 #endif // BUILTINS_H 
\ No newline at end of file
@@ -0,0 +1,160 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "Runtime.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace interpreter {
+
+    // Register-based instruction set. Every instruction is one 32-bit word:
+    //
+    //   ABC:  op:8 | A:8 | B:8 | C:8
+    //   ABx:  op:8 | A:8 | Bx:16        (sBx = Bx - kJumpBias)
+    //
+    // R[n] is register n of the current frame, K[n] is constant n of the
+    // current chunk. Jumps are relative to the following instruction.
+    // env(d) is the environment d levels out from the frame's own (see
+    // Environment.h); globals are indexed by GlobalTable slot. F[n] is the
+    // n-th field cache of the current chunk, naming the field it accesses.
+#define TOCIN_OPCODES(X)                                                    \
+    X(LOADK)      /* R[A] = K[Bx]                                        */ \
+    X(LOADNIL)    /* R[A] = nil                                          */ \
+    X(LOADBOOL)   /* R[A] = (B != 0)                                     */ \
+    X(LOADINT)    /* R[A] = sBx                                          */ \
+    X(MOVE)       /* R[A] = R[B]                                         */ \
+    X(GETGLOBAL)  /* R[A] = globals[Bx]                                  */ \
+    X(SETGLOBAL)  /* globals[Bx] = R[A]  (must already be defined)       */ \
+    X(DEFGLOBAL)  /* globals[Bx] = R[A]                                  */ \
+    X(GETENV)     /* R[A] = env(B).slots[C]                              */ \
+    X(SETENV)     /* env(B).slots[C] = R[A]                              */ \
+    X(CLOSURE)    /* R[A] = K[Bx] bound to the current environment       */ \
+    X(ADD)        /* R[A] = R[B] + R[C]                                  */ \
+    X(SUB)        /* R[A] = R[B] - R[C]                                  */ \
+    X(MUL)        /* R[A] = R[B] * R[C]                                  */ \
+    X(DIV)        /* R[A] = R[B] / R[C]                                  */ \
+    X(MOD)        /* R[A] = R[B] % R[C]                                  */ \
+    X(EQ)         /* R[A] = R[B] == R[C]                                 */ \
+    X(NE)         /* R[A] = R[B] != R[C]                                 */ \
+    X(LT)         /* R[A] = R[B] < R[C]                                  */ \
+    X(LE)         /* R[A] = R[B] <= R[C]                                 */ \
+    X(NEG)        /* R[A] = -R[B]                                        */ \
+    X(NOT)        /* R[A] = !R[B]                                        */ \
+    X(JMP)        /* pc += sBx                                           */ \
+    X(JMPIF)      /* if R[A] is truthy: pc += sBx                        */ \
+    X(JMPIFNOT)   /* if R[A] is falsy: pc += sBx                         */ \
+    X(CALL)       /* R[A] = R[A](R[A+1] .. R[A+B])                       */ \
+    X(CALLNATIVE) /* R[A] = natives[C](R[A] .. R[A+B-1])                 */ \
+    X(RETURN)     /* return B ? R[A] : nil                               */ \
+    X(NEWARRAY)   /* R[A] = [R[B] .. R[B+C-1]]                           */ \
+    X(NEWDICT)    /* R[A] = {R[B]: R[B+1], ...} for C pairs              */ \
+    X(GETINDEX)   /* R[A] = R[B][R[C]]                                   */ \
+    X(SETINDEX)   /* R[A][R[B]] = R[C]                                   */ \
+    X(GETFIELD)   /* R[A] = R[B].F[C]                                    */ \
+    X(SETFIELD)   /* R[A].F[B] = R[C]                                    */ \
+    X(CONCAT)     /* R[A] = str(R[B]) + ... + str(R[B+C-1])              */ \
+    X(FORITER)    /* R[A+2] = next of R[A] at index R[A+1], else pc+=sBx */
+
+    enum class Opcode : uint8_t {
+#define TOCIN_OPCODE_ENUM(name) name,
+        TOCIN_OPCODES(TOCIN_OPCODE_ENUM)
+#undef TOCIN_OPCODE_ENUM
+        COUNT
+    };
+
+    using Instruction = uint32_t;
+
+    constexpr int kMaxRegisters = 256;
+    constexpr int kJumpBias = 0x7fff;
+    constexpr int kMaxBx = 0xffff;
+
+    inline Instruction encodeABC(Opcode op, int a, int b, int c) {
+        return static_cast<uint32_t>(op) | (static_cast<uint32_t>(a) << 8) |
+               (static_cast<uint32_t>(b) << 16) | (static_cast<uint32_t>(c) << 24);
+    }
+
+    inline Instruction encodeABx(Opcode op, int a, int bx) {
+        return static_cast<uint32_t>(op) | (static_cast<uint32_t>(a) << 8) |
+               (static_cast<uint32_t>(bx) << 16);
+    }
+
+    inline Opcode opcodeOf(Instruction i) { return static_cast<Opcode>(i & 0xff); }
+    inline int argA(Instruction i) { return (i >> 8) & 0xff; }
+    inline int argB(Instruction i) { return (i >> 16) & 0xff; }
+    inline int argC(Instruction i) { return (i >> 24) & 0xff; }
+    inline int argBx(Instruction i) { return (i >> 16) & 0xffff; }
+    inline int argSBx(Instruction i) { return argBx(i) - kJumpBias; }
+
+    const char* opcodeName(Opcode op);
+
+    // Inline cache of one GETFIELD/SETFIELD site. Each entry remembers a
+    // dictionary shape seen at the site and the slot `key` has in it; for a
+    // store that added the key, `next` is the shape the dictionary moved
+    // to. Only shared shapes are recorded. A site that has seen more than
+    // kWays shapes keeps the first kWays and looks the rest up.
+    struct FieldCache {
+        static constexpr int kWays = 4;
+
+        struct Entry {
+            const Shape* shape;
+            const Shape* next;
+            int slot;
+        };
+
+        explicit FieldCache(const std::string& key) : key(key) {}
+
+        const Entry* lookup(const Shape* shape) const {
+            for (int n = 0; n < count; ++n) {
+                if (entries[n].shape == shape) {
+                    return &entries[n];
+                }
+            }
+            return nullptr;
+        }
+
+        void remember(const Shape* shape, int slot, const Shape* next = nullptr) {
+            if (count < kWays) {
+                entries[count++] = {shape, next, slot};
+            }
+        }
+
+        Value key;
+        Entry entries[kWays] = {};
+        int count = 0;
+    };
+
+    struct NativeCode;
+
+    // What the VM has seen of a chunk while interpreting it, for JitTier
+    struct Profile {
+        uint32_t calls = 0;
+        uint32_t backedges = 0;       // Backward jumps taken
+        bool nonIntArguments = false; // Some call passed other than small ints
+    };
+
+    // Compiled code for one function (or the top level of a script)
+    struct Chunk {
+        std::string name;
+        int arity = 0;
+        int numRegisters = 0;
+        int envSize = 0;        // Captured locals; 0 means no environment
+        bool isClosure = false; // Reads or writes an enclosing environment
+        bool memoize = false;   // @memoize: calls are looked up in a MemoTable
+        std::vector<Instruction> code;
+        std::vector<int> lines; // Source line of each instruction
+        std::vector<Value> constants;
+        // Filled in as the code runs, hence mutable in a shared chunk
+        mutable std::vector<FieldCache> fieldCaches;
+        mutable Profile profile;
+        // Set once the chunk has been sent to JitTier
+        mutable std::shared_ptr<NativeCode> native;
+    };
+
+    // Human-readable listing of a chunk and the functions in its constant pool
+    std::string disassemble(const Chunk& chunk);
+
+} // namespace interpreter
+
+#endif // BYTECODE_H
@@ -0,0 +1,152 @@
+#ifndef BYTECODE_COMPILER_H
+#define BYTECODE_COMPILER_H
+
+#include "../tocin-compiler/src/ast/ast.h"
+#include "Builtins.h"
+#include "Bytecode.h"
+#include "Resolver.h"
+#include "Runtime.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace interpreter {
+
+    // Lowers the AST to register bytecode. Locals live in registers of the
+    // enclosing function's frame unless a nested function captures them, in
+    // which case they live in the frame's Environment and are addressed by
+    // (depth, slot). Names declared at the top level of a script are
+    // globals, addressed by their slot in the VM's GlobalTable. Calls to
+    // builtins that are not shadowed by a global compile to CALLNATIVE.
+    // Throws std::runtime_error for constructs the VM cannot run.
+    class BytecodeCompiler : public ast::Visitor {
+    public:
+        BytecodeCompiler(const NativeTable& natives, GlobalTable& globals);
+
+        // Compile a script into a zero-argument function value
+        Value compile(const ast::StmtPtr& program);
+
+        void visitBinaryExpr(ast::BinaryExpr* expr) override;
+        void visitGroupingExpr(ast::GroupingExpr* expr) override;
+        void visitLiteralExpr(ast::LiteralExpr* expr) override;
+        void visitUnaryExpr(ast::UnaryExpr* expr) override;
+        void visitVariableExpr(ast::VariableExpr* expr) override;
+        void visitAssignExpr(ast::AssignExpr* expr) override;
+        void visitCallExpr(ast::CallExpr* expr) override;
+        void visitGetExpr(ast::GetExpr* expr) override;
+        void visitSetExpr(ast::SetExpr* expr) override;
+        void visitListExpr(ast::ListExpr* expr) override;
+        void visitDictionaryExpr(ast::DictionaryExpr* expr) override;
+        void visitLambdaExpr(ast::LambdaExpr* expr) override;
+        void visitAwaitExpr(ast::AwaitExpr* expr) override;
+        void visitExpressionStmt(ast::ExpressionStmt* stmt) override;
+        void visitVariableStmt(ast::VariableStmt* stmt) override;
+        void visitBlockStmt(ast::BlockStmt* stmt) override;
+        void visitIfStmt(ast::IfStmt* stmt) override;
+        void visitWhileStmt(ast::WhileStmt* stmt) override;
+        void visitForStmt(ast::ForStmt* stmt) override;
+        void visitFunctionStmt(ast::FunctionStmt* stmt) override;
+        void visitReturnStmt(ast::ReturnStmt* stmt) override;
+        void visitClassStmt(ast::ClassStmt* stmt) override;
+        void visitImportStmt(ast::ImportStmt* stmt) override;
+        void visitMatchStmt(ast::MatchStmt* stmt) override;
+        void visitNewExpr(ast::NewExpr* expr) override;
+        void visitDeleteExpr(ast::DeleteExpr* expr) override;
+        void visitExportStmt(ast::ExportStmt* stmt) override;
+        void visitModuleStmt(ast::ModuleStmt* stmt) override;
+        void visitStringInterpolationExpr(ast::StringInterpolationExpr* expr) override;
+        void visitChannelSendExpr(ast::ChannelSendExpr* expr) override;
+        void visitChannelReceiveExpr(ast::ChannelReceiveExpr* expr) override;
+        void visitSelectStmt(ast::SelectStmt* stmt) override;
+        void visitGoStmt(ast::GoStmt* stmt) override;
+        void visitArrayLiteralExpr(ast::ArrayLiteralExpr* expr) override;
+        void visitTraitStmt(ast::TraitStmt* stmt) override;
+        void visitImplStmt(ast::ImplStmt* stmt) override;
+        void visitMoveExpr(void* expr) override;
+        void visitGoExpr(void* expr) override;
+        void visitRuntimeChannelSendExpr(void* expr) override;
+        void visitRuntimeChannelReceiveExpr(void* expr) override;
+        void visitRuntimeSelectStmt(void* stmt) override;
+
+    private:
+        // A captured local has no register (reg is -1) and lives in slot of
+        // the function's Environment instead
+        struct Local {
+            std::string name;
+            int depth;
+            int reg;
+            int slot;
+        };
+
+        // Where a name lives as seen from the function being compiled
+        struct Variable {
+            enum class Kind { Register, Env, Global } kind;
+            int index; // Register, environment slot or global slot
+            int depth; // Environments to walk outwards, for Env
+        };
+
+        // Per-function compilation state; nested functions push a new one
+        struct FunctionState {
+            FunctionState* enclosing = nullptr;
+            std::shared_ptr<Chunk> chunk;
+            std::vector<Local> locals;
+            std::unordered_map<std::string, int> constantIndex;
+            int scopeDepth = 0;
+            int freeReg = 0;
+            bool hasEnv = false;
+        };
+
+        const NativeTable& natives;
+        GlobalTable& globals;
+        Resolution resolution;
+        FunctionState* current = nullptr;
+        std::unordered_set<std::string> declaredGlobals;
+        int target = 0; // Register the expression being visited writes to
+        int line = 0;
+
+        Value compileFunction(const std::string& name, const std::vector<ast::Parameter>& params,
+                              ast::Statement* body, ast::Expression* bodyExpr, const void* node,
+                              bool memoize = false);
+        bool isMemoized(ast::FunctionStmt* stmt) const;
+        void collectGlobals(ast::Statement* stmt);
+
+        void statement(ast::Statement* stmt);
+        void expression(ast::Expression* expr, int dst);
+        int expressionAnyReg(ast::Expression* expr);
+        void assignTo(const std::string& name, ast::Expression* value, int dst);
+        void storeVariable(const Variable& variable, int reg);
+        void emitFunction(int dst, const Value& function);
+
+        void beginScope();
+        void endScope();
+        int declareLocal(const std::string& name);
+        int declareCaptured(const std::string& name);
+        bool isCaptured(const void* declaration) const;
+        Variable resolve(const std::string& name);
+        int globalSlot(const std::string& name);
+        const Local* findLocal(const FunctionState* state, const std::string& name) const;
+        int localRegisterTop() const;
+        int allocRegister();
+        void freeRegisters(int mark);
+
+        int emit(Instruction instruction);
+        int emitJump(Opcode op, int a);
+        void patchJump(int jump);
+        void emitLoop(int loopStart);
+        int constant(const Value& value);
+        int nameConstant(const std::string& name);
+        int fieldCache(const std::string& name);
+        void emitConstant(int dst, const Value& value);
+
+        Value literalValue(ast::LiteralExpr* expr) const;
+        // Evaluates expressions made only of literals at compile time
+        bool foldConstant(ast::Expression* expr, Value& result);
+
+        [[noreturn]] void unsupported(const std::string& what) const;
+    };
+
+} // namespace interpreter
+
+#endif // BYTECODE_COMPILER_H
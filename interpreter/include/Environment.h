@@ -2,26 +2,37 @@
 #define ENVIRONMENT_H
 
 #include "Runtime.h"
-#include <unordered_map>
-#include <string>
-#include <memory>
+#include <vector>
 
 namespace interpreter {
 
-    class Environment {
+    // Storage for the locals of one function activation that nested
+    // functions capture. Slots are assigned at compile time and reached by
+    // (depth, slot): depth counts environments to walk outwards through
+    // `enclosing`, slot indexes the flat array.
+    class Environment : public Container {
     public:
-        Environment() = default;
-        explicit Environment(std::shared_ptr<Environment> enclosing) : enclosing(enclosing) {}
+        Environment(size_t size, Value enclosing)
+            : Container(ObjectType::Environment), slots(size), enclosing(std::move(enclosing)) {}
 
-        void define(const std::string& name, const Value& value);
-        Value get(const std::string& name);
-        void assign(const std::string& name, const Value& value);
+        void traverse(Tracer& tracer) const override;
+        void clear() override;
+
+        Value& slot(size_t index) { return slots[index]; }
+
+        Environment* outer(int depth) {
+            Environment* env = this;
+            while (depth-- > 0) {
+                env = static_cast<Environment*>(env->enclosing.asObject());
+            }
+            return env;
+        }
 
     private:
-        std::unordered_map<std::string, Value> values;
-        std::shared_ptr<Environment> enclosing;
+        std::vector<Value> slots;
+        Value enclosing;
     };
 
 } // namespace interpreter
 
-#endif // ENVIRONMENT_H 
\ No newline at end of file
+#endif // ENVIRONMENT_H
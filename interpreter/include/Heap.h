@@ -0,0 +1,93 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "Runtime.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace interpreter {
+
+    // Cycle collector for the containers reference counting cannot free.
+    // Counting frees everything else the moment its last reference goes,
+    // so the collector only has to find groups of containers that refer
+    // to each other and to nothing outside.
+    //
+    // Containers are linked into one of three generations when created.
+    // Every kYoungLimit containers created (net of those freed), the
+    // youngest generation is collected; every kOlderRatio collections of a
+    // generation, the next one up is collected with it. Survivors move up
+    // a generation. The old generation is only collected once it has
+    // grown by a quarter since it was last collected, so long-lived data
+    // is not traced over and over.
+    //
+    // A collection subtracts the references the collected containers make
+    // to each other from their reference counts. Whatever is left over
+    // comes from outside: the VM's registers, globals, C++ locals, older
+    // generations. Everything reachable from such a container is kept and
+    // the rest is garbage. No roots need to be registered, and the heap
+    // never stops anything but the allocation that triggered it.
+    class Heap {
+    public:
+        static constexpr int kGenerations = 3;
+        static constexpr size_t kYoungLimit = 700;
+        static constexpr size_t kOlderRatio = 10;
+
+        struct Stats {
+            size_t collections[kGenerations] = {};
+            size_t freed = 0; // Containers in garbage cycles
+            std::chrono::nanoseconds totalPause{0};
+            std::chrono::nanoseconds maxPause{0};
+        };
+
+        // The interpreter's heap; it is single threaded
+        static Heap& instance();
+
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        void track(Container* container);
+        void untrack(Container* container);
+
+        // Collects every generation; returns the number of containers freed
+        size_t collect() { return collect(kGenerations - 1); }
+
+        size_t size() const;
+        const Stats& stats() const { return statistics; }
+
+    private:
+        // A generation, or a list used during a collection
+        struct List {
+            Container* head = nullptr;
+            Container* tail = nullptr;
+            size_t size = 0;
+
+            void append(Container* container);
+            void remove(Container* container);
+            // Moves every container of `other` to the end of this list
+            void splice(List& other);
+        };
+
+        // Generation number of containers found unreachable so far
+        static constexpr uint8_t kUnreachable = kGenerations;
+
+        List lists[kGenerations + 1];
+        size_t counts[kGenerations] = {}; // Allocations, then collections below
+        size_t oldAfterFull = 0;          // Old generation after the last full collection
+        size_t promotedToOld = 0;         // Containers it has gained since
+        bool collecting = false;
+        Stats statistics;
+
+        Heap() = default;
+
+        void maybeCollect();
+        size_t collect(int generation);
+        void move(Container* container, uint8_t generation);
+        // Container that `value` points at if it takes part in the current
+        // collection of generations up to `generation`
+        static Container* collected(const Value& value, int generation);
+    };
+
+} // namespace interpreter
+
+#endif // HEAP_H
@@ -0,0 +1,96 @@
+#ifndef JIT_TIER_H
+#define JIT_TIER_H
+
+#include "Bytecode.h"
+#include "Runtime.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace interpreter {
+
+    // Machine code for one chunk. Returns 0 and stores the result in
+    // *result (which must hold nil) on success, or nonzero to bail out: the
+    // arguments were not what the code was specialized for, an int left
+    // the small-int range, a division by zero, or the recursion got too
+    // deep. Compiled functions have no side effects, so on a bailout the
+    // VM runs the call again in the interpreter, which produces the exact
+    // result or error.
+    using NativeEntry = int (*)(const Value* args, Value* result, const Value* globals, int64_t depth);
+
+    struct NativeCode {
+        std::atomic<NativeEntry> entry{nullptr}; // Null until compiled, or if rejected
+        uint32_t bailouts = 0;
+    };
+
+    // Second execution tier. The VM counts calls and backward jumps per
+    // chunk; once a function is hot it is handed to request(), and a
+    // background thread translates its bytecode to LLVM IR, optimizes it
+    // and compiles it with ORC. The VM keeps interpreting until the entry
+    // point is published, then calls native code directly.
+    //
+    // Only functions the translator can prove pure are compiled: small-int
+    // and boolean arithmetic, comparisons and jumps over registers, and
+    // calls to themselves through the global they are defined in. Type
+    // feedback specializes the code on small-int arguments, which is all
+    // it handles; a function that has been passed anything else stays
+    // interpreted. There is no on-stack replacement, so a call that is
+    // already running finishes in the interpreter.
+    class JitTier {
+    public:
+        static constexpr uint32_t kHotCalls = 1000;
+        static constexpr uint32_t kBackedgesPerCall = 16;
+        // Native code that keeps bailing out is dropped
+        static constexpr uint32_t kMaxBailouts = 100;
+
+        JitTier() = default;
+        ~JitTier();
+
+        JitTier(const JitTier&) = delete;
+        JitTier& operator=(const JitTier&) = delete;
+
+        bool isEnabled() const { return enabled; }
+        void setEnabled(bool on) { enabled = on; }
+
+        static bool isHot(const Profile& profile) {
+            return profile.calls + profile.backedges / kBackedgesPerCall >= kHotCalls;
+        }
+
+        // Queues `function` for compilation and sets its chunk's native
+        // code. Calls made from it through a global that currently holds
+        // it are compiled as direct recursion, guarded on the global.
+        void request(const Value& function, const GlobalTable& globals);
+
+    private:
+        struct Job {
+            const Chunk* chunk;
+            std::shared_ptr<NativeCode> native;
+            uint64_t self;              // Encoding of the function value
+            std::vector<int> selfSlots; // Globals that held it when queued
+        };
+
+        struct Compiler;
+
+        bool enabled = true;
+        // Keeps compiled functions, and so the chunks and the addresses the
+        // guards compare against, alive as long as their code
+        std::vector<Value> compiled;
+        std::vector<std::shared_ptr<NativeCode>> natives;
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<Job> jobs;
+        bool stopping = false;
+        std::thread worker;
+
+        void work();
+    };
+
+} // namespace interpreter
+
+#endif // JIT_TIER_H
@@ -0,0 +1,59 @@
+#ifndef MEMO_TABLE_H
+#define MEMO_TABLE_H
+
+#include "Runtime.h"
+#include <list>
+#include <unordered_map>
+
+namespace interpreter {
+
+    // Results of a @memoize function keyed on its argument values, bounded
+    // by evicting the least recently used entry. Keys match only when the
+    // function could not tell the arguments apart: 1 and 1.0 compare equal
+    // but are different keys, as are 0.0 and -0.0 and dictionaries with
+    // their keys in a different order. Values are copy-on-write, so a
+    // caller changing a result it got from the table cannot change the
+    // cached one.
+    class MemoTable {
+    public:
+        static constexpr size_t kDefaultCapacity = 1024;
+
+        explicit MemoTable(size_t capacity = kDefaultCapacity) : capacity(capacity) {}
+
+        // Cached result for `args`, now the most recently used; or nullptr
+        const Value* find(const Array& args);
+        void insert(Array args, Value result);
+
+        size_t size() const { return entries.size(); }
+
+        // Every argument and result held, for the Heap
+        void traverse(Tracer& tracer) const;
+        void clear() {
+            index.clear();
+            entries.clear();
+        }
+
+    private:
+        struct Entry {
+            Array args;
+            Value result;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Array* args) const;
+        };
+
+        struct KeyEqual {
+            bool operator()(const Array* a, const Array* b) const;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        size_t capacity;
+        EntryList entries; // Most recently used first
+        std::unordered_map<const Array*, EntryList::iterator, KeyHash, KeyEqual> index;
+    };
+
+} // namespace interpreter
+
+#endif // MEMO_TABLE_H
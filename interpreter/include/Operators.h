@@ -0,0 +1,39 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "Bytecode.h"
+#include "Runtime.h"
+#include <cstdint>
+
+namespace interpreter {
+
+    // Semantics of the arithmetic and comparison opcodes. The VM calls these
+    // off its inline small-int paths and the compiler's constant folder
+    // calls them at compile time, so a folded expression always has the
+    // value the VM would have computed. Errors are std::runtime_error.
+
+    // Integer arithmetic wraps around like the VM's int64
+    inline int64_t wrapAdd(int64_t a, int64_t b) {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+    }
+
+    inline int64_t wrapSub(int64_t a, int64_t b) {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+    }
+
+    inline int64_t wrapMul(int64_t a, int64_t b) {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    }
+
+    // ADD, SUB, MUL, DIV or MOD
+    Value arithmetic(Opcode op, const Value& a, const Value& b);
+
+    // LT, or LE when orEqual
+    bool lessThan(const Value& a, const Value& b, bool orEqual);
+
+    // NEG
+    Value negate(const Value& value);
+
+} // namespace interpreter
+
+#endif // OPERATORS_H
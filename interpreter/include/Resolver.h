@@ -0,0 +1,92 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "../tocin-compiler/src/ast/ast.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace interpreter {
+
+    // What the compiler needs to know about a script before emitting code
+    // for it. Declarations and functions are identified by AST node address
+    // (a ForStmt stands for its loop variable, a Parameter for itself).
+    struct Resolution {
+        // Locals read or written by a function nested in their own
+        std::unordered_set<const void*> captured;
+        // Functions that declare at least one captured local
+        std::unordered_set<const void*> functionsWithEnv;
+    };
+
+    // Walks a script with the compiler's scoping rules and finds every
+    // local that must live in an Environment rather than a register.
+    // Top-level declarations of the script are globals and never captured.
+    class Resolver : public ast::Visitor {
+    public:
+        Resolution resolve(ast::Statement* program);
+
+        void visitBinaryExpr(ast::BinaryExpr* expr) override;
+        void visitGroupingExpr(ast::GroupingExpr* expr) override;
+        void visitLiteralExpr(ast::LiteralExpr* expr) override;
+        void visitUnaryExpr(ast::UnaryExpr* expr) override;
+        void visitVariableExpr(ast::VariableExpr* expr) override;
+        void visitAssignExpr(ast::AssignExpr* expr) override;
+        void visitCallExpr(ast::CallExpr* expr) override;
+        void visitGetExpr(ast::GetExpr* expr) override;
+        void visitSetExpr(ast::SetExpr* expr) override;
+        void visitListExpr(ast::ListExpr* expr) override;
+        void visitDictionaryExpr(ast::DictionaryExpr* expr) override;
+        void visitLambdaExpr(ast::LambdaExpr* expr) override;
+        void visitAwaitExpr(ast::AwaitExpr* expr) override;
+        void visitExpressionStmt(ast::ExpressionStmt* stmt) override;
+        void visitVariableStmt(ast::VariableStmt* stmt) override;
+        void visitBlockStmt(ast::BlockStmt* stmt) override;
+        void visitIfStmt(ast::IfStmt* stmt) override;
+        void visitWhileStmt(ast::WhileStmt* stmt) override;
+        void visitForStmt(ast::ForStmt* stmt) override;
+        void visitFunctionStmt(ast::FunctionStmt* stmt) override;
+        void visitReturnStmt(ast::ReturnStmt* stmt) override;
+        void visitClassStmt(ast::ClassStmt* stmt) override;
+        void visitImportStmt(ast::ImportStmt* stmt) override;
+        void visitMatchStmt(ast::MatchStmt* stmt) override;
+        void visitNewExpr(ast::NewExpr* expr) override;
+        void visitDeleteExpr(ast::DeleteExpr* expr) override;
+        void visitExportStmt(ast::ExportStmt* stmt) override;
+        void visitModuleStmt(ast::ModuleStmt* stmt) override;
+        void visitStringInterpolationExpr(ast::StringInterpolationExpr* expr) override;
+        void visitChannelSendExpr(ast::ChannelSendExpr* expr) override;
+        void visitChannelReceiveExpr(ast::ChannelReceiveExpr* expr) override;
+        void visitSelectStmt(ast::SelectStmt* stmt) override;
+        void visitGoStmt(ast::GoStmt* stmt) override;
+        void visitArrayLiteralExpr(ast::ArrayLiteralExpr* expr) override;
+        void visitTraitStmt(ast::TraitStmt* stmt) override;
+        void visitImplStmt(ast::ImplStmt* stmt) override;
+        void visitMoveExpr(void* expr) override;
+        void visitGoExpr(void* expr) override;
+        void visitRuntimeChannelSendExpr(void* expr) override;
+        void visitRuntimeChannelReceiveExpr(void* expr) override;
+        void visitRuntimeSelectStmt(void* stmt) override;
+
+    private:
+        using Scope = std::unordered_map<std::string, const void*>;
+
+        struct FunctionScope {
+            const void* node;
+            std::vector<Scope> scopes;
+        };
+
+        std::vector<FunctionScope> functions;
+        Resolution result;
+
+        void statement(ast::Statement* stmt);
+        void expression(ast::Expression* expr);
+        void function(const void* node, const std::vector<ast::Parameter>& params,
+                      ast::Statement* body, ast::Expression* bodyExpr);
+        void declare(const std::string& name, const void* declaration);
+        void use(const std::string& name);
+    };
+
+} // namespace interpreter
+
+#endif // RESOLVER_H
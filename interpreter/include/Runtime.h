@@ -1,7 +1,9 @@
 #ifndef RUNTIME_H
 #define RUNTIME_H
 
-#include <variant>
+#include "Shape.h"
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -10,43 +12,332 @@
 namespace interpreter {
 
     // Forward declarations
+    class Value;
     class Function;
     class Class;
+    class Dict;
+    class MemoTable;
+    struct Chunk;
 
-    // Define the runtime value types using std::variant
-    using Value = std::variant<
-        std::monostate,  // null
-        bool,
-        int64_t,
-        double,
-        std::string,
-        std::shared_ptr<Function>,
-        std::shared_ptr<Class>,
-        std::vector<Value>,
-        std::unordered_map<std::string, Value>
-    >;
-
-    // Function class to represent functions
-    class Function {
-    public:
-        Function(const std::string& name, const std::vector<std::string>& params, const std::vector<Value>& body)
-            : name(name), params(params), body(body) {}
+    using Array = std::vector<Value>;
+
+    enum class ObjectType : uint8_t {
+        Int,      // Integers too wide for an inline value
+        String,
+        Array,
+        Dict,
+        Function,
+        Class,
+        Environment
+    };
+
+    // Header of every heap-allocated value. Objects are reference counted
+    // by the Values that point at them; the interpreter is single threaded,
+    // so the count is a plain integer. Cycles among containers are left to
+    // the Heap.
+    class Object {
+    public:
+        explicit Object(ObjectType type) : type(type) {}
+        virtual ~Object() = default;
+
+        Object(const Object&) = delete;
+        Object& operator=(const Object&) = delete;
+
+        ObjectType getType() const { return type; }
+        uint32_t getRefCount() const { return refCount; }
+
+    private:
+        friend class Value;
+
+        ObjectType type;
+        uint32_t refCount = 0;
+    };
+
+    // A value in 8 bytes. Doubles are stored as themselves; everything else
+    // lives in the payload of a quiet NaN that arithmetic never produces
+    // (real NaNs are canonicalized on the way in):
+    //
+    //   0x7ffc | 0..2   nil, false, true
+    //   0x7ffd | int48  integers in [-2^47, 2^47)
+    //   0x7ffe | ptr48  Object*
+    //
+    // Copying a Value that points at an object only bumps the count.
+    // Mutating a shared array or dict through mutableArray()/mutableDict()
+    // copies it first, so containers keep value semantics.
+    class Value {
+    public:
+        Value() : bits(kNil) {}
+        Value(bool b) : bits(b ? kTrue : kFalse) {}
+        Value(int i) : Value(static_cast<int64_t>(i)) {}
+        Value(int64_t i);
+        Value(double d);
+        Value(const char* s);
+        Value(std::string s);
+        Value(Array elements);
+        Value(Dict entries);
+        // Takes a reference to a newly created or already shared object
+        explicit Value(Object* object);
+
+        Value(const Value& other) : bits(other.bits) { retain(); }
+        Value(Value&& other) noexcept : bits(other.bits) { other.bits = kNil; }
+        ~Value() { release(); }
+
+        // Both assignments read `other` before releasing the old value,
+        // which may own it (v = v.asArray()[0])
+        Value& operator=(const Value& other) {
+            uint64_t incoming = other.bits;
+            other.retain();
+            release();
+            bits = incoming;
+            return *this;
+        }
+
+        Value& operator=(Value&& other) noexcept {
+            uint64_t incoming = other.bits;
+            other.bits = kNil;
+            release();
+            bits = incoming;
+            return *this;
+        }
+
+        bool isNil() const { return bits == kNil; }
+        bool isBool() const { return bits == kTrue || bits == kFalse; }
+        bool isDouble() const { return (bits & kBoxed) != kBoxed; }
+        bool isSmallInt() const { return (bits & kTagMask) == kIntTag; }
+        bool isObject() const { return (bits & kTagMask) == kObjectTag; }
+        bool isInt() const { return isSmallInt() || isObjectOf(ObjectType::Int); }
+        bool isNumber() const { return isDouble() || isInt(); }
+        bool isString() const { return isObjectOf(ObjectType::String); }
+        bool isArray() const { return isObjectOf(ObjectType::Array); }
+        bool isDict() const { return isObjectOf(ObjectType::Dict); }
+        bool isFunction() const { return isObjectOf(ObjectType::Function); }
+        bool isClass() const { return isObjectOf(ObjectType::Class); }
+
+        bool asBool() const { return bits == kTrue; }
+        int64_t asSmallInt() const { return static_cast<int64_t>(bits << 16) >> 16; }
+        int64_t asInt() const;
+        double asDouble() const {
+            double d;
+            std::memcpy(&d, &bits, sizeof d);
+            return d;
+        }
+        // Int or double as a double
+        double asNumber() const { return isDouble() ? asDouble() : static_cast<double>(asInt()); }
+        Object* asObject() const { return reinterpret_cast<Object*>(bits & kPayloadMask); }
+
+        const std::string& asString() const;
+        const Array& asArray() const;
+        const Dict& asDict() const;
+        Function* asFunction() const;
+        Class* asClass() const;
+
+        // Copy-on-write access: unshares the container if anything else
+        // refers to it
+        Array& mutableArray();
+        Dict& mutableDict();
+
+        // Same payload: the same double bits, scalar or object
+        bool identical(const Value& other) const { return bits == other.bits; }
+
+        static bool fitsSmallInt(int64_t i) { return i >= -kSmallIntLimit && i < kSmallIntLimit; }
+
+        // The encoding itself, for native code that tests and builds
+        // scalar values without calling back into the runtime (JitTier)
+        uint64_t rawBits() const { return bits; }
+
+        static constexpr uint64_t kBoxed = 0x7ffc000000000000ULL;
+        static constexpr uint64_t kTagMask = 0xffff000000000000ULL;
+        static constexpr uint64_t kPayloadMask = 0x0000ffffffffffffULL;
+        static constexpr uint64_t kNil = kBoxed | 0;
+        static constexpr uint64_t kFalse = kBoxed | 1;
+        static constexpr uint64_t kTrue = kBoxed | 2;
+        static constexpr uint64_t kIntTag = 0x7ffd000000000000ULL;
+        static constexpr uint64_t kObjectTag = 0x7ffe000000000000ULL;
+        static constexpr uint64_t kCanonicalNaN = 0x7ff8000000000000ULL;
+        static constexpr int64_t kSmallIntLimit = int64_t(1) << 47;
+
+    private:
+        uint64_t bits;
+
+        bool isObjectOf(ObjectType type) const { return isObject() && asObject()->type == type; }
+
+        void retain() const {
+            if (isObject()) {
+                asObject()->refCount++;
+            }
+        }
+
+        void release() {
+            if (isObject() && --asObject()->refCount == 0) {
+                destroy(asObject());
+            }
+        }
+
+        static void destroy(Object* object);
+    };
+
+    static_assert(sizeof(Value) == 8, "Value must stay NaN-boxed");
+
+    // String-keyed dictionary that iterates in insertion order. Values sit
+    // in a flat array and the Shape says which slot holds which key, so
+    // code that has seen the shape before can skip the key lookup.
+    class Dict {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(const Dict* dict, size_t index) : dict(dict), index(index) {}
+
+            std::pair<const std::string&, const Value&> operator*() const {
+                return {dict->shape->key(index), dict->values[index]};
+            }
+            const_iterator& operator++() {
+                ++index;
+                return *this;
+            }
+            bool operator==(const const_iterator& other) const { return index == other.index; }
+            bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+        private:
+            const Dict* dict;
+            size_t index;
+        };
+
+        Dict() : shape(Shape::empty()) {}
+        Dict(const Dict& other);
+        Dict(Dict&& other) noexcept = default;
+        Dict& operator=(const Dict& other);
+        Dict& operator=(Dict&& other) noexcept = default;
+
+        size_t size() const { return values.size(); }
+        bool empty() const { return values.empty(); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, values.size()); }
+
+        // Value for `key`, or nullptr
+        const Value* find(const std::string& key) const {
+            int slot = shape->find(key);
+            return slot >= 0 ? &values[slot] : nullptr;
+        }
+        // Value for `key`, added as nil if absent
+        Value& operator[](const std::string& key);
+        bool erase(const std::string& key);
+
+        // Direct access for callers that resolved a key against getShape()
+        const Shape* getShape() const { return shape; }
+        const Value& slot(int index) const { return values[index]; }
+        Value& slot(int index) { return values[index]; }
+        // Adds the key that takes the shape to `next`, a transition of the
+        // current shared shape
+        void grow(const Shape* next, Value value) {
+            values.push_back(std::move(value));
+            shape = next;
+        }
+
+    private:
+        const Shape* shape;
+        std::unique_ptr<Shape> ownShape; // Dictionary mode; shape points at it
+        std::vector<Value> values;
+
+        void leaveTransitionTree();
+    };
+
+    // Receives each Value a container holds
+    class Tracer {
+    public:
+        virtual ~Tracer() = default;
+        virtual void visit(const Value& value) = 0;
+    };
+
+    // Object that holds Values, and so can end up in a reference cycle.
+    // Containers are tracked by the Heap from construction to destruction.
+    class Container : public Object {
+    public:
+        explicit Container(ObjectType type);
+        ~Container() override;
+
+        virtual void traverse(Tracer& tracer) const = 0;
+        // Drops every Value held, to break up a garbage cycle
+        virtual void clear() = 0;
+
+    private:
+        friend class Heap;
+
+        Container* prev = nullptr;
+        Container* next = nullptr;
+        uint32_t gcRefs = 0; // References from outside, during a collection
+        uint8_t generation = 0;
+    };
+
+    class IntObject : public Object {
+    public:
+        explicit IntObject(int64_t value) : Object(ObjectType::Int), value(value) {}
+        int64_t value;
+    };
+
+    class StringObject : public Object {
+    public:
+        explicit StringObject(std::string value) : Object(ObjectType::String), value(std::move(value)) {}
+        std::string value;
+    };
+
+    class ArrayObject : public Container {
+    public:
+        explicit ArrayObject(Array elements) : Container(ObjectType::Array), elements(std::move(elements)) {}
+        void traverse(Tracer& tracer) const override;
+        void clear() override;
+        Array elements;
+    };
+
+    class DictObject : public Container {
+    public:
+        explicit DictObject(Dict entries) : Container(ObjectType::Dict), entries(std::move(entries)) {}
+        void traverse(Tracer& tracer) const override;
+        void clear() override;
+        Dict entries;
+    };
+
+    // Function class to represent functions; the body is compiled bytecode.
+    // A closure is a copy of the compiled prototype bound to the environment
+    // chain it was created in.
+    class Function : public Container {
+    public:
+        Function(const std::string& name, const std::vector<std::string>& params, std::shared_ptr<const Chunk> chunk)
+            : Container(ObjectType::Function), name(name), params(params), chunk(std::move(chunk)) {}
+
+        Function(const Function& prototype, Value env)
+            : Container(ObjectType::Function), name(prototype.name), params(prototype.params),
+              chunk(prototype.chunk), env(std::move(env)) {}
+
+        // The environment and the memoized results; constants belong to
+        // the chunk, whose prototypes are never bound to an environment
+        void traverse(Tracer& tracer) const override;
+        void clear() override;
 
         const std::string& getName() const { return name; }
         const std::vector<std::string>& getParams() const { return params; }
-        const std::vector<Value>& getBody() const { return body; }
+        const Chunk& getChunk() const { return *chunk; }
+        // Environment of the enclosing function, or nil
+        const Value& getEnv() const { return env; }
+        // Result cache of a @memoize function, created on first use. Each
+        // closure gets its own, since results may depend on the environment.
+        MemoTable& memoTable() const;
 
     private:
         std::string name;
         std::vector<std::string> params;
-        std::vector<Value> body;
+        std::shared_ptr<const Chunk> chunk;
+        Value env;
+        mutable std::shared_ptr<MemoTable> memo;
     };
 
     // Class class to represent classes
-    class Class {
+    class Class : public Container {
     public:
         Class(const std::string& name, const std::unordered_map<std::string, Value>& methods)
-            : name(name), methods(methods) {}
+            : Container(ObjectType::Class), name(name), methods(methods) {}
+
+        void traverse(Tracer& tracer) const override;
+        void clear() override;
 
         const std::string& getName() const { return name; }
         const std::unordered_map<std::string, Value>& getMethods() const { return methods; }
@@ -56,6 +347,59 @@ namespace interpreter {
         std::unordered_map<std::string, Value> methods;
     };
 
+    // Global variables by slot. The compiler assigns a slot to each name it
+    // sees; the VM reads and writes slots without hashing.
+    class GlobalTable {
+    public:
+        // Slot for `name`, assigned on first use
+        int slotOf(const std::string& name);
+        // Slot for `name`, or -1
+        int find(const std::string& name) const;
+
+        size_t size() const { return names.size(); }
+        const std::string& name(int slot) const { return names[slot]; }
+        bool isDefined(int slot) const { return defined[slot] != 0; }
+        const Value& get(int slot) const { return values[slot]; }
+        // All values by slot; valid until the next new name is added
+        const Value* data() const { return values.data(); }
+        void set(int slot, Value value) { values[slot] = std::move(value); }
+        void define(int slot, Value value) {
+            values[slot] = std::move(value);
+            defined[slot] = 1;
+        }
+
+    private:
+        std::vector<std::string> names;
+        std::unordered_map<std::string, int> slots;
+        std::vector<Value> values;
+        std::vector<uint8_t> defined;
+    };
+
+    inline int64_t Value::asInt() const {
+        return isSmallInt() ? asSmallInt() : static_cast<IntObject*>(asObject())->value;
+    }
+
+    inline const std::string& Value::asString() const { return static_cast<StringObject*>(asObject())->value; }
+    inline const Array& Value::asArray() const { return static_cast<ArrayObject*>(asObject())->elements; }
+    inline const Dict& Value::asDict() const { return static_cast<DictObject*>(asObject())->entries; }
+    inline Function* Value::asFunction() const { return static_cast<Function*>(asObject()); }
+    inline Class* Value::asClass() const { return static_cast<Class*>(asObject()); }
+
+    // nil, false, 0 and 0.0 are falsy; everything else is truthy
+    bool isTruthy(const Value& value);
+
+    bool valuesEqual(const Value& a, const Value& b);
+
+    // Hash under which values that are valuesEqual collide, except ints
+    // past 2^53 against the doubles they round to
+    size_t hashValue(const Value& value);
+
+    // Display form used by print, string concatenation and interpolation
+    std::string stringify(const Value& value);
+
+    // Name of the value's runtime type, for error messages
+    const char* typeName(const Value& value);
+
 } // namespace interpreter
 
-#endif // RUNTIME_H 
\ No newline at end of file
+#endif // RUNTIME_H
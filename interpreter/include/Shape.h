@@ -0,0 +1,60 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace interpreter {
+
+    // Hidden class of a dictionary: its keys in insertion order, each
+    // mapped to a slot of the dictionary's value array. Dictionaries that
+    // gain the same keys in the same order share one Shape, so a cache
+    // keyed on the Shape can remember where a field lives.
+    //
+    // Shared shapes form a transition tree rooted at empty() and live for
+    // the whole run. A dictionary that deletes a key or grows past
+    // kMaxSharedKeys gets a private shape instead (dictionary mode), which
+    // is mutated in place and never cached.
+    class Shape {
+    public:
+        static constexpr size_t kMaxSharedKeys = 32;
+
+        static const Shape* empty();
+
+        // Slot holding `key`, or -1
+        int find(const std::string& key) const;
+
+        size_t size() const { return keys.size(); }
+        const std::string& key(size_t slot) const { return keys[slot]; }
+        bool isShared() const { return shared; }
+
+        // Shared shape with `key`, which must be absent, appended; nullptr
+        // once the shape has kMaxSharedKeys keys
+        const Shape* withKey(const std::string& key) const;
+
+        // Private copy for a dictionary leaving the transition tree
+        std::unique_ptr<Shape> unshare() const;
+
+        // Private shapes only
+        int add(const std::string& key);
+        void remove(int slot);
+
+    private:
+        // Up to this many keys a linear scan beats hashing the key
+        static constexpr size_t kLinearSearchKeys = 8;
+
+        explicit Shape(bool shared) : shared(shared) {}
+
+        std::vector<std::string> keys;
+        std::unordered_map<std::string, int> slots; // Only past kLinearSearchKeys
+        bool shared;
+        mutable std::unordered_map<std::string, std::unique_ptr<Shape>> transitions;
+
+        void reindex();
+    };
+
+} // namespace interpreter
+
+#endif // SHAPE_H
@@ -0,0 +1,59 @@
+#ifndef VM_H
+#define VM_H
+
+#include "Builtins.h"
+#include "Bytecode.h"
+#include "JitTier.h"
+#include "Runtime.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace interpreter {
+
+    // Executes bytecode produced by BytecodeCompiler. All frames share one
+    // register file: a callee's registers start right after the register
+    // holding it, so arguments are passed without copying. Globals persist
+    // across run() calls, which is what the REPL relies on.
+    class VM {
+    public:
+        VM();
+
+        // Run a compiled script and return the value of its top-level return
+        Value run(const Value& script);
+
+        const NativeTable& getNatives() const { return natives; }
+        GlobalTable& getGlobals() { return globals; }
+
+        void defineGlobal(const std::string& name, Value value);
+
+        // Off, every call stays in the interpreter
+        void setJitEnabled(bool enabled) { jit.setEnabled(enabled); }
+
+    private:
+        struct CallFrame {
+            const Function* function;
+            const Instruction* pc;
+            Value* base;
+            Value env; // Environment of captured locals, or the closure's own
+            Value memoArgs; // Arguments of a @memoize call, to store the result under
+        };
+
+        static constexpr size_t kStackSize = 1 << 16;
+        static constexpr size_t kMaxFrames = 4096;
+
+        NativeTable natives;
+        GlobalTable globals;
+        std::vector<Value> stack;
+        std::vector<CallFrame> frames;
+        JitTier jit;
+
+        Value execute(size_t entryDepth);
+
+        int currentLine() const;
+        [[noreturn]] void runtimeError(const std::string& message) const;
+    };
+
+} // namespace interpreter
+
+#endif // VM_H
@@ -8,6 +8,8 @@
 #include <iomanip>
 #include <filesystem>
 #include <cstdlib>
+#include <thread>
+#include <array>
 
 namespace interpreter {
 
@@ -81,36 +83,55 @@ namespace interpreter {
         builtins["to_dict"] = toDict;
     }
 
+    NativeTable::NativeTable() {
+        std::unordered_map<std::string, BuiltinFunction> builtins;
+        Builtins::registerBuiltins(builtins);
+        for (const auto& entry : builtins) {
+            names.push_back(entry.first);
+        }
+        // Sorted so indices do not depend on hash order
+        std::sort(names.begin(), names.end());
+        for (const auto& builtinName : names) {
+            indices[builtinName] = static_cast<int>(functions.size());
+            functions.push_back(builtins[builtinName]);
+        }
+    }
+
+    int NativeTable::indexOf(const std::string& builtinName) const {
+        auto it = indices.find(builtinName);
+        return it != indices.end() ? it->second : -1;
+    }
+
     Value Builtins::print(const std::vector<Value>& args) {
         for (size_t i = 0; i < args.size(); ++i) {
             if (i > 0) std::cout << " ";
-            std::visit([](const auto& v) { std::cout << v; }, args[i]);
+            std::cout << stringify(args[i]);
         }
         std::cout << std::endl;
         return Value();
     }
 
     Value Builtins::strLength(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("str_length expects one string");
         }
-        return Value(static_cast<int64_t>(std::get<std::string>(args[0]).size()));
+        return Value(static_cast<int64_t>(args[0].asString().size()));
     }
 
     Value Builtins::strConcat(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isString() || !args[1].isString()) {
             throw std::runtime_error("str_concat expects two strings");
         }
-        return Value(std::get<std::string>(args[0]) + std::get<std::string>(args[1]));
+        return Value(args[0].asString() + args[1].asString());
     }
 
     Value Builtins::strSlice(const std::vector<Value>& args) {
-        if (args.size() != 3 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<int64_t>(args[1]) || !std::holds_alternative<int64_t>(args[2])) {
+        if (args.size() != 3 || !args[0].isString() || !args[1].isInt() || !args[2].isInt()) {
             throw std::runtime_error("str_slice expects string, start, end");
         }
-        auto str = std::get<std::string>(args[0]);
-        int64_t start = std::get<int64_t>(args[1]);
-        int64_t end = std::get<int64_t>(args[2]);
+        const std::string& str = args[0].asString();
+        int64_t start = args[1].asInt();
+        int64_t end = args[2].asInt();
         if (start < 0 || end > static_cast<int64_t>(str.size()) || start > end) {
             return Value("");
         }
@@ -118,18 +139,18 @@ namespace interpreter {
     }
 
     Value Builtins::mathSqrt(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("sqrt expects one float");
         }
-        return Value(std::sqrt(std::get<double>(args[0])));
+        return Value(std::sqrt(args[0].asDouble()));
     }
 
     Value Builtins::strSplit(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isString() || !args[1].isString()) {
             throw std::runtime_error("str_split expects string and delimiter");
         }
-        std::string str = std::get<std::string>(args[0]);
-        std::string delim = std::get<std::string>(args[1]);
+        std::string str = args[0].asString();
+        const std::string& delim = args[1].asString();
         std::vector<Value> result;
         size_t pos = 0;
         std::string token;
@@ -143,55 +164,55 @@ namespace interpreter {
     }
 
     Value Builtins::strJoin(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::vector<Value>>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isArray() || !args[1].isString()) {
             throw std::runtime_error("str_join expects array and delimiter");
         }
-        std::vector<Value> arr = std::get<std::vector<Value>>(args[0]);
-        std::string delim = std::get<std::string>(args[1]);
+        const Array& arr = args[0].asArray();
+        const std::string& delim = args[1].asString();
         std::stringstream ss;
         for (size_t i = 0; i < arr.size(); ++i) {
             if (i > 0) ss << delim;
-            ss << std::get<std::string>(toString({arr[i]}));
+            ss << stringify(arr[i]);
         }
         return Value(ss.str());
     }
 
     Value Builtins::strTrim(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("str_trim expects one string");
         }
-        std::string str = std::get<std::string>(args[0]);
+        std::string str = args[0].asString();
         str.erase(0, str.find_first_not_of(" \t\n\r\f\v"));
         str.erase(str.find_last_not_of(" \t\n\r\f\v") + 1);
         return Value(str);
     }
 
     Value Builtins::strToUpper(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("str_to_upper expects one string");
         }
-        std::string str = std::get<std::string>(args[0]);
+        std::string str = args[0].asString();
         std::transform(str.begin(), str.end(), str.begin(), ::toupper);
         return Value(str);
     }
 
     Value Builtins::strToLower(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("str_to_lower expects one string");
         }
-        std::string str = std::get<std::string>(args[0]);
+        std::string str = args[0].asString();
         std::transform(str.begin(), str.end(), str.begin(), ::tolower);
         return Value(str);
     }
 
     Value Builtins::strReplace(const std::vector<Value>& args) {
-        if (args.size() != 3 || !std::holds_alternative<std::string>(args[0]) || 
-            !std::holds_alternative<std::string>(args[1]) || !std::holds_alternative<std::string>(args[2])) {
+        if (args.size() != 3 || !args[0].isString() || 
+            !args[1].isString() || !args[2].isString()) {
             throw std::runtime_error("str_replace expects string, pattern, and replacement");
         }
-        std::string str = std::get<std::string>(args[0]);
-        std::string pattern = std::get<std::string>(args[1]);
-        std::string replacement = std::get<std::string>(args[2]);
+        std::string str = args[0].asString();
+        const std::string& pattern = args[1].asString();
+        const std::string& replacement = args[2].asString();
         size_t pos = 0;
         while ((pos = str.find(pattern, pos)) != std::string::npos) {
             str.replace(pos, pattern.length(), replacement);
@@ -201,104 +222,104 @@ namespace interpreter {
     }
 
     Value Builtins::strContains(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isString() || !args[1].isString()) {
             throw std::runtime_error("str_contains expects two strings");
         }
-        std::string str = std::get<std::string>(args[0]);
-        std::string pattern = std::get<std::string>(args[1]);
+        const std::string& str = args[0].asString();
+        const std::string& pattern = args[1].asString();
         return Value(str.find(pattern) != std::string::npos);
     }
 
     Value Builtins::strStartsWith(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isString() || !args[1].isString()) {
             throw std::runtime_error("str_starts_with expects two strings");
         }
-        std::string str = std::get<std::string>(args[0]);
-        std::string prefix = std::get<std::string>(args[1]);
+        const std::string& str = args[0].asString();
+        const std::string& prefix = args[1].asString();
         return Value(str.substr(0, prefix.length()) == prefix);
     }
 
     Value Builtins::strEndsWith(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isString() || !args[1].isString()) {
             throw std::runtime_error("str_ends_with expects two strings");
         }
-        std::string str = std::get<std::string>(args[0]);
-        std::string suffix = std::get<std::string>(args[1]);
+        const std::string& str = args[0].asString();
+        const std::string& suffix = args[1].asString();
         if (str.length() < suffix.length()) return Value(false);
         return Value(str.substr(str.length() - suffix.length()) == suffix);
     }
 
     Value Builtins::mathPow(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<double>(args[0]) || !std::holds_alternative<double>(args[1])) {
+        if (args.size() != 2 || !args[0].isDouble() || !args[1].isDouble()) {
             throw std::runtime_error("math_pow expects two numbers");
         }
-        return Value(std::pow(std::get<double>(args[0]), std::get<double>(args[1])));
+        return Value(std::pow(args[0].asDouble(), args[1].asDouble()));
     }
 
     Value Builtins::mathSin(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_sin expects one number");
         }
-        return Value(std::sin(std::get<double>(args[0])));
+        return Value(std::sin(args[0].asDouble()));
     }
 
     Value Builtins::mathCos(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_cos expects one number");
         }
-        return Value(std::cos(std::get<double>(args[0])));
+        return Value(std::cos(args[0].asDouble()));
     }
 
     Value Builtins::mathTan(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_tan expects one number");
         }
-        return Value(std::tan(std::get<double>(args[0])));
+        return Value(std::tan(args[0].asDouble()));
     }
 
     Value Builtins::mathLog(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_log expects one number");
         }
-        return Value(std::log(std::get<double>(args[0])));
+        return Value(std::log(args[0].asDouble()));
     }
 
     Value Builtins::mathExp(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_exp expects one number");
         }
-        return Value(std::exp(std::get<double>(args[0])));
+        return Value(std::exp(args[0].asDouble()));
     }
 
     Value Builtins::mathAbs(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_abs expects one number");
         }
-        return Value(std::abs(std::get<double>(args[0])));
+        return Value(std::abs(args[0].asDouble()));
     }
 
     Value Builtins::mathFloor(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_floor expects one number");
         }
-        return Value(std::floor(std::get<double>(args[0])));
+        return Value(std::floor(args[0].asDouble()));
     }
 
     Value Builtins::mathCeil(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_ceil expects one number");
         }
-        return Value(std::ceil(std::get<double>(args[0])));
+        return Value(std::ceil(args[0].asDouble()));
     }
 
     Value Builtins::mathRound(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("math_round expects one number");
         }
-        return Value(std::round(std::get<double>(args[0])));
+        return Value(std::round(args[0].asDouble()));
     }
 
-    Value Builtins::mathRandom(const std::vector<Value>& args) {
+    Value Builtins::mathRandom(const std::vector<Value>&) {
         static std::random_device rd;
         static std::mt19937 gen(rd());
         static std::uniform_real_distribution<> dis(0.0, 1.0);
@@ -306,41 +327,40 @@ namespace interpreter {
     }
 
     Value Builtins::arrayLength(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::vector<Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isArray()) {
             throw std::runtime_error("array_length expects one array");
         }
-        return Value(static_cast<int64_t>(std::get<std::vector<Value>>(args[0]).size()));
+        return Value(static_cast<int64_t>(args[0].asArray().size()));
     }
 
     Value Builtins::arrayPush(const std::vector<Value>& args) {
-        if (args.size() < 2 || !std::holds_alternative<std::vector<Value>>(args[0])) {
+        if (args.size() < 2 || !args[0].isArray()) {
             throw std::runtime_error("array_push expects array and at least one value");
         }
-        std::vector<Value> arr = std::get<std::vector<Value>>(args[0]);
+        Value result = args[0];
+        Array& arr = result.mutableArray();
         for (size_t i = 1; i < args.size(); ++i) {
             arr.push_back(args[i]);
         }
-        return Value(arr);
+        return result;
     }
 
     Value Builtins::arrayPop(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::vector<Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isArray()) {
             throw std::runtime_error("array_pop expects one array");
         }
-        std::vector<Value> arr = std::get<std::vector<Value>>(args[0]);
+        const Array& arr = args[0].asArray();
         if (arr.empty()) {
             throw std::runtime_error("Cannot pop from empty array");
         }
-        Value result = arr.back();
-        arr.pop_back();
-        return result;
+        return arr.back();
     }
 
     Value Builtins::dictKeys(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isDict()) {
             throw std::runtime_error("dict_keys expects one dictionary");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
+        const Dict& dict = args[0].asDict();
         std::vector<Value> keys;
         for (const auto& pair : dict) {
             keys.push_back(Value(pair.first));
@@ -349,10 +369,10 @@ namespace interpreter {
     }
 
     Value Builtins::dictValues(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isDict()) {
             throw std::runtime_error("dict_values expects one dictionary");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
+        const Dict& dict = args[0].asDict();
         std::vector<Value> values;
         for (const auto& pair : dict) {
             values.push_back(pair.second);
@@ -361,103 +381,100 @@ namespace interpreter {
     }
 
     Value Builtins::dictHasKey(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0]) || 
-            !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isDict() || 
+            !args[1].isString()) {
             throw std::runtime_error("dict_has_key expects dictionary and key");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
-        std::string key = std::get<std::string>(args[1]);
-        return Value(dict.find(key) != dict.end());
+        const Dict& dict = args[0].asDict();
+        const std::string& key = args[1].asString();
+        return Value(dict.find(key) != nullptr);
     }
 
     Value Builtins::dictGet(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0]) || 
-            !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isDict() || 
+            !args[1].isString()) {
             throw std::runtime_error("dict_get expects dictionary and key");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
-        std::string key = std::get<std::string>(args[1]);
-        auto it = dict.find(key);
-        return it != dict.end() ? it->second : Value();
+        const Dict& dict = args[0].asDict();
+        const std::string& key = args[1].asString();
+        const Value* value = dict.find(key);
+        return value ? *value : Value();
     }
 
     Value Builtins::dictSet(const std::vector<Value>& args) {
-        if (args.size() != 3 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0]) || 
-            !std::holds_alternative<std::string>(args[1]) || !std::holds_alternative<Value>(args[2])) {
+        if (args.size() != 3 || !args[0].isDict() || 
+            !args[1].isString()) {
             throw std::runtime_error("dict_set expects dictionary, key, and value");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
-        std::string key = std::get<std::string>(args[1]);
-        Value value = std::get<Value>(args[2]);
-        dict[key] = value;
-        return Value();
+        Value result = args[0];
+        result.mutableDict()[args[1].asString()] = args[2];
+        return result;
     }
 
     Value Builtins::dictDelete(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0]) || 
-            !std::holds_alternative<std::string>(args[1])) {
+        if (args.size() != 2 || !args[0].isDict() || 
+            !args[1].isString()) {
             throw std::runtime_error("dict_delete expects dictionary and key");
         }
-        auto dict = std::get<std::unordered_map<std::string, Value>>(args[0]);
-        std::string key = std::get<std::string>(args[1]);
-        dict.erase(key);
-        return Value();
+        Value result = args[0];
+        result.mutableDict().erase(args[1].asString());
+        return result;
     }
 
     Value Builtins::dictMerge(const std::vector<Value>& args) {
-        if (args.size() != 2 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0]) || 
-            !std::holds_alternative<std::unordered_map<std::string, Value>>(args[1])) {
+        if (args.size() != 2 || !args[0].isDict() || 
+            !args[1].isDict()) {
             throw std::runtime_error("dict_merge expects two dictionaries");
         }
-        auto dict1 = std::get<std::unordered_map<std::string, Value>>(args[0]);
-        auto dict2 = std::get<std::unordered_map<std::string, Value>>(args[1]);
-        for (const auto& pair : dict2) {
-            dict1[pair.first] = pair.second;
+        Value result = args[0];
+        Dict& merged = result.mutableDict();
+        for (const auto& pair : args[1].asDict()) {
+            merged[pair.first] = pair.second;
         }
-        return Value();
+        return result;
     }
 
-    Value Builtins::timeNow(const std::vector<Value>& args) {
+    Value Builtins::timeNow(const std::vector<Value>&) {
         auto now = std::chrono::system_clock::now();
         auto duration = now.time_since_epoch();
         return Value(static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()) / 1000.0);
     }
 
     Value Builtins::timeSleep(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<double>(args[0])) {
+        if (args.size() != 1 || !args[0].isDouble()) {
             throw std::runtime_error("time_sleep expects one number");
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(
-            static_cast<long>(std::get<double>(args[0]) * 1000)));
+            static_cast<long>(args[0].asDouble() * 1000)));
         return Value();
     }
 
     Value Builtins::systemExit(const std::vector<Value>& args) {
         int exitCode = 0;
-        if (args.size() > 0 && std::holds_alternative<int64_t>(args[0])) {
-            exitCode = static_cast<int>(std::get<int64_t>(args[0]));
+        if (args.size() > 0 && args[0].isInt()) {
+            exitCode = static_cast<int>(args[0].asInt());
         }
         std::exit(exitCode);
         return Value();
     }
 
     Value Builtins::systemEnv(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("system_env expects one string");
         }
-        const char* value = std::getenv(std::get<std::string>(args[0]).c_str());
+        const char* value = std::getenv(args[0].asString().c_str());
         return value ? Value(std::string(value)) : Value();
     }
 
-    Value Builtins::systemCwd(const std::vector<Value>& args) {
+    Value Builtins::systemCwd(const std::vector<Value>&) {
         return Value(std::filesystem::current_path().string());
     }
 
     Value Builtins::systemExec(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::string>(args[0])) {
+        if (args.size() != 1 || !args[0].isString()) {
             throw std::runtime_error("system_exec expects one string");
         }
-        std::string command = std::get<std::string>(args[0]);
+        const std::string& command = args[0].asString();
         std::array<char, 128> buffer;
         std::string result;
         std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(command.c_str(), "r"), pclose);
@@ -474,15 +491,15 @@ namespace interpreter {
         if (args.size() != 1) {
             throw std::runtime_error("to_int expects one argument");
         }
-        if (std::holds_alternative<int64_t>(args[0])) {
+        if (args[0].isInt()) {
             return args[0];
         }
-        if (std::holds_alternative<double>(args[0])) {
-            return Value(static_cast<int64_t>(std::get<double>(args[0])));
+        if (args[0].isDouble()) {
+            return Value(static_cast<int64_t>(args[0].asDouble()));
         }
-        if (std::holds_alternative<std::string>(args[0])) {
+        if (args[0].isString()) {
             try {
-                return Value(std::stoll(std::get<std::string>(args[0])));
+                return Value(static_cast<int64_t>(std::stoll(args[0].asString())));
             } catch (...) {
                 throw std::runtime_error("Cannot convert string to integer");
             }
@@ -494,15 +511,15 @@ namespace interpreter {
         if (args.size() != 1) {
             throw std::runtime_error("to_float expects one argument");
         }
-        if (std::holds_alternative<double>(args[0])) {
+        if (args[0].isDouble()) {
             return args[0];
         }
-        if (std::holds_alternative<int64_t>(args[0])) {
-            return Value(static_cast<double>(std::get<int64_t>(args[0])));
+        if (args[0].isInt()) {
+            return Value(static_cast<double>(args[0].asInt()));
         }
-        if (std::holds_alternative<std::string>(args[0])) {
+        if (args[0].isString()) {
             try {
-                return Value(std::stod(std::get<std::string>(args[0])));
+                return Value(std::stod(args[0].asString()));
             } catch (...) {
                 throw std::runtime_error("Cannot convert string to float");
             }
@@ -514,39 +531,37 @@ namespace interpreter {
         if (args.size() != 1) {
             throw std::runtime_error("to_string expects one argument");
         }
-        std::stringstream ss;
-        std::visit([&ss](const auto& v) { ss << v; }, args[0]);
-        return Value(ss.str());
+        return Value(stringify(args[0]));
     }
 
     Value Builtins::toBool(const std::vector<Value>& args) {
         if (args.size() != 1) {
             throw std::runtime_error("to_bool expects one argument");
         }
-        if (std::holds_alternative<bool>(args[0])) {
+        if (args[0].isBool()) {
             return args[0];
         }
-        if (std::holds_alternative<int64_t>(args[0])) {
-            return Value(std::get<int64_t>(args[0]) != 0);
+        if (args[0].isInt()) {
+            return Value(args[0].asInt() != 0);
         }
-        if (std::holds_alternative<double>(args[0])) {
-            return Value(std::get<double>(args[0]) != 0.0);
+        if (args[0].isDouble()) {
+            return Value(args[0].asDouble() != 0.0);
         }
-        if (std::holds_alternative<std::string>(args[0])) {
-            return Value(!std::get<std::string>(args[0]).empty());
+        if (args[0].isString()) {
+            return Value(!args[0].asString().empty());
         }
         return Value(false);
     }
 
     Value Builtins::toArray(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::vector<Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isArray()) {
             throw std::runtime_error("to_array expects one array");
         }
         return args[0];
     }
 
     Value Builtins::toDict(const std::vector<Value>& args) {
-        if (args.size() != 1 || !std::holds_alternative<std::unordered_map<std::string, Value>>(args[0])) {
+        if (args.size() != 1 || !args[0].isDict()) {
             throw std::runtime_error("to_dict expects one dictionary");
         }
         return args[0];
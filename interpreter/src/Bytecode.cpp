@@ -0,0 +1,78 @@
+#include "Bytecode.h"
+#include <iomanip>
+#include <sstream>
+
+namespace interpreter {
+
+    const char* opcodeName(Opcode op) {
+        static const char* const names[] = {
+#define TOCIN_OPCODE_NAME(name) #name,
+            TOCIN_OPCODES(TOCIN_OPCODE_NAME)
+#undef TOCIN_OPCODE_NAME
+        };
+        auto index = static_cast<size_t>(op);
+        return index < static_cast<size_t>(Opcode::COUNT) ? names[index] : "???";
+    }
+
+    namespace {
+
+        bool usesConstant(Opcode op) {
+            return op == Opcode::LOADK || op == Opcode::CLOSURE;
+        }
+
+        bool usesGlobal(Opcode op) {
+            return op == Opcode::GETGLOBAL || op == Opcode::SETGLOBAL || op == Opcode::DEFGLOBAL;
+        }
+
+        bool isJump(Opcode op) {
+            return op == Opcode::JMP || op == Opcode::JMPIF || op == Opcode::JMPIFNOT ||
+                   op == Opcode::FORITER;
+        }
+
+        void disassembleInto(const Chunk& chunk, std::ostringstream& out) {
+            out << "function " << chunk.name << " (arity " << chunk.arity << ", "
+                << chunk.numRegisters << " registers, " << chunk.envSize << " captured, "
+                << chunk.code.size() << " instructions" << (chunk.isClosure ? ", closure" : "")
+                << (chunk.memoize ? ", memoized" : "") << ")\n";
+
+            for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+                Instruction i = chunk.code[pc];
+                Opcode op = opcodeOf(i);
+                out << std::setw(5) << pc << "  [" << std::setw(4) << chunk.lines[pc] << "]  "
+                    << std::left << std::setw(11) << opcodeName(op) << std::right;
+
+                if (isJump(op)) {
+                    out << argA(i) << " -> " << static_cast<long>(pc) + 1 + argSBx(i);
+                } else if (op == Opcode::LOADINT) {
+                    out << argA(i) << " " << argSBx(i);
+                } else if (usesConstant(op)) {
+                    out << argA(i) << " K" << argBx(i) << "  ; " << stringify(chunk.constants[argBx(i)]);
+                } else if (op == Opcode::GETFIELD || op == Opcode::SETFIELD) {
+                    int cache = op == Opcode::GETFIELD ? argC(i) : argB(i);
+                    out << argA(i) << " " << argB(i) << " " << argC(i) << "  ; ."
+                        << chunk.fieldCaches[cache].key.asString();
+                } else if (usesGlobal(op)) {
+                    out << argA(i) << " G" << argBx(i);
+                } else {
+                    out << argA(i) << " " << argB(i) << " " << argC(i);
+                }
+                out << "\n";
+            }
+
+            for (const auto& constant : chunk.constants) {
+                if (constant.isFunction()) {
+                    out << "\n";
+                    disassembleInto(constant.asFunction()->getChunk(), out);
+                }
+            }
+        }
+
+    } // namespace
+
+    std::string disassemble(const Chunk& chunk) {
+        std::ostringstream out;
+        disassembleInto(chunk, out);
+        return out.str();
+    }
+
+} // namespace interpreter
@@ -0,0 +1,919 @@
+#include "BytecodeCompiler.h"
+#include "Operators.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace interpreter {
+
+    BytecodeCompiler::BytecodeCompiler(const NativeTable& natives, GlobalTable& globals)
+        : natives(natives), globals(globals) {}
+
+    Value BytecodeCompiler::compile(const ast::StmtPtr& program) {
+        if (!program) {
+            throw std::runtime_error("Nothing to compile");
+        }
+        // Globals may be used before their declaration (functions calling
+        // each other), so they have to be known before any call is compiled
+        collectGlobals(program.get());
+        resolution = Resolver().resolve(program.get());
+        return compileFunction("<script>", {}, program.get(), nullptr, program.get());
+    }
+
+    void BytecodeCompiler::collectGlobals(ast::Statement* stmt) {
+        if (auto* block = dynamic_cast<ast::BlockStmt*>(stmt)) {
+            for (const auto& child : block->statements) {
+                if (child) {
+                    collectGlobals(child.get());
+                }
+            }
+        } else if (auto* var = dynamic_cast<ast::VariableStmt*>(stmt)) {
+            declaredGlobals.insert(var->name);
+        } else if (auto* function = dynamic_cast<ast::FunctionStmt*>(stmt)) {
+            declaredGlobals.insert(function->name);
+        } else if (auto* exported = dynamic_cast<ast::ExportStmt*>(stmt)) {
+            if (exported->declaration) {
+                collectGlobals(exported->declaration.get());
+            }
+        }
+    }
+
+    Value BytecodeCompiler::compileFunction(
+        const std::string& name, const std::vector<ast::Parameter>& params,
+        ast::Statement* body, ast::Expression* bodyExpr, const void* node, bool memoize) {
+        FunctionState state;
+        state.enclosing = current;
+        state.chunk = std::make_shared<Chunk>();
+        state.chunk->name = name;
+        state.chunk->arity = static_cast<int>(params.size());
+        state.chunk->memoize = memoize;
+        state.hasEnv = resolution.functionsWithEnv.count(node) > 0;
+        current = &state;
+
+        std::vector<std::string> paramNames;
+        try {
+            if (state.enclosing) {
+                // Everything declared in a function body is local to it
+                state.scopeDepth = 1;
+                for (const auto& param : params) {
+                    paramNames.push_back(param.name);
+                    if (!isCaptured(&param)) {
+                        declareLocal(param.name);
+                        continue;
+                    }
+                    // Arguments arrive in registers; a captured one is
+                    // copied into the environment on entry
+                    int reg = declareLocal("(param)");
+                    int slot = declareCaptured(param.name);
+                    emit(encodeABC(Opcode::SETENV, reg, 0, slot));
+                }
+            }
+
+            if (bodyExpr) {
+                int result = expressionAnyReg(bodyExpr);
+                emit(encodeABC(Opcode::RETURN, result, 1, 0));
+            } else {
+                // The outermost block shares the parameters' scope
+                if (auto* block = dynamic_cast<ast::BlockStmt*>(body)) {
+                    for (const auto& stmt : block->statements) {
+                        statement(stmt.get());
+                    }
+                } else {
+                    statement(body);
+                }
+                emit(encodeABC(Opcode::RETURN, 0, 0, 0));
+            }
+        } catch (...) {
+            current = state.enclosing;
+            throw;
+        }
+
+        current = state.enclosing;
+        return Value(new Function(name, paramNames, std::move(state.chunk)));
+    }
+
+    // --- Helpers ---
+
+    void BytecodeCompiler::statement(ast::Statement* stmt) {
+        if (!stmt) {
+            return;
+        }
+        line = stmt->token.line;
+        stmt->accept(*this);
+    }
+
+    void BytecodeCompiler::expression(ast::Expression* expr, int dst) {
+        if (!expr) {
+            emit(encodeABC(Opcode::LOADNIL, dst, 0, 0));
+            return;
+        }
+        int savedTarget = target;
+        target = dst;
+        line = expr->token.line;
+        expr->accept(*this);
+        target = savedTarget;
+    }
+
+    int BytecodeCompiler::expressionAnyReg(ast::Expression* expr) {
+        // A local can be used where it lives instead of being copied
+        if (auto* var = dynamic_cast<ast::VariableExpr*>(expr)) {
+            const Local* local = findLocal(current, var->name);
+            if (local && local->reg >= 0) {
+                return local->reg;
+            }
+        }
+        int reg = allocRegister();
+        expression(expr, reg);
+        return reg;
+    }
+
+    void BytecodeCompiler::assignTo(const std::string& name, ast::Expression* value, int dst) {
+        Variable variable = resolve(name);
+        if (variable.kind == Variable::Kind::Register) {
+            int local = variable.index;
+            // `x = a and x` reads x after the first write to the target,
+            // so short-circuit values go through a temporary
+            auto* binary = dynamic_cast<ast::BinaryExpr*>(value);
+            bool inPlace = !binary || (binary->op.type != lexer::TokenType::AND &&
+                                       binary->op.type != lexer::TokenType::OR);
+            if (inPlace) {
+                expression(value, local);
+            } else {
+                int mark = current->freeReg;
+                int temp = allocRegister();
+                expression(value, temp);
+                emit(encodeABC(Opcode::MOVE, local, temp, 0));
+                freeRegisters(mark);
+            }
+            if (dst >= 0 && dst != local) {
+                emit(encodeABC(Opcode::MOVE, dst, local, 0));
+            }
+            return;
+        }
+
+        int mark = current->freeReg;
+        int reg = dst >= 0 ? dst : allocRegister();
+        expression(value, reg);
+        storeVariable(variable, reg);
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::storeVariable(const Variable& variable, int reg) {
+        switch (variable.kind) {
+            case Variable::Kind::Register:
+                if (variable.index != reg) {
+                    emit(encodeABC(Opcode::MOVE, variable.index, reg, 0));
+                }
+                break;
+            case Variable::Kind::Env:
+                emit(encodeABC(Opcode::SETENV, reg, variable.depth, variable.index));
+                break;
+            case Variable::Kind::Global:
+                emit(encodeABx(Opcode::SETGLOBAL, reg, variable.index));
+                break;
+        }
+    }
+
+    void BytecodeCompiler::emitFunction(int dst, const Value& function) {
+        // Only functions reaching into an enclosing environment need to be
+        // bound to it; the rest stay shared constants
+        bool closure = function.asFunction()->getChunk().isClosure;
+        emit(encodeABx(closure ? Opcode::CLOSURE : Opcode::LOADK, dst, constant(function)));
+    }
+
+    void BytecodeCompiler::beginScope() {
+        current->scopeDepth++;
+    }
+
+    void BytecodeCompiler::endScope() {
+        current->scopeDepth--;
+        auto& locals = current->locals;
+        while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+            locals.pop_back();
+        }
+        // Environment slots are not reused: closures created in the scope
+        // may still refer to them
+        current->freeReg = localRegisterTop();
+    }
+
+    int BytecodeCompiler::declareLocal(const std::string& name) {
+        int reg = allocRegister();
+        current->locals.push_back({name, current->scopeDepth, reg, -1});
+        return reg;
+    }
+
+    int BytecodeCompiler::declareCaptured(const std::string& name) {
+        int slot = current->chunk->envSize++;
+        if (slot >= kMaxRegisters) {
+            unsupported("functions with more than 256 captured variables");
+        }
+        current->locals.push_back({name, current->scopeDepth, -1, slot});
+        return slot;
+    }
+
+    bool BytecodeCompiler::isCaptured(const void* declaration) const {
+        return resolution.captured.count(declaration) > 0;
+    }
+
+    BytecodeCompiler::Variable BytecodeCompiler::resolve(const std::string& name) {
+        int depth = 0;
+        for (FunctionState* state = current; state; state = state->enclosing) {
+            const Local* local = findLocal(state, name);
+            if (!local) {
+                // A frame with an environment of its own is one more step
+                // away from the environment it was created in
+                if (state->hasEnv) {
+                    depth++;
+                }
+                continue;
+            }
+            if (state == current && local->reg >= 0) {
+                return {Variable::Kind::Register, local->reg, 0};
+            }
+            if (local->reg >= 0) {
+                // The resolver marks everything a nested function uses
+                unsupported("capturing '" + name + "' from an enclosing function");
+            }
+            if (depth >= kMaxRegisters) {
+                unsupported("closures nested more than 255 environments deep");
+            }
+            // Every function between the use and the declaration has to be
+            // bound to the environment it was created in
+            for (FunctionState* inner = current; inner != state; inner = inner->enclosing) {
+                inner->chunk->isClosure = true;
+            }
+            return {Variable::Kind::Env, local->slot, depth};
+        }
+        return {Variable::Kind::Global, globalSlot(name), 0};
+    }
+
+    int BytecodeCompiler::globalSlot(const std::string& name) {
+        int slot = globals.slotOf(name);
+        if (slot > kMaxBx) {
+            unsupported("more than 64K globals");
+        }
+        return slot;
+    }
+
+    const BytecodeCompiler::Local* BytecodeCompiler::findLocal(const FunctionState* state,
+                                                               const std::string& name) const {
+        for (auto it = state->locals.rbegin(); it != state->locals.rend(); ++it) {
+            if (it->name == name) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    int BytecodeCompiler::localRegisterTop() const {
+        const auto& locals = current->locals;
+        for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
+            if (it->reg >= 0) {
+                return it->reg + 1;
+            }
+        }
+        return 0;
+    }
+
+    int BytecodeCompiler::allocRegister() {
+        int reg = current->freeReg++;
+        if (reg >= kMaxRegisters) {
+            unsupported("functions needing more than 256 registers");
+        }
+        if (current->freeReg > current->chunk->numRegisters) {
+            current->chunk->numRegisters = current->freeReg;
+        }
+        return reg;
+    }
+
+    void BytecodeCompiler::freeRegisters(int mark) {
+        current->freeReg = mark;
+    }
+
+    int BytecodeCompiler::emit(Instruction instruction) {
+        current->chunk->code.push_back(instruction);
+        current->chunk->lines.push_back(line);
+        return static_cast<int>(current->chunk->code.size()) - 1;
+    }
+
+    int BytecodeCompiler::emitJump(Opcode op, int a) {
+        return emit(encodeABx(op, a, kJumpBias));
+    }
+
+    void BytecodeCompiler::patchJump(int jump) {
+        auto& code = current->chunk->code;
+        int offset = static_cast<int>(code.size()) - (jump + 1);
+        if (offset + kJumpBias > kMaxBx) {
+            unsupported("jumps over more than 32K instructions");
+        }
+        code[jump] = encodeABx(opcodeOf(code[jump]), argA(code[jump]), offset + kJumpBias);
+    }
+
+    void BytecodeCompiler::emitLoop(int loopStart) {
+        int offset = loopStart - (static_cast<int>(current->chunk->code.size()) + 1);
+        if (offset + kJumpBias < 0) {
+            unsupported("loops over more than 32K instructions");
+        }
+        emit(encodeABx(Opcode::JMP, 0, offset + kJumpBias));
+    }
+
+    int BytecodeCompiler::constant(const Value& value) {
+        // Scalars and strings are shared; functions are always distinct
+        std::string key;
+        if (value.isInt()) {
+            key = "i" + std::to_string(value.asInt());
+        } else if (value.isDouble()) {
+            double d = value.asDouble();
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof bits);
+            key = "d" + std::to_string(bits);
+        } else if (value.isString()) {
+            key = "s" + value.asString();
+        }
+        auto& constants = current->chunk->constants;
+        if (!key.empty()) {
+            auto it = current->constantIndex.find(key);
+            if (it != current->constantIndex.end()) {
+                return it->second;
+            }
+        }
+        if (constants.size() > static_cast<size_t>(kMaxBx)) {
+            unsupported("more than 64K constants in one function");
+        }
+        constants.push_back(value);
+        int index = static_cast<int>(constants.size()) - 1;
+        if (!key.empty()) {
+            current->constantIndex[key] = index;
+        }
+        return index;
+    }
+
+    int BytecodeCompiler::nameConstant(const std::string& name) {
+        return constant(Value(name));
+    }
+
+    void BytecodeCompiler::emitConstant(int dst, const Value& value) {
+        if (value.isNil()) {
+            emit(encodeABC(Opcode::LOADNIL, dst, 0, 0));
+        } else if (value.isBool()) {
+            emit(encodeABC(Opcode::LOADBOOL, dst, value.asBool() ? 1 : 0, 0));
+        } else if (value.isSmallInt() && value.asSmallInt() >= -kJumpBias &&
+                   value.asSmallInt() <= kMaxBx - kJumpBias) {
+            emit(encodeABx(Opcode::LOADINT, dst, static_cast<int>(value.asSmallInt()) + kJumpBias));
+        } else {
+            emit(encodeABx(Opcode::LOADK, dst, constant(value)));
+        }
+    }
+
+    Value BytecodeCompiler::literalValue(ast::LiteralExpr* expr) const {
+        switch (expr->literalType) {
+            case ast::LiteralExpr::LiteralType::INTEGER:
+                return Value(static_cast<int64_t>(std::stoll(expr->value)));
+            case ast::LiteralExpr::LiteralType::FLOAT:
+                return Value(std::stod(expr->value));
+            case ast::LiteralExpr::LiteralType::BOOLEAN:
+                return Value(expr->value == "true");
+            case ast::LiteralExpr::LiteralType::STRING:
+                return Value(expr->value);
+            case ast::LiteralExpr::LiteralType::NIL:
+                break;
+        }
+        return Value();
+    }
+
+    bool BytecodeCompiler::foldConstant(ast::Expression* expr, Value& result) {
+        // Only literals and the operators over them are folded. The
+        // operators are the VM's own, and anything that would fail at run
+        // time is left unfolded so the error surfaces when the code runs.
+        if (auto* literal = dynamic_cast<ast::LiteralExpr*>(expr)) {
+            result = literalValue(literal);
+            return true;
+        }
+        if (auto* grouping = dynamic_cast<ast::GroupingExpr*>(expr)) {
+            return foldConstant(grouping->expression.get(), result);
+        }
+        try {
+            if (auto* unary = dynamic_cast<ast::UnaryExpr*>(expr)) {
+                Value operand;
+                if (!foldConstant(unary->right.get(), operand)) {
+                    return false;
+                }
+                switch (unary->op.type) {
+                    case lexer::TokenType::MINUS: result = negate(operand); return true;
+                    case lexer::TokenType::BANG: result = Value(!isTruthy(operand)); return true;
+                    default: return false;
+                }
+            }
+            auto* binary = dynamic_cast<ast::BinaryExpr*>(expr);
+            Value left, right;
+            if (!binary || !foldConstant(binary->left.get(), left) ||
+                !foldConstant(binary->right.get(), right)) {
+                return false;
+            }
+            switch (binary->op.type) {
+                case lexer::TokenType::AND: result = isTruthy(left) ? right : left; return true;
+                case lexer::TokenType::OR: result = isTruthy(left) ? left : right; return true;
+                case lexer::TokenType::PLUS: result = arithmetic(Opcode::ADD, left, right); return true;
+                case lexer::TokenType::MINUS: result = arithmetic(Opcode::SUB, left, right); return true;
+                case lexer::TokenType::STAR: result = arithmetic(Opcode::MUL, left, right); return true;
+                case lexer::TokenType::SLASH: result = arithmetic(Opcode::DIV, left, right); return true;
+                case lexer::TokenType::PERCENT: result = arithmetic(Opcode::MOD, left, right); return true;
+                case lexer::TokenType::EQUAL_EQUAL: result = Value(valuesEqual(left, right)); return true;
+                case lexer::TokenType::BANG_EQUAL:
+                case lexer::TokenType::NOT_EQUAL: result = Value(!valuesEqual(left, right)); return true;
+                case lexer::TokenType::LESS: result = Value(lessThan(left, right, false)); return true;
+                case lexer::TokenType::LESS_EQUAL: result = Value(lessThan(left, right, true)); return true;
+                case lexer::TokenType::GREATER: result = Value(lessThan(right, left, false)); return true;
+                case lexer::TokenType::GREATER_EQUAL: result = Value(lessThan(right, left, true)); return true;
+                default: return false;
+            }
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+    }
+
+    int BytecodeCompiler::fieldCache(const std::string& name) {
+        // Every site gets its own cache; past what an operand can address,
+        // sites fall back to an uncached GETINDEX/SETINDEX
+        auto& caches = current->chunk->fieldCaches;
+        if (caches.size() >= static_cast<size_t>(kMaxRegisters)) {
+            return -1;
+        }
+        caches.emplace_back(name);
+        return static_cast<int>(caches.size()) - 1;
+    }
+
+    void BytecodeCompiler::unsupported(const std::string& what) const {
+        throw std::runtime_error("line " + std::to_string(line) + ": " + what +
+                                 " is not supported by the bytecode VM");
+    }
+
+    // --- Expressions ---
+
+    void BytecodeCompiler::visitBinaryExpr(ast::BinaryExpr* expr) {
+        int dst = target;
+        auto op = expr->op.type;
+
+        Value folded;
+        if (foldConstant(expr, folded)) {
+            emitConstant(dst, folded);
+            return;
+        }
+
+        if (op == lexer::TokenType::AND || op == lexer::TokenType::OR) {
+            expression(expr->left.get(), dst);
+            int skip = emitJump(op == lexer::TokenType::AND ? Opcode::JMPIFNOT : Opcode::JMPIF, dst);
+            expression(expr->right.get(), dst);
+            patchJump(skip);
+            return;
+        }
+
+        Opcode opcode;
+        bool swap = false;
+        switch (op) {
+            case lexer::TokenType::PLUS: opcode = Opcode::ADD; break;
+            case lexer::TokenType::MINUS: opcode = Opcode::SUB; break;
+            case lexer::TokenType::STAR: opcode = Opcode::MUL; break;
+            case lexer::TokenType::SLASH: opcode = Opcode::DIV; break;
+            case lexer::TokenType::PERCENT: opcode = Opcode::MOD; break;
+            case lexer::TokenType::EQUAL_EQUAL: opcode = Opcode::EQ; break;
+            case lexer::TokenType::BANG_EQUAL:
+            case lexer::TokenType::NOT_EQUAL: opcode = Opcode::NE; break;
+            case lexer::TokenType::LESS: opcode = Opcode::LT; break;
+            case lexer::TokenType::LESS_EQUAL: opcode = Opcode::LE; break;
+            case lexer::TokenType::GREATER: opcode = Opcode::LT; swap = true; break;
+            case lexer::TokenType::GREATER_EQUAL: opcode = Opcode::LE; swap = true; break;
+            default: unsupported("operator '" + expr->op.value + "'");
+        }
+
+        int mark = current->freeReg;
+        int left = expressionAnyReg(expr->left.get());
+        int right = expressionAnyReg(expr->right.get());
+        if (swap) {
+            std::swap(left, right);
+        }
+        emit(encodeABC(opcode, dst, left, right));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitGroupingExpr(ast::GroupingExpr* expr) {
+        expression(expr->expression.get(), target);
+    }
+
+    void BytecodeCompiler::visitLiteralExpr(ast::LiteralExpr* expr) {
+        emitConstant(target, literalValue(expr));
+    }
+
+    void BytecodeCompiler::visitUnaryExpr(ast::UnaryExpr* expr) {
+        int dst = target;
+        Value folded;
+        if (foldConstant(expr, folded)) {
+            emitConstant(dst, folded);
+            return;
+        }
+        Opcode opcode;
+        switch (expr->op.type) {
+            case lexer::TokenType::MINUS: opcode = Opcode::NEG; break;
+            case lexer::TokenType::BANG: opcode = Opcode::NOT; break;
+            default: unsupported("unary operator '" + expr->op.value + "'");
+        }
+        int mark = current->freeReg;
+        int operand = expressionAnyReg(expr->right.get());
+        emit(encodeABC(opcode, dst, operand, 0));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitVariableExpr(ast::VariableExpr* expr) {
+        int dst = target;
+        Variable variable = resolve(expr->name);
+        switch (variable.kind) {
+            case Variable::Kind::Register:
+                if (variable.index != dst) {
+                    emit(encodeABC(Opcode::MOVE, dst, variable.index, 0));
+                }
+                break;
+            case Variable::Kind::Env:
+                emit(encodeABC(Opcode::GETENV, dst, variable.depth, variable.index));
+                break;
+            case Variable::Kind::Global:
+                emit(encodeABx(Opcode::GETGLOBAL, dst, variable.index));
+                break;
+        }
+    }
+
+    void BytecodeCompiler::visitAssignExpr(ast::AssignExpr* expr) {
+        int dst = target;
+        if (expr->isVariableAssignment()) {
+            assignTo(expr->name, expr->value.get(), dst);
+            return;
+        }
+        if (auto* var = dynamic_cast<ast::VariableExpr*>(expr->target.get())) {
+            assignTo(var->name, expr->value.get(), dst);
+            return;
+        }
+        if (auto* get = dynamic_cast<ast::GetExpr*>(expr->target.get())) {
+            ast::SetExpr set(expr->token, get->object, get->name, expr->value);
+            target = dst;
+            visitSetExpr(&set);
+            return;
+        }
+        unsupported("this assignment target");
+    }
+
+    void BytecodeCompiler::visitCallExpr(ast::CallExpr* expr) {
+        int dst = target;
+        if (expr->arguments.size() >= static_cast<size_t>(kMaxRegisters)) {
+            unsupported("calls with more than 255 arguments");
+        }
+        int nargs = static_cast<int>(expr->arguments.size());
+        int mark = current->freeReg;
+
+        // Builtins that no global shadows are called directly by index
+        int native = -1;
+        if (auto* var = dynamic_cast<ast::VariableExpr*>(expr->callee.get())) {
+            bool shadowed = declaredGlobals.count(var->name) ||
+                            resolve(var->name).kind != Variable::Kind::Global;
+            if (!shadowed) {
+                native = natives.indexOf(var->name);
+            }
+        }
+
+        // When the target is the topmost temporary the call can be laid out
+        // from it directly and no result move is needed. A local target is
+        // excluded: the arguments may still read it.
+        bool inPlace = dst == current->freeReg - 1 && dst >= localRegisterTop();
+        if (native >= 0 && native < kMaxRegisters) {
+            int base = inPlace ? dst : current->freeReg;
+            for (int i = 0; i < nargs; ++i) {
+                int reg = (inPlace && i == 0) ? dst : allocRegister();
+                expression(expr->arguments[i].get(), reg);
+            }
+            emit(encodeABC(Opcode::CALLNATIVE, base, nargs, native));
+            if (base != dst) {
+                emit(encodeABC(Opcode::MOVE, dst, base, 0));
+            }
+            freeRegisters(mark);
+            return;
+        }
+
+        int base = inPlace ? dst : allocRegister();
+        expression(expr->callee.get(), base);
+        for (int i = 0; i < nargs; ++i) {
+            expression(expr->arguments[i].get(), allocRegister());
+        }
+        emit(encodeABC(Opcode::CALL, base, nargs, 0));
+        if (base != dst) {
+            emit(encodeABC(Opcode::MOVE, dst, base, 0));
+        }
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitGetExpr(ast::GetExpr* expr) {
+        int dst = target;
+        int mark = current->freeReg;
+        int object = expressionAnyReg(expr->object.get());
+        int cache = fieldCache(expr->name);
+        if (cache >= 0) {
+            emit(encodeABC(Opcode::GETFIELD, dst, object, cache));
+        } else {
+            int key = allocRegister();
+            emit(encodeABx(Opcode::LOADK, key, nameConstant(expr->name)));
+            emit(encodeABC(Opcode::GETINDEX, dst, object, key));
+        }
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitSetExpr(ast::SetExpr* expr) {
+        int dst = target;
+        int mark = current->freeReg;
+        int object = expressionAnyReg(expr->object.get());
+        int cache = fieldCache(expr->name);
+        if (cache >= 0) {
+            expression(expr->value.get(), dst);
+            emit(encodeABC(Opcode::SETFIELD, object, cache, dst));
+        } else {
+            int key = allocRegister();
+            emit(encodeABx(Opcode::LOADK, key, nameConstant(expr->name)));
+            expression(expr->value.get(), dst);
+            emit(encodeABC(Opcode::SETINDEX, object, key, dst));
+        }
+        // Containers are values: a global or captured variable was copied
+        // into a register, so the updated copy has to be stored back
+        if (auto* var = dynamic_cast<ast::VariableExpr*>(expr->object.get())) {
+            Variable variable = resolve(var->name);
+            if (variable.kind != Variable::Kind::Register) {
+                storeVariable(variable, object);
+            }
+        }
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitListExpr(ast::ListExpr* expr) {
+        int dst = target;
+        if (expr->elements.size() >= static_cast<size_t>(kMaxRegisters)) {
+            unsupported("list literals with more than 255 elements");
+        }
+        int mark = current->freeReg;
+        int base = current->freeReg;
+        for (const auto& element : expr->elements) {
+            expression(element.get(), allocRegister());
+        }
+        emit(encodeABC(Opcode::NEWARRAY, dst, base, static_cast<int>(expr->elements.size())));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitArrayLiteralExpr(ast::ArrayLiteralExpr* expr) {
+        ast::ListExpr list(expr->token, expr->elements);
+        visitListExpr(&list);
+    }
+
+    void BytecodeCompiler::visitDictionaryExpr(ast::DictionaryExpr* expr) {
+        int dst = target;
+        if (expr->entries.size() * 2 >= static_cast<size_t>(kMaxRegisters)) {
+            unsupported("dictionary literals with more than 127 entries");
+        }
+        int mark = current->freeReg;
+        int base = current->freeReg;
+        for (const auto& entry : expr->entries) {
+            expression(entry.first.get(), allocRegister());
+            expression(entry.second.get(), allocRegister());
+        }
+        emit(encodeABC(Opcode::NEWDICT, dst, base, static_cast<int>(expr->entries.size())));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitLambdaExpr(ast::LambdaExpr* expr) {
+        int dst = target;
+        auto function = compileFunction("<lambda>", expr->parameters, nullptr, expr->body.get(), expr);
+        emitFunction(dst, function);
+    }
+
+    void BytecodeCompiler::visitStringInterpolationExpr(ast::StringInterpolationExpr* expr) {
+        int dst = target;
+        const auto& parts = expr->getTextParts();
+        const auto& values = expr->getExpressions();
+        int mark = current->freeReg;
+        int base = current->freeReg;
+        for (size_t i = 0; i < parts.size() || i < values.size(); ++i) {
+            if (i < parts.size() && !parts[i].empty()) {
+                emit(encodeABx(Opcode::LOADK, allocRegister(), constant(Value(parts[i]))));
+            }
+            if (i < values.size()) {
+                expression(values[i].get(), allocRegister());
+            }
+        }
+        emit(encodeABC(Opcode::CONCAT, dst, base, current->freeReg - base));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitAwaitExpr(ast::AwaitExpr*) { unsupported("await"); }
+    void BytecodeCompiler::visitNewExpr(ast::NewExpr*) { unsupported("new"); }
+    void BytecodeCompiler::visitDeleteExpr(ast::DeleteExpr*) { unsupported("delete"); }
+    void BytecodeCompiler::visitChannelSendExpr(ast::ChannelSendExpr*) { unsupported("channel send"); }
+    void BytecodeCompiler::visitChannelReceiveExpr(ast::ChannelReceiveExpr*) { unsupported("channel receive"); }
+    void BytecodeCompiler::visitMoveExpr(void*) { unsupported("move"); }
+    void BytecodeCompiler::visitGoExpr(void*) { unsupported("go"); }
+    void BytecodeCompiler::visitRuntimeChannelSendExpr(void*) { unsupported("channel send"); }
+    void BytecodeCompiler::visitRuntimeChannelReceiveExpr(void*) { unsupported("channel receive"); }
+
+    // --- Statements ---
+
+    void BytecodeCompiler::visitExpressionStmt(ast::ExpressionStmt* stmt) {
+        // Assignments need no result register
+        if (auto* assign = dynamic_cast<ast::AssignExpr*>(stmt->expression.get())) {
+            if (assign->isVariableAssignment()) {
+                assignTo(assign->name, assign->value.get(), -1);
+                return;
+            }
+        }
+        int mark = current->freeReg;
+        expression(stmt->expression.get(), allocRegister());
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitVariableStmt(ast::VariableStmt* stmt) {
+        if (!current->enclosing && current->scopeDepth == 0) {
+            int mark = current->freeReg;
+            int reg = allocRegister();
+            expression(stmt->initializer.get(), reg);
+            emit(encodeABx(Opcode::DEFGLOBAL, reg, globalSlot(stmt->name)));
+            freeRegisters(mark);
+            return;
+        }
+        // Evaluate before declaring so `let x = x` reads the outer x
+        if (isCaptured(stmt)) {
+            int mark = current->freeReg;
+            int reg = allocRegister();
+            expression(stmt->initializer.get(), reg);
+            freeRegisters(mark);
+            emit(encodeABC(Opcode::SETENV, reg, 0, declareCaptured(stmt->name)));
+            return;
+        }
+        int reg = allocRegister();
+        expression(stmt->initializer.get(), reg);
+        current->locals.push_back({stmt->name, current->scopeDepth, reg, -1});
+    }
+
+    void BytecodeCompiler::visitBlockStmt(ast::BlockStmt* stmt) {
+        beginScope();
+        for (const auto& child : stmt->statements) {
+            statement(child.get());
+        }
+        endScope();
+    }
+
+    void BytecodeCompiler::visitIfStmt(ast::IfStmt* stmt) {
+        std::vector<int> exits;
+        auto branch = [&](ast::Expression* condition, ast::Statement* body, bool last) {
+            int mark = current->freeReg;
+            int cond = expressionAnyReg(condition);
+            int skip = emitJump(Opcode::JMPIFNOT, cond);
+            freeRegisters(mark);
+            statement(body);
+            if (!last) {
+                exits.push_back(emitJump(Opcode::JMP, 0));
+            }
+            patchJump(skip);
+        };
+
+        bool hasMore = !stmt->elifBranches.empty() || stmt->elseBranch;
+        branch(stmt->condition.get(), stmt->thenBranch.get(), !hasMore);
+        for (size_t i = 0; i < stmt->elifBranches.size(); ++i) {
+            bool last = i + 1 == stmt->elifBranches.size() && !stmt->elseBranch;
+            branch(stmt->elifBranches[i].first.get(), stmt->elifBranches[i].second.get(), last);
+        }
+        if (stmt->elseBranch) {
+            statement(stmt->elseBranch.get());
+        }
+        for (int exit : exits) {
+            patchJump(exit);
+        }
+    }
+
+    void BytecodeCompiler::visitWhileStmt(ast::WhileStmt* stmt) {
+        int loopStart = static_cast<int>(current->chunk->code.size());
+        int mark = current->freeReg;
+        int cond = expressionAnyReg(stmt->condition.get());
+        int exit = emitJump(Opcode::JMPIFNOT, cond);
+        freeRegisters(mark);
+        statement(stmt->body.get());
+        emitLoop(loopStart);
+        patchJump(exit);
+    }
+
+    void BytecodeCompiler::visitForStmt(ast::ForStmt* stmt) {
+        beginScope();
+        // FORITER expects iterable, index and loop variable in consecutive
+        // registers; the first two are hidden locals
+        int iterable = allocRegister();
+        expression(stmt->iterable.get(), iterable);
+        current->locals.push_back({"(for iterable)", current->scopeDepth, iterable, -1});
+        int index = declareLocal("(for index)");
+        emit(encodeABx(Opcode::LOADINT, index, kJumpBias));
+        // FORITER needs the loop variable in a register; a captured one is
+        // copied into its environment slot at the top of every iteration
+        bool captured = isCaptured(stmt);
+        int element = declareLocal(captured ? "(for element)" : stmt->variable);
+        int slot = captured ? declareCaptured(stmt->variable) : -1;
+
+        int loopStart = static_cast<int>(current->chunk->code.size());
+        int exit = emitJump(Opcode::FORITER, iterable);
+        if (captured) {
+            emit(encodeABC(Opcode::SETENV, element, 0, slot));
+        }
+        statement(stmt->body.get());
+        emitLoop(loopStart);
+        patchJump(exit);
+        endScope();
+    }
+
+    void BytecodeCompiler::visitFunctionStmt(ast::FunctionStmt* stmt) {
+        bool memoize = isMemoized(stmt);
+        if (!current->enclosing && current->scopeDepth == 0) {
+            auto function = compileFunction(stmt->name, stmt->parameters, stmt->body.get(), nullptr, stmt, memoize);
+            int mark = current->freeReg;
+            int reg = allocRegister();
+            emitFunction(reg, function);
+            emit(encodeABx(Opcode::DEFGLOBAL, reg, globalSlot(stmt->name)));
+            freeRegisters(mark);
+            return;
+        }
+        // Declared before the body is compiled so the function can call itself
+        if (isCaptured(stmt)) {
+            int slot = declareCaptured(stmt->name);
+            auto function = compileFunction(stmt->name, stmt->parameters, stmt->body.get(), nullptr, stmt, memoize);
+            int mark = current->freeReg;
+            int reg = allocRegister();
+            emitFunction(reg, function);
+            emit(encodeABC(Opcode::SETENV, reg, 0, slot));
+            freeRegisters(mark);
+            return;
+        }
+        int reg = declareLocal(stmt->name);
+        auto function = compileFunction(stmt->name, stmt->parameters, stmt->body.get(), nullptr, stmt, memoize);
+        emitFunction(reg, function);
+    }
+
+    bool BytecodeCompiler::isMemoized(ast::FunctionStmt* stmt) const {
+        // @memoize is the caller's promise that the function is pure: its
+        // result depends only on its arguments and it has no side effects
+        for (const auto& decorator : stmt->decorators) {
+            if (decorator != "memoize") {
+                unsupported("decorator '@" + decorator + "'");
+            }
+        }
+        return !stmt->decorators.empty();
+    }
+
+    void BytecodeCompiler::visitReturnStmt(ast::ReturnStmt* stmt) {
+        if (!stmt->value) {
+            emit(encodeABC(Opcode::RETURN, 0, 0, 0));
+            return;
+        }
+        int mark = current->freeReg;
+        int value = expressionAnyReg(stmt->value.get());
+        emit(encodeABC(Opcode::RETURN, value, 1, 0));
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitMatchStmt(ast::MatchStmt* stmt) {
+        int mark = current->freeReg;
+        int value = expressionAnyReg(stmt->value.get());
+        int caseMark = current->freeReg;
+        std::vector<int> exits;
+        for (const auto& matchCase : stmt->cases) {
+            int test = allocRegister();
+            int pattern = expressionAnyReg(matchCase.first.get());
+            emit(encodeABC(Opcode::EQ, test, value, pattern));
+            int skip = emitJump(Opcode::JMPIFNOT, test);
+            freeRegisters(caseMark);
+            statement(matchCase.second.get());
+            exits.push_back(emitJump(Opcode::JMP, 0));
+            patchJump(skip);
+        }
+        if (stmt->defaultCase) {
+            statement(stmt->defaultCase.get());
+        }
+        for (int exit : exits) {
+            patchJump(exit);
+        }
+        freeRegisters(mark);
+    }
+
+    void BytecodeCompiler::visitExportStmt(ast::ExportStmt* stmt) {
+        // Modules are not implemented yet; an exported declaration is
+        // still a declaration
+        if (stmt->declaration) {
+            statement(stmt->declaration.get());
+        }
+    }
+
+    void BytecodeCompiler::visitClassStmt(ast::ClassStmt*) { unsupported("classes"); }
+    void BytecodeCompiler::visitImportStmt(ast::ImportStmt*) { unsupported("import"); }
+    void BytecodeCompiler::visitModuleStmt(ast::ModuleStmt*) { unsupported("modules"); }
+    void BytecodeCompiler::visitSelectStmt(ast::SelectStmt*) { unsupported("select"); }
+    void BytecodeCompiler::visitGoStmt(ast::GoStmt*) { unsupported("go"); }
+    void BytecodeCompiler::visitTraitStmt(ast::TraitStmt*) { unsupported("traits"); }
+    void BytecodeCompiler::visitImplStmt(ast::ImplStmt*) { unsupported("impl blocks"); }
+    void BytecodeCompiler::visitRuntimeSelectStmt(void*) { unsupported("select"); }
+
+} // namespace interpreter
@@ -0,0 +1,306 @@
+#include "Heap.h"
+#include "Environment.h"
+#include "MemoTable.h"
+#include <algorithm>
+
+namespace interpreter {
+
+    // --- Containers ---
+
+    Container::Container(ObjectType type) : Object(type) {
+        Heap::instance().track(this);
+    }
+
+    Container::~Container() {
+        Heap::instance().untrack(this);
+    }
+
+    void ArrayObject::traverse(Tracer& tracer) const {
+        for (const Value& element : elements) {
+            tracer.visit(element);
+        }
+    }
+
+    void ArrayObject::clear() {
+        Array().swap(elements);
+    }
+
+    void DictObject::traverse(Tracer& tracer) const {
+        for (const auto& entry : entries) {
+            tracer.visit(entry.second);
+        }
+    }
+
+    void DictObject::clear() {
+        Dict dropped(std::move(entries));
+        entries = Dict();
+    }
+
+    void Function::traverse(Tracer& tracer) const {
+        tracer.visit(env);
+        if (memo) {
+            memo->traverse(tracer);
+        }
+    }
+
+    void Function::clear() {
+        env = Value();
+        if (memo) {
+            memo->clear();
+        }
+    }
+
+    void Class::traverse(Tracer& tracer) const {
+        for (const auto& method : methods) {
+            tracer.visit(method.second);
+        }
+    }
+
+    void Class::clear() {
+        std::unordered_map<std::string, Value>().swap(methods);
+    }
+
+    void Environment::traverse(Tracer& tracer) const {
+        for (const Value& value : slots) {
+            tracer.visit(value);
+        }
+        tracer.visit(enclosing);
+    }
+
+    void Environment::clear() {
+        for (Value& value : slots) {
+            value = Value();
+        }
+        enclosing = Value();
+    }
+
+    // --- Heap ---
+
+    namespace {
+
+        // Tracer calling a lambda
+        template <typename Visit>
+        class FunctionTracer : public Tracer {
+        public:
+            explicit FunctionTracer(Visit visit) : visitor(visit) {}
+            void visit(const Value& value) override { visitor(value); }
+
+        private:
+            Visit visitor;
+        };
+
+        template <typename Visit>
+        FunctionTracer<Visit> tracer(Visit visit) {
+            return FunctionTracer<Visit>(visit);
+        }
+
+    } // namespace
+
+    Heap& Heap::instance() {
+        // Never destroyed: containers held by other statics may be freed
+        // after it would have been
+        static Heap* heap = new Heap();
+        return *heap;
+    }
+
+    void Heap::List::append(Container* container) {
+        container->prev = tail;
+        container->next = nullptr;
+        if (tail) {
+            tail->next = container;
+        } else {
+            head = container;
+        }
+        tail = container;
+        ++size;
+    }
+
+    void Heap::List::remove(Container* container) {
+        if (container->prev) {
+            container->prev->next = container->next;
+        } else {
+            head = container->next;
+        }
+        if (container->next) {
+            container->next->prev = container->prev;
+        } else {
+            tail = container->prev;
+        }
+        container->prev = container->next = nullptr;
+        --size;
+    }
+
+    void Heap::List::splice(List& other) {
+        if (!other.head) {
+            return;
+        }
+        if (tail) {
+            tail->next = other.head;
+            other.head->prev = tail;
+        } else {
+            head = other.head;
+        }
+        tail = other.tail;
+        size += other.size;
+        other = List();
+    }
+
+    void Heap::track(Container* container) {
+        // The new container is not linked yet, so a collection started
+        // here never sees it half constructed
+        if (++counts[0] > kYoungLimit && !collecting) {
+            maybeCollect();
+        }
+        container->generation = 0;
+        lists[0].append(container);
+    }
+
+    void Heap::untrack(Container* container) {
+        lists[container->generation].remove(container);
+        if (counts[0] > 0) {
+            --counts[0];
+        }
+    }
+
+    size_t Heap::size() const {
+        size_t total = 0;
+        for (int generation = 0; generation < kGenerations; ++generation) {
+            total += lists[generation].size;
+        }
+        return total;
+    }
+
+    void Heap::maybeCollect() {
+        for (int generation = kGenerations - 1; generation >= 0; --generation) {
+            if (counts[generation] <= (generation == 0 ? kYoungLimit : kOlderRatio)) {
+                continue;
+            }
+            if (generation == kGenerations - 1 && promotedToOld < oldAfterFull / 4) {
+                continue;
+            }
+            collect(generation);
+            return;
+        }
+    }
+
+    void Heap::move(Container* container, uint8_t generation) {
+        lists[container->generation].remove(container);
+        container->generation = generation;
+        lists[generation].append(container);
+    }
+
+    Container* Heap::collected(const Value& value, int generation) {
+        if (!value.isObject()) {
+            return nullptr;
+        }
+        ObjectType type = value.asObject()->getType();
+        if (type == ObjectType::Int || type == ObjectType::String) {
+            return nullptr;
+        }
+        auto* container = static_cast<Container*>(value.asObject());
+        return container->generation == generation || container->generation == kUnreachable ? container : nullptr;
+    }
+
+    size_t Heap::collect(int generation) {
+        if (collecting) {
+            return 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        collecting = true;
+        if (generation + 1 < kGenerations) {
+            ++counts[generation + 1];
+        }
+        for (int younger = 0; younger <= generation; ++younger) {
+            counts[younger] = 0;
+        }
+
+        List& young = lists[generation];
+        for (int younger = 0; younger < generation; ++younger) {
+            for (Container* c = lists[younger].head; c; c = c->next) {
+                c->generation = static_cast<uint8_t>(generation);
+            }
+            young.splice(lists[younger]);
+        }
+
+        // What is left of each count after the collected containers' own
+        // references comes from outside them
+        for (Container* c = young.head; c; c = c->next) {
+            c->gcRefs = c->getRefCount();
+        }
+        auto subtract = tracer([generation](const Value& value) {
+            if (Container* target = collected(value, generation)) {
+                if (target->gcRefs > 0) {
+                    --target->gcRefs;
+                }
+            }
+        });
+        for (Container* c = young.head; c; c = c->next) {
+            c->traverse(subtract);
+        }
+
+        // Containers referenced from outside keep everything they reach.
+        // One found unreachable may still be reached from a container
+        // later in the list; it then goes back to the end of it.
+        List& unreachable = lists[kUnreachable];
+        auto rescue = tracer([this, generation](const Value& value) {
+            Container* target = collected(value, generation);
+            if (!target) {
+                return;
+            }
+            if (target->generation == kUnreachable) {
+                move(target, static_cast<uint8_t>(generation));
+                target->gcRefs = 1;
+            } else if (target->gcRefs == 0) {
+                target->gcRefs = 1;
+            }
+        });
+        for (Container* c = young.head; c;) {
+            if (c->gcRefs > 0) {
+                c->traverse(rescue);
+                c = c->next;
+            } else {
+                Container* next = c->next;
+                move(c, kUnreachable);
+                c = next;
+            }
+        }
+
+        // Survivors move up a generation
+        if (generation + 1 < kGenerations) {
+            int older = generation + 1;
+            if (older == kGenerations - 1) {
+                promotedToOld += young.size;
+            }
+            for (Container* c = young.head; c; c = c->next) {
+                c->generation = static_cast<uint8_t>(older);
+            }
+            lists[older].splice(young);
+        } else {
+            oldAfterFull = young.size;
+            promotedToOld = 0;
+        }
+
+        // Hold every garbage container while emptying them all, so none is
+        // destroyed while another still points at it; dropping the holds
+        // then frees them
+        std::vector<Value> garbage;
+        garbage.reserve(unreachable.size);
+        for (Container* c = unreachable.head; c; c = c->next) {
+            garbage.emplace_back(static_cast<Object*>(c));
+        }
+        for (const Value& value : garbage) {
+            static_cast<Container*>(value.asObject())->clear();
+        }
+        size_t freed = garbage.size();
+        garbage.clear();
+        collecting = false;
+
+        auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        ++statistics.collections[generation];
+        statistics.freed += freed;
+        statistics.totalPause += pause;
+        statistics.maxPause = std::max(statistics.maxPause, pause);
+        return freed;
+    }
+
+} // namespace interpreter
@@ -17,43 +17,9 @@
 #include <algorithm>
 #include <type_traits>
 #include <optional>
-#include <llvm/IR/LLVMContext.h>
-#include <llvm/IR/Module.h>
-#include <llvm/IR/IRBuilder.h>
-#include <llvm/IR/Verifier.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/IPO.h>
 
 namespace interpreter {
 
-    // Thread-safe value cache for optimization
-    class ValueCache {
-    private:
-        std::mutex mutex;
-        std::unordered_map<std::string, Value> cache;
-        size_t maxSize = 1000;
-
-    public:
-        void put(const std::string& key, const Value& value) {
-            std::lock_guard<std::mutex> lock(mutex);
-            if (cache.size() >= maxSize) {
-                cache.erase(cache.begin());
-            }
-            cache[key] = value;
-        }
-
-        bool get(const std::string& key, Value& value) {
-            std::lock_guard<std::mutex> lock(mutex);
-            auto it = cache.find(key);
-            if (it != cache.end()) {
-                value = it->second;
-                return true;
-            }
-            return false;
-        }
-    };
-
     // Enhanced error handling with stack traces
     class EnhancedErrorHandler : public error::ErrorHandler {
     private:
@@ -104,83 +70,6 @@ namespace interpreter {
         }
     };
 
-    // Memory management and garbage collection
-    class MemoryManager {
-    private:
-        std::unordered_map<void*, size_t> objectSizes;
-        std::unordered_map<void*, std::set<void*>> references;
-        std::mutex mutex;
-        size_t totalMemory = 0;
-        size_t maxMemory = 1024 * 1024 * 1024; // 1GB limit
-
-    public:
-        template<typename T>
-        T* allocate(size_t size) {
-            std::lock_guard<std::mutex> lock(mutex);
-            if (totalMemory + size > maxMemory) {
-                collectGarbage();
-                if (totalMemory + size > maxMemory) {
-                    throw std::runtime_error("Memory limit exceeded");
-                }
-            }
-            T* ptr = new T();
-            objectSizes[ptr] = size;
-            totalMemory += size;
-            return ptr;
-        }
-
-        void addReference(void* from, void* to) {
-            std::lock_guard<std::mutex> lock(mutex);
-            references[from].insert(to);
-        }
-
-        void removeReference(void* from, void* to) {
-            std::lock_guard<std::mutex> lock(mutex);
-            references[from].erase(to);
-        }
-
-        void collectGarbage() {
-            std::lock_guard<std::mutex> lock(mutex);
-            std::set<void*> reachable;
-            std::queue<void*> toVisit;
-
-            // Start with root objects
-            for (const auto& [ptr, _] : objectSizes) {
-                if (references[ptr].empty()) {
-                    toVisit.push(ptr);
-                }
-            }
-
-            // Mark reachable objects
-            while (!toVisit.empty()) {
-                void* current = toVisit.front();
-                toVisit.pop();
-                reachable.insert(current);
-
-                for (void* ref : references[current]) {
-                    if (reachable.find(ref) == reachable.end()) {
-                        toVisit.push(ref);
-                    }
-                }
-            }
-
-            // Free unreachable objects
-            for (auto it = objectSizes.begin(); it != objectSizes.end();) {
-                if (reachable.find(it->first) == reachable.end()) {
-                    totalMemory -= it->second;
-                    delete static_cast<char*>(it->first);
-                    it = objectSizes.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-        }
-
-        size_t getTotalMemory() const {
-            return totalMemory;
-        }
-    };
-
     // Static Analysis System
     class StaticAnalyzer {
     private:
@@ -508,74 +397,6 @@ namespace interpreter {
         }
     };
 
-    // LLVM-based JIT Compiler
-    class LLVMJITCompiler {
-    private:
-        std::unique_ptr<llvm::LLVMContext> context;
-        std::unique_ptr<llvm::Module> module;
-        std::unique_ptr<llvm::IRBuilder<>> builder;
-        std::unique_ptr<llvm::ExecutionEngine> engine;
-        std::mutex mutex;
-
-    public:
-        LLVMJITCompiler() {
-            context = std::make_unique<llvm::LLVMContext>();
-            module = std::make_unique<llvm::Module>("jit_module", *context);
-            builder = std::make_unique<llvm::IRBuilder<>>(*context);
-            
-            // Initialize optimization passes
-            llvm::InitializeNativeTarget();
-            llvm::InitializeNativeTargetAsmPrinter();
-            llvm::InitializeNativeTargetAsmParser();
-        }
-
-        void compileFunction(const std::string& name, ast::FunctionStmt* stmt) {
-            std::lock_guard<std::mutex> lock(mutex);
-            
-            // Create function type
-            std::vector<llvm::Type*> paramTypes;
-            for (const auto& param : stmt->parameters) {
-                paramTypes.push_back(builder->getInt64Ty());
-            }
-            
-            llvm::FunctionType* funcType = llvm::FunctionType::get(
-                builder->getInt64Ty(), paramTypes, false);
-            
-            llvm::Function* func = llvm::Function::Create(
-                funcType, llvm::Function::ExternalLinkage, name, module.get());
-            
-            // Create basic block
-            llvm::BasicBlock* entry = llvm::BasicBlock::Create(
-                *context, "entry", func);
-            builder->SetInsertPoint(entry);
-            
-            // Generate IR for function body
-            // Simple implementation: create a default return value
-            // For a full implementation, we would need to traverse the function body AST
-            llvm::Value* returnValue = llvm::ConstantInt::get(builder->getInt64Ty(), 0);
-            builder->CreateRet(returnValue);
-            
-            // Verify and optimize
-            llvm::verifyFunction(*func);
-            
-            // Create execution engine if not already created
-            if (!engine) {
-                std::string error;
-                engine = std::unique_ptr<llvm::ExecutionEngine>(
-                    llvm::EngineBuilder(std::unique_ptr<llvm::Module>(module.release()))
-                        .setErrorStr(&error)
-                        .create());
-                if (!engine) {
-                    throw std::runtime_error("Failed to create execution engine: " + error);
-                }
-            }
-        }
-
-        void* getCompiledFunction(const std::string& name) {
-            return engine->getPointerToFunction(module->getFunction(name));
-        }
-    };
-
     // Type safety system
     class TypeSystem {
     private:
@@ -659,125 +480,22 @@ namespace interpreter {
         }
     };
 
-    // Enhanced garbage collection with generational collection
-    class GenerationalGC {
-    private:
-        struct Generation {
-            std::set<void*> objects;
-            size_t maxSize;
-            size_t currentSize;
-        };
-
-        std::vector<Generation> generations;
-        std::unordered_map<void*, size_t> objectAges;
-        std::mutex mutex;
-        size_t totalMemory = 0;
-        const size_t MAX_MEMORY = 1024 * 1024 * 1024; // 1GB
-
-    public:
-        GenerationalGC() {
-            // Initialize three generations
-            generations.push_back({std::set<void*>(), 1024 * 1024, 0});     // 1MB
-            generations.push_back({std::set<void*>(), 10 * 1024 * 1024, 0}); // 10MB
-            generations.push_back({std::set<void*>(), 100 * 1024 * 1024, 0}); // 100MB
-        }
-
-        template<typename T>
-        T* allocate(size_t size) {
-            std::lock_guard<std::mutex> lock(mutex);
-            if (totalMemory + size > MAX_MEMORY) {
-                collect();
-                if (totalMemory + size > MAX_MEMORY) {
-                    throw std::runtime_error("Memory limit exceeded");
-                }
-            }
-
-            T* ptr = new T();
-            generations[0].objects.insert(ptr);
-            generations[0].currentSize += size;
-            objectAges[ptr] = 0;
-            totalMemory += size;
-            return ptr;
-        }
-
-        void addReference(void* from, void* to) {
-            std::lock_guard<std::mutex> lock(mutex);
-            // Update object age
-            if (objectAges.find(to) != objectAges.end()) {
-                objectAges[to]++;
-            }
-        }
-
-        void collect() {
-            std::lock_guard<std::mutex> lock(mutex);
-            std::set<void*> reachable;
-            std::queue<void*> toVisit;
-
-            // Mark phase
-            for (const auto& gen : generations) {
-                for (void* obj : gen.objects) {
-                    if (objectAges[obj] > 0) {
-                        toVisit.push(obj);
-                    }
-                }
-            }
-
-            while (!toVisit.empty()) {
-                void* current = toVisit.front();
-                toVisit.pop();
-                reachable.insert(current);
-            }
-
-            // Sweep phase
-            for (auto& gen : generations) {
-                for (auto it = gen.objects.begin(); it != gen.objects.end();) {
-                    if (reachable.find(*it) == reachable.end()) {
-                        totalMemory -= sizeof(*it);
-                        delete static_cast<char*>(*it);
-                        it = gen.objects.erase(it);
-                    } else {
-                        // Promote objects to next generation if they survive collection
-                        if (objectAges[*it] > 0 && &gen != &generations.back()) {
-                            size_t nextGen = &gen - &generations[0] + 1;
-                            generations[nextGen].objects.insert(*it);
-                            it = gen.objects.erase(it);
-                        } else {
-                            ++it;
-                        }
-                    }
-                }
-            }
-        }
-
-        size_t getTotalMemory() const {
-            return totalMemory;
-        }
-    };
-
     // Enhanced Interpreter with all safety features
     class EnhancedInterpreter : public Interpreter {
     private:
-        ValueCache valueCache;
         EnhancedErrorHandler& errorHandler;
         PerformanceMonitor perfMonitor;
         std::queue<std::function<void()>> asyncTasks;
         std::mutex asyncMutex;
         bool isRunning = true;
-        std::shared_ptr<MemoryManager> memoryManager;
-        std::shared_ptr<LLVMJITCompiler> jitCompiler;
-        std::unordered_map<std::string, size_t> functionCallCounts;
         std::mutex mutex;
 
-        // JIT compilation cache
-        std::unordered_map<std::string, std::function<Value(const std::vector<Value>&)>> jitCache;
-
         // Pattern matching optimization
         std::unordered_map<std::string, std::function<bool(const Value&)>> patternCache;
 
         std::shared_ptr<TypeSystem> typeSystem;
         std::shared_ptr<NullSafety> nullSafety;
         std::shared_ptr<LoopSafety> loopSafety;
-        std::shared_ptr<GenerationalGC> gc;
 
         std::shared_ptr<StaticAnalyzer> staticAnalyzer;
         std::shared_ptr<Optimizer> optimizer;
@@ -785,24 +503,15 @@ namespace interpreter {
     public:
         EnhancedInterpreter(EnhancedErrorHandler& handler) 
             : Interpreter(handler), errorHandler(handler),
-              memoryManager(std::make_shared<MemoryManager>()),
-              jitCompiler(std::make_shared<LLVMJITCompiler>()),
               typeSystem(std::make_shared<TypeSystem>()),
               nullSafety(std::make_shared<NullSafety>()),
               loopSafety(std::make_shared<LoopSafety>()),
-              gc(std::make_shared<GenerationalGC>()),
               staticAnalyzer(std::make_shared<StaticAnalyzer>()),
               optimizer(std::make_shared<Optimizer>()) {
             initializeEnhancedFeatures();
         }
 
         void initializeEnhancedFeatures() {
-            // Initialize JIT cache
-            jitCache["math"] = [](const std::vector<Value>& args) {
-                // Optimized math operations
-                return Value(0); // Placeholder
-            };
-
             // Initialize pattern cache
             patternCache["number"] = [](const Value& v) {
                 return std::holds_alternative<double>(v);
@@ -826,26 +535,6 @@ namespace interpreter {
                 }
             }).detach();
 
-            // Start memory monitoring thread
-            std::thread([this]() {
-                while (true) {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    if (memoryManager->getTotalMemory() > 512 * 1024 * 1024) { // 512MB
-                        memoryManager->collectGarbage();
-                    }
-                }
-            }).detach();
-
-            // Start GC thread
-            std::thread([this]() {
-                while (true) {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    if (gc->getTotalMemory() > 512 * 1024 * 1024) { // 512MB
-                        gc->collect();
-                    }
-                }
-            }).detach();
-
             // Initialize static analysis
             staticAnalyzer->analyzeSymbol("print", {"function", false, false, {}});
             
@@ -862,21 +551,11 @@ namespace interpreter {
         void visitBinaryExpr(ast::BinaryExpr* expr) override {
             auto start = std::chrono::high_resolution_clock::now();
             
-            // Check cache first
-            std::string cacheKey = "binary_" + std::to_string(expr->op);
-            Value cachedResult;
-            if (valueCache.get(cacheKey, cachedResult)) {
-                perfMonitor.recordExecution("binary_cache_hit", 
-                    std::chrono::high_resolution_clock::now() - start);
-                return cachedResult;
-            }
-
-            // Perform operation
+            // No result cache: a key of the operator alone returned the first
+            // result for every later operation. Constant subtrees are folded
+            // by the bytecode compiler and @memoize caches pure functions.
             Value result = Interpreter::visitBinaryExpr(expr);
             
-            // Cache result
-            valueCache.put(cacheKey, result);
-            
             perfMonitor.recordExecution("binary_operation", 
                 std::chrono::high_resolution_clock::now() - start);
             return result;
@@ -896,11 +575,6 @@ namespace interpreter {
             // Optimize function body
             optimizer->optimize(stmt->body.get());
             
-            // JIT compile if frequently called
-            if (functionCallCounts[stmt->name] > 1000) {
-                jitCompiler->compileFunction(stmt->name, stmt);
-            }
-            
             Interpreter::visitFunctionStmt(stmt);
             
             perfMonitor.recordExecution("function_compilation", 
@@ -999,13 +673,7 @@ namespace interpreter {
 
                 // Parse and execute module
                 lexer::Lexer lexer(content, modulePath);
-                std::vector<lexer::Token> tokens = lexer.tokenize();
-
-                if (errorHandler.hasErrors()) {
-                    throw std::runtime_error("Lexical error in module: " + modulePath);
-                }
-
-                parser::Parser parser(tokens);
+                parser::Parser parser(lexer);
                 std::vector<ast::StmtPtr> statements = parser.parse();
 
                 if (errorHandler.hasErrors()) {
@@ -1030,38 +698,21 @@ namespace interpreter {
 
         Value visitCallExpr(ast::CallExpr* expr) override {
             auto start = std::chrono::high_resolution_clock::now();
-            
-            // Check for JIT compiled version
-            if (jitCompiler->getCompiledFunction(expr->callee->toString())) {
-                // Call JIT compiled version
-                auto func = reinterpret_cast<Value(*)(const std::vector<Value>&)>(
-                    jitCompiler->getCompiledFunction(expr->callee->toString()));
-                
-                std::vector<Value> args;
-                for (const auto& arg : expr->arguments) {
-                    args.push_back(arg->accept(*this));
-                }
-                
-                auto result = func(args);
-                perfMonitor.recordExecution("jit_function_call", 
-                    std::chrono::high_resolution_clock::now() - start);
-                return result;
-            }
-            
-            return Interpreter::visitCallExpr(expr);
+            Value result = Interpreter::visitCallExpr(expr);
+            perfMonitor.recordExecution("function_call",
+                std::chrono::high_resolution_clock::now() - start);
+            return result;
         }
 
         void visitClassStmt(ast::ClassStmt* stmt) override {
             auto start = std::chrono::high_resolution_clock::now();
             
-            // Allocate class memory through memory manager
-            auto class_ = memoryManager->allocate<Class>(stmt->name);
+            auto class_ = std::make_shared<Class>(stmt->name);
             
             std::unordered_map<std::string, Value> methods;
             for (const auto& method : stmt->methods) {
                 auto function = std::make_shared<Function>(method->name, method->params, method->body);
                 methods[method->name] = function;
-                memoryManager->addReference(class_, function.get());
             }
             
             class_->setMethods(methods);
@@ -1169,9 +820,6 @@ namespace interpreter {
             // Test optimizations
             testOptimizations();
             
-            // Test JIT compilation
-            testJITCompilation();
-            
             auto end = std::chrono::high_resolution_clock::now();
             std::cout << "\nTotal test execution time: " 
                       << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() 
@@ -1209,20 +857,6 @@ namespace interpreter {
             optimizer->optimize(functionStmt.get());
         }
 
-        void testJITCompilation() {
-            std::cout << "Testing JIT compilation...\n";
-            
-            // Create a function to JIT compile
-            auto functionStmt = std::make_unique<ast::FunctionStmt>(
-                "testFunction",
-                std::vector<std::string>{"x", "y"},
-                std::vector<ast::StmtPtr>()
-            );
-            
-            // Compile the function
-            jitCompiler->compileFunction("testFunction", functionStmt.get());
-        }
-
         void visitGoStmt(ast::GoStmt* stmt) override {
             // Launch expression in a separate thread (goroutine-style)
             std::thread([this, stmt]() {
@@ -0,0 +1,598 @@
+#include "JitTier.h"
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace interpreter {
+
+    namespace {
+
+        // Native recursion stops where the VM's frame stack would, so a
+        // runaway recursion bails out and overflows in the interpreter
+        constexpr int64_t kMaxNativeDepth = 4096;
+
+        // What a register holds at some point of a chunk, over every path
+        // that reaches it. Unset registers have not been written; Mixed ones
+        // hold different kinds on different paths, and neither may be read.
+        enum class Kind : uint8_t { Unset, Int, Bool, Nil, Self, Mixed };
+
+        using Kinds = std::vector<Kind>;
+
+        constexpr int kNoSuccessor = std::numeric_limits<int>::min();
+
+        bool isScalar(Kind kind) {
+            return kind == Kind::Int || kind == Kind::Bool || kind == Kind::Nil;
+        }
+
+        // Kinds of the registers on entry to each instruction, computed to a
+        // fixed point over the control flow graph; empty for unreachable
+        // instructions. Fails on any instruction the translator does not
+        // handle or any read it cannot type.
+        bool analyze(const Chunk& chunk, const std::vector<int>& selfSlots, std::vector<Kinds>& states) {
+            const int size = static_cast<int>(chunk.code.size());
+            const int registers = chunk.numRegisters;
+            if (chunk.isClosure || chunk.envSize || chunk.memoize || size == 0 || chunk.arity > registers) {
+                return false;
+            }
+            states.assign(size, Kinds());
+            states[0].assign(registers, Kind::Unset);
+            std::fill(states[0].begin(), states[0].begin() + chunk.arity, Kind::Int);
+
+            std::vector<int> worklist{0};
+            while (!worklist.empty()) {
+                int pc = worklist.back();
+                worklist.pop_back();
+                Kinds kinds = states[pc];
+                Instruction i = chunk.code[pc];
+                int a = argA(i);
+                int b = argB(i);
+                int c = argC(i);
+                if (a >= registers) {
+                    return false;
+                }
+                auto kindOf = [&](int r) { return r < registers ? kinds[r] : Kind::Mixed; };
+
+                int next = pc + 1;
+                int jump = kNoSuccessor;
+                switch (opcodeOf(i)) {
+                    case Opcode::LOADK:
+                        if (!chunk.constants[argBx(i)].isSmallInt()) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Int;
+                        break;
+                    case Opcode::LOADNIL:
+                        kinds[a] = Kind::Nil;
+                        break;
+                    case Opcode::LOADBOOL:
+                        kinds[a] = Kind::Bool;
+                        break;
+                    case Opcode::LOADINT:
+                        kinds[a] = Kind::Int;
+                        break;
+                    case Opcode::MOVE:
+                        if (!isScalar(kindOf(b)) && kindOf(b) != Kind::Self) {
+                            return false;
+                        }
+                        kinds[a] = kinds[b];
+                        break;
+                    case Opcode::GETGLOBAL:
+                        if (std::find(selfSlots.begin(), selfSlots.end(), argBx(i)) == selfSlots.end()) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Self;
+                        break;
+                    case Opcode::ADD:
+                    case Opcode::SUB:
+                    case Opcode::MUL:
+                    case Opcode::DIV:
+                    case Opcode::MOD:
+                        if (kindOf(b) != Kind::Int || kindOf(c) != Kind::Int) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Int;
+                        break;
+                    case Opcode::LT:
+                    case Opcode::LE:
+                        if (kindOf(b) != Kind::Int || kindOf(c) != Kind::Int) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Bool;
+                        break;
+                    case Opcode::EQ:
+                    case Opcode::NE:
+                        if (!isScalar(kindOf(b)) || !isScalar(kindOf(c))) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Bool;
+                        break;
+                    case Opcode::NEG:
+                        if (kindOf(b) != Kind::Int) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Int;
+                        break;
+                    case Opcode::NOT:
+                        if (!isScalar(kindOf(b))) {
+                            return false;
+                        }
+                        kinds[a] = Kind::Bool;
+                        break;
+                    case Opcode::JMP:
+                        next = kNoSuccessor;
+                        jump = pc + 1 + argSBx(i);
+                        break;
+                    case Opcode::JMPIF:
+                    case Opcode::JMPIFNOT:
+                        if (!isScalar(kinds[a])) {
+                            return false;
+                        }
+                        jump = pc + 1 + argSBx(i);
+                        break;
+                    case Opcode::CALL:
+                        if (kinds[a] != Kind::Self || b != chunk.arity) {
+                            return false;
+                        }
+                        for (int n = 1; n <= b; ++n) {
+                            if (kindOf(a + n) != Kind::Int) {
+                                return false;
+                            }
+                        }
+                        // The result must be an int too; the call site checks.
+                        // The interpreter clears the callee's registers.
+                        kinds[a] = Kind::Int;
+                        std::fill(kinds.begin() + a + 1, kinds.end(), Kind::Mixed);
+                        break;
+                    case Opcode::RETURN:
+                        if (b && !isScalar(kinds[a])) {
+                            return false;
+                        }
+                        next = kNoSuccessor;
+                        break;
+                    default:
+                        return false;
+                }
+
+                for (int successor : {next, jump}) {
+                    if (successor == kNoSuccessor) {
+                        continue;
+                    }
+                    if (successor < 0 || successor >= size) {
+                        return false;
+                    }
+                    Kinds& target = states[successor];
+                    bool changed = false;
+                    if (target.empty()) {
+                        target = kinds;
+                        changed = true;
+                    } else {
+                        for (int r = 0; r < registers; ++r) {
+                            Kind joined = target[r] == kinds[r] ? kinds[r] : Kind::Mixed;
+                            if (joined != target[r]) {
+                                target[r] = joined;
+                                changed = true;
+                            }
+                        }
+                    }
+                    if (changed) {
+                        worklist.push_back(successor);
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Emits the code for one analyzed chunk as two functions: an
+        // internal body taking unboxed int arguments, which recursive calls
+        // use directly, and an exported entry point with the NativeEntry
+        // signature that checks and unboxes the VM's arguments. Registers
+        // are stack slots holding raw int64s (bools as 0/1); the optimizer
+        // promotes them to SSA values.
+        class Translator {
+        public:
+            Translator(llvm::Module& module, const Chunk& chunk, const std::vector<Kinds>& states,
+                       uint64_t self)
+                : context(module.getContext()), module(module), builder(module.getContext()),
+                  chunk(chunk), states(states), self(self) {
+                i64 = builder.getInt64Ty();
+                i32 = builder.getInt32Ty();
+                pointer = llvm::PointerType::getUnqual(i64);
+            }
+
+            void emit(const std::string& name) {
+                emitBody(name + ".body");
+                emitEntry(name);
+            }
+
+        private:
+            llvm::LLVMContext& context;
+            llvm::Module& module;
+            llvm::IRBuilder<> builder;
+            const Chunk& chunk;
+            const std::vector<Kinds>& states;
+            uint64_t self;
+
+            llvm::Type* i64;
+            llvm::Type* i32;
+            llvm::PointerType* pointer;
+
+            llvm::Function* body = nullptr;
+            llvm::Value* depth = nullptr;
+            llvm::Value* globals = nullptr;
+            llvm::Value* out = nullptr;
+            llvm::Value* callResult = nullptr;
+            std::vector<llvm::Value*> registers;
+            std::vector<llvm::BasicBlock*> blocks;
+            llvm::BasicBlock* bail = nullptr;
+
+            llvm::Constant* constant(uint64_t value) { return llvm::ConstantInt::get(i64, value); }
+
+            llvm::Value* load(int r) { return builder.CreateLoad(i64, registers[r]); }
+            void store(int r, llvm::Value* value) { builder.CreateStore(value, registers[r]); }
+
+            // Continues in a new block if `ok`, else bails out
+            void guard(llvm::Value* ok) {
+                llvm::BasicBlock* next = llvm::BasicBlock::Create(context, "", body);
+                builder.CreateCondBr(ok, next, bail);
+                builder.SetInsertPoint(next);
+            }
+
+            llvm::Value* isSmallIntBits(llvm::Value* bits) {
+                return builder.CreateICmpEQ(builder.CreateLShr(bits, 48), constant(Value::kIntTag >> 48));
+            }
+
+            llvm::Value* unboxSmallInt(llvm::Value* bits) {
+                return builder.CreateAShr(builder.CreateShl(bits, 16), 16);
+            }
+
+            void guardSmallInt(llvm::Value* value) {
+                guard(builder.CreateICmpEQ(unboxSmallInt(value), value));
+            }
+
+            llvm::Value* box(llvm::Value* value, Kind kind) {
+                switch (kind) {
+                    case Kind::Int:
+                        return builder.CreateOr(builder.CreateAnd(value, constant(Value::kPayloadMask)),
+                                                constant(Value::kIntTag));
+                    case Kind::Bool:
+                        return builder.CreateSelect(builder.CreateICmpNE(value, constant(0)),
+                                                    constant(Value::kTrue), constant(Value::kFalse));
+                    default:
+                        return constant(Value::kNil);
+                }
+            }
+
+            llvm::Value* truthy(int r, Kind kind) {
+                if (kind == Kind::Nil) {
+                    return builder.getFalse();
+                }
+                return builder.CreateICmpNE(load(r), constant(0));
+            }
+
+            llvm::Value* equal(int l, Kind left, int r, Kind right) {
+                if (left != right) {
+                    return builder.getFalse();
+                }
+                if (left == Kind::Nil) {
+                    return builder.getTrue();
+                }
+                return builder.CreateICmpEQ(load(l), load(r));
+            }
+
+            void setBool(int r, llvm::Value* condition) { store(r, builder.CreateZExt(condition, i64)); }
+
+            void emitBody(const std::string& name) {
+                std::vector<llvm::Type*> params(chunk.arity, i64);
+                params.insert(params.end(), {i64, pointer, pointer});
+                body = llvm::Function::Create(llvm::FunctionType::get(i32, params, false),
+                                              llvm::Function::InternalLinkage, name, module);
+                depth = body->getArg(chunk.arity);
+                globals = body->getArg(chunk.arity + 1);
+                out = body->getArg(chunk.arity + 2);
+
+                llvm::BasicBlock* entry = llvm::BasicBlock::Create(context, "entry", body);
+                bail = llvm::BasicBlock::Create(context, "bail", body);
+                for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+                    blocks.push_back(llvm::BasicBlock::Create(context, "", body));
+                }
+
+                builder.SetInsertPoint(bail);
+                builder.CreateRet(builder.getInt32(1));
+
+                builder.SetInsertPoint(entry);
+                for (int r = 0; r < chunk.numRegisters; ++r) {
+                    registers.push_back(builder.CreateAlloca(i64));
+                }
+                callResult = builder.CreateAlloca(i64);
+                for (int n = 0; n < chunk.arity; ++n) {
+                    store(n, body->getArg(n));
+                }
+                builder.CreateCondBr(builder.CreateICmpSLT(depth, constant(kMaxNativeDepth)), blocks[0], bail);
+
+                for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+                    builder.SetInsertPoint(blocks[pc]);
+                    if (states[pc].empty()) {
+                        builder.CreateUnreachable();
+                    } else {
+                        emitInstruction(static_cast<int>(pc));
+                    }
+                }
+            }
+
+            void emitInstruction(int pc) {
+                const Kinds& kinds = states[pc];
+                Instruction i = chunk.code[pc];
+                int a = argA(i);
+                int b = argB(i);
+                int c = argC(i);
+                switch (opcodeOf(i)) {
+                    case Opcode::LOADK:
+                        store(a, constant(static_cast<uint64_t>(chunk.constants[argBx(i)].asSmallInt())));
+                        break;
+                    case Opcode::LOADNIL:
+                        store(a, constant(0));
+                        break;
+                    case Opcode::LOADBOOL:
+                        store(a, constant(b != 0));
+                        break;
+                    case Opcode::LOADINT:
+                        store(a, constant(static_cast<uint64_t>(static_cast<int64_t>(argSBx(i)))));
+                        break;
+                    case Opcode::MOVE:
+                        store(a, load(b));
+                        break;
+                    case Opcode::GETGLOBAL: {
+                        // Direct recursion is only valid while the global
+                        // still holds this function
+                        llvm::Value* slot = builder.CreateGEP(i64, globals, constant(argBx(i)));
+                        guard(builder.CreateICmpEQ(builder.CreateLoad(i64, slot), constant(self)));
+                        break;
+                    }
+                    case Opcode::ADD:
+                    case Opcode::SUB:
+                    case Opcode::MUL: {
+                        llvm::Value* x = load(b);
+                        llvm::Value* y = load(c);
+                        llvm::Value* result = opcodeOf(i) == Opcode::ADD   ? builder.CreateAdd(x, y)
+                                              : opcodeOf(i) == Opcode::SUB ? builder.CreateSub(x, y)
+                                                                           : builder.CreateMul(x, y);
+                        guardSmallInt(result);
+                        store(a, result);
+                        break;
+                    }
+                    case Opcode::DIV:
+                    case Opcode::MOD: {
+                        // Operands are small ints, so only x / 0 can trap and
+                        // only -2^47 / -1 leaves the range
+                        llvm::Value* x = load(b);
+                        llvm::Value* y = load(c);
+                        guard(builder.CreateICmpNE(y, constant(0)));
+                        if (opcodeOf(i) == Opcode::DIV) {
+                            llvm::Value* result = builder.CreateSDiv(x, y);
+                            guardSmallInt(result);
+                            store(a, result);
+                        } else {
+                            store(a, builder.CreateSRem(x, y));
+                        }
+                        break;
+                    }
+                    case Opcode::EQ:
+                        setBool(a, equal(b, kinds[b], c, kinds[c]));
+                        break;
+                    case Opcode::NE:
+                        setBool(a, builder.CreateNot(equal(b, kinds[b], c, kinds[c])));
+                        break;
+                    case Opcode::LT:
+                        setBool(a, builder.CreateICmpSLT(load(b), load(c)));
+                        break;
+                    case Opcode::LE:
+                        setBool(a, builder.CreateICmpSLE(load(b), load(c)));
+                        break;
+                    case Opcode::NEG: {
+                        llvm::Value* result = builder.CreateSub(constant(0), load(b));
+                        guardSmallInt(result);
+                        store(a, result);
+                        break;
+                    }
+                    case Opcode::NOT:
+                        setBool(a, builder.CreateNot(truthy(b, kinds[b])));
+                        break;
+                    case Opcode::JMP:
+                        builder.CreateBr(blocks[pc + 1 + argSBx(i)]);
+                        return;
+                    case Opcode::JMPIF:
+                    case Opcode::JMPIFNOT: {
+                        llvm::BasicBlock* target = blocks[pc + 1 + argSBx(i)];
+                        llvm::BasicBlock* next = blocks[pc + 1];
+                        if (opcodeOf(i) == Opcode::JMPIF) {
+                            builder.CreateCondBr(truthy(a, kinds[a]), target, next);
+                        } else {
+                            builder.CreateCondBr(truthy(a, kinds[a]), next, target);
+                        }
+                        return;
+                    }
+                    case Opcode::CALL: {
+                        std::vector<llvm::Value*> args;
+                        for (int n = 1; n <= b; ++n) {
+                            args.push_back(load(a + n));
+                        }
+                        args.insert(args.end(), {builder.CreateAdd(depth, constant(1)), globals, callResult});
+                        guard(builder.CreateICmpEQ(builder.CreateCall(body, args), builder.getInt32(0)));
+                        llvm::Value* bits = builder.CreateLoad(i64, callResult);
+                        guard(isSmallIntBits(bits));
+                        store(a, unboxSmallInt(bits));
+                        break;
+                    }
+                    case Opcode::RETURN:
+                        builder.CreateStore(b ? box(load(a), kinds[a]) : constant(Value::kNil), out);
+                        builder.CreateRet(builder.getInt32(0));
+                        return;
+                    default:
+                        // analyze() let through nothing else
+                        builder.CreateBr(bail);
+                        return;
+                }
+                builder.CreateBr(blocks[pc + 1]);
+            }
+
+            void emitEntry(const std::string& name) {
+                llvm::FunctionType* type = llvm::FunctionType::get(i32, {pointer, pointer, pointer, i64}, false);
+                llvm::Function* entry = llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, module);
+                llvm::Value* argsIn = entry->getArg(0);
+                llvm::BasicBlock* start = llvm::BasicBlock::Create(context, "entry", entry);
+                llvm::BasicBlock* mismatch = llvm::BasicBlock::Create(context, "mismatch", entry);
+                builder.SetInsertPoint(mismatch);
+                builder.CreateRet(builder.getInt32(1));
+
+                builder.SetInsertPoint(start);
+                std::vector<llvm::Value*> args;
+                for (int n = 0; n < chunk.arity; ++n) {
+                    llvm::Value* bits = builder.CreateLoad(i64, builder.CreateGEP(i64, argsIn, constant(n)));
+                    llvm::BasicBlock* next = llvm::BasicBlock::Create(context, "", entry);
+                    builder.CreateCondBr(isSmallIntBits(bits), next, mismatch);
+                    builder.SetInsertPoint(next);
+                    args.push_back(unboxSmallInt(bits));
+                }
+                args.insert(args.end(), {entry->getArg(3), entry->getArg(2), entry->getArg(1)});
+                builder.CreateRet(builder.CreateCall(body, args));
+            }
+        };
+
+        void optimize(llvm::Module& module) {
+            llvm::LoopAnalysisManager loops;
+            llvm::FunctionAnalysisManager functions;
+            llvm::CGSCCAnalysisManager sccs;
+            llvm::ModuleAnalysisManager modules;
+            llvm::PassBuilder passes;
+            passes.registerModuleAnalyses(modules);
+            passes.registerCGSCCAnalyses(sccs);
+            passes.registerFunctionAnalyses(functions);
+            passes.registerLoopAnalyses(loops);
+            passes.crossRegisterProxies(loops, functions, sccs, modules);
+            passes.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2).run(module, modules);
+        }
+
+    } // namespace
+
+    // Owned by the worker thread
+    struct JitTier::Compiler {
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        int count = 0;
+
+        Compiler() {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+            auto created = llvm::orc::LLJITBuilder().create();
+            if (created) {
+                jit = std::move(*created);
+            } else {
+                llvm::consumeError(created.takeError());
+            }
+        }
+
+        // Entry point for the job's chunk, or nullptr if it cannot be compiled
+        NativeEntry compile(const Job& job) {
+            std::vector<Kinds> states;
+            if (!jit || !analyze(*job.chunk, job.selfSlots, states)) {
+                return nullptr;
+            }
+            auto context = std::make_unique<llvm::LLVMContext>();
+            auto module = std::make_unique<llvm::Module>("tocin.jit", *context);
+            module->setDataLayout(jit->getDataLayout());
+            module->setTargetTriple(jit->getTargetTriple().str());
+            std::string name = "tocin.jit." + std::to_string(count++) + "." + job.chunk->name;
+            Translator(*module, *job.chunk, states, job.self).emit(name);
+            if (llvm::verifyModule(*module)) {
+                return nullptr;
+            }
+            optimize(*module);
+
+            llvm::orc::ThreadSafeModule compiled(std::move(module), llvm::orc::ThreadSafeContext(std::move(context)));
+            if (auto error = jit->addIRModule(std::move(compiled))) {
+                llvm::consumeError(std::move(error));
+                return nullptr;
+            }
+            auto symbol = jit->lookup(name);
+            if (!symbol) {
+                llvm::consumeError(symbol.takeError());
+                return nullptr;
+            }
+#if LLVM_VERSION_MAJOR >= 15
+            return symbol->toPtr<NativeEntry>();
+#else
+            return reinterpret_cast<NativeEntry>(symbol->getAddress());
+#endif
+        }
+    };
+
+    JitTier::~JitTier() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        // The code goes away with the worker's LLJIT; chunks may not
+        for (const auto& native : natives) {
+            native->entry.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    void JitTier::request(const Value& function, const GlobalTable& globals) {
+        const Chunk& chunk = function.asFunction()->getChunk();
+        Job job{&chunk, std::make_shared<NativeCode>(), function.rawBits(), {}};
+        // Either way the VM stops profiling the chunk
+        chunk.native = job.native;
+        if (chunk.profile.nonIntArguments) {
+            return;
+        }
+        for (Instruction i : chunk.code) {
+            int slot = argBx(i);
+            if (opcodeOf(i) == Opcode::GETGLOBAL && globals.get(slot).identical(function) &&
+                std::find(job.selfSlots.begin(), job.selfSlots.end(), slot) == job.selfSlots.end()) {
+                job.selfSlots.push_back(slot);
+            }
+        }
+        compiled.push_back(function);
+        natives.push_back(job.native);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        if (!worker.joinable()) {
+            worker = std::thread(&JitTier::work, this);
+        }
+        ready.notify_one();
+    }
+
+    void JitTier::work() {
+        Compiler compiler;
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            if (NativeEntry entry = compiler.compile(job)) {
+                job.native->entry.store(entry, std::memory_order_release);
+            }
+        }
+    }
+
+} // namespace interpreter
@@ -0,0 +1,113 @@
+#include "MemoTable.h"
+
+namespace interpreter {
+
+    namespace {
+
+        bool sameArgument(const Value& a, const Value& b) {
+            if (a.identical(b)) {
+                return true;
+            }
+            if (a.isInt() && b.isInt()) {
+                return a.asInt() == b.asInt();
+            }
+            if (!a.isObject() || !b.isObject() || a.asObject()->getType() != b.asObject()->getType()) {
+                return false;
+            }
+            switch (a.asObject()->getType()) {
+                case ObjectType::String:
+                    return a.asString() == b.asString();
+                case ObjectType::Array: {
+                    const auto& x = a.asArray();
+                    const auto& y = b.asArray();
+                    if (x.size() != y.size()) {
+                        return false;
+                    }
+                    for (size_t i = 0; i < x.size(); ++i) {
+                        if (!sameArgument(x[i], y[i])) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+                case ObjectType::Dict: {
+                    const auto& x = a.asDict();
+                    const auto& y = b.asDict();
+                    if (x.size() != y.size()) {
+                        return false;
+                    }
+                    for (auto i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+                        if ((*i).first != (*j).first || !sameArgument((*i).second, (*j).second)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+    } // namespace
+
+    size_t MemoTable::KeyHash::operator()(const Array* args) const {
+        size_t hash = args->size();
+        for (const auto& arg : *args) {
+            hash = hash * 31 + hashValue(arg);
+        }
+        return hash;
+    }
+
+    bool MemoTable::KeyEqual::operator()(const Array* a, const Array* b) const {
+        if (a->size() != b->size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a->size(); ++i) {
+            if (!sameArgument((*a)[i], (*b)[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const Value* MemoTable::find(const Array& args) {
+        auto it = index.find(&args);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->result;
+    }
+
+    void MemoTable::insert(Array args, Value result) {
+        auto it = index.find(&args);
+        if (it != index.end()) {
+            it->second->result = std::move(result);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.push_front({std::move(args), std::move(result)});
+        index.emplace(&entries.front().args, entries.begin());
+        if (entries.size() > capacity) {
+            index.erase(&entries.back().args);
+            entries.pop_back();
+        }
+    }
+
+    void MemoTable::traverse(Tracer& tracer) const {
+        for (const Entry& entry : entries) {
+            for (const Value& arg : entry.args) {
+                tracer.visit(arg);
+            }
+            tracer.visit(entry.result);
+        }
+    }
+
+    MemoTable& Function::memoTable() const {
+        if (!memo) {
+            memo = std::make_shared<MemoTable>();
+        }
+        return *memo;
+    }
+
+} // namespace interpreter
@@ -0,0 +1,98 @@
+#include "Operators.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace interpreter {
+
+    namespace {
+
+        [[noreturn]] void operandError(const char* op, const Value& a, const Value& b) {
+            throw std::runtime_error(std::string("Unsupported operands for ") + op + ": " +
+                                     typeName(a) + " and " + typeName(b));
+        }
+
+        const char* operatorSymbol(Opcode op) {
+            switch (op) {
+                case Opcode::ADD: return "+";
+                case Opcode::SUB: return "-";
+                case Opcode::MUL: return "*";
+                case Opcode::DIV: return "/";
+                case Opcode::MOD: return "%";
+                default: return opcodeName(op);
+            }
+        }
+
+    } // namespace
+
+    Value arithmetic(Opcode op, const Value& a, const Value& b) {
+        if (op == Opcode::ADD && (a.isString() || b.isString())) {
+            return Value(stringify(a) + stringify(b));
+        }
+        if (op == Opcode::ADD && a.isArray() && b.isArray()) {
+            Array result;
+            result.reserve(a.asArray().size() + b.asArray().size());
+            result.insert(result.end(), a.asArray().begin(), a.asArray().end());
+            result.insert(result.end(), b.asArray().begin(), b.asArray().end());
+            return Value(std::move(result));
+        }
+
+        if (a.isInt() && b.isInt()) {
+            int64_t x = a.asInt();
+            int64_t y = b.asInt();
+            switch (op) {
+                case Opcode::ADD: return Value(wrapAdd(x, y));
+                case Opcode::SUB: return Value(wrapSub(x, y));
+                case Opcode::MUL: return Value(wrapMul(x, y));
+                default: break;
+            }
+            if (y == 0) {
+                throw std::runtime_error(op == Opcode::MOD ? "Modulo by zero" : "Division by zero");
+            }
+            if (y == -1) {
+                // INT64_MIN / -1 overflows
+                return Value(op == Opcode::MOD ? int64_t(0) : wrapSub(0, x));
+            }
+            return Value(op == Opcode::MOD ? x % y : x / y);
+        }
+
+        const char* name = operatorSymbol(op);
+        if (!a.isNumber() || !b.isNumber()) {
+            operandError(name, a, b);
+        }
+        double l = a.asNumber();
+        double r = b.asNumber();
+        switch (op) {
+            case Opcode::ADD: return Value(l + r);
+            case Opcode::SUB: return Value(l - r);
+            case Opcode::MUL: return Value(l * r);
+            case Opcode::DIV: return Value(l / r);
+            case Opcode::MOD: return Value(std::fmod(l, r));
+            default: operandError(name, a, b);
+        }
+    }
+
+    bool lessThan(const Value& a, const Value& b, bool orEqual) {
+        if (a.isInt() && b.isInt()) {
+            return orEqual ? a.asInt() <= b.asInt() : a.asInt() < b.asInt();
+        }
+        if (a.isNumber() && b.isNumber()) {
+            return orEqual ? a.asNumber() <= b.asNumber() : a.asNumber() < b.asNumber();
+        }
+        if (a.isString() && b.isString()) {
+            return orEqual ? a.asString() <= b.asString() : a.asString() < b.asString();
+        }
+        operandError(orEqual ? "<=" : "<", a, b);
+    }
+
+    Value negate(const Value& value) {
+        if (value.isInt()) {
+            return Value(wrapSub(0, value.asInt()));
+        }
+        if (value.isDouble()) {
+            return Value(-value.asDouble());
+        }
+        throw std::runtime_error(std::string("Cannot negate ") + typeName(value));
+    }
+
+} // namespace interpreter
@@ -1,20 +1,19 @@
-#include "Interpreter.h"
-#include "Runtime.h"
-#include "Builtins.h"
+#include "BytecodeCompiler.h"
+#include "VM.h"
 #include "../tocin-compiler/src/lexer/lexer.h"
 #include "../tocin-compiler/src/parser/parser.h"
 #include "../tocin-compiler/src/error/error_handler.h"
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
 
 namespace interpreter {
 
     void runRepl() {
         error::ErrorHandler errorHandler;
-        Interpreter interpreter(errorHandler);
-        std::unordered_map<std::string, BuiltinFunction> builtins;
-        Builtins::registerBuiltins(builtins);
+        // Both live for the whole session so globals carry over between lines
+        VM vm;
+        BytecodeCompiler compiler(vm.getNatives(), vm.getGlobals());
 
         std::cout << "Tocin Interpreter REPL" << std::endl;
         std::cout << "Type 'exit' to quit" << std::endl;
@@ -29,14 +28,7 @@ namespace interpreter {
             }
 
             lexer::Lexer lexer(input, "<repl>");
-            std::vector<lexer::Token> tokens = lexer.tokenize();
-
-            if (errorHandler.hasErrors()) {
-                errorHandler.clearErrors();
-                continue;
-            }
-
-            parser::Parser parser(tokens);
+            parser::Parser parser(lexer);
             ast::StmtPtr stmt = parser.parse();
 
             if (errorHandler.hasErrors()) {
@@ -44,7 +36,11 @@ namespace interpreter {
                 continue;
             }
 
-            interpreter.interpret(stmt);
+            try {
+                vm.run(compiler.compile(stmt));
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            }
         }
     }
 
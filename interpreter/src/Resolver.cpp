@@ -0,0 +1,236 @@
+#include "Resolver.h"
+
+namespace interpreter {
+
+    Resolution Resolver::resolve(ast::Statement* program) {
+        result = Resolution();
+        functions.clear();
+        // The script is a function whose outermost scope holds globals
+        functions.push_back({program, {Scope()}});
+        if (auto* block = dynamic_cast<ast::BlockStmt*>(program)) {
+            for (const auto& stmt : block->statements) {
+                statement(stmt.get());
+            }
+        } else {
+            statement(program);
+        }
+        functions.clear();
+        return std::move(result);
+    }
+
+    void Resolver::statement(ast::Statement* stmt) {
+        if (stmt) {
+            stmt->accept(*this);
+        }
+    }
+
+    void Resolver::expression(ast::Expression* expr) {
+        if (expr) {
+            expr->accept(*this);
+        }
+    }
+
+    void Resolver::function(const void* node, const std::vector<ast::Parameter>& params,
+                            ast::Statement* body, ast::Expression* bodyExpr) {
+        functions.push_back({node, {Scope()}});
+        for (const auto& param : params) {
+            declare(param.name, &param);
+        }
+        if (bodyExpr) {
+            expression(bodyExpr);
+        } else if (auto* block = dynamic_cast<ast::BlockStmt*>(body)) {
+            // As in the compiler, the body block shares the parameters' scope
+            for (const auto& stmt : block->statements) {
+                statement(stmt.get());
+            }
+        } else {
+            statement(body);
+        }
+        functions.pop_back();
+    }
+
+    void Resolver::declare(const std::string& name, const void* declaration) {
+        if (functions.size() == 1 && functions.back().scopes.size() == 1) {
+            return; // Global
+        }
+        functions.back().scopes.back()[name] = declaration;
+    }
+
+    void Resolver::use(const std::string& name) {
+        for (auto function = functions.rbegin(); function != functions.rend(); ++function) {
+            for (auto scope = function->scopes.rbegin(); scope != function->scopes.rend(); ++scope) {
+                auto it = scope->find(name);
+                if (it == scope->end()) {
+                    continue;
+                }
+                if (function != functions.rbegin()) {
+                    result.captured.insert(it->second);
+                    result.functionsWithEnv.insert(function->node);
+                }
+                return;
+            }
+        }
+    }
+
+    // --- Expressions ---
+
+    void Resolver::visitBinaryExpr(ast::BinaryExpr* expr) {
+        expression(expr->left.get());
+        expression(expr->right.get());
+    }
+
+    void Resolver::visitGroupingExpr(ast::GroupingExpr* expr) {
+        expression(expr->expression.get());
+    }
+
+    void Resolver::visitLiteralExpr(ast::LiteralExpr*) {}
+
+    void Resolver::visitUnaryExpr(ast::UnaryExpr* expr) {
+        expression(expr->right.get());
+    }
+
+    void Resolver::visitVariableExpr(ast::VariableExpr* expr) {
+        use(expr->name);
+    }
+
+    void Resolver::visitAssignExpr(ast::AssignExpr* expr) {
+        expression(expr->value.get());
+        if (expr->isVariableAssignment()) {
+            use(expr->name);
+        } else {
+            expression(expr->target.get());
+        }
+    }
+
+    void Resolver::visitCallExpr(ast::CallExpr* expr) {
+        expression(expr->callee.get());
+        for (const auto& argument : expr->arguments) {
+            expression(argument.get());
+        }
+    }
+
+    void Resolver::visitGetExpr(ast::GetExpr* expr) {
+        expression(expr->object.get());
+    }
+
+    void Resolver::visitSetExpr(ast::SetExpr* expr) {
+        expression(expr->object.get());
+        expression(expr->value.get());
+    }
+
+    void Resolver::visitListExpr(ast::ListExpr* expr) {
+        for (const auto& element : expr->elements) {
+            expression(element.get());
+        }
+    }
+
+    void Resolver::visitArrayLiteralExpr(ast::ArrayLiteralExpr* expr) {
+        for (const auto& element : expr->elements) {
+            expression(element.get());
+        }
+    }
+
+    void Resolver::visitDictionaryExpr(ast::DictionaryExpr* expr) {
+        for (const auto& entry : expr->entries) {
+            expression(entry.first.get());
+            expression(entry.second.get());
+        }
+    }
+
+    void Resolver::visitLambdaExpr(ast::LambdaExpr* expr) {
+        function(expr, expr->parameters, nullptr, expr->body.get());
+    }
+
+    void Resolver::visitStringInterpolationExpr(ast::StringInterpolationExpr* expr) {
+        for (const auto& value : expr->getExpressions()) {
+            expression(value.get());
+        }
+    }
+
+    // The compiler rejects these; there is nothing to resolve
+    void Resolver::visitAwaitExpr(ast::AwaitExpr*) {}
+    void Resolver::visitNewExpr(ast::NewExpr*) {}
+    void Resolver::visitDeleteExpr(ast::DeleteExpr*) {}
+    void Resolver::visitChannelSendExpr(ast::ChannelSendExpr*) {}
+    void Resolver::visitChannelReceiveExpr(ast::ChannelReceiveExpr*) {}
+    void Resolver::visitMoveExpr(void*) {}
+    void Resolver::visitGoExpr(void*) {}
+    void Resolver::visitRuntimeChannelSendExpr(void*) {}
+    void Resolver::visitRuntimeChannelReceiveExpr(void*) {}
+
+    // --- Statements ---
+
+    void Resolver::visitExpressionStmt(ast::ExpressionStmt* stmt) {
+        expression(stmt->expression.get());
+    }
+
+    void Resolver::visitVariableStmt(ast::VariableStmt* stmt) {
+        // The initializer sees the outer binding of the name
+        expression(stmt->initializer.get());
+        declare(stmt->name, stmt);
+    }
+
+    void Resolver::visitBlockStmt(ast::BlockStmt* stmt) {
+        functions.back().scopes.emplace_back();
+        for (const auto& child : stmt->statements) {
+            statement(child.get());
+        }
+        functions.back().scopes.pop_back();
+    }
+
+    void Resolver::visitIfStmt(ast::IfStmt* stmt) {
+        expression(stmt->condition.get());
+        statement(stmt->thenBranch.get());
+        for (const auto& branch : stmt->elifBranches) {
+            expression(branch.first.get());
+            statement(branch.second.get());
+        }
+        statement(stmt->elseBranch.get());
+    }
+
+    void Resolver::visitWhileStmt(ast::WhileStmt* stmt) {
+        expression(stmt->condition.get());
+        statement(stmt->body.get());
+    }
+
+    void Resolver::visitForStmt(ast::ForStmt* stmt) {
+        functions.back().scopes.emplace_back();
+        expression(stmt->iterable.get());
+        declare(stmt->variable, stmt);
+        statement(stmt->body.get());
+        functions.back().scopes.pop_back();
+    }
+
+    void Resolver::visitFunctionStmt(ast::FunctionStmt* stmt) {
+        // Declared first so the body can call itself
+        declare(stmt->name, stmt);
+        function(stmt, stmt->parameters, stmt->body.get(), nullptr);
+    }
+
+    void Resolver::visitReturnStmt(ast::ReturnStmt* stmt) {
+        expression(stmt->value.get());
+    }
+
+    void Resolver::visitMatchStmt(ast::MatchStmt* stmt) {
+        expression(stmt->value.get());
+        for (const auto& matchCase : stmt->cases) {
+            expression(matchCase.first.get());
+            statement(matchCase.second.get());
+        }
+        statement(stmt->defaultCase.get());
+    }
+
+    void Resolver::visitExportStmt(ast::ExportStmt* stmt) {
+        statement(stmt->declaration.get());
+    }
+
+    void Resolver::visitClassStmt(ast::ClassStmt*) {}
+    void Resolver::visitImportStmt(ast::ImportStmt*) {}
+    void Resolver::visitModuleStmt(ast::ModuleStmt*) {}
+    void Resolver::visitSelectStmt(ast::SelectStmt*) {}
+    void Resolver::visitGoStmt(ast::GoStmt*) {}
+    void Resolver::visitTraitStmt(ast::TraitStmt*) {}
+    void Resolver::visitImplStmt(ast::ImplStmt*) {}
+    void Resolver::visitRuntimeSelectStmt(void*) {}
+
+} // namespace interpreter
@@ -1,20 +1,302 @@
 #include "Runtime.h"
+#include <cmath>
+#include <functional>
+#include <sstream>
 
 namespace interpreter {
 
-    // Function implementation
-    Function::Function(const std::string& name, const std::vector<std::string>& params, const std::vector<Value>& body)
-        : name(name), params(params), body(body) {}
+    Value::Value(int64_t i) {
+        if (fitsSmallInt(i)) {
+            bits = kIntTag | (static_cast<uint64_t>(i) & kPayloadMask);
+        } else {
+            bits = kNil;
+            *this = Value(new IntObject(i));
+        }
+    }
 
-    const std::string& Function::getName() const { return name; }
-    const std::vector<std::string>& Function::getParams() const { return params; }
-    const std::vector<Value>& Function::getBody() const { return body; }
+    Value::Value(double d) {
+        if (d != d) {
+            bits = kCanonicalNaN;
+        } else {
+            std::memcpy(&bits, &d, sizeof d);
+        }
+    }
 
-    // Class implementation
-    Class::Class(const std::string& name, const std::unordered_map<std::string, Value>& methods)
-        : name(name), methods(methods) {}
+    Value::Value(const char* s) : Value(new StringObject(s)) {}
 
-    const std::string& Class::getName() const { return name; }
-    const std::unordered_map<std::string, Value>& Class::getMethods() const { return methods; }
+    Value::Value(std::string s) : Value(new StringObject(std::move(s))) {}
 
-} // namespace interpreter 
\ No newline at end of file
+    Value::Value(Array elements) : Value(new ArrayObject(std::move(elements))) {}
+
+    Value::Value(Dict entries) : Value(new DictObject(std::move(entries))) {}
+
+    Value::Value(Object* object) : bits(kObjectTag | reinterpret_cast<uint64_t>(object)) {
+        object->refCount++;
+    }
+
+    Array& Value::mutableArray() {
+        auto* array = static_cast<ArrayObject*>(asObject());
+        if (array->refCount > 1) {
+            *this = Value(new ArrayObject(array->elements));
+            array = static_cast<ArrayObject*>(asObject());
+        }
+        return array->elements;
+    }
+
+    Dict& Value::mutableDict() {
+        auto* dict = static_cast<DictObject*>(asObject());
+        if (dict->refCount > 1) {
+            *this = Value(new DictObject(dict->entries));
+            dict = static_cast<DictObject*>(asObject());
+        }
+        return dict->entries;
+    }
+
+    void Value::destroy(Object* object) {
+        delete object;
+    }
+
+    Dict::Dict(const Dict& other) : shape(other.shape), values(other.values) {
+        if (other.ownShape) {
+            ownShape = other.ownShape->unshare();
+            shape = ownShape.get();
+        }
+    }
+
+    Dict& Dict::operator=(const Dict& other) {
+        if (this != &other) {
+            Dict copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Value& Dict::operator[](const std::string& key) {
+        int slot = shape->find(key);
+        if (slot >= 0) {
+            return values[slot];
+        }
+        if (!ownShape) {
+            if (const Shape* next = shape->withKey(key)) {
+                grow(next, Value());
+                return values.back();
+            }
+            leaveTransitionTree();
+        }
+        ownShape->add(key);
+        values.emplace_back();
+        return values.back();
+    }
+
+    bool Dict::erase(const std::string& key) {
+        int slot = shape->find(key);
+        if (slot < 0) {
+            return false;
+        }
+        // Shapes only ever grow along the tree, so a deletion goes private
+        leaveTransitionTree();
+        ownShape->remove(slot);
+        values.erase(values.begin() + slot);
+        return true;
+    }
+
+    void Dict::leaveTransitionTree() {
+        if (!ownShape) {
+            ownShape = shape->unshare();
+            shape = ownShape.get();
+        }
+    }
+
+    int GlobalTable::slotOf(const std::string& name) {
+        auto it = slots.find(name);
+        if (it != slots.end()) {
+            return it->second;
+        }
+        int slot = static_cast<int>(names.size());
+        names.push_back(name);
+        slots.emplace(name, slot);
+        values.emplace_back();
+        defined.push_back(0);
+        return slot;
+    }
+
+    int GlobalTable::find(const std::string& name) const {
+        auto it = slots.find(name);
+        return it != slots.end() ? it->second : -1;
+    }
+
+    bool isTruthy(const Value& value) {
+        if (value.isBool()) {
+            return value.asBool();
+        }
+        if (value.isNil()) {
+            return false;
+        }
+        if (value.isSmallInt()) {
+            return value.asSmallInt() != 0;
+        }
+        if (value.isDouble()) {
+            return value.asDouble() != 0.0;
+        }
+        // Boxed ints are never zero
+        return true;
+    }
+
+    bool valuesEqual(const Value& a, const Value& b) {
+        if (a.identical(b)) {
+            // NaN is the only double that differs from itself
+            return !a.isDouble() || a.asDouble() == a.asDouble();
+        }
+        // Ints and floats compare by numeric value
+        if (a.isNumber() && b.isNumber()) {
+            if (a.isInt() && b.isInt()) {
+                return a.asInt() == b.asInt();
+            }
+            return a.asNumber() == b.asNumber();
+        }
+        if (!a.isObject() || !b.isObject() || a.asObject()->getType() != b.asObject()->getType()) {
+            return false;
+        }
+        switch (a.asObject()->getType()) {
+            case ObjectType::String:
+                return a.asString() == b.asString();
+            case ObjectType::Array: {
+                const auto& x = a.asArray();
+                const auto& y = b.asArray();
+                if (x.size() != y.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < x.size(); ++i) {
+                    if (!valuesEqual(x[i], y[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ObjectType::Dict: {
+                const auto& x = a.asDict();
+                const auto& y = b.asDict();
+                if (x.size() != y.size()) {
+                    return false;
+                }
+                for (const auto& [key, value] : x) {
+                    const Value* other = y.find(key);
+                    if (!other || !valuesEqual(value, *other)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                // Functions and classes compare by identity
+                return false;
+        }
+    }
+
+    size_t hashValue(const Value& value) {
+        if (value.isInt()) {
+            return std::hash<int64_t>()(value.asInt());
+        }
+        if (value.isDouble()) {
+            // Integral doubles hash like the ints they equal
+            double d = value.asDouble();
+            if (d == std::floor(d) && std::fabs(d) < 9.2e18) {
+                return std::hash<int64_t>()(static_cast<int64_t>(d));
+            }
+            return std::hash<double>()(d);
+        }
+        if (!value.isObject()) {
+            return value.isNil() ? 0x9e3779b9 : value.asBool() ? 1 : 2;
+        }
+        switch (value.asObject()->getType()) {
+            case ObjectType::String:
+                return std::hash<std::string>()(value.asString());
+            case ObjectType::Array: {
+                size_t hash = value.asArray().size();
+                for (const auto& element : value.asArray()) {
+                    hash = hash * 31 + hashValue(element);
+                }
+                return hash;
+            }
+            case ObjectType::Dict: {
+                // Equal dictionaries may differ in order
+                size_t hash = value.asDict().size();
+                for (const auto& [key, item] : value.asDict()) {
+                    hash += std::hash<std::string>()(key) ^ (hashValue(item) * 31);
+                }
+                return hash;
+            }
+            default:
+                return std::hash<const void*>()(value.asObject());
+        }
+    }
+
+    namespace {
+
+        std::string quoted(const Value& value) {
+            return value.isString() ? "\"" + value.asString() + "\"" : stringify(value);
+        }
+
+    } // namespace
+
+    std::string stringify(const Value& value) {
+        if (value.isNil()) {
+            return "nil";
+        }
+        if (value.isBool()) {
+            return value.asBool() ? "true" : "false";
+        }
+        if (value.isDouble()) {
+            double d = value.asDouble();
+            std::ostringstream out;
+            if (std::isfinite(d) && d == std::floor(d) && std::fabs(d) < 1e15) {
+                out << static_cast<int64_t>(d) << ".0";
+            } else {
+                out << d;
+            }
+            return out.str();
+        }
+        if (value.isInt()) {
+            return std::to_string(value.asInt());
+        }
+        switch (value.asObject()->getType()) {
+            case ObjectType::String:
+                return value.asString();
+            case ObjectType::Function:
+                return "<function " + value.asFunction()->getName() + ">";
+            case ObjectType::Class:
+                return "<class " + value.asClass()->getName() + ">";
+            case ObjectType::Array: {
+                std::string out = "[";
+                const auto& array = value.asArray();
+                for (size_t i = 0; i < array.size(); ++i) {
+                    if (i > 0) out += ", ";
+                    out += quoted(array[i]);
+                }
+                return out + "]";
+            }
+            case ObjectType::Dict: {
+                std::string out = "{";
+                bool first = true;
+                for (const auto& [key, item] : value.asDict()) {
+                    if (!first) out += ", ";
+                    first = false;
+                    out += "\"" + key + "\": " + quoted(item);
+                }
+                return out + "}";
+            }
+            default:
+                return "<environment>";
+        }
+    }
+
+    const char* typeName(const Value& value) {
+        if (value.isNil()) return "nil";
+        if (value.isBool()) return "bool";
+        if (value.isDouble()) return "float";
+        if (value.isInt()) return "int";
+        static const char* const names[] = {"int", "string", "array", "dict", "function", "class", "environment"};
+        return names[static_cast<int>(value.asObject()->getType())];
+    }
+
+} // namespace interpreter
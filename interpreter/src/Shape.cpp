@@ -0,0 +1,70 @@
+#include "Shape.h"
+
+namespace interpreter {
+
+    const Shape* Shape::empty() {
+        static const Shape root(true);
+        return &root;
+    }
+
+    int Shape::find(const std::string& key) const {
+        if (keys.size() <= kLinearSearchKeys) {
+            for (size_t slot = 0; slot < keys.size(); ++slot) {
+                if (keys[slot] == key) {
+                    return static_cast<int>(slot);
+                }
+            }
+            return -1;
+        }
+        auto it = slots.find(key);
+        return it != slots.end() ? it->second : -1;
+    }
+
+    const Shape* Shape::withKey(const std::string& key) const {
+        auto it = transitions.find(key);
+        if (it != transitions.end()) {
+            return it->second.get();
+        }
+        if (keys.size() >= kMaxSharedKeys) {
+            return nullptr;
+        }
+        std::unique_ptr<Shape> next(new Shape(true));
+        next->keys = keys;
+        next->keys.push_back(key);
+        next->reindex();
+        return transitions.emplace(key, std::move(next)).first->second.get();
+    }
+
+    std::unique_ptr<Shape> Shape::unshare() const {
+        std::unique_ptr<Shape> copy(new Shape(false));
+        copy->keys = keys;
+        copy->slots = slots;
+        return copy;
+    }
+
+    int Shape::add(const std::string& key) {
+        int slot = static_cast<int>(keys.size());
+        keys.push_back(key);
+        if (keys.size() == kLinearSearchKeys + 1) {
+            reindex();
+        } else if (keys.size() > kLinearSearchKeys) {
+            slots.emplace(key, slot);
+        }
+        return slot;
+    }
+
+    void Shape::remove(int slot) {
+        keys.erase(keys.begin() + slot);
+        reindex();
+    }
+
+    void Shape::reindex() {
+        slots.clear();
+        if (keys.size() > kLinearSearchKeys) {
+            for (size_t slot = 0; slot < keys.size(); ++slot) {
+                slots.emplace(keys[slot], static_cast<int>(slot));
+            }
+        }
+    }
+
+} // namespace interpreter
@@ -0,0 +1,585 @@
+#include "VM.h"
+#include "Environment.h"
+#include "MemoTable.h"
+#include "Operators.h"
+#include <iterator>
+#include <stdexcept>
+
+// Token-threaded dispatch: each handler jumps straight to the next one
+// through a label table instead of returning to a central switch, which
+// gives the branch predictor one indirect jump per opcode to learn.
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_COMPUTED_GOTO 1
+#else
+#define TOCIN_COMPUTED_GOTO 0
+#endif
+
+namespace interpreter {
+
+    namespace {
+
+        size_t checkedIndex(const Value& index, size_t size) {
+            if (!index.isInt()) {
+                throw std::runtime_error(std::string("Index must be int, not ") + typeName(index));
+            }
+            int64_t i = index.asInt();
+            if (i < 0 || static_cast<uint64_t>(i) >= size) {
+                throw std::runtime_error("Index " + std::to_string(i) + " out of range");
+            }
+            return static_cast<size_t>(i);
+        }
+
+        const std::string& keyString(const Value& key) {
+            if (!key.isString()) {
+                throw std::runtime_error(std::string("Dictionary keys must be strings, not ") + typeName(key));
+            }
+            return key.asString();
+        }
+
+        bool isLengthKey(const Value& key) {
+            return key.isString() && key.asString() == "length";
+        }
+
+        Value getIndex(const Value& object, const Value& key) {
+            if (object.isArray()) {
+                const Array& array = object.asArray();
+                if (isLengthKey(key)) {
+                    return Value(static_cast<int64_t>(array.size()));
+                }
+                return array[checkedIndex(key, array.size())];
+            }
+            if (object.isDict()) {
+                const Value* value = object.asDict().find(keyString(key));
+                return value ? *value : Value();
+            }
+            if (object.isString()) {
+                const std::string& str = object.asString();
+                if (isLengthKey(key)) {
+                    return Value(static_cast<int64_t>(str.size()));
+                }
+                return Value(std::string(1, str[checkedIndex(key, str.size())]));
+            }
+            throw std::runtime_error(std::string("Cannot index ") + typeName(object));
+        }
+
+        void setIndex(Value& object, const Value& key, const Value& value) {
+            // mutable*() copies the container only if another value shares it
+            if (object.isArray()) {
+                size_t index = checkedIndex(key, object.asArray().size());
+                object.mutableArray()[index] = value;
+                return;
+            }
+            if (object.isDict()) {
+                object.mutableDict()[keyString(key)] = value;
+                return;
+            }
+            throw std::runtime_error(std::string("Cannot assign into ") + typeName(object));
+        }
+
+        // Slow paths of GETFIELD/SETFIELD: look the key up and remember
+        // where it was for the next dictionary of the same shape
+        Value loadField(const Value& object, FieldCache& cache) {
+            if (!object.isDict()) {
+                return getIndex(object, cache.key);
+            }
+            const Dict& dict = object.asDict();
+            int slot = dict.getShape()->find(cache.key.asString());
+            if (slot < 0) {
+                return Value();
+            }
+            if (dict.getShape()->isShared()) {
+                cache.remember(dict.getShape(), slot);
+            }
+            return dict.slot(slot);
+        }
+
+        void storeField(Value& object, FieldCache& cache, Value value) {
+            if (!object.isDict()) {
+                setIndex(object, cache.key, value);
+                return;
+            }
+            Dict& dict = object.mutableDict();
+            const Shape* shape = dict.getShape();
+            const std::string& key = cache.key.asString();
+            int slot = shape->find(key);
+            if (slot >= 0) {
+                dict.slot(slot) = std::move(value);
+                if (shape->isShared()) {
+                    cache.remember(shape, slot);
+                }
+                return;
+            }
+            const Shape* next = shape->isShared() ? shape->withKey(key) : nullptr;
+            if (next) {
+                dict.grow(next, std::move(value));
+                cache.remember(shape, static_cast<int>(shape->size()), next);
+                return;
+            }
+            dict[key] = std::move(value);
+        }
+
+        // Functions with captured locals get a fresh environment per call,
+        // chained to the one the function was created in
+        Value frameEnvironment(const Function* function) {
+            size_t size = function->getChunk().envSize;
+            return size ? Value(new Environment(size, function->getEnv())) : function->getEnv();
+        }
+
+    } // namespace
+
+    VM::VM() : stack(kStackSize) {
+        frames.reserve(kMaxFrames);
+    }
+
+    void VM::defineGlobal(const std::string& name, Value value) {
+        globals.define(globals.slotOf(name), std::move(value));
+    }
+
+    Value VM::run(const Value& script) {
+        if (!script.isFunction()) {
+            throw std::runtime_error(std::string("Cannot run ") + typeName(script));
+        }
+        const Function* function = script.asFunction();
+        size_t entryDepth = frames.size();
+        Value* base = stack.data();
+        if (!frames.empty()) {
+            base = frames.back().base + frames.back().function->getChunk().numRegisters;
+        }
+        const Chunk& chunk = function->getChunk();
+        if (base + chunk.numRegisters > stack.data() + stack.size()) {
+            throw std::runtime_error("Stack overflow");
+        }
+        frames.push_back({function, chunk.code.data(), base, frameEnvironment(function), Value()});
+
+        try {
+            return execute(entryDepth);
+        } catch (const std::runtime_error& error) {
+            std::string message = "line " + std::to_string(currentLine()) + ": " + error.what();
+            frames.resize(entryDepth);
+            throw std::runtime_error(message);
+        } catch (...) {
+            frames.resize(entryDepth);
+            throw;
+        }
+    }
+
+    int VM::currentLine() const {
+        if (frames.empty()) {
+            return 0;
+        }
+        const CallFrame& frame = frames.back();
+        const Chunk& chunk = frame.function->getChunk();
+        auto offset = frame.pc - chunk.code.data() - 1;
+        if (offset < 0 || static_cast<size_t>(offset) >= chunk.lines.size()) {
+            return 0;
+        }
+        return chunk.lines[offset];
+    }
+
+    void VM::runtimeError(const std::string& message) const {
+        throw std::runtime_error(message);
+    }
+
+#if TOCIN_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+    Value VM::execute(size_t entryDepth) {
+        CallFrame* frame = &frames.back();
+        const Instruction* pc = frame->pc;
+        Value* R = frame->base;
+        const Value* K = frame->function->getChunk().constants.data();
+        FieldCache* F = frame->function->getChunk().fieldCaches.data();
+        Instruction i;
+
+        // Handlers save pc before anything that can throw so that run()
+        // can report the failing line. A computed goto does not destroy the
+        // locals of the scope it leaves, so anything owning memory must be
+        // gone or moved from by the time a handler dispatches.
+#define SAVE_PC() (frame->pc = pc)
+#define RA R[argA(i)]
+#define RB R[argB(i)]
+#define RC R[argC(i)]
+
+#if TOCIN_COMPUTED_GOTO
+#define TOCIN_OPCODE_LABEL(name) &&op_##name,
+        static const void* const dispatchTable[] = {TOCIN_OPCODES(TOCIN_OPCODE_LABEL)};
+#undef TOCIN_OPCODE_LABEL
+#define DISPATCH()                                    \
+    do {                                              \
+        i = *pc++;                                    \
+        goto *dispatchTable[i & 0xff];                \
+    } while (0)
+#define CASE(name) op_##name:
+        DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Opcode::name:
+    dispatch:
+        i = *pc++;
+        switch (opcodeOf(i)) {
+#endif
+
+        CASE(LOADK) {
+            RA = K[argBx(i)];
+            DISPATCH();
+        }
+        CASE(LOADNIL) {
+            RA = Value();
+            DISPATCH();
+        }
+        CASE(LOADBOOL) {
+            RA = Value(argB(i) != 0);
+            DISPATCH();
+        }
+        CASE(LOADINT) {
+            RA = Value(static_cast<int64_t>(argSBx(i)));
+            DISPATCH();
+        }
+        CASE(MOVE) {
+            RA = RB;
+            DISPATCH();
+        }
+        CASE(GETGLOBAL) {
+            if (!globals.isDefined(argBx(i))) {
+                SAVE_PC();
+                runtimeError("Undefined variable '" + globals.name(argBx(i)) + "'");
+            }
+            RA = globals.get(argBx(i));
+            DISPATCH();
+        }
+        CASE(SETGLOBAL) {
+            if (!globals.isDefined(argBx(i))) {
+                SAVE_PC();
+                runtimeError("Undefined variable '" + globals.name(argBx(i)) + "'");
+            }
+            globals.set(argBx(i), RA);
+            DISPATCH();
+        }
+        CASE(DEFGLOBAL) {
+            globals.define(argBx(i), RA);
+            DISPATCH();
+        }
+        CASE(GETENV) {
+            RA = static_cast<Environment*>(frame->env.asObject())->outer(argB(i))->slot(argC(i));
+            DISPATCH();
+        }
+        CASE(SETENV) {
+            static_cast<Environment*>(frame->env.asObject())->outer(argB(i))->slot(argC(i)) = RA;
+            DISPATCH();
+        }
+        CASE(CLOSURE) {
+            RA = Value(new Function(*K[argBx(i)].asFunction(), frame->env));
+            DISPATCH();
+        }
+
+#define TOCIN_ARITH(name, intOp)                                    \
+    CASE(name) {                                                    \
+        if (RB.isSmallInt() && RC.isSmallInt()) {                   \
+            RA = Value(intOp(RB.asSmallInt(), RC.asSmallInt()));    \
+        } else {                                                    \
+            SAVE_PC();                                              \
+            RA = arithmetic(Opcode::name, RB, RC);                  \
+        }                                                           \
+        DISPATCH();                                                 \
+    }
+        TOCIN_ARITH(ADD, wrapAdd)
+        TOCIN_ARITH(SUB, wrapSub)
+        TOCIN_ARITH(MUL, wrapMul)
+#undef TOCIN_ARITH
+
+        CASE(DIV) {
+            SAVE_PC();
+            RA = arithmetic(Opcode::DIV, RB, RC);
+            DISPATCH();
+        }
+        CASE(MOD) {
+            if (RB.isSmallInt() && RC.isSmallInt() && RC.asSmallInt() > 0) {
+                RA = Value(RB.asSmallInt() % RC.asSmallInt());
+            } else {
+                SAVE_PC();
+                RA = arithmetic(Opcode::MOD, RB, RC);
+            }
+            DISPATCH();
+        }
+        CASE(EQ) {
+            RA = Value(valuesEqual(RB, RC));
+            DISPATCH();
+        }
+        CASE(NE) {
+            RA = Value(!valuesEqual(RB, RC));
+            DISPATCH();
+        }
+        CASE(LT) {
+            if (RB.isSmallInt() && RC.isSmallInt()) {
+                RA = Value(RB.asSmallInt() < RC.asSmallInt());
+            } else {
+                SAVE_PC();
+                RA = Value(lessThan(RB, RC, false));
+            }
+            DISPATCH();
+        }
+        CASE(LE) {
+            if (RB.isSmallInt() && RC.isSmallInt()) {
+                RA = Value(RB.asSmallInt() <= RC.asSmallInt());
+            } else {
+                SAVE_PC();
+                RA = Value(lessThan(RB, RC, true));
+            }
+            DISPATCH();
+        }
+        CASE(NEG) {
+            if (RB.isSmallInt()) {
+                RA = Value(wrapSub(0, RB.asSmallInt()));
+            } else {
+                SAVE_PC();
+                RA = negate(RB);
+            }
+            DISPATCH();
+        }
+        CASE(NOT) {
+            RA = Value(!isTruthy(RB));
+            DISPATCH();
+        }
+        CASE(JMP) {
+            if (argSBx(i) < 0) {
+                ++frame->function->getChunk().profile.backedges;
+            }
+            pc += argSBx(i);
+            DISPATCH();
+        }
+        CASE(JMPIF) {
+            if (isTruthy(RA)) {
+                pc += argSBx(i);
+            }
+            DISPATCH();
+        }
+        CASE(JMPIFNOT) {
+            if (!isTruthy(RA)) {
+                pc += argSBx(i);
+            }
+            DISPATCH();
+        }
+        CASE(CALL) {
+            SAVE_PC();
+            if (!RA.isFunction()) {
+                runtimeError(std::string("Cannot call ") + typeName(RA));
+            }
+            const Function* function = RA.asFunction();
+            const Chunk& chunk = function->getChunk();
+            if (argB(i) != chunk.arity) {
+                runtimeError(function->getName() + "() takes " + std::to_string(chunk.arity) +
+                             " arguments but " + std::to_string(argB(i)) + " were given");
+            }
+            Value* base = R + argA(i) + 1;
+            if (frames.size() >= kMaxFrames || base + chunk.numRegisters > stack.data() + stack.size()) {
+                runtimeError("Stack overflow");
+            }
+            if (chunk.native) {
+                if (NativeEntry entry = chunk.native->entry.load(std::memory_order_acquire)) {
+                    Value result;
+                    if (entry(base, &result, globals.data(), static_cast<int64_t>(frames.size())) == 0) {
+                        RA = std::move(result);
+                        for (int n = 0; n < chunk.arity; ++n) {
+                            base[n] = Value();
+                        }
+                        DISPATCH();
+                    }
+                    // Run the call again in the interpreter
+                    if (++chunk.native->bailouts == JitTier::kMaxBailouts) {
+                        chunk.native->entry.store(nullptr, std::memory_order_relaxed);
+                    }
+                }
+            } else if (jit.isEnabled()) {
+                Profile& profile = chunk.profile;
+                ++profile.calls;
+                for (int n = 0; n < chunk.arity && !profile.nonIntArguments; ++n) {
+                    profile.nonIntArguments = !base[n].isSmallInt();
+                }
+                if (JitTier::isHot(profile)) {
+                    jit.request(RA, globals);
+                }
+            }
+            Value memoArgs;
+            if (chunk.memoize) {
+                bool hit = false;
+                {
+                    Array args(base, base + chunk.arity);
+                    if (const Value* cached = function->memoTable().find(args)) {
+                        RA = *cached;
+                        hit = true;
+                    } else {
+                        memoArgs = Value(std::move(args));
+                    }
+                }
+                if (hit) {
+                    for (int n = 0; n < chunk.arity; ++n) {
+                        base[n] = Value();
+                    }
+                    DISPATCH();
+                }
+            }
+            frames.push_back({function, chunk.code.data(), base, frameEnvironment(function), std::move(memoArgs)});
+            frame = &frames.back();
+            pc = frame->pc;
+            R = base;
+            K = chunk.constants.data();
+            F = chunk.fieldCaches.data();
+            DISPATCH();
+        }
+        CASE(CALLNATIVE) {
+            SAVE_PC();
+            // Argument registers are temporaries; moving out of them keeps
+            // stale references from forcing copy-on-write copies later
+            {
+                std::vector<Value> args(std::make_move_iterator(R + argA(i)),
+                                        std::make_move_iterator(R + argA(i) + argB(i)));
+                RA = natives.function(argC(i))(args);
+            }
+            DISPATCH();
+        }
+        CASE(RETURN) {
+            Value result = argB(i) ? std::move(RA) : Value();
+            if (frame->memoArgs.isArray()) {
+                frame->function->memoTable().insert(frame->memoArgs.asArray(), result);
+            }
+            // Drop the frame's references so the values it touched are
+            // unshared again
+            for (Value* r = R, *end = R + frame->function->getChunk().numRegisters; r != end; ++r) {
+                *r = Value();
+            }
+            frames.pop_back();
+            if (frames.size() == entryDepth) {
+                return result;
+            }
+            // The callee's frame starts just past the register that held it
+            R[-1] = std::move(result);
+            frame = &frames.back();
+            pc = frame->pc;
+            R = frame->base;
+            K = frame->function->getChunk().constants.data();
+            F = frame->function->getChunk().fieldCaches.data();
+            DISPATCH();
+        }
+        CASE(NEWARRAY) {
+            RA = Value(Array(R + argB(i), R + argB(i) + argC(i)));
+            DISPATCH();
+        }
+        CASE(NEWDICT) {
+            Dict dict;
+            for (int n = 0; n < argC(i); ++n) {
+                const Value& key = R[argB(i) + 2 * n];
+                dict[key.isString() ? key.asString() : stringify(key)] = R[argB(i) + 2 * n + 1];
+            }
+            RA = Value(std::move(dict));
+            DISPATCH();
+        }
+        CASE(GETINDEX) {
+            SAVE_PC();
+            // Via a temporary: the target may be the indexed register
+            Value value = getIndex(RB, RC);
+            RA = std::move(value);
+            DISPATCH();
+        }
+        CASE(SETINDEX) {
+            SAVE_PC();
+            setIndex(RA, RB, RC);
+            DISPATCH();
+        }
+        CASE(GETFIELD) {
+            FieldCache& cache = F[argC(i)];
+            if (RB.isDict()) {
+                const Dict& dict = RB.asDict();
+                if (const FieldCache::Entry* hit = cache.lookup(dict.getShape())) {
+                    // Via a temporary: the target may be the object register
+                    Value value = dict.slot(hit->slot);
+                    RA = std::move(value);
+                    DISPATCH();
+                }
+            }
+            SAVE_PC();
+            Value value = loadField(RB, cache);
+            RA = std::move(value);
+            DISPATCH();
+        }
+        CASE(SETFIELD) {
+            FieldCache& cache = F[argB(i)];
+            if (RA.isDict()) {
+                // Copy-on-write keeps the shape, so the lookup can follow it
+                Dict& dict = RA.mutableDict();
+                if (const FieldCache::Entry* hit = cache.lookup(dict.getShape())) {
+                    if (hit->next) {
+                        dict.grow(hit->next, RC);
+                    } else {
+                        dict.slot(hit->slot) = RC;
+                    }
+                    DISPATCH();
+                }
+            }
+            SAVE_PC();
+            storeField(RA, cache, RC);
+            DISPATCH();
+        }
+        CASE(CONCAT) {
+            std::string result;
+            for (int n = 0; n < argC(i); ++n) {
+                result += stringify(R[argB(i) + n]);
+            }
+            RA = Value(std::move(result));
+            DISPATCH();
+        }
+        CASE(FORITER) {
+            Value* iter = &RA;
+            int64_t index = iter[1].asSmallInt();
+            if (index == 0 && iter[0].isDict()) {
+                // Dictionaries iterate over a snapshot of their keys
+                Array keys;
+                for (const auto& entry : iter[0].asDict()) {
+                    keys.emplace_back(entry.first);
+                }
+                iter[0] = Value(std::move(keys));
+            }
+            if (iter[0].isArray()) {
+                const Array& array = iter[0].asArray();
+                if (static_cast<size_t>(index) < array.size()) {
+                    iter[2] = array[index];
+                    iter[1] = Value(index + 1);
+                    DISPATCH();
+                }
+            } else if (iter[0].isString()) {
+                const std::string& str = iter[0].asString();
+                if (static_cast<size_t>(index) < str.size()) {
+                    iter[2] = Value(std::string(1, str[index]));
+                    iter[1] = Value(index + 1);
+                    DISPATCH();
+                }
+            } else {
+                SAVE_PC();
+                runtimeError(std::string("Cannot iterate over ") + typeName(iter[0]));
+            }
+            pc += argSBx(i);
+            DISPATCH();
+        }
+
+#if !TOCIN_COMPUTED_GOTO
+            default:
+                break;
+        }
+        SAVE_PC();
+        runtimeError("Invalid opcode");
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef RC
+#undef RB
+#undef RA
+#undef SAVE_PC
+    }
+
+#if TOCIN_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+} // namespace interpreter
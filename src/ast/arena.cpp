@@ -0,0 +1,25 @@
+#include "arena.h"
+
+namespace ast
+{
+
+    void *Arena::allocateSlow(size_t size, size_t alignment)
+    {
+        // Oversized requests get a block of their own, so the current block
+        // keeps its free space
+        size_t blockSize = size + alignment > kBlockSize ? size + alignment : kBlockSize;
+        std::unique_ptr<char[]> block(new char[blockSize]);
+        char *begin = block.get();
+        reserved += blockSize;
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(begin) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (blockSize == kBlockSize)
+        {
+            next = reinterpret_cast<char *>(aligned + size);
+            end = begin + blockSize;
+        }
+        blocks.push_back(std::move(block));
+        used += size;
+        return reinterpret_cast<void *>(aligned);
+    }
+
+} // namespace ast
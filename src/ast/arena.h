@@ -0,0 +1,112 @@
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+
+    /**
+     * @brief Bump allocator for the nodes of one compilation unit.
+     *
+     * Nodes are carved out of large blocks one after another, so creating a
+     * node is a pointer bump instead of a call to malloc, nodes parsed
+     * together sit together in memory, and the whole tree is returned to the
+     * system a block at a time. Freeing an individual node does nothing; the
+     * blocks go when the arena does. Allocation is not thread safe.
+     */
+    class Arena
+    {
+    public:
+        static constexpr size_t kBlockSize = 64 * 1024;
+
+        Arena() = default;
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        void *allocate(size_t size, size_t alignment)
+        {
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            if (next && aligned + size <= reinterpret_cast<uintptr_t>(end))
+            {
+                next = reinterpret_cast<char *>(aligned + size);
+                used += size;
+                return reinterpret_cast<void *>(aligned);
+            }
+            return allocateSlow(size, alignment);
+        }
+
+        /**
+         * @brief Bytes handed out so far.
+         */
+        size_t bytesUsed() const { return used; }
+
+        /**
+         * @brief Bytes reserved from the system.
+         */
+        size_t bytesReserved() const { return reserved; }
+
+    private:
+        void *allocateSlow(size_t size, size_t alignment);
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *next = nullptr;
+        char *end = nullptr;
+        size_t used = 0;
+        size_t reserved = 0;
+    };
+
+    /**
+     * @brief Standard allocator drawing from an Arena.
+     *
+     * Each node's shared_ptr control block keeps a copy, and through it a
+     * reference to the arena, so the arena lives exactly as long as the
+     * last node allocated from it.
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(std::shared_ptr<Arena> arena) : arena(std::move(arena)) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+        T *allocate(size_t n)
+        {
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *, size_t) {}
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+    private:
+        template <typename U>
+        friend class ArenaAllocator;
+
+        std::shared_ptr<Arena> arena;
+    };
+
+    /**
+     * @brief Creates a node in an arena; the result is an ordinary shared_ptr.
+     */
+    template <typename T, typename... Args>
+    std::shared_ptr<T> makeNode(const std::shared_ptr<Arena> &arena, Args &&...args)
+    {
+        return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+    }
+
+} // namespace ast
+
+#endif // AST_ARENA_H
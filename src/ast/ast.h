@@ -2,6 +2,7 @@
 #define AST_H
 
 #include "../lexer/token.h"
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -601,8 +602,13 @@ namespace ast
         TypePtr returnType;
         StmtPtr body;
         bool isAsync;
+        std::vector<std::string> decorators; // Names from @name lines before the def
 
         bool isGeneric() const { return !typeParameters.empty(); }
+        bool hasDecorator(const std::string &decorator) const
+        {
+            return std::find(decorators.begin(), decorators.end(), decorator) != decorators.end();
+        }
     };
 
     /**
@@ -844,9 +850,11 @@ namespace ast
             ExprPtr channel;
             StmtPtr body;
             bool isDefault;
+            ExprPtr value; // Send: value to send; receive: optional variable bound to the result
+            bool isSend;
 
-            Case(ExprPtr ch, StmtPtr b, bool def = false)
-                : channel(std::move(ch)), body(std::move(b)), isDefault(def) {}
+            Case(ExprPtr ch, StmtPtr b, bool def = false, ExprPtr v = nullptr, bool send = false)
+                : channel(std::move(ch)), body(std::move(b)), isDefault(def), value(std::move(v)), isSend(send) {}
         };
 
         SelectStmt(const lexer::Token &token, std::vector<Case> cases)
@@ -15,6 +15,7 @@
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/Casting.h>
 #include <iostream>
+#include <atomic>
 #include <vector>
 
 using namespace codegen;
@@ -150,6 +151,31 @@ void IRGenerator::declareStdLibFunctions()
     llvm::Function *futureGetFunc = llvm::Function::Create(
         futureGetType, llvm::Function::ExternalLinkage, "Future_get", *module);
     stdLibFunctions["Future_get"] = futureGetFunc;
+
+    // Runtime math and numeric kernels. The stdlib calls them as
+    // __native_<name>; the JIT and the linker resolve native_<name>.
+    // Pointer parameters take lists (see visitCallExpr)
+    llvm::Type *doubleType = llvm::Type::getDoubleTy(context);
+    llvm::Type *int64Type = llvm::Type::getInt64Ty(context);
+    llvm::Type *voidType = llvm::Type::getVoidTy(context);
+    llvm::Type *ptrType = llvm::PointerType::get(context, 0);
+    auto bindNative = [&](const std::string &name, llvm::Type *result, std::vector<llvm::Type *> params)
+    {
+        llvm::Function *func = llvm::Function::Create(
+            llvm::FunctionType::get(result, params, false),
+            llvm::Function::ExternalLinkage, "native_" + name, *module);
+        stdLibFunctions["__native_" + name] = func;
+        nativeFunctions.insert(func);
+    };
+    for (const char *name : {"sqrt", "log", "exp", "sin", "cos", "tan", "asin", "acos", "atan"})
+    {
+        bindNative(name, doubleType, {doubleType});
+    }
+    bindNative("pow", doubleType, {doubleType, doubleType});
+    bindNative("vec_dot", doubleType, {ptrType, ptrType, int64Type});
+    bindNative("vec_axpy", voidType, {doubleType, ptrType, ptrType, int64Type});
+    bindNative("vec_add", voidType, {ptrType, ptrType, ptrType, int64Type});
+    bindNative("mat_mul", voidType, {ptrType, ptrType, ptrType, int64Type, int64Type, int64Type});
 }
 
 // Get a standard library function by name
@@ -261,6 +287,12 @@ llvm::Type *IRGenerator::getLLVMType(ast::TypePtr type)
         return llvm::PointerType::get(context, 0);
     }
 
+    // Channels are runtime handles; element values travel as words
+    if (std::dynamic_pointer_cast<ast::ChannelType>(type))
+    {
+        return llvm::PointerType::get(context, 0);
+    }
+
     // Handle generic types
     if (auto genericType = std::dynamic_pointer_cast<ast::GenericType>(type))
     {
@@ -414,6 +446,9 @@ void IRGenerator::visitLiteralExpr(ast::LiteralExpr *expr)
 
 void IRGenerator::visitVariableStmt(ast::VariableStmt *stmt)
 {
+    bool global = promoteToGlobal;
+    promoteToGlobal = false;
+
     // Get the variable type
     llvm::Type *varType = nullptr;
 
@@ -448,11 +483,37 @@ void IRGenerator::visitVariableStmt(ast::VariableStmt *stmt)
         return;
     }
 
-    // Create an alloca instruction in the entry block of the current function
-    llvm::AllocaInst *alloca = createEntryBlockAlloca(currentFunction, stmt->name, varType);
+    llvm::Value *storage = nullptr;
+    if (global)
+    {
+        // A REPL variable outlives its input; rebinding a name from an
+        // earlier input reuses that input's global
+        llvm::GlobalVariable *variable = module->getGlobalVariable(stmt->name);
+        if (variable && variable->getValueType() != varType)
+        {
+            errorHandler.reportError(error::ErrorCode::T001_TYPE_MISMATCH,
+                                     "Cannot change the type of '" + stmt->name + "'",
+                                     "", 0, 0, error::ErrorSeverity::ERROR);
+            return;
+        }
+        if (!variable)
+        {
+            variable = new llvm::GlobalVariable(*module, varType, false,
+                                                llvm::GlobalValue::ExternalLinkage,
+                                                llvm::Constant::getNullValue(varType), stmt->name);
+        }
+        storage = variable;
+    }
+    else
+    {
+        // Create an alloca instruction in the entry block of the current function
+        llvm::AllocaInst *alloca = createEntryBlockAlloca(currentFunction, stmt->name, varType);
 
-    // Store the variable in the symbol table
-    namedValues[stmt->name] = alloca;
+        // Store the variable in the symbol table
+        namedValues[stmt->name] = alloca;
+        variableTypes[stmt->name] = stmt->type;
+        storage = alloca;
+    }
 
     // If there's an initializer, store its value
     if (stmt->initializer)
@@ -488,7 +549,7 @@ void IRGenerator::visitVariableStmt(ast::VariableStmt *stmt)
         }
 
         // Store the initial value
-        builder.CreateStore(lastValue, alloca);
+        builder.CreateStore(lastValue, storage);
     }
 }
 
@@ -654,6 +715,7 @@ void IRGenerator::visitFunctionStmt(ast::FunctionStmt *stmt)
                 arg.getType(), nullptr, stmt->parameters[idx].name);
             builder.CreateStore(&arg, alloca);
             namedValues[stmt->parameters[idx].name] = alloca;
+            variableTypes[stmt->parameters[idx].name] = stmt->parameters[idx].type;
         }
         idx++;
     }
@@ -706,6 +768,7 @@ void IRGenerator::visitFunctionStmt(ast::FunctionStmt *stmt)
     
     // Clear named values for next function
     namedValues.clear();
+    variableTypes.clear();
 }
 
 void IRGenerator::visitReturnStmt(ast::ReturnStmt *stmt)
@@ -847,6 +910,24 @@ void IRGenerator::visitCallExpr(ast::CallExpr *expr)
         args.push_back(lastValue);
     }
 
+    // Natives take the element buffer of a list and C scalar types
+    auto nativeFunc = llvm::dyn_cast<llvm::Function>(callee);
+    if (nativeFunc && nativeFunctions.count(nativeFunc))
+    {
+        for (size_t i = 0; i < args.size() && i < funcType->getNumParams(); ++i)
+        {
+            llvm::Type *paramType = funcType->getParamType(i);
+            args[i] = paramType->isPointerTy() && args[i]->getType()->isPointerTy()
+                          ? listData(args[i])
+                          : implicitConversion(args[i], paramType);
+            if (!args[i])
+            {
+                lastValue = nullptr;
+                return;
+            }
+        }
+    }
+
     // Create the call instruction
     lastValue = builder.CreateCall(funcType, callee, args);
 }
@@ -1289,7 +1370,7 @@ void IRGenerator::visitLambdaExpr(ast::LambdaExpr *expr)
     llvm::FunctionType *functionType = llvm::FunctionType::get(returnType, paramTypes, false);
 
     // Create unique name for the lambda
-    static int lambdaCounter = 0;
+    static std::atomic<int> lambdaCounter{0}; // Modules are generated on several threads
     std::string lambdaName = "lambda_" + std::to_string(lambdaCounter++);
 
     // Create function
@@ -1538,6 +1619,15 @@ void IRGenerator::createEmptyList(ast::TypePtr listTypeArg)
     lastValue = listAlloc;
 }
 
+// Load the element buffer out of a { length, data } list
+llvm::Value *IRGenerator::listData(llvm::Value *list)
+{
+    llvm::StructType *listStructType = llvm::StructType::get(
+        context, {llvm::Type::getInt64Ty(context), llvm::PointerType::get(context, 0)});
+    llvm::Value *dataPtr = builder.CreateStructGEP(listStructType, list, 1, "list.data_ptr");
+    return builder.CreateLoad(llvm::PointerType::get(context, 0), dataPtr, "list.data");
+}
+
 void IRGenerator::visitDictionaryExpr(ast::DictionaryExpr *expr)
 {
     if (expr->entries.empty())
@@ -2463,8 +2553,20 @@ bool IRGenerator::handleVariableAssignment(ast::AssignExpr *expr, llvm::Value *r
 
         // Look up the variable in the current scope
         llvm::AllocaInst *alloca = currentScope ? currentScope->lookup(name) : lookupVariable(name);
+        llvm::Value *storage = alloca;
+        llvm::Type *storedType = alloca ? alloca->getAllocatedType() : nullptr;
 
+        // Otherwise it may be a REPL variable from an earlier input
         if (!alloca)
+        {
+            if (llvm::GlobalVariable *global = module->getGlobalVariable(name))
+            {
+                storage = global;
+                storedType = global->getValueType();
+            }
+        }
+
+        if (!storage)
         {
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
                                      "Undefined variable: " + name,
@@ -2474,17 +2576,17 @@ bool IRGenerator::handleVariableAssignment(ast::AssignExpr *expr, llvm::Value *r
         }
 
         // Validate that initializer type matches variable type
-        if (rhs->getType() != alloca->getAllocatedType())
+        if (rhs->getType() != storedType)
         {
             // Simple cast for numeric values
-            if (rhs->getType()->isIntegerTy() && alloca->getAllocatedType()->isIntegerTy())
+            if (rhs->getType()->isIntegerTy() && storedType->isIntegerTy())
             {
-                rhs = builder.CreateIntCast(rhs, alloca->getAllocatedType(), true, "cast");
+                rhs = builder.CreateIntCast(rhs, storedType, true, "cast");
             }
             else if ((rhs->getType()->isFloatTy() || rhs->getType()->isDoubleTy()) &&
-                     (alloca->getAllocatedType()->isFloatTy() || alloca->getAllocatedType()->isDoubleTy()))
+                     (storedType->isFloatTy() || storedType->isDoubleTy()))
             {
-                rhs = builder.CreateFPCast(rhs, alloca->getAllocatedType(), "cast");
+                rhs = builder.CreateFPCast(rhs, storedType, "cast");
             }
             else
             {
@@ -2496,7 +2598,7 @@ bool IRGenerator::handleVariableAssignment(ast::AssignExpr *expr, llvm::Value *r
         }
 
         // Store the initial value
-        builder.CreateStore(rhs, alloca);
+        builder.CreateStore(rhs, storage);
         return true;
     }
 
@@ -2528,6 +2630,8 @@ std::unique_ptr<llvm::Module> IRGenerator::generate(ast::StmtPtr ast)
     // Exit the global scope
     exitScope();
 
+    joinGoroutines(*module);
+
     // Verify the module
     std::string verificationErrors;
     llvm::raw_string_ostream errStream(verificationErrors);
@@ -2541,6 +2645,85 @@ std::unique_ptr<llvm::Module> IRGenerator::generate(ast::StmtPtr ast)
     return std::move(module);
 }
 
+std::unique_ptr<llvm::Module> IRGenerator::generateReplInput(ast::StmtPtr ast, const std::string &entryName)
+{
+    if (!ast)
+    {
+        errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                 "Null AST passed to IRGenerator",
+                                 "", 0, 0, error::ErrorSeverity::FATAL);
+        return nullptr;
+    }
+
+    std::vector<ast::StmtPtr> statements;
+    if (auto block = std::dynamic_pointer_cast<ast::BlockStmt>(ast))
+    {
+        statements = block->statements;
+    }
+    else
+    {
+        statements.push_back(ast);
+    }
+
+    enterScope();
+
+    // Declarations first, at module scope; they leave the builder wherever
+    // they finished, so the entry function is started afterwards
+    std::vector<ast::StmtPtr> body;
+    for (auto &statement : statements)
+    {
+        ast::Statement *raw = statement.get();
+        if (!raw)
+        {
+            continue;
+        }
+        if (dynamic_cast<ast::FunctionStmt *>(raw) || dynamic_cast<ast::ClassStmt *>(raw) ||
+            dynamic_cast<ast::TraitStmt *>(raw) || dynamic_cast<ast::ImplStmt *>(raw) ||
+            dynamic_cast<ast::ImportStmt *>(raw) || dynamic_cast<ast::ExportStmt *>(raw) ||
+            dynamic_cast<ast::ModuleStmt *>(raw))
+        {
+            raw->accept(*this);
+        }
+        else
+        {
+            body.push_back(statement);
+        }
+    }
+
+    llvm::FunctionType *entryType = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+    llvm::Function *entry = llvm::Function::Create(
+        entryType, llvm::Function::ExternalLinkage, entryName, *module);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", entry));
+    currentFunction = entry;
+
+    for (auto &statement : body)
+    {
+        promoteToGlobal = dynamic_cast<ast::VariableStmt *>(statement.get()) != nullptr;
+        statement->accept(*this);
+        promoteToGlobal = false;
+    }
+    if (!builder.GetInsertBlock()->getTerminator())
+    {
+        builder.CreateRetVoid();
+    }
+
+    currentFunction = nullptr;
+    namedValues.clear();
+    variableTypes.clear();
+    exitScope();
+
+    std::string verificationErrors;
+    llvm::raw_string_ostream errStream(verificationErrors);
+    if (llvm::verifyModule(*module, &errStream))
+    {
+        errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                 "Module verification failed: " + verificationErrors,
+                                 "", 0, 0, error::ErrorSeverity::ERROR);
+    }
+
+    return std::move(module);
+}
+
 /**
  * @brief Look up a variable in the current scope and global scope
  *
@@ -2694,22 +2877,9 @@ void IRGenerator::visitMoveExpr(void *expr)
 
 void IRGenerator::visitGoExpr(void *expr)
 {
-    // GoExpr: emit a call to a runtime stub for goroutine launch
-    auto goExpr = static_cast<ast::GoStmt *>(expr);
-    if (goExpr && goExpr->expression) {
-        // Evaluate the function call expression
-        goExpr->expression->accept(*this);
-        llvm::Value *fnCall = lastValue;
-        // Emit a call to a runtime stub (e.g., __tocin_go_launch)
-        llvm::Function *goStub = getStdLibFunction("__tocin_go_launch");
-        if (!goStub) {
-            // Declare the stub if not present
-            llvm::FunctionType *goType = llvm::FunctionType::get(
-                llvm::Type::getVoidTy(context), {fnCall->getType()}, false);
-            goStub = llvm::Function::Create(goType, llvm::Function::ExternalLinkage, "__tocin_go_launch", *module);
-        }
-        builder.CreateCall(goStub, {fnCall});
-        lastValue = nullptr;
+    // GoExpr: same lowering as the typed visitor (runtime_schedule_goroutine)
+    if (auto goStmt = static_cast<ast::GoStmt *>(expr)) {
+        visitGoStmt(goStmt);
     } else {
         lastValue = nullptr;
     }
@@ -2758,16 +2928,12 @@ void IRGenerator::visitRuntimeChannelReceiveExpr(void *expr)
 
 void IRGenerator::visitRuntimeSelectStmt(void *stmt)
 {
-    // SelectStmt: emit a call to a runtime stub for select
-    auto selectStmt = static_cast<ast::SelectStmt *>(stmt);
-    // For now, just emit a call to a stub (real implementation would be more complex)
-    llvm::Function *selectStub = getStdLibFunction("__tocin_chan_select");
-    if (!selectStub) {
-        llvm::FunctionType *selectType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(context), {}, false);
-        selectStub = llvm::Function::Create(selectType, llvm::Function::ExternalLinkage, "__tocin_chan_select", *module);
+    // SelectStmt: same lowering as the typed visitor (runtime_select)
+    if (auto selectStmt = static_cast<ast::SelectStmt *>(stmt)) {
+        visitSelectStmt(selectStmt);
+    } else {
+        lastValue = nullptr;
     }
-    lastValue = builder.CreateCall(selectStub, {});
 }
 
 // AST channel visitor methods - empty implementations for now
@@ -3146,6 +3312,10 @@ void IRGenerator::visitVariableExpr(ast::VariableExpr *expr)
     {
         lastValue = builder.CreateLoad(alloca->getAllocatedType(), alloca, expr->name);
     }
+    else if (llvm::GlobalVariable *global = module->getGlobalVariable(expr->name))
+    {
+        lastValue = builder.CreateLoad(global->getValueType(), global, expr->name);
+    }
     else
     {
         lastValue = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), 0);
@@ -3222,64 +3392,98 @@ void IRGenerator::visitAwaitExpr(ast::AwaitExpr *expr)
 }
 
 void codegen::IRGenerator::visitGoStmt(ast::GoStmt* stmt) {
-    // Generate IR for goroutine launch (go statement)
-    
-    // First, generate IR for the expression (function call)
-    stmt->expression->accept(*this);
-    llvm::Value* functionCall = lastValue;
-    
-    if (!functionCall) {
+    // Generate IR for goroutine launch (go statement). As in Go, the callee
+    // and its arguments are evaluated here; the call itself runs on the
+    // fiber scheduler through runtime_schedule_goroutine(entry, env).
+    auto callExpr = std::dynamic_pointer_cast<ast::CallExpr>(stmt->expression);
+    if (!callExpr) {
         errorHandler.reportError(error::ErrorCode::C013_INVALID_SPAWN_OPERATION,
-                               "Invalid expression in go statement",
+                               "Go statement requires a function call",
                                std::string(stmt->token.filename), stmt->token.line, stmt->token.column,
                                error::ErrorSeverity::ERROR);
+        lastValue = nullptr;
         return;
     }
-    
-    // Get the function type
-    llvm::FunctionType* funcType = nullptr;
-    if (auto callInst = llvm::dyn_cast<llvm::CallInst>(functionCall)) {
-        funcType = callInst->getFunctionType();
+
+    // Resolve the callee the same way visitCallExpr does
+    llvm::Function* callee = nullptr;
+    if (auto varExpr = std::dynamic_pointer_cast<ast::VariableExpr>(callExpr->callee)) {
+        auto it = stdLibFunctions.find(varExpr->name);
+        callee = it != stdLibFunctions.end() ? it->second : module->getFunction(varExpr->name);
     } else {
+        callExpr->callee->accept(*this);
+        callee = lastValue ? llvm::dyn_cast<llvm::Function>(lastValue) : nullptr;
+    }
+    if (!callee) {
         errorHandler.reportError(error::ErrorCode::C013_INVALID_SPAWN_OPERATION,
-                               "Go statement requires a function call",
+                               "Invalid expression in go statement",
                                std::string(stmt->token.filename), stmt->token.line, stmt->token.column,
                                error::ErrorSeverity::ERROR);
+        lastValue = nullptr;
         return;
     }
-    
-    // Create a wrapper function that will be executed in a goroutine
-    std::string wrapperName = "goroutine_wrapper_" + std::to_string(getNextId());
+    llvm::FunctionType* funcType = callee->getFunctionType();
+
+    // Evaluate the arguments in the launching goroutine
+    std::vector<llvm::Value*> args;
+    std::vector<llvm::Type*> argTypes;
+    for (size_t i = 0; i < callExpr->arguments.size(); ++i) {
+        callExpr->arguments[i]->accept(*this);
+        llvm::Value* arg = lastValue;
+        if (arg && i < funcType->getNumParams()) {
+            arg = implicitConversion(arg, funcType->getParamType(i));
+        }
+        if (!arg) {
+            lastValue = nullptr;
+            return;
+        }
+        args.push_back(arg);
+        argTypes.push_back(arg->getType());
+    }
+
+    // Capture them in a heap environment; the runtime frees it after the call
+    llvm::Type* ptrType = llvm::PointerType::get(context, 0);
+    llvm::StructType* envType = llvm::StructType::get(context, argTypes);
+    llvm::Value* env = llvm::ConstantPointerNull::get(llvm::PointerType::get(context, 0));
+    if (!args.empty()) {
+        llvm::Function* mallocFunc = getStdLibFunction("malloc");
+        if (!mallocFunc) {
+            mallocFunc = llvm::Function::Create(
+                llvm::FunctionType::get(ptrType, {llvm::Type::getInt64Ty(context)}, false),
+                llvm::Function::ExternalLinkage, "malloc", module.get());
+        }
+        llvm::Value* envSize = llvm::ConstantExpr::getSizeOf(envType);
+        env = builder.CreateCall(mallocFunc, {envSize}, "go.env");
+        for (size_t i = 0; i < args.size(); ++i) {
+            builder.CreateStore(args[i], builder.CreateStructGEP(envType, env, i));
+        }
+    }
+
+    // Entry point: void goroutine_wrapper_N(ptr env) unpacks and makes the call
     llvm::Function* wrapperFunc = llvm::Function::Create(
-        llvm::FunctionType::get(llvm::Type::getVoidTy(context), false),
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), {ptrType}, false),
         llvm::Function::InternalLinkage,
-        wrapperName,
+        "goroutine_wrapper_" + std::to_string(getNextId()),
         module.get()
     );
-    
-    // Create the wrapper function body
-    llvm::BasicBlock* entryBlock = llvm::BasicBlock::Create(context, "entry", wrapperFunc);
-    builder.SetInsertPoint(entryBlock);
-    
-    // Call the original function
-    builder.CreateCall(funcType, functionCall);
-    
-    // Return void
+    llvm::IRBuilderBase::InsertPoint savedInsertPoint = builder.saveIP();
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", wrapperFunc));
+    llvm::Value* wrapperEnv = wrapperFunc->getArg(0);
+    std::vector<llvm::Value*> unpacked;
+    for (size_t i = 0; i < args.size(); ++i) {
+        unpacked.push_back(builder.CreateLoad(argTypes[i], builder.CreateStructGEP(envType, wrapperEnv, i)));
+    }
+    builder.CreateCall(funcType, callee, unpacked);
     builder.CreateRetVoid();
-    
-    // Schedule the wrapper function to run in a goroutine
-    // This would typically call a runtime function to schedule the task
-    std::vector<llvm::Value*> args = {
-        llvm::ConstantExpr::getBitCast(wrapperFunc, llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0))
-    };
-    
+    builder.restoreIP(savedInsertPoint);
+
     // Get the runtime scheduler function
     llvm::Function* schedulerFunc = module->getFunction("runtime_schedule_goroutine");
     if (!schedulerFunc) {
         // Create the runtime function declaration if it doesn't exist
         llvm::FunctionType* schedulerType = llvm::FunctionType::get(
             llvm::Type::getVoidTy(context),
-            {llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0)},
+            {ptrType, ptrType}, // entry, env
             false
         );
         schedulerFunc = llvm::Function::Create(
@@ -3289,12 +3493,32 @@ void codegen::IRGenerator::visitGoStmt(ast::GoStmt* stmt) {
             module.get()
         );
     }
-    
-    // Call the scheduler
-    builder.CreateCall(schedulerFunc, args);
-    
-    // Set the current value to void
-    lastValue = llvm::Constant::getNullValue(llvm::Type::getVoidTy(context));
+
+    builder.CreateCall(schedulerFunc, {wrapperFunc, env});
+    lastValue = nullptr;
+}
+
+void codegen::IRGenerator::joinGoroutines(llvm::Module& module) {
+    // A program that launched goroutines waits for them before main returns
+    llvm::Function* mainFunc = module.getFunction("main");
+    if (!mainFunc || mainFunc->isDeclaration() || !module.getFunction("runtime_schedule_goroutine")) {
+        return;
+    }
+
+    llvm::FunctionCallee waitAll = module.getOrInsertFunction(
+        "runtime_wait_all", llvm::FunctionType::get(llvm::Type::getVoidTy(module.getContext()), false));
+    for (llvm::User* user : waitAll.getCallee()->users()) {
+        auto* call = llvm::dyn_cast<llvm::CallInst>(user);
+        if (call && call->getFunction() == mainFunc) {
+            return;
+        }
+    }
+
+    for (auto& block : *mainFunc) {
+        if (auto* ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+            llvm::CallInst::Create(waitAll, "", ret);
+        }
+    }
 }
 
 void codegen::IRGenerator::visitChannelSendExpr(ast::ChannelSendExpr* expr) {
@@ -3335,7 +3559,7 @@ void codegen::IRGenerator::visitChannelSendExpr(ast::ChannelSendExpr* expr) {
     
     // Cast channel and value to void pointers for the runtime call
     llvm::Value* channelPtr = builder.CreateBitCast(channel, llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0));
-    llvm::Value* valuePtr = builder.CreateBitCast(value, llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0));
+    llvm::Value* valuePtr = toChannelWord(value);
     
     // Call the runtime send function
     std::vector<llvm::Value*> args = {channelPtr, valuePtr};
@@ -3384,33 +3608,176 @@ void codegen::IRGenerator::visitChannelReceiveExpr(ast::ChannelReceiveExpr* expr
     std::vector<llvm::Value*> args = {channelPtr};
     llvm::Value* result = builder.CreateCall(receiveFunc, args);
     
-    // Set the current value to the received value
+    // Decode the word back into the element type the sender encoded
+    if (llvm::Type* elementType = channelElementType(expr->channel)) {
+        result = fromChannelWord(result, elementType);
+    }
     lastValue = result;
 }
 
+llvm::Type* codegen::IRGenerator::channelElementType(const ast::ExprPtr& channel) {
+    // Channels are opaque pointers in IR; only a declared channel<T>
+    // (variable or parameter) says what T is
+    auto variable = std::dynamic_pointer_cast<ast::VariableExpr>(channel);
+    if (!variable) {
+        return nullptr;
+    }
+    auto it = variableTypes.find(variable->name);
+    if (it == variableTypes.end()) {
+        return nullptr;
+    }
+    auto channelType = std::dynamic_pointer_cast<ast::ChannelType>(it->second);
+    return channelType ? getLLVMType(channelType->elementType) : nullptr;
+}
+
+llvm::Value* codegen::IRGenerator::toChannelWord(llvm::Value* value) {
+    // Scalars travel through the runtime as pointer-sized words
+    llvm::Type* wordType = llvm::PointerType::get(context, 0);
+    llvm::Type* type = value->getType();
+    if (type->isPointerTy()) {
+        return value;
+    }
+    if (type->isFloatingPointTy()) {
+        value = builder.CreateFPExt(value, llvm::Type::getDoubleTy(context));
+        value = builder.CreateBitCast(value, llvm::Type::getInt64Ty(context));
+    } else if (type->isIntegerTy()) {
+        value = builder.CreateIntCast(value, llvm::Type::getInt64Ty(context), !type->isIntegerTy(1));
+    } else {
+        // Aggregates outlive the sender, so box them on the heap; the
+        // receiver frees the box in fromChannelWord
+        llvm::Function* mallocFunc = getStdLibFunction("malloc");
+        if (!mallocFunc) {
+            mallocFunc = llvm::Function::Create(
+                llvm::FunctionType::get(wordType, {llvm::Type::getInt64Ty(context)}, false),
+                llvm::Function::ExternalLinkage, "malloc", module.get());
+        }
+        llvm::Value* box = builder.CreateCall(mallocFunc, {llvm::ConstantExpr::getSizeOf(type)}, "chan.box");
+        builder.CreateStore(value, box);
+        return box;
+    }
+    return builder.CreateIntToPtr(value, wordType);
+}
+
+void codegen::IRGenerator::freeChannelBox(llvm::Value* box) {
+    llvm::Function* freeFunc = getStdLibFunction("free");
+    if (!freeFunc) {
+        freeFunc = llvm::Function::Create(
+            llvm::FunctionType::get(llvm::Type::getVoidTy(context), {llvm::PointerType::get(context, 0)}, false),
+            llvm::Function::ExternalLinkage, "free", module.get());
+    }
+    builder.CreateCall(freeFunc, {box});
+}
+
+llvm::Value* codegen::IRGenerator::fromChannelWord(llvm::Value* word, llvm::Type* targetType) {
+    if (targetType->isPointerTy()) {
+        return word;
+    }
+    llvm::Value* bits = builder.CreatePtrToInt(word, llvm::Type::getInt64Ty(context));
+    if (targetType->isFloatingPointTy()) {
+        return builder.CreateFPTrunc(builder.CreateBitCast(bits, llvm::Type::getDoubleTy(context)), targetType);
+    }
+    if (targetType->isIntegerTy()) {
+        return builder.CreateTrunc(bits, targetType);
+    }
+
+    // Boxed aggregate: unbox and free it. A closed channel yields a null
+    // word, which reads as the zero value.
+    llvm::Function* function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock* before = builder.GetInsertBlock();
+    llvm::BasicBlock* unboxBlock = llvm::BasicBlock::Create(context, "chan.unbox", function);
+    llvm::BasicBlock* doneBlock = llvm::BasicBlock::Create(context, "chan.unboxed", function);
+    builder.CreateCondBr(builder.CreateIsNull(word), doneBlock, unboxBlock);
+
+    builder.SetInsertPoint(unboxBlock);
+    llvm::Value* unboxed = builder.CreateLoad(targetType, word, "chan.value");
+    freeChannelBox(word);
+    builder.CreateBr(doneBlock);
+
+    builder.SetInsertPoint(doneBlock);
+    llvm::PHINode* result = builder.CreatePHI(targetType, 2);
+    result->addIncoming(llvm::Constant::getNullValue(targetType), before);
+    result->addIncoming(unboxed, unboxBlock);
+    return result;
+}
+
 void codegen::IRGenerator::visitSelectStmt(ast::SelectStmt* stmt) {
-    // Generate IR for select statement
-    
-    // Create a function to handle the select logic
-    std::string selectFuncName = "select_handler_" + std::to_string(getNextId());
-    llvm::Function* selectFunc = llvm::Function::Create(
-        llvm::FunctionType::get(llvm::Type::getInt32Ty(context), false), // Returns case index
-        llvm::Function::InternalLinkage,
-        selectFuncName,
-        module.get()
-    );
-    
-    // Create the select function body
-    llvm::BasicBlock* entryBlock = llvm::BasicBlock::Create(context, "entry", selectFunc);
-    builder.SetInsertPoint(entryBlock);
-    
+    // Generate IR for select statement: fill an array of TocinSelectCase
+    // ({channel, value, isSend, ok}), let runtime_select pick one and
+    // switch on the returned index (-1 default, -2 timeout)
+    llvm::Function* currentFunction = builder.GetInsertBlock()->getParent();
+    llvm::Type* ptrType = llvm::PointerType::get(context, 0);
+    llvm::IntegerType* i32Type = llvm::Type::getInt32Ty(context);
+    llvm::StructType* caseType = llvm::StructType::get(context, {ptrType, ptrType, i32Type, i32Type});
+
+    std::vector<const ast::SelectStmt::Case*> channelCases;
+    const ast::SelectStmt::Case* defaultCase = nullptr;
+    for (const auto& selectCase : stmt->cases) {
+        if (selectCase.isDefault) {
+            if (defaultCase) {
+                errorHandler.reportError(error::ErrorCode::C011_INVALID_CHANNEL_OPERATION,
+                                       "Multiple default cases in select statement",
+                                       std::string(stmt->token.filename), stmt->token.line, stmt->token.column,
+                                       error::ErrorSeverity::ERROR);
+                return;
+            }
+            defaultCase = &selectCase;
+        } else {
+            channelCases.push_back(&selectCase);
+        }
+    }
+
+    llvm::ArrayType* casesType = llvm::ArrayType::get(caseType, channelCases.size());
+    llvm::AllocaInst* cases = createEntryBlockAlloca(currentFunction, "select.cases", casesType);
+    std::vector<std::pair<size_t, llvm::Value*>> sentBoxes;
+
+    // Evaluate every channel and send value up front, in source order
+    for (size_t i = 0; i < channelCases.size(); ++i) {
+        const auto* selectCase = channelCases[i];
+        selectCase->channel->accept(*this);
+        llvm::Value* channel = lastValue;
+        if (!channel || !channel->getType()->isPointerTy()) {
+            errorHandler.reportError(error::ErrorCode::C011_INVALID_CHANNEL_OPERATION,
+                                   "Invalid channel in select case",
+                                   std::string(stmt->token.filename), stmt->token.line, stmt->token.column,
+                                   error::ErrorSeverity::ERROR);
+            return;
+        }
+
+        llvm::Value* value = llvm::ConstantPointerNull::get(llvm::PointerType::get(context, 0));
+        if (selectCase->isSend) {
+            selectCase->value->accept(*this);
+            if (!lastValue) {
+                errorHandler.reportError(error::ErrorCode::C011_INVALID_CHANNEL_OPERATION,
+                                       "Invalid value in select send case",
+                                       std::string(stmt->token.filename), stmt->token.line, stmt->token.column,
+                                       error::ErrorSeverity::ERROR);
+                return;
+            }
+            llvm::Type* valueType = lastValue->getType();
+            value = toChannelWord(lastValue);
+            if (!valueType->isPointerTy() && !valueType->isIntegerTy() && !valueType->isFloatingPointTy()) {
+                sentBoxes.emplace_back(i, value);
+            }
+        }
+
+        llvm::Value* caseIndex = llvm::ConstantInt::get(i32Type, i);
+        llvm::Value* zero = llvm::ConstantInt::get(i32Type, 0);
+        auto fieldPtr = [&](unsigned field) {
+            return builder.CreateInBoundsGEP(casesType, cases, {zero, caseIndex, llvm::ConstantInt::get(i32Type, field)});
+        };
+        builder.CreateStore(channel, fieldPtr(0));
+        builder.CreateStore(value, fieldPtr(1));
+        builder.CreateStore(llvm::ConstantInt::get(i32Type, selectCase->isSend ? 1 : 0), fieldPtr(2));
+        builder.CreateStore(llvm::ConstantInt::get(i32Type, 0), fieldPtr(3));
+    }
+
     // Get the runtime select function
     llvm::Function* runtimeSelectFunc = module->getFunction("runtime_select");
     if (!runtimeSelectFunc) {
         // Create the runtime function declaration if it doesn't exist
         llvm::FunctionType* selectType = llvm::FunctionType::get(
-            llvm::Type::getInt32Ty(context), // Returns selected case index
-            {llvm::Type::getInt32Ty(context)}, // Number of cases
+            i32Type, // Returns selected case index
+            {ptrType, i32Type, llvm::Type::getInt1Ty(context), llvm::Type::getInt64Ty(context)}, // cases, count, hasDefault, timeout
             false
         );
         runtimeSelectFunc = llvm::Function::Create(
@@ -3420,60 +3787,77 @@ void codegen::IRGenerator::visitSelectStmt(ast::SelectStmt* stmt) {
             module.get()
         );
     }
-    
-    // Call the runtime select function with the number of cases
+
     std::vector<llvm::Value*> args = {
-        llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), stmt->cases.size())
+        cases,
+        llvm::ConstantInt::get(i32Type, channelCases.size()),
+        llvm::ConstantInt::get(llvm::Type::getInt1Ty(context), defaultCase != nullptr),
+        llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), -1) // No timeout
     };
-    llvm::Value* selectedCase = builder.CreateCall(runtimeSelectFunc, args);
-    
-    // Return the selected case index
-    builder.CreateRet(selectedCase);
-    
-    // Now create the main select logic in the current function
-    llvm::BasicBlock* currentBlock = builder.GetInsertBlock();
-    llvm::Function* currentFunction = currentBlock->getParent();
-    
-    // Call the select handler
-    std::vector<llvm::Value*> callArgs;
-    llvm::Value* caseIndex = builder.CreateCall(selectFunc, callArgs);
-    
-    // Create a switch statement to handle each case
-    llvm::SwitchInst* switchInst = builder.CreateSwitch(caseIndex, nullptr, stmt->cases.size());
-    
-    // Add cases for each select case
-    for (size_t i = 0; i < stmt->cases.size(); ++i) {
-        const auto& selectCase = stmt->cases[i];
-        
-        // Create a basic block for this case
-        llvm::BasicBlock* caseBlock = llvm::BasicBlock::Create(context, 
-            "select_case_" + std::to_string(i), currentFunction);
-        
-        // Add the case to the switch
-        switchInst->addCase(llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), i), caseBlock);
-        
-        // Set the insert point to the case block
+    llvm::Value* selectedCase = builder.CreateCall(runtimeSelectFunc, args, "select.index");
+
+    // Boxed values of send cases that did not fire never reach a receiver
+    for (const auto& [index, box] : sentBoxes) {
+        llvm::BasicBlock* freeBlock = llvm::BasicBlock::Create(context, "select.free", currentFunction);
+        llvm::BasicBlock* nextBlock = llvm::BasicBlock::Create(context, "select.freed", currentFunction);
+        builder.CreateCondBr(builder.CreateICmpNE(selectedCase, llvm::ConstantInt::get(i32Type, index)), freeBlock, nextBlock);
+        builder.SetInsertPoint(freeBlock);
+        freeChannelBox(box);
+        builder.CreateBr(nextBlock);
+        builder.SetInsertPoint(nextBlock);
+    }
+
+    llvm::BasicBlock* endBlock = llvm::BasicBlock::Create(context, "select_end", currentFunction);
+    llvm::SwitchInst* switchInst = builder.CreateSwitch(selectedCase, endBlock, stmt->cases.size());
+
+    auto emitBody = [&](const ast::SelectStmt::Case* selectCase) {
+        if (selectCase->body) {
+            selectCase->body->accept(*this);
+        }
+        if (!builder.GetInsertBlock()->getTerminator()) {
+            builder.CreateBr(endBlock);
+        }
+    };
+
+    for (size_t i = 0; i < channelCases.size(); ++i) {
+        const auto* selectCase = channelCases[i];
+        llvm::BasicBlock* caseBlock = llvm::BasicBlock::Create(context,
+            "select_case_" + std::to_string(i), currentFunction, endBlock);
+        switchInst->addCase(llvm::ConstantInt::get(i32Type, i), caseBlock);
         builder.SetInsertPoint(caseBlock);
-        
-        // Execute the case body
-        if (selectCase.body) {
-            selectCase.body->accept(*this);
-        }
-        
-        // Branch to the end of the select
-        llvm::BasicBlock* endBlock = llvm::BasicBlock::Create(context, "select_end", currentFunction);
-        builder.CreateBr(endBlock);
-        
-        // Set the insert point to the end block
-        builder.SetInsertPoint(endBlock);
+
+        // Bind the received word to `name = <-channel` cases
+        auto target = std::dynamic_pointer_cast<ast::VariableExpr>(selectCase->value);
+        if (!selectCase->isSend && target) {
+            llvm::Value* valuePtr = builder.CreateInBoundsGEP(casesType, cases,
+                {llvm::ConstantInt::get(i32Type, 0), llvm::ConstantInt::get(i32Type, i), llvm::ConstantInt::get(i32Type, 1)});
+            llvm::Value* word = builder.CreateLoad(ptrType, valuePtr, target->name + ".word");
+            llvm::AllocaInst* variable = lookupVariable(target->name);
+            if (!variable) {
+                // `case v = <-ch` declares v with the channel's element type
+                llvm::Type* elementType = channelElementType(selectCase->channel);
+                variable = createEntryBlockAlloca(currentFunction, target->name,
+                                                  elementType ? elementType : ptrType);
+                namedValues[target->name] = variable;
+            }
+            builder.CreateStore(fromChannelWord(word, variable->getAllocatedType()), variable);
+        }
+        emitBody(selectCase);
     }
-    
-    // Set the current value to void
-    lastValue = llvm::Constant::getNullValue(llvm::Type::getVoidTy(context));
+
+    if (defaultCase) {
+        llvm::BasicBlock* defaultBlock = llvm::BasicBlock::Create(context, "select_default", currentFunction, endBlock);
+        switchInst->addCase(llvm::ConstantInt::get(i32Type, -1, true), defaultBlock);
+        builder.SetInsertPoint(defaultBlock);
+        emitBody(defaultCase);
+    }
+
+    builder.SetInsertPoint(endBlock);
+    lastValue = nullptr;
 }
 
 int IRGenerator::getNextId() {
-    static int nextId = 0;
+    static std::atomic<int> nextId{0};
     return ++nextId;
 }
 
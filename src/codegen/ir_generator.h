@@ -14,6 +14,7 @@
 #include <llvm/IR/BasicBlock.h>
 #include <string>
 #include <map>
+#include <set>
 #include <memory>
 #include <vector>
 
@@ -88,6 +89,27 @@ namespace codegen
          */
         std::unique_ptr<llvm::Module> generate(ast::StmtPtr ast);
 
+        /**
+         * @brief Generate one REPL input.
+         *
+         * Declarations (functions, classes, traits, imports) go to module
+         * scope; the remaining top-level statements run in order inside
+         * `void entryName()`. Top-level variables become external globals
+         * so later inputs can reach them. Anything defined by earlier
+         * inputs must already be declared in the module.
+         */
+        std::unique_ptr<llvm::Module> generateReplInput(ast::StmtPtr ast, const std::string &entryName);
+
+        /**
+         * @brief Make `main` wait for every goroutine before it returns.
+         *
+         * Does nothing if the module defines no `main`, launches no
+         * goroutines, or `main` already joins them. generate() runs it on
+         * each module; a build of several modules runs it again once they
+         * are linked, as the goroutines may be launched from an import.
+         */
+        static void joinGoroutines(llvm::Module &module);
+
         // Visitor implementation methods
         void visitBlockStmt(ast::BlockStmt *stmt) override;
         void visitExpressionStmt(ast::ExpressionStmt *stmt) override;
@@ -153,11 +175,14 @@ namespace codegen
         Scope *currentScope = nullptr;
         bool isInAsyncContext = false;
         std::string currentModuleName = "default";
+        bool promoteToGlobal = false; // The next VariableStmt is a REPL top-level variable
         std::unique_ptr<PatternVisitor> patternVisitor;
 
         // Symbol tables
         std::map<std::string, llvm::AllocaInst *> namedValues;                     // Variable symbol table
+        std::map<std::string, ast::TypePtr> variableTypes;                         // Declared types, where LLVM erases them (channels)
         std::map<std::string, llvm::Function *> stdLibFunctions;                   // Standard library functions
+        std::set<llvm::Function *> nativeFunctions;                                // Runtime natives bound as __native_<name>
         std::map<std::string, ClassInfo> classTypes;                               // Class type information
         std::map<std::string, llvm::Function *> classMethods;                      // Class method table
         std::map<std::string, GenericInstance> genericInstances;                   // Instantiated generic types
@@ -190,6 +215,7 @@ namespace codegen
 
         // Memory management
         void createEmptyList(ast::TypePtr listType);
+        llvm::Value *listData(llvm::Value *list);
         void createEmptyDictionary(ast::TypePtr dictType);
         void generateMethod(const std::string &className, llvm::StructType *classType, ast::FunctionStmt *method);
 
@@ -197,6 +223,11 @@ namespace codegen
         llvm::Value *implicitConversion(llvm::Value *value, llvm::Type *targetType);
         bool canConvertImplicitly(llvm::Type *sourceType, llvm::Type *targetType);
         llvm::Value *createDefaultValue(llvm::Type *type);
+        // Channels carry pointer-sized words (see runtime_select)
+        llvm::Value *toChannelWord(llvm::Value *value);
+        llvm::Value *fromChannelWord(llvm::Value *word, llvm::Type *targetType);
+        void freeChannelBox(llvm::Value *box);
+        llvm::Type *channelElementType(const ast::ExprPtr &channel);
 
         // Variable handling
         bool handleVariableAssignment(ast::AssignExpr *expr, llvm::Value *rhs);
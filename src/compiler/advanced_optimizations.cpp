@@ -1,27 +1,145 @@
 #include "advanced_optimizations.h"
-#include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/Utils.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Analysis/CallGraph.h>
 #include <llvm/IR/LegacyPassManager.h>
-#include <llvm/Transforms/Scalar/SROA.h>
-#include <llvm/Transforms/IPO/ConstantHoisting.h>
-#include <llvm/Transforms/Scalar/DCE.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/MDBuilder.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/ProfileData/InstrProfReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Threading.h>
+#include "../llvm_shim.h"
 #include <fstream>
 #include <unordered_set>
 #include <algorithm>
 #include <chrono>
+#include <mutex>
 
 namespace tocin {
 namespace optimization {
 
+// ============================================================================
+// Standard LLVM Pipeline
+// ============================================================================
+
+void runStandardPipeline(llvm::Module& module, int optLevel, int sizeLevel,
+                         llvm::TargetMachine* targetMachine, bool thinLTOPreLink,
+                         std::optional<llvm::PGOOptions> pgo) {
+    llvm::OptimizationLevel level = llvm::OptimizationLevel::O0;
+    if (sizeLevel >= 2) {
+        level = llvm::OptimizationLevel::Oz;
+    } else if (sizeLevel == 1) {
+        level = llvm::OptimizationLevel::Os;
+    } else if (optLevel == 1) {
+        level = llvm::OptimizationLevel::O1;
+    } else if (optLevel == 2) {
+        level = llvm::OptimizationLevel::O2;
+    } else if (optLevel >= 3) {
+        level = llvm::OptimizationLevel::O3;
+    }
+
+    if (targetMachine && module.getTargetTriple().empty()) {
+        module.setTargetTriple(targetMachine->getTargetTriple().str());
+        module.setDataLayout(targetMachine->createDataLayout());
+    }
+
+    // Same defaults as clang: vectorize and unroll from -O2 up, -Os keeps
+    // vectorization, -Oz gives up both for size
+    llvm::PipelineTuningOptions tuning;
+    bool speed = level.getSpeedupLevel() >= 2;
+    tuning.LoopVectorization = speed && level != llvm::OptimizationLevel::Oz;
+    tuning.SLPVectorization = speed && level != llvm::OptimizationLevel::Oz;
+    tuning.LoopUnrolling = speed && level.getSizeLevel() == 0;
+    tuning.LoopInterleaving = tuning.LoopUnrolling;
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassBuilder PB(targetMachine, tuning, pgo);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM = level == llvm::OptimizationLevel::O0
+        ? PB.buildO0DefaultPipeline(level, thinLTOPreLink)
+        : thinLTOPreLink ? PB.buildThinLTOPreLinkDefaultPipeline(level)
+                         : PB.buildPerModuleDefaultPipeline(level);
+    MPM.run(module, MAM);
+}
+
+llvm::CodeGenOptLevel codeGenOptLevel(int optLevel, int sizeLevel) {
+    if (sizeLevel > 0) {
+        return llvm::CodeGenOptLevel::Default;
+    }
+    switch (optLevel) {
+        case 0: return llvm::CodeGenOptLevel::None;
+        case 1: return llvm::CodeGenOptLevel::Less;
+        case 2: return llvm::CodeGenOptLevel::Default;
+        default: return llvm::CodeGenOptLevel::Aggressive;
+    }
+}
+
+TargetCPU resolveTargetCPU(const std::string& cpu) {
+    TargetCPU result;
+    if (cpu.empty() || cpu == "generic") {
+        return result;
+    }
+    if (cpu != "native") {
+        result.name = cpu;
+        return result;
+    }
+
+    result.name = llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> hostFeatures;
+    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+        // Sort so the same host always yields the same feature string
+        std::vector<std::string> features;
+        for (const auto& feature : hostFeatures) {
+            features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        }
+        std::sort(features.begin(), features.end());
+        for (const auto& feature : features) {
+            if (!result.features.empty()) {
+                result.features += ',';
+            }
+            result.features += feature;
+        }
+    }
+    return result;
+}
+
+void applyTargetCPU(llvm::Module& module, const TargetCPU& cpu) {
+    for (auto& function : module) {
+        if (function.isDeclaration()) {
+            continue;
+        }
+        function.addFnAttr("target-cpu", cpu.name);
+        if (!cpu.features.empty()) {
+            function.addFnAttr("target-features", cpu.features);
+        }
+    }
+}
+
 // ============================================================================
 // PGO Manager Implementation
 // ============================================================================
 
-PGOManager::PGOManager() : profilingEnabled_(false) {
+PGOManager::PGOManager() {
     stats_ = {0, 0, 0, 0};
 }
 
@@ -29,147 +147,73 @@ PGOManager::~PGOManager() {
     disableProfiling();
 }
 
-void PGOManager::enableProfiling(llvm::Module* module) {
-    profilingEnabled_ = true;
-    
-    // Insert profiling instrumentation
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        // Insert function entry counter
-        llvm::IRBuilder<> builder(&F.getEntryBlock(), F.getEntryBlock().begin());
-        
-        // Create global counter for this function
-        std::string counterName = "__pgo_counter_" + F.getName().str();
-        llvm::Type* i64Type = llvm::Type::getInt64Ty(module->getContext());
-        
-        llvm::GlobalVariable* counter = module->getGlobalVariable(counterName);
-        if (!counter) {
-            counter = new llvm::GlobalVariable(
-                *module, i64Type, false,
-                llvm::GlobalValue::InternalLinkage,
-                llvm::ConstantInt::get(i64Type, 0),
-                counterName);
-        }
-        
-        // Increment counter on function entry
-        llvm::Value* count = builder.CreateLoad(i64Type, counter, "load_count");
-        llvm::Value* inc = builder.CreateAdd(count, llvm::ConstantInt::get(i64Type, 1), "inc_count");
-        builder.CreateStore(inc, counter);
-        
-        stats_.hotFunctions++; // Track instrumented functions
-    }
+void PGOManager::enableProfiling(const std::string& rawProfilePath) {
+    rawProfilePath_ = rawProfilePath;
 }
 
 void PGOManager::disableProfiling() {
-    profilingEnabled_ = false;
+    rawProfilePath_.clear();
 }
 
-bool PGOManager::loadProfile(const std::string& profilePath) {
-    std::ifstream file(profilePath, std::ios::binary);
-    if (!file.is_open()) {
-        return false;
-    }
-    
-    // Read profile data
-    file.read(reinterpret_cast<char*>(&stats_.totalExecutions), sizeof(stats_.totalExecutions));
-    file.read(reinterpret_cast<char*>(&stats_.hotFunctions), sizeof(stats_.hotFunctions));
-    file.read(reinterpret_cast<char*>(&stats_.coldFunctions), sizeof(stats_.coldFunctions));
-    file.read(reinterpret_cast<char*>(&stats_.branchMispredictions), sizeof(stats_.branchMispredictions));
-    
-    // Read detailed profile data
-    size_t dataSize;
-    file.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize));
-    profileData_.resize(dataSize);
-    file.read(&profileData_[0], dataSize);
-    
-    file.close();
-    return true;
+std::string PGOManager::rawProfilePath(const std::string& directory) {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, "default_%m.profraw");
+    return std::string(path);
+}
+
+void PGOManager::useProfile(const std::string& profilePath) {
+    profilePath_ = profilePath;
 }
 
-bool PGOManager::saveProfile(const std::string& profilePath) {
-    std::ofstream file(profilePath, std::ios::binary);
-    if (!file.is_open()) {
+bool PGOManager::checkProfile(const std::string& profilePath, std::string& error) {
+    auto buffer = llvm::MemoryBuffer::getFile(profilePath);
+    if (!buffer) {
+        error = profilePath + ": " + buffer.getError().message();
         return false;
     }
-    
-    // Write profile statistics
-    file.write(reinterpret_cast<const char*>(&stats_.totalExecutions), sizeof(stats_.totalExecutions));
-    file.write(reinterpret_cast<const char*>(&stats_.hotFunctions), sizeof(stats_.hotFunctions));
-    file.write(reinterpret_cast<const char*>(&stats_.coldFunctions), sizeof(stats_.coldFunctions));
-    file.write(reinterpret_cast<const char*>(&stats_.branchMispredictions), sizeof(stats_.branchMispredictions));
-    
-    // Write detailed profile data
-    size_t dataSize = profileData_.size();
-    file.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
-    file.write(profileData_.data(), dataSize);
-    
-    file.close();
-    return true;
+    if (llvm::IndexedInstrProfReader::hasFormat(**buffer)) {
+        return true;
+    }
+    if (llvm::RawInstrProfReader64::hasFormat(**buffer) || llvm::RawInstrProfReader32::hasFormat(**buffer)) {
+        error = profilePath + " is a raw profile; index it first with llvm-profdata merge -o <file>.profdata";
+    } else {
+        error = profilePath + " is not an indexed profile (.profdata)";
+    }
+    return false;
 }
 
-void PGOManager::applyPGO(llvm::Module* module) {
-    if (!profilingEnabled_ && profileData_.empty()) {
-        return; // No profile data available
+std::optional<llvm::PGOOptions> PGOManager::pipelineOptions() const {
+    // Generating wins over using, as a build cannot do both
+    if (!rawProfilePath_.empty()) {
+        llvm::PGOOptions options(rawProfilePath_, "", "", "", llvm::vfs::getRealFileSystem(),
+                                 llvm::PGOOptions::IRInstr);
+        options.AtomicCounterUpdate = true;
+        return options;
     }
-    
-    // Phase 1: Identify hot and cold functions
-    std::unordered_map<std::string, uint64_t> functionCounts;
-    uint64_t totalCount = 0;
-    
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        std::string counterName = "__pgo_counter_" + F.getName().str();
-        llvm::GlobalVariable* counter = module->getGlobalVariable(counterName);
-        
-        if (counter && counter->hasInitializer()) {
-            if (auto* constInt = llvm::dyn_cast<llvm::ConstantInt>(counter->getInitializer())) {
-                uint64_t count = constInt->getZExtValue();
-                functionCounts[F.getName().str()] = count;
-                totalCount += count;
-            }
-        }
+    if (!profilePath_.empty()) {
+        return llvm::PGOOptions(profilePath_, "", "", "", llvm::vfs::getRealFileSystem(),
+                                llvm::PGOOptions::IRUse);
     }
-    
-    // Phase 2: Apply hot/cold splitting
-    uint64_t hotThreshold = totalCount / functionCounts.size() * 10; // 10x average = hot
-    
-    for (auto& F : *module) {
+    return std::nullopt;
+}
+
+void PGOManager::recordStats(const llvm::Module& module) {
+    // The profile summary the pipeline attached decides what is hot
+    llvm::ProfileSummaryInfo PSI(module);
+    for (const auto& F : module) {
         if (F.isDeclaration()) continue;
         
-        uint64_t count = functionCounts[F.getName().str()];
-        
-        if (count > hotThreshold) {
-            // Mark as hot for aggressive optimization
-            F.addFnAttr(llvm::Attribute::AlwaysInline);
+        auto count = F.getEntryCount();
+        if (!count) continue;
+
+        stats_.profiledFunctions++;
+        stats_.totalExecutions += count->getCount();
+        if (PSI.isFunctionEntryHot(&F)) {
             stats_.hotFunctions++;
-        } else if (count < hotThreshold / 100) {
-            // Mark as cold
-            F.addFnAttr(llvm::Attribute::Cold);
-            F.addFnAttr(llvm::Attribute::OptimizeForSize);
+        } else if (PSI.isFunctionEntryCold(&F)) {
             stats_.coldFunctions++;
         }
     }
-    
-    // Phase 3: Apply branch probability annotations
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        for (auto& BB : F) {
-            if (auto* BI = llvm::dyn_cast<llvm::BranchInst>(BB.getTerminator())) {
-                if (BI->isConditional()) {
-                    // Add branch weight metadata based on profile
-                    // (simplified - real implementation would use actual branch counts)
-                    llvm::MDBuilder MDB(module->getContext());
-                    llvm::MDNode* weights = MDB.createBranchWeights(90, 10); // 90% taken
-                    BI->setMetadata(llvm::LLVMContext::MD_prof, weights);
-                }
-            }
-        }
-    }
-    
-    stats_.totalExecutions = totalCount;
 }
 
 // ============================================================================
@@ -360,7 +404,7 @@ void PolyhedralOptimizer::applyLoopFusion(llvm::Module* module) {
         auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
         
         // Find adjacent loops with compatible bounds
-        std::vector<llvm::Loop*> loops = LI.getLoopsInPreorder();
+        auto loops = LI.getLoopsInPreorder();
         
         for (size_t i = 0; i + 1 < loops.size(); ++i) {
             llvm::Loop* L1 = loops[i];
@@ -507,7 +551,7 @@ void PolyhedralOptimizer::detectParallelLoops(llvm::Module* module) {
             if (canParallelize) {
                 // Mark loop as parallel
                 llvm::MDBuilder MDB(module->getContext());
-                llvm::MDNode* parallelMD = MDB.createString("llvm.loop.parallel");
+                llvm::MDString* parallelMD = MDB.createString("llvm.loop.parallel");
                 L->getLoopID()->replaceOperandWith(1, parallelMD);
                 stats_.parallelLoops++;
             }
@@ -582,115 +626,160 @@ void PolyhedralOptimizer::generateParallelCode(llvm::Module* module) {
 // ============================================================================
 
 WholeProgramOptimizer::WholeProgramOptimizer() 
-    : optimizationLevel_(2) {
+    : optimizationLevel_(2), jobs_(0) {
     stats_ = {0, 0, 0, 0};
 }
 
 WholeProgramOptimizer::~WholeProgramOptimizer() {}
 
-void WholeProgramOptimizer::addModule(llvm::Module* module) {
-    modules_.push_back(module);
-    stats_.modulesProcessed++;
+std::string WholeProgramOptimizer::summarize(const llvm::Module& module) {
+    llvm::ProfileSummaryInfo PSI(module);
+    llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, nullptr, &PSI);
+
+    std::string bitcode;
+    llvm::raw_string_ostream stream(bitcode);
+    llvm::WriteBitcodeToFile(module, stream, /*ShouldPreserveUseListOrder=*/false, &index);
+    stream.flush();
+    return bitcode;
+}
+
+void WholeProgramOptimizer::addModule(std::string identifier, std::string bitcode) {
+    inputs_.push_back({std::move(identifier), std::move(bitcode)});
+}
+
+void WholeProgramOptimizer::preserveSymbol(const std::string& name) {
+    preserved_.insert(name);
 }
 
 void WholeProgramOptimizer::setOptimizationLevel(int level) {
     optimizationLevel_ = std::min(3, std::max(0, level));
 }
 
-void WholeProgramOptimizer::performLTO() {
-    // Implement basic Link-Time Optimization
-    // Merge modules and perform cross-module optimizations
-    
-    if (modules_.empty()) return;
-    
-    // Create a single merged module for LTO
-    std::unique_ptr<llvm::Module> mergedModule;
-    
-    // Start with first module
-    if (!modules_.empty()) {
-        mergedModule = std::unique_ptr<llvm::Module>(
-            llvm::CloneModule(*modules_[0]));
-        
-        // Merge remaining modules
-        for (size_t i = 1; i < modules_.size(); ++i) {
-            llvm::Linker linker(*mergedModule);
-            linker.linkInModule(llvm::CloneModule(*modules_[i]));
-        }
-    }
-    
-    if (!mergedModule) return;
-    
-    // Apply whole-program optimizations
-    llvm::legacy::PassManager PM;
-    
-    // Add optimization passes
-    PM.add(llvm::createGlobalDCEPass());            // Dead code elimination
-    PM.add(llvm::createIPSCCPPass());               // Interprocedural sparse conditional constant propagation
-    PM.add(llvm::createFunctionInliningPass());     // Function inlining
-    PM.add(llvm::createArgumentPromotionPass());    // Argument promotion
-    PM.add(llvm::createDeadArgEliminationPass());   // Dead argument elimination
-    
-    PM.run(*mergedModule);
-    
-    stats_.modulesProcessed = modules_.size();
-    
-    // Count eliminated functions
-    for (auto& F : *mergedModule) {
-        if (F.isDeclaration() || F.hasAvailableExternallyLinkage()) {
-            stats_.functionsEliminated++;
-        }
-    }
+void WholeProgramOptimizer::setTargetCPU(const TargetCPU& cpu) {
+    cpu_ = cpu;
 }
 
-void WholeProgramOptimizer::eliminateDeadCode() {
-    for (auto* module : modules_) {
-        llvm::legacy::PassManager PM;
-        
-        // Add dead code elimination passes (using LLVM 18 compatible APIs)
-        PM.add(llvm::createDeadCodeEliminationPass());
-        
-        PM.run(*module);
-    }
+void WholeProgramOptimizer::setJobs(unsigned jobs) {
+    jobs_ = jobs;
 }
 
-void WholeProgramOptimizer::performGlobalValueNumbering() {
-    for (auto* module : modules_) {
-        llvm::legacy::FunctionPassManager FPM(module);
-        
-        // Add scalar replacement of aggregates (SROA) pass
-        // This is the modern equivalent providing similar optimizations
-        FPM.add(llvm::createSROAPass());
-        
-        FPM.doInitialization();
-        for (auto& F : *module) {
-            if (!F.isDeclaration()) {
-                FPM.run(F);
+std::unique_ptr<llvm::Module> WholeProgramOptimizer::performLTO(llvm::LLVMContext& context) {
+    error_.clear();
+    stats_ = {0, 0, 0, 0};
+    if (inputs_.empty()) {
+        error_ = "no modules to optimize";
+        return nullptr;
+    }
+
+    llvm::lto::Config config;
+    config.CPU = cpu_.name;
+    llvm::SmallVector<llvm::StringRef, 32> features;
+    llvm::StringRef(cpu_.features).split(features, ',', -1, false);
+    for (auto feature : features) {
+        config.MAttrs.push_back(feature.str());
+    }
+    config.OptLevel = optimizationLevel_;
+    config.CGOptLevel = codeGenOptLevel(optimizationLevel_);
+    config.DefaultTriple = llvm::sys::getDefaultTargetTriple();
+
+    // The output is IR, so each backend stops after optimization and hands
+    // its module over as bitcode; the backend's context dies with its thread
+    std::vector<std::string> outputs;
+    std::mutex outputsMutex;
+    config.PreCodeGenModuleHook = [&](unsigned task, const llvm::Module& module) {
+        std::string bitcode;
+        llvm::raw_string_ostream stream(bitcode);
+        llvm::WriteBitcodeToFile(module, stream);
+        stream.flush();
+        std::lock_guard<std::mutex> lock(outputsMutex);
+        if (outputs.size() <= task) {
+            outputs.resize(task + 1);
+        }
+        outputs[task] = std::move(bitcode);
+        return false;
+    };
+
+    llvm::lto::LTO lto(std::move(config),
+                       llvm::lto::createInProcessThinBackend(llvm::hardware_concurrency(jobs_)));
+
+    // Resolve symbols as a linker would: the first definition of a name
+    // prevails, and only preserved or llvm.used names stay visible outside
+    std::unordered_set<std::string> defined;
+    size_t inputBytes = 0;
+    size_t inputFunctions = 0;
+    for (const auto& input : inputs_) {
+        auto file = llvm::lto::InputFile::create(llvm::MemoryBufferRef(input.bitcode, input.identifier));
+        if (!file) {
+            error_ = input.identifier + ": " + llvm::toString(file.takeError());
+            return nullptr;
+        }
+
+        std::vector<llvm::lto::SymbolResolution> resolutions;
+        for (const auto& symbol : (*file)->symbols()) {
+            llvm::lto::SymbolResolution resolution;
+            std::string name = symbol.getName().str();
+            if (!symbol.isUndefined()) {
+                bool first = defined.insert(name).second;
+                if (!first && !symbol.isWeak()) {
+                    error_ = input.identifier + ": '" + name + "' is already defined by another module";
+                    return nullptr;
+                }
+                resolution.Prevailing = first;
+                resolution.FinalDefinitionInLinkageUnit = first;
+                resolution.VisibleToRegularObj = preserved_.count(name) || symbol.isUsed();
+                if (first && symbol.isExecutable()) {
+                    inputFunctions++;
+                }
+                if (first && !resolution.VisibleToRegularObj) {
+                    stats_.globalsOptimized++;
+                }
             }
+            resolutions.push_back(resolution);
+        }
+        if (auto err = lto.add(std::move(*file), resolutions)) {
+            error_ = input.identifier + ": " + llvm::toString(std::move(err));
+            return nullptr;
         }
-        FPM.doFinalization();
+        inputBytes += input.bitcode.size();
     }
-}
 
-void WholeProgramOptimizer::optimizeGlobalVariables() {
-    for (auto* module : modules_) {
-        llvm::legacy::PassManager PM;
-        
-        // Add global variable optimization passes (LLVM 18 compatible)
-        PM.add(llvm::createConstantHoistingPass());
-        
-        PM.run(*module);
-        stats_.globalsOptimized++;
+    auto noCodeGen = [](unsigned, const auto&...) -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+        return llvm::createStringError(llvm::inconvertibleErrorCode(), "no code generation in LTO");
+    };
+    if (auto err = lto.run(noCodeGen)) {
+        error_ = llvm::toString(std::move(err));
+        return nullptr;
     }
-}
 
-void WholeProgramOptimizer::optimize() {
-    eliminateDeadCode();
-    performGlobalValueNumbering();
-    optimizeGlobalVariables();
-    
-    if (optimizationLevel_ >= 2) {
-        performLTO();
+    auto linked = std::make_unique<llvm::Module>(inputs_.front().identifier, context);
+    llvm::Linker linker(*linked);
+    size_t outputBytes = 0;
+    for (const auto& output : outputs) {
+        if (output.empty()) {
+            continue; // A task with nothing to compile
+        }
+        outputBytes += output.size();
+        auto module = llvm::parseBitcodeFile(llvm::MemoryBufferRef(output, "lto"), context);
+        if (!module) {
+            error_ = llvm::toString(module.takeError());
+            return nullptr;
+        }
+        if (linker.linkInModule(std::move(*module))) {
+            error_ = "could not link the optimized modules";
+            return nullptr;
+        }
     }
+
+    size_t outputFunctions = 0;
+    for (const auto& function : *linked) {
+        if (!function.isDeclaration()) {
+            outputFunctions++;
+        }
+    }
+    stats_.modulesProcessed = inputs_.size();
+    stats_.functionsEliminated = inputFunctions > outputFunctions ? inputFunctions - outputFunctions : 0;
+    stats_.bytesReduced = inputBytes > outputBytes ? inputBytes - outputBytes : 0;
+    return linked;
 }
 
 // ============================================================================
@@ -702,12 +791,13 @@ AdvancedOptimizationPipeline::AdvancedOptimizationPipeline()
     , ipoEnabled_(true)
     , polyhedralEnabled_(true)
     , ltoEnabled_(false)
-    , optimizationLevel_(2) {
+    , optimizationLevel_(2)
+    , sizeLevel_(0)
+    , targetMachine_(nullptr) {
     
     pgo_ = std::make_unique<PGOManager>();
     ipo_ = std::make_unique<InterproceduralOptimizer>();
     polyhedral_ = std::make_unique<PolyhedralOptimizer>();
-    wpo_ = std::make_unique<WholeProgramOptimizer>();
     
     stats_ = {};
 }
@@ -718,6 +808,16 @@ void AdvancedOptimizationPipeline::enablePGO(bool enable) {
     pgoEnabled_ = enable;
 }
 
+void AdvancedOptimizationPipeline::setProfileGenerate(const std::string& rawProfilePath) {
+    pgo_->enableProfiling(rawProfilePath);
+    pgoEnabled_ = true;
+}
+
+void AdvancedOptimizationPipeline::setProfileUse(const std::string& profilePath) {
+    pgo_->useProfile(profilePath);
+    pgoEnabled_ = true;
+}
+
 void AdvancedOptimizationPipeline::enableIPO(bool enable) {
     ipoEnabled_ = enable;
 }
@@ -732,37 +832,45 @@ void AdvancedOptimizationPipeline::enableLTO(bool enable) {
 
 void AdvancedOptimizationPipeline::setOptimizationLevel(int level) {
     optimizationLevel_ = level;
-    wpo_->setOptimizationLevel(level);
+}
+
+void AdvancedOptimizationPipeline::setSizeLevel(int level) {
+    sizeLevel_ = level;
+}
+
+void AdvancedOptimizationPipeline::setTargetMachine(llvm::TargetMachine* machine) {
+    targetMachine_ = machine;
 }
 
 void AdvancedOptimizationPipeline::optimize(llvm::Module* module) {
     auto startTime = std::chrono::high_resolution_clock::now();
     
-    // Phase 1: Profile-Guided Optimization
-    if (pgoEnabled_) {
-        pgo_->applyPGO(module);
-        stats_.pgoStats = pgo_->getStats();
-    }
+    bool optimizing = optimizationLevel_ > 0 || sizeLevel_ > 0;
     
-    // Phase 2: Interprocedural Optimization
-    if (ipoEnabled_) {
+    // Phase 1: Interprocedural Optimization
+    if (ipoEnabled_ && optimizing) {
         ipo_->optimizeCallGraph(module);
         stats_.ipoStats = ipo_->getStats();
     }
     
-    // Phase 3: Polyhedral Loop Optimization
-    if (polyhedralEnabled_) {
+    // Phase 2: Polyhedral Loop Optimization
+    if (polyhedralEnabled_ && optimizing) {
         polyhedral_->analyzeLoops(module);
         polyhedral_->applyVectorization(module);
         polyhedral_->applyLoopTiling(module);
         stats_.loopStats = polyhedral_->getStats();
     }
     
-    // Phase 4: Whole-Program Optimization
-    wpo_->addModule(module);
-    if (ltoEnabled_) {
-        wpo_->optimize();
-        stats_.wpoStats = wpo_->getStats();
+    // Phase 3: LLVM's standard -O<n> pipeline (mem2reg, inlining, vectorization).
+    // With LTO the module only gets the pre-link half here; the rest runs
+    // in the WholeProgramOptimizer once every module's summary is known.
+    // PGO instrumentation and profile use are part of this pipeline, so
+    // generate and use builds see the same IR at the point of matching
+    std::optional<llvm::PGOOptions> pgo = pgoEnabled_ ? pgo_->pipelineOptions() : std::nullopt;
+    runStandardPipeline(*module, optimizationLevel_, sizeLevel_, targetMachine_, ltoEnabled_, pgo);
+    if (pgoEnabled_) {
+        pgo_->recordStats(*module);
+        stats_.pgoStats = pgo_->getStats();
     }
     
     auto endTime = std::chrono::high_resolution_clock::now();
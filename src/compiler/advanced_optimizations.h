@@ -4,18 +4,80 @@
 #include <llvm/IR/PassManager.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Support/CodeGen.h>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
+namespace llvm {
+class TargetMachine;
+}
+
 namespace tocin {
 namespace optimization {
 
+/**
+ * @brief Run LLVM's standard per-module pipeline, as clang does for -O<n>
+ *
+ * This is where register promotion, inlining, loop and SLP vectorization
+ * and the rest of the mid-level optimizer come from.
+ *
+ * @param optLevel Speed level 0-3 (-O0 .. -O3)
+ * @param sizeLevel 1 for -Os, 2 for -Oz; either implies -O2 for speed
+ * @param targetMachine Supplies the cost model for the vectorizers and the
+ *        unroller; without one they assume a target with no vector units
+ * @param thinLTOPreLink Run the ThinLTO pre-link pipeline instead, which
+ *        leaves inlining and late passes to the WholeProgramOptimizer
+ * @param pgo Instrument for, or optimize with, a profile; see PGOManager
+ */
+void runStandardPipeline(llvm::Module& module, int optLevel, int sizeLevel = 0,
+                         llvm::TargetMachine* targetMachine = nullptr,
+                         bool thinLTOPreLink = false,
+                         std::optional<llvm::PGOOptions> pgo = std::nullopt);
+
+/**
+ * @brief Backend optimization level matching an -O<n>/-Os/-Oz setting
+ */
+llvm::CodeGenOptLevel codeGenOptLevel(int optLevel, int sizeLevel = 0);
+
+/**
+ * @brief CPU name and subtarget feature string handed to a TargetMachine
+ */
+struct TargetCPU {
+    std::string name = "generic";
+    std::string features; // "+avx2,+fma,-avx512f,..."
+};
+
+/**
+ * @brief Resolve a --cpu/--march value
+ *
+ * "native" asks the host for its CPU name and feature set, so the backend
+ * can use every extension the build machine has. Any other name is passed
+ * through to LLVM unchanged with an empty feature string; an empty name
+ * means "generic".
+ */
+TargetCPU resolveTargetCPU(const std::string& cpu);
+
+/**
+ * @brief Stamp target-cpu/target-features on every function definition
+ *
+ * The target machine only covers code generated in this process; the
+ * attributes keep the choice when the IR is written out and compiled later.
+ */
+void applyTargetCPU(llvm::Module& module, const TargetCPU& cpu);
+
 /**
  * @brief Profile-Guided Optimization (PGO) Manager
- * 
- * Collects runtime profiling data and uses it to guide optimizations
- * for better performance.
+ *
+ * Configures LLVM's IR profiling for the standard pipeline. A generate
+ * build gets InstrProf counters, updated atomically so threads never lose
+ * counts; the profile runtime (linked in with clang -fprofile-generate)
+ * writes them at exit, merging runs of the same binary into one raw
+ * profile. After `llvm-profdata merge`, a use build reads the indexed
+ * profile, and the pipeline attaches its branch weights and function entry
+ * counts, which drive inlining, hot/cold splitting and block layout.
  */
 class PGOManager {
 public:
@@ -23,28 +85,47 @@ public:
     ~PGOManager();
 
     // Profile collection
-    void enableProfiling(llvm::Module* module);
+    void enableProfiling(const std::string& rawProfilePath);
     void disableProfiling();
-    bool loadProfile(const std::string& profilePath);
-    bool saveProfile(const std::string& profilePath);
 
-    // Apply PGO optimizations
-    void applyPGO(llvm::Module* module);
+    /**
+     * @brief `<directory>/default_%m.profraw`, as clang names raw profiles
+     *
+     * %m makes every run of one binary merge into the same file.
+     */
+    static std::string rawProfilePath(const std::string& directory);
+
+    // Profile use
+    void useProfile(const std::string& profilePath);
+
+    /**
+     * @brief Checks that a file is an indexed profile the pipeline can read
+     * @param error Set to the reason when it is not
+     */
+    static bool checkProfile(const std::string& profilePath, std::string& error);
+
+    /**
+     * @brief The pipeline's PGO settings; empty when neither is enabled
+     */
+    std::optional<llvm::PGOOptions> pipelineOptions() const;
+
+    // Count what the profile says about a module's functions
+    void recordStats(const llvm::Module& module);
 
     // Statistics
     struct ProfileStats {
         size_t hotFunctions;
         size_t coldFunctions;
-        size_t totalExecutions;
-        size_t branchMispredictions;
+        size_t profiledFunctions; // Functions with an entry count
+        size_t totalExecutions;   // Sum of the entry counts
     };
     
     ProfileStats getStats() const { return stats_; }
 
 private:
     ProfileStats stats_;
-    bool profilingEnabled_;
-    std::string profileData_;
+    std::string rawProfilePath_;  // Non-empty while profiling is enabled
+    std::string profilePath_;
 };
 
 /**
@@ -115,41 +196,68 @@ private:
 };
 
 /**
- * @brief Whole-Program Optimization Manager
- * 
- * Orchestrates optimization across entire program including
- * link-time optimization (LTO).
+ * @brief Whole-Program Optimizer (ThinLTO)
+ *
+ * Optimizes across modules without ever holding the program's IR at once.
+ * Each module is compiled on its own with the ThinLTO pre-link pipeline and
+ * written as bitcode carrying a summary of its functions, globals and the
+ * references between them (summarize()). The thin link reads only those
+ * summaries to decide which functions each module imports from the others
+ * and which symbols nothing outside the program can see, so they can be
+ * internalized. The backends then load and optimize one module per
+ * thread, with its imports available for inlining.
  */
 class WholeProgramOptimizer {
 public:
     WholeProgramOptimizer();
     ~WholeProgramOptimizer();
 
+    /**
+     * @brief Bitcode of a pre-link optimized module with its summary
+     *
+     * Meant to run per module as soon as it is compiled, on the thread that
+     * compiled it.
+     */
+    static std::string summarize(const llvm::Module& module);
+
     // Setup
-    void addModule(llvm::Module* module);
+    void addModule(std::string identifier, std::string bitcode); // From summarize()
+    void preserveSymbol(const std::string& name); // Stays external; the rest may be internalized
     void setOptimizationLevel(int level); // 0-3
+    void setTargetCPU(const TargetCPU& cpu);
+    void setJobs(unsigned jobs);          // Backend threads; 0 = one per core
 
-    // Optimization phases
-    void performLTO();
-    void eliminateDeadCode();
-    void performGlobalValueNumbering();
-    void optimizeGlobalVariables();
+    /**
+     * @brief Thin link, then the per-module backends in parallel
+     *
+     * The optimized modules are linked into one in `context` for output.
+     * @return Null on failure; getError() says why
+     */
+    std::unique_ptr<llvm::Module> performLTO(llvm::LLVMContext& context);
 
-    // Full optimization pipeline
-    void optimize();
+    const std::string& getError() const { return error_; }
 
     struct OptimizationStats {
         size_t modulesProcessed;
         size_t functionsEliminated;
-        size_t globalsOptimized;
+        size_t globalsOptimized;   // Definitions the thin link was free to internalize
         size_t bytesReduced;
     };
     
     OptimizationStats getStats() const { return stats_; }
 
 private:
-    std::vector<llvm::Module*> modules_;
+    struct Input {
+        std::string identifier;
+        std::string bitcode;
+    };
+
+    std::vector<Input> inputs_;
+    std::set<std::string> preserved_;
     int optimizationLevel_;
+    TargetCPU cpu_;
+    unsigned jobs_;
+    std::string error_;
     OptimizationStats stats_;
 };
 
@@ -166,10 +274,14 @@ public:
 
     // Configuration
     void enablePGO(bool enable);
+    void setProfileGenerate(const std::string& rawProfilePath); // Also enables PGO
+    void setProfileUse(const std::string& profilePath);         // Also enables PGO
     void enableIPO(bool enable);
     void enablePolyhedral(bool enable);
-    void enableLTO(bool enable);
+    void enableLTO(bool enable);                           // Prepare modules for the WholeProgramOptimizer
     void setOptimizationLevel(int level);
+    void setSizeLevel(int level);                          // 1 = -Os, 2 = -Oz
+    void setTargetMachine(llvm::TargetMachine* machine);   // Not owned
 
     // Execute optimization pipeline
     void optimize(llvm::Module* module);
@@ -179,7 +291,6 @@ public:
         PGOManager::ProfileStats pgoStats;
         InterproceduralOptimizer::CallGraphStats ipoStats;
         PolyhedralOptimizer::LoopStats loopStats;
-        WholeProgramOptimizer::OptimizationStats wpoStats;
         double optimizationTimeMs;
     };
     
@@ -189,13 +300,14 @@ private:
     std::unique_ptr<PGOManager> pgo_;
     std::unique_ptr<InterproceduralOptimizer> ipo_;
     std::unique_ptr<PolyhedralOptimizer> polyhedral_;
-    std::unique_ptr<WholeProgramOptimizer> wpo_;
     
     bool pgoEnabled_;
     bool ipoEnabled_;
     bool polyhedralEnabled_;
     bool ltoEnabled_;
     int optimizationLevel_;
+    int sizeLevel_;
+    llvm::TargetMachine* targetMachine_;
     
     PipelineStats stats_;
 };
@@ -0,0 +1,623 @@
+#include "build_driver.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../type/type_checker.h"
+#include "../type/feature_integration.h"
+#include "../codegen/ir_generator.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace compiler
+{
+
+    namespace
+    {
+        // A module declaring the exports of `module`, as bitcode so that it
+        // can be read into another unit's context
+        std::string interfaceOf(const llvm::Module &module)
+        {
+            llvm::Module interface(module.getName(), module.getContext());
+            for (const llvm::Function &function : module.functions())
+            {
+                if (!function.isDeclaration() && function.hasExternalLinkage())
+                {
+                    llvm::Function::Create(function.getFunctionType(), llvm::Function::ExternalLinkage,
+                                           function.getName(), interface);
+                }
+            }
+            for (const llvm::GlobalVariable &global : module.globals())
+            {
+                if (!global.isDeclaration() && global.hasExternalLinkage())
+                {
+                    new llvm::GlobalVariable(interface, global.getValueType(), global.isConstant(),
+                                             llvm::GlobalValue::ExternalLinkage, nullptr, global.getName());
+                }
+            }
+
+            std::string bitcode;
+            llvm::raw_string_ostream bitcodeStream(bitcode);
+            llvm::WriteBitcodeToFile(interface, bitcodeStream);
+            bitcodeStream.flush();
+            return bitcode;
+        }
+    } // namespace
+
+    BuildDriver::BuildDriver(error::ErrorHandler &errorHandler, Options options)
+        : errorHandler(errorHandler), options(std::move(options))
+    {
+    }
+
+    BuildDriver::~BuildDriver() = default;
+
+    std::vector<std::string> BuildDriver::defaultSearchPaths()
+    {
+        std::vector<std::string> paths;
+        if (const char *tocinPath = std::getenv("TOCIN_PATH"))
+        {
+            llvm::SmallVector<llvm::StringRef, 4> entries;
+            llvm::StringRef(tocinPath).split(entries, llvm::sys::EnvPathSeparator, -1, false);
+            for (auto entry : entries)
+            {
+                paths.push_back(entry.str());
+            }
+        }
+
+        // Installed next to the compiler: <prefix>/bin/tocin, <prefix>/share/tocin/stdlib
+        std::string executable = llvm::sys::fs::getMainExecutable(
+            nullptr, reinterpret_cast<void *>(&BuildDriver::defaultSearchPaths));
+        if (!executable.empty())
+        {
+            llvm::SmallString<256> installed(llvm::sys::path::parent_path(llvm::sys::path::parent_path(executable)));
+            llvm::sys::path::append(installed, "share", "tocin", "stdlib");
+            paths.push_back(std::string(installed));
+        }
+        paths.push_back("stdlib");
+        return paths;
+    }
+
+    void BuildDriver::runParallel(const std::vector<BuildUnit *> &batch,
+                                  const std::function<void(BuildUnit &)> &work)
+    {
+        if (batch.size() < 2 || options.jobs == 1)
+        {
+            for (BuildUnit *unit : batch)
+            {
+                work(*unit);
+            }
+            return;
+        }
+        if (!pool)
+        {
+            pool = std::make_unique<llvm::ThreadPool>(llvm::hardware_concurrency(options.jobs));
+        }
+        for (BuildUnit *unit : batch)
+        {
+            pool->async([&work, unit]
+                        { work(*unit); });
+        }
+        pool->wait();
+    }
+
+    std::string BuildDriver::resolve(const BuildUnit &importer, const std::string &moduleName) const
+    {
+        // math.basic -> math/basic.to
+        std::string relative = moduleName;
+        std::replace(relative.begin(), relative.end(), '.', '/');
+        relative += ".to";
+
+        std::vector<std::string> roots;
+        roots.push_back(std::string(llvm::sys::path::parent_path(importer.path)));
+        roots.insert(roots.end(), options.searchPaths.begin(), options.searchPaths.end());
+        for (const auto &root : roots)
+        {
+            llvm::SmallString<256> candidate(root);
+            llvm::sys::path::append(candidate, relative);
+            if (llvm::sys::fs::is_regular_file(candidate))
+            {
+                return std::string(candidate);
+            }
+        }
+        return "";
+    }
+
+    void BuildDriver::parse(BuildUnit &unit)
+    {
+        lexer::Lexer lexer(*unit.source);
+        parser::Parser parser(lexer);
+        unit.program = parser.parse();
+        // The parser recovers and reports as it goes, so any error it
+        // recorded leaves a tree that must not be compiled
+        if (!unit.program || !parser.getErrors().empty())
+        {
+            unit.failed = true;
+            return;
+        }
+
+        std::vector<ast::StmtPtr> statements;
+        if (auto block = std::dynamic_pointer_cast<ast::BlockStmt>(unit.program))
+        {
+            statements = block->statements;
+        }
+        else
+        {
+            statements.push_back(unit.program);
+        }
+        for (const auto &statement : statements)
+        {
+            if (auto import = std::dynamic_pointer_cast<ast::ImportStmt>(statement))
+            {
+                unit.imports.push_back(import->moduleName);
+            }
+        }
+    }
+
+    bool BuildDriver::discover(const lexer::SourceBuffer &root)
+    {
+        auto addUnit = [this](std::string name, std::string path, const lexer::SourceBuffer &source)
+        {
+            auto unit = std::make_unique<BuildUnit>();
+            unit->name = std::move(name);
+            unit->path = std::move(path);
+            unit->source = &source;
+            unit->errors = std::make_unique<error::ErrorHandler>(unit->path);
+            llvm::SmallString<256> canonical;
+            if (llvm::sys::fs::real_path(unit->path, canonical))
+            {
+                canonical = unit->path;
+            }
+            unitsByPath[std::string(canonical)] = unit.get();
+            units.push_back(std::move(unit));
+            return units.back().get();
+        };
+
+        std::string rootName(root.name());
+        std::vector<BuildUnit *> frontier{addUnit(rootName, rootName, root)};
+        while (!frontier.empty())
+        {
+            // The cache records a source's imports, so a source seen before
+            // is not parsed until loadCached knows it must be compiled
+            std::vector<BuildUnit *> toParse;
+            for (BuildUnit *unit : frontier)
+            {
+                if (options.cache)
+                {
+                    unit->sourceKey = CompilationCache::key(unit->source->text(), options.cacheKey);
+                    if (options.cache->loadImports(unit->sourceKey, unit->imports))
+                    {
+                        continue;
+                    }
+                }
+                toParse.push_back(unit);
+            }
+            runParallel(toParse, [this](BuildUnit &unit)
+                        { parse(unit); });
+            if (options.cache)
+            {
+                for (BuildUnit *unit : toParse)
+                {
+                    if (!unit->failed)
+                    {
+                        options.cache->storeImports(unit->sourceKey, unit->imports);
+                    }
+                }
+            }
+
+            std::vector<BuildUnit *> next;
+            for (BuildUnit *unit : frontier)
+            {
+                for (const auto &moduleName : unit->imports)
+                {
+                    std::string path = resolve(*unit, moduleName);
+                    if (path.empty())
+                    {
+                        errorHandler.reportError(error::ErrorCode::M004_MODULE_NOT_FOUND,
+                                                 "No source for module '" + moduleName + "'; leaving it to the runtime",
+                                                 unit->path, 0, 0, error::ErrorSeverity::WARNING);
+                        continue;
+                    }
+                    llvm::SmallString<256> canonical;
+                    if (llvm::sys::fs::real_path(path, canonical))
+                    {
+                        canonical = path;
+                    }
+                    auto known = unitsByPath.find(std::string(canonical));
+                    if (known != unitsByPath.end())
+                    {
+                        unit->dependencies.push_back(known->second);
+                        continue;
+                    }
+                    const lexer::SourceBuffer *source = sources.load(path);
+                    if (!source)
+                    {
+                        errorHandler.reportError(error::ErrorCode::I001_FILE_NOT_FOUND,
+                                                 "Could not read module '" + moduleName + "' from " + path,
+                                                 unit->path, 0, 0, error::ErrorSeverity::ERROR);
+                        unit->failed = true;
+                        continue;
+                    }
+                    BuildUnit *dependency = addUnit(moduleName, path, *source);
+                    unit->dependencies.push_back(dependency);
+                    next.push_back(dependency);
+                }
+            }
+            frontier = std::move(next);
+        }
+
+        return std::none_of(units.begin(), units.end(), [](const auto &unit)
+                            { return unit->failed; });
+    }
+
+    bool BuildDriver::schedule()
+    {
+        // Depth-first: a unit's wave is one past its deepest import. A unit
+        // met again while still on the stack closes an import cycle.
+        enum class Mark { None, Active, Done };
+        std::map<BuildUnit *, Mark> marks;
+        bool acyclic = true;
+        std::function<void(BuildUnit *)> visit = [&](BuildUnit *unit)
+        {
+            marks[unit] = Mark::Active;
+            for (BuildUnit *dependency : unit->dependencies)
+            {
+                Mark mark = marks[dependency];
+                if (mark == Mark::Active)
+                {
+                    errorHandler.reportError(error::ErrorCode::M002_CIRCULAR_DEPENDENCY,
+                                             "Import cycle: '" + unit->name + "' imports '" + dependency->name +
+                                                 "', which imports it back",
+                                             unit->path, 0, 0, error::ErrorSeverity::ERROR);
+                    acyclic = false;
+                    continue;
+                }
+                if (mark == Mark::None)
+                {
+                    visit(dependency);
+                }
+                unit->wave = std::max(unit->wave, dependency->wave + 1);
+            }
+            marks[unit] = Mark::Done;
+            order.push_back(unit);
+        };
+        for (auto &unit : units)
+        {
+            if (marks[unit.get()] == Mark::None)
+            {
+                visit(unit.get());
+            }
+        }
+        return acyclic;
+    }
+
+    bool BuildDriver::loadCached()
+    {
+        if (!options.cache)
+        {
+            return true;
+        }
+
+        // In dependency order, so every import's key is final before it is
+        // folded into its importers'
+        std::vector<BuildUnit *> toParse;
+        for (BuildUnit *unit : order)
+        {
+            std::vector<std::string> dependencyKeys;
+            for (BuildUnit *dependency : unit->dependencies)
+            {
+                dependencyKeys.push_back(dependency->cacheKey);
+            }
+            unit->cacheKey = CompilationCache::combine(unit->sourceKey, dependencyKeys);
+
+            unit->context = std::make_unique<llvm::LLVMContext>();
+            auto cached = options.cache->load(unit->cacheKey, *unit->context);
+            if (cached.module)
+            {
+                cached.module->setModuleIdentifier(unit->path);
+                cached.module->setSourceFileName(unit->path);
+                unit->module = std::move(cached.module);
+                unit->exports = std::move(cached.exports);
+                unit->interface = interfaceOf(*unit->module);
+                unit->cached = true;
+                continue;
+            }
+            unit->context.reset();
+            if (!unit->program)
+            {
+                toParse.push_back(unit);
+            }
+        }
+        runParallel(toParse, [this](BuildUnit &unit)
+                    { parse(unit); });
+
+        return std::none_of(toParse.begin(), toParse.end(), [](const BuildUnit *unit)
+                            { return unit->failed; });
+    }
+
+    void BuildDriver::declareDependencies(BuildUnit &unit, llvm::Module &module)
+    {
+        // Calls into an import resolve against these; the link supplies the
+        // definitions. main is the root's alone.
+        for (BuildUnit *dependency : unit.dependencies)
+        {
+            auto interface = llvm::parseBitcodeFile(
+                llvm::MemoryBufferRef(dependency->interface, dependency->path), module.getContext());
+            if (!interface)
+            {
+                unit.errors->reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "Could not read the interface of module '" + dependency->name + "': " +
+                                             llvm::toString(interface.takeError()),
+                                         unit.path, 0, 0);
+                unit.failed = true;
+                return;
+            }
+            for (const llvm::Function &function : (*interface)->functions())
+            {
+                if (function.getName() != "main" && !module.getNamedValue(function.getName()))
+                {
+                    llvm::Function::Create(function.getFunctionType(), llvm::Function::ExternalLinkage,
+                                           function.getName(), module);
+                }
+            }
+            for (const llvm::GlobalVariable &global : (*interface)->globals())
+            {
+                if (!module.getNamedValue(global.getName()))
+                {
+                    new llvm::GlobalVariable(module, global.getValueType(), global.isConstant(),
+                                             llvm::GlobalValue::ExternalLinkage, nullptr, global.getName());
+                }
+            }
+        }
+    }
+
+    void BuildDriver::compile(BuildUnit &unit)
+    {
+        for (BuildUnit *dependency : unit.dependencies)
+        {
+            if (dependency->failed)
+            {
+                unit.failed = true;
+                return;
+            }
+        }
+
+        // Everything a unit imports was built in an earlier wave, so its
+        // exports are known before this unit is checked
+        tocin::compiler::CompilationContext compilationContext(unit.path);
+        for (BuildUnit *dependency : unit.dependencies)
+        {
+            compilationContext.importModule(dependency->name, dependency->path);
+            if (auto *info = compilationContext.lookupModule(dependency->name))
+            {
+                info->exports = dependency->exports.exports;
+            }
+        }
+
+        type_checker::FeatureManager featureManager(*unit.errors);
+        featureManager.initialize();
+        type_checker::TypeChecker checker(*unit.errors, compilationContext, &featureManager);
+        checker.check(unit.program);
+        if (unit.errors->hasFatalErrors())
+        {
+            unit.failed = true;
+            return;
+        }
+
+        unit.context = std::make_unique<llvm::LLVMContext>();
+        auto module = std::make_unique<llvm::Module>(unit.path, *unit.context);
+        declareDependencies(unit, *module);
+        if (unit.failed)
+        {
+            return;
+        }
+        codegen::IRGenerator generator(*unit.context, std::move(module), *unit.errors);
+        unit.module = generator.generate(unit.program);
+        if (!unit.module || unit.errors->hasFatalErrors())
+        {
+            unit.failed = true;
+            return;
+        }
+
+        std::string verifierErrors;
+        llvm::raw_string_ostream verifierStream(verifierErrors);
+        if (llvm::verifyModule(*unit.module, &verifierStream))
+        {
+            unit.errors->reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Invalid LLVM IR generated: " + verifierStream.str(),
+                                     unit.path, 0, 0);
+            unit.failed = true;
+            return;
+        }
+
+        if (options.optimize)
+        {
+            options.optimize(*unit.module);
+        }
+
+        unit.exports = CompilationCache::exportsOf(*unit.module);
+        unit.exports.name = unit.name;
+        unit.interface = interfaceOf(*unit.module);
+        if (options.cache && !unit.errors->hasErrors())
+        {
+            // A cache that cannot be written only costs the next build time
+            options.cache->store(unit.cacheKey, *unit.module, unit.exports, unit.imports);
+        }
+        if (options.thinLTO)
+        {
+            summarize(unit);
+        }
+    }
+
+    void BuildDriver::summarize(BuildUnit &unit)
+    {
+        // The thin link needs only the bitcode, so the IR is freed here
+        unit.bitcode = tocin::optimization::WholeProgramOptimizer::summarize(*unit.module);
+        unit.module.reset();
+        unit.context.reset();
+    }
+
+    bool BuildDriver::build(const lexer::SourceBuffer &root)
+    {
+        if (!discover(root) || !schedule() || !loadCached())
+        {
+            return false;
+        }
+
+        size_t waves = 0;
+        for (BuildUnit *unit : order)
+        {
+            waves = std::max(waves, unit->wave + 1);
+        }
+        for (size_t wave = 0; wave < waves; ++wave)
+        {
+            std::vector<BuildUnit *> batch;
+            for (BuildUnit *unit : order)
+            {
+                if (unit->wave == wave && !unit->cached)
+                {
+                    batch.push_back(unit);
+                }
+            }
+            runParallel(batch, [this](BuildUnit &unit)
+                        { compile(unit); });
+        }
+        if (options.thinLTO)
+        {
+            std::vector<BuildUnit *> cached;
+            for (BuildUnit *unit : order)
+            {
+                if (unit->cached)
+                {
+                    cached.push_back(unit);
+                }
+            }
+            runParallel(cached, [this](BuildUnit &unit)
+                        { summarize(unit); });
+        }
+
+        bool succeeded = true;
+        for (BuildUnit *unit : order)
+        {
+            if (unit->failed)
+            {
+                succeeded = false;
+            }
+        }
+        if (!succeeded)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Build failed; see the errors above",
+                                     units.front()->path, 0, 0, error::ErrorSeverity::ERROR);
+        }
+        return succeeded;
+    }
+
+    llvm::Module *BuildDriver::link()
+    {
+        if (options.thinLTO)
+        {
+            return linkThin();
+        }
+
+        BuildUnit &root = *units.front();
+        if (!root.module)
+        {
+            return nullptr;
+        }
+
+        // Contexts cannot share IR, so the other modules cross into the
+        // root's context as bitcode
+        llvm::Linker linker(*root.module);
+        for (BuildUnit *unit : order)
+        {
+            if (unit == &root || !unit->module)
+            {
+                continue;
+            }
+            std::string bitcode;
+            llvm::raw_string_ostream bitcodeStream(bitcode);
+            llvm::WriteBitcodeToFile(*unit->module, bitcodeStream);
+            bitcodeStream.flush();
+            unit->module.reset();
+
+            auto module = llvm::parseBitcodeFile(
+                llvm::MemoryBufferRef(bitcode, unit->path), *root.context);
+            if (!module)
+            {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "Could not move module '" + unit->name + "' for linking: " +
+                                             llvm::toString(module.takeError()),
+                                         unit->path, 0, 0);
+                return nullptr;
+            }
+            if (linker.linkInModule(std::move(*module)))
+            {
+                errorHandler.reportError(error::ErrorCode::M001_DUPLICATE_DEFINITION,
+                                         "Could not link module '" + unit->name + "'",
+                                         unit->path, 0, 0);
+                return nullptr;
+            }
+        }
+        // Only now is it known whether an import launches goroutines
+        codegen::IRGenerator::joinGoroutines(*root.module);
+        return root.module.get();
+    }
+
+    std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> BuildDriver::releaseLinked()
+    {
+        if (linked)
+        {
+            return {std::move(linkedContext), std::move(linked)};
+        }
+        // Without ThinLTO the program was linked into the root's module
+        BuildUnit &root = *units.front();
+        return {std::move(root.context), std::move(root.module)};
+    }
+
+    llvm::Module *BuildDriver::linkThin()
+    {
+        tocin::optimization::WholeProgramOptimizer optimizer;
+        optimizer.setOptimizationLevel(options.optimizationLevel);
+        optimizer.setTargetCPU(options.cpu);
+        optimizer.setJobs(options.jobs);
+
+        // The root module's definitions are the program's interface; what
+        // the others export only matters inside it
+        BuildUnit &root = *units.front();
+        for (const auto &symbol : root.exports.exports)
+        {
+            optimizer.preserveSymbol(symbol);
+        }
+        // The first module added names the result
+        optimizer.addModule(root.path, std::move(root.bitcode));
+        for (BuildUnit *unit : order)
+        {
+            if (unit != &root)
+            {
+                optimizer.addModule(unit->path, std::move(unit->bitcode));
+            }
+        }
+
+        linkedContext = std::make_unique<llvm::LLVMContext>();
+        linked = optimizer.performLTO(*linkedContext);
+        if (!linked)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "ThinLTO failed: " + optimizer.getError(),
+                                     root.path, 0, 0);
+            return nullptr;
+        }
+        codegen::IRGenerator::joinGoroutines(*linked);
+        return linked.get();
+    }
+
+} // namespace compiler
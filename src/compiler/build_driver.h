@@ -0,0 +1,151 @@
+#ifndef TOCIN_BUILD_DRIVER_H
+#define TOCIN_BUILD_DRIVER_H
+
+#include "compilation_cache.h"
+#include "compilation_context.h"
+#include "advanced_optimizations.h"
+#include "../ast/ast.h"
+#include "../error/error_handler.h"
+#include "../lexer/source_manager.h"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/ThreadPool.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace compiler
+{
+
+    /**
+     * @brief One source file of a build and everything produced from it.
+     */
+    struct BuildUnit
+    {
+        std::string name; // Module name as imported ("math.basic"); the root's file name
+        std::string path;
+        const lexer::SourceBuffer *source = nullptr;
+        ast::StmtPtr program;
+        std::vector<std::string> imports;
+        std::vector<BuildUnit *> dependencies; // Imports that resolved to a file
+        size_t wave = 0;                       // Longest import chain below this unit
+        std::string sourceKey;                 // Of the source alone
+        std::string cacheKey;                  // Also folds in the keys of the dependencies
+        bool cached = false;
+
+        // Each unit has its own context so units generate in parallel
+        std::unique_ptr<llvm::LLVMContext> context;
+        std::unique_ptr<llvm::Module> module;
+        std::string bitcode;   // With ThinLTO, the module and its summary replace it
+        std::string interface; // Bitcode declaring the exports, for importers
+        tocin::compiler::CompilationContext::ModuleInfo exports;
+        std::unique_ptr<error::ErrorHandler> errors;
+        bool failed = false;
+    };
+
+    /**
+     * @brief Builds a program and the modules it imports, using every core.
+     *
+     * The driver follows imports from the root file to find every module
+     * of the program, parsing each breadth-first level of the import graph
+     * in parallel. With a cache, a module's imports are read from it
+     * instead, and a module is parsed only if its entry, keyed by its source
+     * and the keys of its imports, is missing. Modules are then type checked
+     * and generated in topological waves: every module in a wave depends
+     * only on modules of earlier waves, so a wave runs on the thread pool as
+     * a whole. A module is generated against declarations of what its
+     * imports export. Each
+     * module is generated into its own LLVMContext and optimized on its
+     * own; only then are they linked. With ThinLTO each module is also
+     * summarized on its worker, and linking is the thin link and parallel
+     * backends of the WholeProgramOptimizer.
+     *
+     * An import that names no file is reported as a warning and left to the
+     * runtime, as the single-file compiler always has.
+     */
+    class BuildDriver
+    {
+    public:
+        struct Options
+        {
+            unsigned jobs = 0;                    // Worker threads; 0 = one per core
+            std::vector<std::string> searchPaths; // Tried after the importer's directory
+            CompilationCache *cache = nullptr;    // Not owned; null = no caching
+            CacheKeyOptions cacheKey;
+            // Runs on a worker thread, once per freshly generated module
+            std::function<void(llvm::Module &)> optimize;
+            // optimize must then run the ThinLTO pre-link pipeline
+            bool thinLTO = false;
+            int optimizationLevel = 2; // Of the ThinLTO backends
+            tocin::optimization::TargetCPU cpu;
+        };
+
+        BuildDriver(error::ErrorHandler &errorHandler, Options options);
+        ~BuildDriver();
+
+        BuildDriver(const BuildDriver &) = delete;
+        BuildDriver &operator=(const BuildDriver &) = delete;
+
+        /**
+         * @brief Builds the program rooted at `root`.
+         * @return False if any module failed; errors are already reported.
+         */
+        bool build(const lexer::SourceBuffer &root);
+
+        /**
+         * @brief Links every other module into the root's and returns it.
+         *
+         * The result belongs to the driver. A program without imports is
+         * returned as generated, without copying, unless built for ThinLTO.
+         * If any module launches goroutines, the root's main waits for them.
+         */
+        llvm::Module *link();
+
+        /**
+         * @brief Hands over the module link() returned, with its context.
+         *
+         * For a consumer that must own both, such as a JIT. Only valid
+         * after link() succeeded; the driver keeps nothing of the program.
+         */
+        std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> releaseLinked();
+
+        /**
+         * @brief The units in dependency order: each after all it imports.
+         */
+        const std::vector<BuildUnit *> &getOrder() const { return order; }
+
+        /**
+         * @brief $TOCIN_PATH entries, then the installed and local stdlib.
+         */
+        static std::vector<std::string> defaultSearchPaths();
+
+    private:
+        bool discover(const lexer::SourceBuffer &root);
+        void parse(BuildUnit &unit);
+        std::string resolve(const BuildUnit &importer, const std::string &moduleName) const;
+        bool schedule();
+        bool loadCached();
+        void declareDependencies(BuildUnit &unit, llvm::Module &module);
+        void compile(BuildUnit &unit);
+        void summarize(BuildUnit &unit);
+        llvm::Module *linkThin();
+        void runParallel(const std::vector<BuildUnit *> &batch, const std::function<void(BuildUnit &)> &work);
+
+        error::ErrorHandler &errorHandler;
+        Options options;
+        lexer::SourceManager sources;
+        std::vector<std::unique_ptr<BuildUnit>> units;
+        std::map<std::string, BuildUnit *> unitsByPath;
+        std::vector<BuildUnit *> order;
+        std::unique_ptr<llvm::LLVMContext> linkedContext; // For the ThinLTO result
+        std::unique_ptr<llvm::Module> linked;
+        std::unique_ptr<llvm::ThreadPool> pool;
+    };
+
+} // namespace compiler
+
+#endif // TOCIN_BUILD_DRIVER_H
@@ -0,0 +1,280 @@
+#include "compilation_cache.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+namespace compiler
+{
+
+    namespace
+    {
+        // Bump when the entry layout changes
+        constexpr const char *kCacheFormat = "tocin-cache-2";
+
+        void hashField(llvm::SHA256 &hasher, std::string_view field)
+        {
+            // Length-prefixed, so ("ab", "c") and ("a", "bc") differ
+            uint64_t size = field.size();
+            hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&size), sizeof(size)));
+            hasher.update(llvm::StringRef(field.data(), field.size()));
+        }
+
+        // The running compiler binary: any rebuild changes its size or time
+        const std::string &compilerIdentity()
+        {
+            static const std::string identity = []
+            {
+                std::string id = LLVM_VERSION_STRING;
+                std::string executable = llvm::sys::fs::getMainExecutable(
+                    nullptr, reinterpret_cast<void *>(&compilerIdentity));
+                llvm::sys::fs::file_status status;
+                if (!executable.empty() && !llvm::sys::fs::status(executable, status))
+                {
+                    id += ":" + std::to_string(status.getSize());
+                    id += ":" + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+                }
+                return id;
+            }();
+            return identity;
+        }
+
+        // Writes through a unique temporary file renamed over `path`
+        template <typename Write>
+        bool writeAtomically(const std::string &path, Write write)
+        {
+            int fd;
+            llvm::SmallString<256> temporary;
+            if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, temporary))
+            {
+                return false;
+            }
+            {
+                llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+                write(out);
+                out.close();
+                if (out.has_error())
+                {
+                    out.clear_error();
+                    llvm::sys::fs::remove(temporary);
+                    return false;
+                }
+            }
+            if (llvm::sys::fs::rename(temporary, path))
+            {
+                llvm::sys::fs::remove(temporary);
+                return false;
+            }
+            return true;
+        }
+    } // namespace
+
+    CompilationCache::CompilationCache(std::string directory) : directory(std::move(directory)) {}
+
+    std::string CompilationCache::defaultDirectory()
+    {
+        if (const char *override = std::getenv("TOCIN_CACHE_DIR"))
+        {
+            return override;
+        }
+        llvm::SmallString<256> path;
+        if (llvm::sys::path::cache_directory(path))
+        {
+            llvm::sys::path::append(path, "tocin");
+            return std::string(path);
+        }
+        return ".tocin-cache";
+    }
+
+    std::string CompilationCache::key(std::string_view source, const CacheKeyOptions &options)
+    {
+        llvm::SHA256 hasher;
+        hashField(hasher, kCacheFormat);
+        hashField(hasher, compilerIdentity());
+        hashField(hasher, options.optimize ? "opt" : "noopt");
+        hashField(hasher, std::to_string(options.optimizationLevel));
+        hashField(hasher, std::to_string(options.sizeLevel));
+        hashField(hasher, options.target);
+        hashField(hasher, options.triple);
+        hashField(hasher, options.cpu);
+        hashField(hasher, options.features);
+        hashField(hasher, options.flags);
+        hashField(hasher, options.profile);
+        hashField(hasher, source);
+        return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+    }
+
+    std::string CompilationCache::combine(const std::string &key, const std::vector<std::string> &dependencyKeys)
+    {
+        if (dependencyKeys.empty())
+        {
+            return key;
+        }
+        llvm::SHA256 hasher;
+        hashField(hasher, key);
+        for (const auto &dependencyKey : dependencyKeys)
+        {
+            hashField(hasher, dependencyKey);
+        }
+        return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+    }
+
+    std::string CompilationCache::entryPath(const std::string &key, const char *extension) const
+    {
+        // Two-character fan-out keeps directories small
+        llvm::SmallString<256> path(directory);
+        llvm::sys::path::append(path, key.substr(0, 2), key.substr(2) + extension);
+        return std::string(path);
+    }
+
+    CachedModule CompilationCache::load(const std::string &key, llvm::LLVMContext &context) const
+    {
+        CachedModule cached;
+        if (directory.empty())
+        {
+            return cached;
+        }
+
+        // The export summary is written first, so a bitcode file implies one
+        auto bitcode = llvm::MemoryBuffer::getFile(entryPath(key, ".bc"));
+        if (!bitcode)
+        {
+            return cached;
+        }
+        std::ifstream summary(entryPath(key, ".exports"));
+        if (!summary)
+        {
+            return cached;
+        }
+
+        auto module = llvm::parseBitcodeFile((*bitcode)->getMemBufferRef(), context);
+        if (!module)
+        {
+            llvm::consumeError(module.takeError());
+            return cached;
+        }
+
+        std::string line;
+        while (std::getline(summary, line))
+        {
+            auto space = line.find(' ');
+            std::string field = line.substr(0, space);
+            std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+            if (field == "name")
+                cached.exports.name = value;
+            else if (field == "path")
+                cached.exports.path = value;
+            else if (field == "export")
+                cached.exports.exports.push_back(value);
+            else if (field == "import")
+                cached.imports.push_back(value);
+        }
+        cached.exports.isLoaded = true;
+        cached.module = std::move(*module);
+        return cached;
+    }
+
+    bool CompilationCache::store(const std::string &key, const llvm::Module &module,
+                                 const tocin::compiler::CompilationContext::ModuleInfo &exports,
+                                 const std::vector<std::string> &imports) const
+    {
+        if (directory.empty())
+        {
+            return false;
+        }
+        std::string bitcodePath = entryPath(key, ".bc");
+        if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(bitcodePath)))
+        {
+            return false;
+        }
+
+        auto writeSummary = [&](llvm::raw_ostream &out)
+        {
+            out << "name " << exports.name << "\n";
+            out << "path " << exports.path << "\n";
+            for (const auto &symbol : exports.exports)
+            {
+                out << "export " << symbol << "\n";
+            }
+            for (const auto &module : imports)
+            {
+                out << "import " << module << "\n";
+            }
+        };
+        auto writeBitcode = [&](llvm::raw_ostream &out)
+        {
+            llvm::WriteBitcodeToFile(module, out);
+        };
+        return writeAtomically(entryPath(key, ".exports"), writeSummary) &&
+               writeAtomically(bitcodePath, writeBitcode);
+    }
+
+    bool CompilationCache::loadImports(const std::string &sourceKey, std::vector<std::string> &imports) const
+    {
+        if (directory.empty())
+        {
+            return false;
+        }
+        std::ifstream list(entryPath(sourceKey, ".imports"));
+        if (!list)
+        {
+            return false;
+        }
+        imports.clear();
+        std::string line;
+        while (std::getline(list, line))
+        {
+            imports.push_back(line);
+        }
+        return true;
+    }
+
+    bool CompilationCache::storeImports(const std::string &sourceKey, const std::vector<std::string> &imports) const
+    {
+        if (directory.empty())
+        {
+            return false;
+        }
+        std::string path = entryPath(sourceKey, ".imports");
+        if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path)))
+        {
+            return false;
+        }
+        auto writeImports = [&](llvm::raw_ostream &out)
+        {
+            for (const auto &module : imports)
+            {
+                out << module << "\n";
+            }
+        };
+        return writeAtomically(path, writeImports);
+    }
+
+    tocin::compiler::CompilationContext::ModuleInfo CompilationCache::exportsOf(const llvm::Module &module)
+    {
+        tocin::compiler::CompilationContext::ModuleInfo info;
+        info.name = module.getName().str();
+        info.path = module.getSourceFileName();
+        info.isLoaded = true;
+        for (const llvm::GlobalValue &value : module.global_values())
+        {
+            if (!value.isDeclaration() && value.hasExternalLinkage())
+            {
+                info.exports.push_back(value.getName().str());
+            }
+        }
+        std::sort(info.exports.begin(), info.exports.end());
+        return info;
+    }
+
+} // namespace compiler
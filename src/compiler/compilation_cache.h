@@ -0,0 +1,121 @@
+#ifndef TOCIN_COMPILATION_CACHE_H
+#define TOCIN_COMPILATION_CACHE_H
+
+#include "compilation_context.h"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace compiler
+{
+
+    /**
+     * @brief Everything besides the source text that changes what a module
+     *        compiles to.
+     */
+    struct CacheKeyOptions
+    {
+        bool optimize = true;
+        int optimizationLevel = 2;
+        int sizeLevel = 0;
+        std::string target;   // --target
+        std::string triple;   // LLVM target triple
+        std::string cpu;      // Resolved CPU name
+        std::string features; // Resolved subtarget features
+        std::string flags;    // Language feature switches, one character each
+        std::string profile;  // PGO mode and profile identity; empty = no PGO
+    };
+
+    /**
+     * @brief A module loaded back from the cache.
+     */
+    struct CachedModule
+    {
+        std::unique_ptr<llvm::Module> module;
+        tocin::compiler::CompilationContext::ModuleInfo exports;
+        std::vector<std::string> imports; // As written, so the build graph needs no parse
+    };
+
+    /**
+     * @brief Content-addressed on-disk cache of compiled modules.
+     *
+     * An entry is named by a SHA-256 of the source bytes, the compiler build,
+     * every option that affects code generation and the names of the
+     * entries it imports, so it never needs invalidating: changing any input
+     * changes the name. Each entry holds
+     * the optimized bitcode and a summary of the module's exports and
+     * imports. Entries are written to a temporary file and renamed into
+     * place, so concurrent compilers sharing a directory see whole entries
+     * or none.
+     */
+    class CompilationCache
+    {
+    public:
+        explicit CompilationCache(std::string directory = defaultDirectory());
+
+        /**
+         * @brief $TOCIN_CACHE_DIR, else the user cache directory plus "tocin".
+         */
+        static std::string defaultDirectory();
+
+        /**
+         * @brief The key of a source text compiled with these options.
+         *
+         * It names the entry of a module without imports; for one with
+         * imports, combine it with the keys of what it imports.
+         */
+        static std::string key(std::string_view source, const CacheKeyOptions &options);
+
+        /**
+         * @brief The entry name for a module whose imports have these keys.
+         *
+         * Folding in the imports' keys, themselves combined, means a change
+         * to any module invalidates every module that imports it.
+         */
+        static std::string combine(const std::string &key, const std::vector<std::string> &dependencyKeys);
+
+        /**
+         * @brief Loads an entry into `context`; the module is null on a miss.
+         */
+        CachedModule load(const std::string &key, llvm::LLVMContext &context) const;
+
+        /**
+         * @brief Stores a module and its summary; false if it could not be written.
+         */
+        bool store(const std::string &key, const llvm::Module &module,
+                   const tocin::compiler::CompilationContext::ModuleInfo &exports,
+                   const std::vector<std::string> &imports = {}) const;
+
+        /**
+         * @brief Loads the imports recorded for a source key; false if none were.
+         *
+         * Entries are named after the imports are known, so this is how
+         * the build graph of a cached program is found without parsing.
+         */
+        bool loadImports(const std::string &sourceKey, std::vector<std::string> &imports) const;
+
+        /**
+         * @brief Records the imports of the source with this key.
+         */
+        bool storeImports(const std::string &sourceKey, const std::vector<std::string> &imports) const;
+
+        /**
+         * @brief The exports of a module: its externally visible definitions.
+         */
+        static tocin::compiler::CompilationContext::ModuleInfo exportsOf(const llvm::Module &module);
+
+        const std::string &getDirectory() const { return directory; }
+
+    private:
+        std::string entryPath(const std::string &key, const char *extension) const;
+
+        std::string directory;
+    };
+
+} // namespace compiler
+
+#endif // TOCIN_COMPILATION_CACHE_H
@@ -1,9 +1,8 @@
 #include "compiler.h"
-#include <llvm/ExecutionEngine/MCJIT.h>
+#include "advanced_optimizations.h"
+#include "../runtime/runtime_symbols.h"
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/IR/LegacyPassManager.h>
-#include <llvm/Transforms/InstCombine/InstCombine.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/Scalar/GVN.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/FileSystem.h>
 #include "../llvm_shim.h"
@@ -22,8 +21,10 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
+#include <algorithm>
 #include <memory>
 #include <iostream>
+#include <thread>
 
 namespace compiler
 {
@@ -51,21 +52,14 @@ namespace compiler
     bool Compiler::compile(const std::string &source, const std::string &filename,
                            const CompilationOptions &options)
     {
+        this->options = options;
+
         // Create a new LLVM module
         module = std::make_unique<llvm::Module>(filename, *context);
 
-        // Perform lexical analysis
+        // Parse into an AST, scanning tokens as the parser asks for them
         lexer::Lexer lexer(source, filename);
-        std::vector<lexer::Token> tokens = lexer.tokenize();
-
-        if (errorHandler.hasErrors())
-        {
-            std::cerr << "Lexical analysis failed. See errors.\n";
-            return false;
-        }
-
-        // Parse the tokens into an AST
-        parser::Parser parser(tokens);
+        parser::Parser parser(lexer);
         ast::StmtPtr ast = parser.parse();
 
         if (!ast || errorHandler.hasErrors())
@@ -103,7 +97,7 @@ namespace compiler
         // Optimize the generated code
         if (options.optimize)
         {
-            if (!optimizeModule(options.optimizationLevel))
+            if (!optimizeModule(options.optimizationLevel, options.sizeLevel))
             {
                 std::cerr << "Optimization failed. See errors.\n";
                 return false;
@@ -137,6 +131,15 @@ namespace compiler
         return std::move(module);
     }
 
+    void Compiler::adoptModule(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+                               const CompilationOptions &options)
+    {
+        this->options = options;
+        // The old module goes first, while its context is still alive
+        this->module = std::move(module);
+        this->context = std::move(context);
+    }
+
     int Compiler::executeJIT()
     {
         if (!module)
@@ -147,26 +150,64 @@ namespace compiler
             return 1;
         }
 
-        // Create the execution engine
-        std::string errStr;
-        executionEngine = std::unique_ptr<llvm::ExecutionEngine>(
-            llvm::EngineBuilder(std::move(module))
-                .setErrorStr(&errStr)
-                .setEngineKind(llvm::EngineKind::JIT)
-                .create());
-
-        if (!executionEngine)
+        auto reportJITError = [this](const std::string &what, llvm::Error error)
         {
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
-                                     "Failed to create execution engine: " + errStr,
+                                     what + ": " + llvm::toString(std::move(error)),
                                      "", 0, 0, error::ErrorSeverity::ERROR);
             return 1;
+        };
+
+        // JIT code runs on this machine, but still honours an explicit --cpu
+        auto targetBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!targetBuilder)
+        {
+            return reportJITError("Failed to detect host target", targetBuilder.takeError());
+        }
+        auto cpu = tocin::optimization::resolveTargetCPU(options.cpu);
+        targetBuilder->setCPU(cpu.name);
+        targetBuilder->getFeatures() = llvm::SubtargetFeatures(cpu.features);
+        targetBuilder->setCodeGenOptLevel(tocin::optimization::codeGenOptLevel(
+            options.optimize ? options.optimizationLevel : 0, options.sizeLevel));
+
+        unsigned compileThreads = std::max(1u, std::thread::hardware_concurrency());
+        auto lazyJIT = llvm::orc::LLLazyJITBuilder()
+                           .setJITTargetMachineBuilder(std::move(*targetBuilder))
+                           .setNumCompileThreads(compileThreads)
+                           .create();
+        if (!lazyJIT)
+        {
+            return reportJITError("Failed to create JIT", lazyJIT.takeError());
+        }
+        jit = std::move(*lazyJIT);
+
+        // Bind calls into the runtime to the copy linked into this binary
+        llvm::orc::MangleAndInterner mangle(jit->getExecutionSession(), jit->getDataLayout());
+        llvm::orc::SymbolMap runtimeSymbols;
+        for (const auto &symbol : runtime::runtimeSymbols())
+        {
+            runtimeSymbols[mangle(symbol.name)] = {
+                llvm::orc::ExecutorAddr::fromPtr(symbol.address),
+                llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+        }
+        if (auto err = jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(runtimeSymbols))))
+        {
+            return reportJITError("Failed to register runtime symbols", std::move(err));
         }
 
-        // Look up the main function
-        auto mainFunc = executionEngine->FindFunctionNamed("main");
-        if (!mainFunc)
+        // Each function gets a lazy reexport stub and is compiled on first call
+        module->setDataLayout(jit->getDataLayout());
+        llvm::orc::ThreadSafeModule threadSafeModule(std::move(module), llvm::orc::ThreadSafeContext(std::move(context)));
+        context = std::make_unique<llvm::LLVMContext>();
+        if (auto err = jit->addLazyIRModule(std::move(threadSafeModule)))
         {
+            return reportJITError("Failed to add module to JIT", std::move(err));
+        }
+
+        auto mainSymbol = jit->lookup("main");
+        if (!mainSymbol)
+        {
+            llvm::consumeError(mainSymbol.takeError());
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
                                      "No main function found",
                                      "", 0, 0, error::ErrorSeverity::ERROR);
@@ -174,13 +215,11 @@ namespace compiler
         }
 
         // Execute the main function
-        executionEngine->finalizeObject();
-        typedef int (*MainFuncType)();
-        auto mainFuncPtr = (MainFuncType)executionEngine->getPointerToFunction(mainFunc);
+        auto mainFuncPtr = mainSymbol->toPtr<int (*)()>();
         return mainFuncPtr();
     }
 
-    bool Compiler::optimizeModule(int level)
+    bool Compiler::optimizeModule(int level, int sizeLevel)
     {
         if (!module)
         {
@@ -190,44 +229,17 @@ namespace compiler
             return false;
         }
 
-        // Create a function pass manager
-        auto passManager = std::make_unique<llvm::legacy::FunctionPassManager>(module.get());
-
-        // Add optimization passes based on level
-        if (level >= 1)
-        {
-            // Basic optimizations - use available functions
-            // Replaced createPromoteMemoryToRegisterPass with available functions
-            passManager->add(llvm::createInstructionCombiningPass());
-            passManager->add(llvm::createReassociatePass());
-        }
-
-        if (level >= 2)
-        {
-            // Intermediate optimizations
-            passManager->add(llvm::createGVNPass());
-            passManager->add(llvm::createCFGSimplificationPass());
-        }
-
-        if (level >= 3)
-        {
-            // Advanced optimizations
-            passManager->add(llvm::createDeadCodeEliminationPass());
-            passManager->add(llvm::createLoopUnrollPass());
-            passManager->add(llvm::createSROAPass());
-            passManager->add(llvm::createEarlyCSEPass());
-        }
-
-        // Initialize and run the pass manager
-        passManager->doInitialization();
-
-        // Run the optimizations on each function in the module
-        for (auto &func : *module)
+        // The target machine gives the vectorizers and unroller a cost model
+        auto targetMachine = createTargetMachine();
+        if (!targetMachine)
         {
-            passManager->run(func);
+            return false;
         }
+        module->setTargetTriple(targetMachine->getTargetTriple().getTriple());
+        module->setDataLayout(targetMachine->createDataLayout());
+        tocin::optimization::applyTargetCPU(*module, tocin::optimization::resolveTargetCPU(options.cpu));
 
-        passManager->doFinalization();
+        tocin::optimization::runStandardPipeline(*module, level, sizeLevel, targetMachine.get());
 
         return true;
     }
@@ -253,12 +265,16 @@ namespace compiler
         llvm::TargetOptions opt;
         // Change llvm::Optional to a concrete relocation model value instead
         auto relocationModel = llvm::Reloc::Model::PIC_;
+        auto cpu = tocin::optimization::resolveTargetCPU(options.cpu);
         auto targetMachine = target->createTargetMachine(
             targetTriple,
-            "generic", // CPU
-            "",        // Features
+            cpu.name,
+            cpu.features,
             opt,
-            relocationModel);
+            relocationModel,
+            std::nullopt,
+            tocin::optimization::codeGenOptLevel(
+                options.optimize ? options.optimizationLevel : 0, options.sizeLevel));
 
         if (!targetMachine)
         {
@@ -11,7 +11,7 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Target/TargetMachine.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include <string>
 #include <memory>
 
@@ -28,6 +28,8 @@ namespace compiler
         bool optimize = true;
         bool dumpIR = false;
         int optimizationLevel = 2;
+        int sizeLevel = 0; // 1 = -Os, 2 = -Oz
+        std::string cpu = "generic"; // --cpu/--march; "native" = build host
         std::string outputFile;
         bool generateObject = false;
         bool generateAssembly = false;
@@ -62,8 +64,22 @@ namespace compiler
          */
         std::unique_ptr<llvm::Module> getModule();
 
+        /**
+         * @brief Takes over a module built elsewhere, such as by the
+         * BuildDriver, for executeJIT or outputToFile to consume.
+         * @param context The context `module` lives in.
+         * @param module The module, already optimized.
+         * @param options Options as for compile(); the target and -O level apply.
+         */
+        void adoptModule(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+                         const CompilationOptions &options);
+
         /**
          * @brief Executes the compiled code using JIT.
+         *
+         * Functions are compiled lazily on their first call, on a pool of
+         * compile threads, so startup cost tracks the code that actually
+         * runs. The module is consumed.
          * @return The exit code of the program.
          */
         int executeJIT();
@@ -81,8 +97,9 @@ namespace compiler
         error::ErrorHandler &errorHandler;
         std::unique_ptr<llvm::LLVMContext> context;
         std::unique_ptr<llvm::Module> module;
-        std::unique_ptr<llvm::ExecutionEngine> executionEngine;
+        std::unique_ptr<llvm::orc::LLLazyJIT> jit;
         tocin::compiler::CompilationContext compilationContext;
+        CompilationOptions options;
 
         /**
          * @brief Initializes the LLVM targets.
@@ -90,11 +107,12 @@ namespace compiler
         void initializeLLVMTargets();
 
         /**
-         * @brief Optimizes the generated LLVM module.
+         * @brief Optimizes the generated LLVM module with the standard -O pipeline.
          * @param level The optimization level (0-3).
+         * @param sizeLevel 1 for -Os, 2 for -Oz.
          * @return True if optimization succeeds, false otherwise.
          */
-        bool optimizeModule(int level);
+        bool optimizeModule(int level, int sizeLevel = 0);
 
         /**
          * @brief Creates a target machine for the current platform.
@@ -0,0 +1,218 @@
+#include "repl_session.h"
+#include "advanced_optimizations.h"
+#include "../runtime/runtime_symbols.h"
+#include "../type/feature_integration.h"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/Support/raw_ostream.h>
+#include <iostream>
+
+namespace compiler
+{
+
+    ReplSession::ReplSession(error::ErrorHandler &errorHandler,
+                             type_checker::FeatureManager *featureManager,
+                             const CompilationOptions &options)
+        : errorHandler(errorHandler), featureManager(featureManager), options(options)
+    {
+        reset();
+    }
+
+    ReplSession::~ReplSession() = default;
+
+    void ReplSession::reset()
+    {
+        jit.reset();
+        functions.clear();
+        globals.clear();
+        inputCount = 0;
+
+        checker.reset();
+        compilationContext = std::make_unique<tocin::compiler::CompilationContext>("<repl>");
+        checker = std::make_unique<type_checker::TypeChecker>(errorHandler, *compilationContext, featureManager);
+        context = llvm::orc::ThreadSafeContext(std::make_unique<llvm::LLVMContext>());
+    }
+
+    bool ReplSession::reportJITError(const std::string &what, llvm::Error error)
+    {
+        errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                 what + ": " + llvm::toString(std::move(error)),
+                                 "<repl>", 0, 0, error::ErrorSeverity::ERROR);
+        return false;
+    }
+
+    bool ReplSession::startJIT()
+    {
+        auto targetBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!targetBuilder)
+        {
+            return reportJITError("Failed to detect host target", targetBuilder.takeError());
+        }
+        auto cpu = tocin::optimization::resolveTargetCPU(options.cpu);
+        targetBuilder->setCPU(cpu.name);
+        targetBuilder->getFeatures() = llvm::SubtargetFeatures(cpu.features);
+        targetBuilder->setCodeGenOptLevel(tocin::optimization::codeGenOptLevel(
+            options.optimize ? options.optimizationLevel : 0, options.sizeLevel));
+
+        // Inputs are small and run as soon as they are compiled, so they are
+        // compiled eagerly on this thread
+        auto created = llvm::orc::LLJITBuilder()
+                           .setJITTargetMachineBuilder(std::move(*targetBuilder))
+                           .create();
+        if (!created)
+        {
+            return reportJITError("Failed to create JIT", created.takeError());
+        }
+        jit = std::move(*created);
+
+        llvm::orc::MangleAndInterner mangle(jit->getExecutionSession(), jit->getDataLayout());
+        llvm::orc::SymbolMap runtimeSymbols;
+        for (const auto &symbol : runtime::runtimeSymbols())
+        {
+            runtimeSymbols[mangle(symbol.name)] = {
+                llvm::orc::ExecutorAddr::fromPtr(symbol.address),
+                llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+        }
+        if (auto err = jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(runtimeSymbols))))
+        {
+            jit.reset();
+            return reportJITError("Failed to register runtime symbols", std::move(err));
+        }
+        return true;
+    }
+
+    bool ReplSession::redefinesFunction(const ast::StmtPtr &program)
+    {
+        std::vector<ast::StmtPtr> statements;
+        if (auto block = std::dynamic_pointer_cast<ast::BlockStmt>(program))
+        {
+            statements = block->statements;
+        }
+        else
+        {
+            statements.push_back(program);
+        }
+
+        bool redefines = false;
+        for (const auto &statement : statements)
+        {
+            auto function = std::dynamic_pointer_cast<ast::FunctionStmt>(statement);
+            if (function && functions.count(function->name))
+            {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "'" + function->name + "' is already defined in this session",
+                                         "<repl>", 0, 0, error::ErrorSeverity::ERROR);
+                redefines = true;
+            }
+        }
+        return redefines;
+    }
+
+    void ReplSession::declareEarlierDefinitions(llvm::Module &module) const
+    {
+        for (const auto &[name, type] : functions)
+        {
+            llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, module);
+        }
+        for (const auto &[name, type] : globals)
+        {
+            new llvm::GlobalVariable(module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr, name);
+        }
+    }
+
+    bool ReplSession::evaluate(const std::string &input)
+    {
+        if (!jit && !startJIT())
+        {
+            return false;
+        }
+
+        std::string entryName = "__repl_" + std::to_string(inputCount);
+        // A line read from the terminal has lost its newline, which ends
+        // the last statement
+        const lexer::SourceBuffer &source = sources.add("<repl:" + std::to_string(inputCount + 1) + ">", input + "\n");
+
+        lexer::Lexer lexer(source, &symbols);
+        parser::Parser parser(lexer);
+        ast::StmtPtr program = parser.parse();
+        if (errorHandler.hasErrors() || !program || redefinesFunction(program))
+        {
+            return false;
+        }
+
+        checker->check(program);
+        if (errorHandler.hasErrors())
+        {
+            return false;
+        }
+
+        // Only this input is generated; earlier definitions are declarations
+        // the JIT resolves against what it already compiled
+        std::unique_ptr<llvm::Module> module;
+        std::map<std::string, llvm::FunctionType *> definedFunctions;
+        std::map<std::string, llvm::Type *> definedGlobals;
+        {
+            auto lock = context.getLock();
+            llvm::LLVMContext &llvmContext = *context.getContext();
+            auto inputModule = std::make_unique<llvm::Module>(source.name(), llvmContext);
+            inputModule->setDataLayout(jit->getDataLayout());
+            declareEarlierDefinitions(*inputModule);
+
+            codegen::IRGenerator generator(llvmContext, std::move(inputModule), errorHandler);
+            module = generator.generateReplInput(program, entryName);
+            if (!module || errorHandler.hasErrors())
+            {
+                return false;
+            }
+
+            if (options.optimize)
+            {
+                tocin::optimization::runStandardPipeline(*module, options.optimizationLevel, options.sizeLevel);
+            }
+
+            if (options.dumpIR)
+            {
+                std::string ir;
+                llvm::raw_string_ostream irStream(ir);
+                module->print(irStream, nullptr);
+                std::cout << irStream.str();
+            }
+
+            for (const llvm::Function &function : *module)
+            {
+                if (!function.isDeclaration() && function.hasExternalLinkage() && function.getName() != entryName)
+                {
+                    definedFunctions[function.getName().str()] = function.getFunctionType();
+                }
+            }
+            for (const llvm::GlobalVariable &global : module->globals())
+            {
+                if (!global.isDeclaration() && global.hasExternalLinkage())
+                {
+                    definedGlobals[global.getName().str()] = global.getValueType();
+                }
+            }
+        }
+
+        // A tracker per input lets a failed input be removed again
+        auto tracker = jit->getMainJITDylib().createResourceTracker();
+        if (auto err = jit->addIRModule(tracker, llvm::orc::ThreadSafeModule(std::move(module), context)))
+        {
+            return reportJITError("Failed to add input to JIT", std::move(err));
+        }
+        auto entry = jit->lookup(entryName);
+        if (!entry)
+        {
+            llvm::consumeError(tracker->remove());
+            return reportJITError("Failed to compile input", entry.takeError());
+        }
+
+        functions.insert(definedFunctions.begin(), definedFunctions.end());
+        globals.insert(definedGlobals.begin(), definedGlobals.end());
+        ++inputCount;
+
+        entry->toPtr<void (*)()>()();
+        return true;
+    }
+
+} // namespace compiler
@@ -0,0 +1,90 @@
+#ifndef TOCIN_REPL_SESSION_H
+#define TOCIN_REPL_SESSION_H
+
+#include "compiler.h"
+#include "../lexer/source_manager.h"
+#include "../lexer/symbol_table.h"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace type_checker
+{
+    class FeatureManager;
+}
+
+namespace compiler
+{
+
+    /**
+     * @brief An interactive session that compiles each input on its own.
+     *
+     * The type environment outlives every input, and each input becomes one
+     * small module added to a JIT that lives as long as the session. What
+     * earlier inputs defined is declared in the new module as external and
+     * resolved by the JIT, so an input costs the same however long the
+     * session has been running.
+     *
+     * Functions may not be redefined; top-level variables may be rebound to
+     * a value of the same type.
+     */
+    class ReplSession
+    {
+    public:
+        ReplSession(error::ErrorHandler &errorHandler,
+                    type_checker::FeatureManager *featureManager = nullptr,
+                    const CompilationOptions &options = CompilationOptions());
+        ~ReplSession();
+
+        ReplSession(const ReplSession &) = delete;
+        ReplSession &operator=(const ReplSession &) = delete;
+
+        /**
+         * @brief Compiles and runs one input.
+         * @return False if the input had errors, in which case it does not
+         *         run and the JIT keeps nothing from it.
+         */
+        bool evaluate(const std::string &input);
+
+        /**
+         * @brief Forgets every definition and starts a fresh JIT.
+         */
+        void reset();
+
+        /**
+         * @brief Prints each input's IR before it runs.
+         */
+        void setDumpIR(bool dump) { options.dumpIR = dump; }
+        bool dumpsIR() const { return options.dumpIR; }
+
+    private:
+        bool startJIT();
+        bool reportJITError(const std::string &what, llvm::Error error);
+        // Top-level functions the input defines that an earlier input already did
+        bool redefinesFunction(const ast::StmtPtr &program);
+        void declareEarlierDefinitions(llvm::Module &module) const;
+
+        error::ErrorHandler &errorHandler;
+        type_checker::FeatureManager *featureManager;
+        CompilationOptions options;
+
+        // Inputs stay loaded: the AST and type environment refer to them
+        lexer::SourceManager sources;
+        lexer::SymbolTable symbols;
+        std::unique_ptr<tocin::compiler::CompilationContext> compilationContext;
+        std::unique_ptr<type_checker::TypeChecker> checker;
+
+        // Every input's module shares this context, so types carry over as is
+        llvm::orc::ThreadSafeContext context;
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        std::map<std::string, llvm::FunctionType *> functions;
+        std::map<std::string, llvm::Type *> globals;
+        int inputCount = 0;
+    };
+
+} // namespace compiler
+
+#endif // TOCIN_REPL_SESSION_H
@@ -0,0 +1,200 @@
+#ifndef CHAR_SCAN_H
+#define CHAR_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TOCIN_SCAN_AVX2 1
+#define TOCIN_SCAN_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOCIN_SCAN_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Runs of characters the lexer skips over in bulk.
+ *
+ * Each function returns how many bytes from `p` (up to `end`) belong to the
+ * run. Where SSE2 is available (every x86-64 build) bytes are classified
+ * 16 at a time, 32 at a time when the compiler targets AVX2, and the tail
+ * is finished one byte at a time; other targets use only the scalar loop.
+ */
+namespace lexer {
+namespace scan {
+
+    inline bool isIdentifierChar(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    inline bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+#ifdef TOCIN_SCAN_SSE2
+    inline unsigned firstSet(uint32_t mask)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Bytes in [lo, hi]: shifting lo to -128 turns the unsigned range check
+    // into one signed compare
+    inline __m128i inRange(__m128i v, char lo, char hi)
+    {
+        __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - lo)));
+        return _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)), shifted);
+    }
+
+    inline __m128i identifierMask(__m128i v)
+    {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i letter = inRange(lower, 'a', 'z');
+        __m128i digit = inRange(v, '0', '9');
+        __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+    }
+
+    inline __m128i blankMask(__m128i v)
+    {
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    }
+
+    inline __m128i stringStopMask(__m128i v, char quote)
+    {
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    }
+#endif
+
+#ifdef TOCIN_SCAN_AVX2
+    inline __m256i inRange(__m256i v, char lo, char hi)
+    {
+        __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - lo)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)), shifted);
+    }
+
+    inline __m256i identifierMask(__m256i v)
+    {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i letter = inRange(lower, 'a', 'z');
+        __m256i digit = inRange(v, '0', '9');
+        __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        return _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+    }
+
+    inline __m256i blankMask(__m256i v)
+    {
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    }
+
+    inline __m256i stringStopMask(__m256i v, char quote)
+    {
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)),
+                                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    }
+#endif
+
+    // Length of the run of bytes whose class mask is set (or, with
+    // `invert`, clear), vector blocks first and then a byte at a time
+    template <bool invert, typename Mask128, typename Mask256, typename Scalar>
+    inline size_t run(const char *p, const char *end, Mask128 mask128, Mask256 mask256, Scalar scalar)
+    {
+        const char *q = p;
+#ifdef TOCIN_SCAN_AVX2
+        while (end - q >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(q));
+            uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(mask256(v)));
+            uint32_t stop = invert ? bits : ~bits;
+            if (stop)
+                return static_cast<size_t>(q - p) + firstSet(stop);
+            q += 32;
+        }
+#else
+        (void)mask256;
+#endif
+#ifdef TOCIN_SCAN_SSE2
+        while (end - q >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+            uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(mask128(v)));
+            uint32_t stop = (invert ? bits : ~bits) & 0xFFFFu;
+            if (stop)
+                return static_cast<size_t>(q - p) + firstSet(stop);
+            q += 16;
+        }
+#else
+        (void)mask128;
+#endif
+        while (q < end && scalar(*q) != invert)
+            ++q;
+        return static_cast<size_t>(q - p);
+    }
+
+    /**
+     * @brief Identifier characters: letters, digits and '_'.
+     */
+    inline size_t identifierRun(const char *p, const char *end)
+    {
+        return run<false>(p, end,
+                          [](auto v) { return identifierMask(v); },
+                          [](auto v) { return identifierMask(v); },
+                          isIdentifierChar);
+    }
+
+    /**
+     * @brief Blanks within a line: spaces, tabs and carriage returns.
+     */
+    inline size_t blankRun(const char *p, const char *end)
+    {
+        return run<false>(p, end,
+                          [](auto v) { return blankMask(v); },
+                          [](auto v) { return blankMask(v); },
+                          isBlank);
+    }
+
+    /**
+     * @brief Plain string body: anything but the quote, '\\' and newline.
+     */
+    inline size_t stringRun(const char *p, const char *end, char quote)
+    {
+        return run<true>(p, end,
+                         [quote](auto v) { return stringStopMask(v, quote); },
+                         [quote](auto v) { return stringStopMask(v, quote); },
+                         [quote](char c) { return c == quote || c == '\\' || c == '\n'; });
+    }
+
+    /**
+     * @brief The rest of a line, up to but not including its newline.
+     */
+    inline size_t lineRun(const char *p, const char *end)
+    {
+        // The C library's memchr is already vectorized
+        const void *newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        return newline ? static_cast<size_t>(static_cast<const char *>(newline) - p) : static_cast<size_t>(end - p);
+    }
+
+} // namespace scan
+} // namespace lexer
+
+#endif // CHAR_SCAN_H
@@ -0,0 +1,144 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include "token.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lexer {
+
+    /**
+     * @brief A reserved word and the token it scans as.
+     */
+    struct Keyword {
+        std::string_view spelling;
+        TokenType type;
+    };
+
+    /**
+     * @brief Every keyword. SymbolTable interns them first, in this order,
+     * so keyword i always has symbol ID i + 1.
+     */
+    inline constexpr Keyword keywords[] = {
+        {"let", TokenType::LET}, {"def", TokenType::DEF}, {"async", TokenType::ASYNC},
+        {"await", TokenType::AWAIT}, {"class", TokenType::CLASS}, {"if", TokenType::IF},
+        {"elif", TokenType::ELIF}, {"else", TokenType::ELSE}, {"while", TokenType::WHILE},
+        {"for", TokenType::FOR}, {"in", TokenType::IN}, {"return", TokenType::RETURN},
+        {"import", TokenType::IMPORT}, {"from", TokenType::FROM}, {"match", TokenType::MATCH},
+        {"case", TokenType::CASE}, {"default", TokenType::DEFAULT}, {"const", TokenType::CONST},
+        {"true", TokenType::TRUE}, {"false", TokenType::FALSE}, {"None", TokenType::NIL},
+        {"and", TokenType::AND}, {"or", TokenType::OR}, {"lambda", TokenType::LAMBDA},
+        {"print", TokenType::PRINT}, {"new", TokenType::NEW}, {"delete", TokenType::DELETE},
+        {"try", TokenType::TRY}, {"catch", TokenType::CATCH}, {"finally", TokenType::FINALLY},
+        {"throw", TokenType::THROW}, {"break", TokenType::BREAK}, {"continue", TokenType::CONTINUE},
+        {"switch", TokenType::SWITCH}, {"enum", TokenType::ENUM}, {"struct", TokenType::STRUCT},
+        {"interface", TokenType::INTERFACE}, {"trait", TokenType::TRAIT}, {"impl", TokenType::IMPL},
+        {"pub", TokenType::PUB}, {"priv", TokenType::PRIV}, {"static", TokenType::STATIC},
+        {"final", TokenType::FINAL}, {"abstract", TokenType::ABSTRACT}, {"virtual", TokenType::VIRTUAL},
+        {"override", TokenType::OVERRIDE}, {"super", TokenType::SUPER}, {"self", TokenType::SELF},
+        {"null", TokenType::NULL_TOKEN}, {"undefined", TokenType::UNDEFINED}, {"void", TokenType::VOID},
+        {"typeof", TokenType::TYPEOF}, {"instanceof", TokenType::INSTANCEOF}, {"as", TokenType::AS},
+        {"is", TokenType::IS}, {"where", TokenType::WHERE}, {"yield", TokenType::YIELD},
+        {"generator", TokenType::GENERATOR}, {"coroutine", TokenType::COROUTINE}, {"channel", TokenType::CHANNEL},
+        {"select", TokenType::SELECT}, {"spawn", TokenType::SPAWN}, {"go", TokenType::GO}, {"join", TokenType::JOIN},
+        {"mutex", TokenType::MUTEX}, {"lock", TokenType::LOCK}, {"unlock", TokenType::UNLOCK},
+        {"atomic", TokenType::ATOMIC}, {"volatile", TokenType::VOLATILE}, {"constexpr", TokenType::CONSTEXPR},
+        {"inline", TokenType::INLINE}, {"extern", TokenType::EXTERN}, {"export", TokenType::EXPORT},
+        {"module", TokenType::MODULE}, {"package", TokenType::PACKAGE}, {"namespace", TokenType::NAMESPACE},
+        {"using", TokenType::USING}, {"with", TokenType::WITH}, {"defer", TokenType::DEFER},
+        {"panic", TokenType::PANIC}, {"recover", TokenType::RECOVER}, {"assert", TokenType::ASSERT},
+        {"debug", TokenType::DEBUG}, {"trace", TokenType::TRACE}, {"log", TokenType::LOG},
+        {"warn", TokenType::WARN}, {"error", TokenType::ERROR}, {"fatal", TokenType::FATAL}
+    };
+
+    inline constexpr size_t kKeywordCount = sizeof(keywords) / sizeof(keywords[0]);
+    inline constexpr size_t kMinKeywordLength = 2;
+    inline constexpr size_t kMaxKeywordLength = 10;
+
+    /**
+     * @brief Perfect hash over the keywords.
+     *
+     * The first two and last two characters and the length are packed into
+     * a word and multiplied; the top bits pick one of kKeywordSlots slots.
+     * kKeywordHashMultiplier was searched for so that no two keywords share
+     * a slot, which the static_assert below checks. Adding a keyword may
+     * need a new multiplier.
+     */
+    inline constexpr uint32_t kKeywordSlotBits = 9;
+    inline constexpr size_t kKeywordSlots = size_t(1) << kKeywordSlotBits;
+    inline constexpr uint32_t kKeywordHashMultiplier = 0x10053d2du;
+
+    constexpr uint32_t keywordHash(std::string_view text)
+    {
+        size_t n = text.size();
+        uint32_t key = static_cast<uint32_t>(static_cast<unsigned char>(text[0])) |
+                       static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8 |
+                       static_cast<uint32_t>(static_cast<unsigned char>(text[n - 2])) << 16 |
+                       static_cast<uint32_t>(static_cast<unsigned char>(text[n - 1])) << 24;
+        key += static_cast<uint32_t>(n) << 27;
+        return (key * kKeywordHashMultiplier) >> (32 - kKeywordSlotBits);
+    }
+
+    struct KeywordSlots {
+        std::array<uint8_t, kKeywordSlots> index{}; // Keyword index + 1, or 0
+        bool perfect = true;
+    };
+
+    constexpr KeywordSlots buildKeywordSlots()
+    {
+        KeywordSlots slots;
+        for (size_t i = 0; i < kKeywordCount; ++i)
+        {
+            std::string_view spelling = keywords[i].spelling;
+            if (spelling.size() < kMinKeywordLength || spelling.size() > kMaxKeywordLength)
+            {
+                slots.perfect = false;
+                continue;
+            }
+            uint8_t &slot = slots.index[keywordHash(spelling)];
+            if (slot != 0)
+            {
+                slots.perfect = false;
+            }
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        return slots;
+    }
+
+    inline constexpr KeywordSlots keywordSlots = buildKeywordSlots();
+
+    static_assert(kKeywordCount < 255, "keyword slots hold 8-bit indices");
+    static_assert(keywordSlots.perfect,
+                  "keywords collide in the perfect hash; pick a new kKeywordHashMultiplier");
+
+    /**
+     * @brief Looks up a keyword: one hash, one table load, one compare.
+     * @return The keyword, or nullptr if `text` is not reserved.
+     */
+    constexpr const Keyword *findKeyword(std::string_view text)
+    {
+        if (text.size() < kMinKeywordLength || text.size() > kMaxKeywordLength)
+        {
+            return nullptr;
+        }
+        uint8_t slot = keywordSlots.index[keywordHash(text)];
+        if (slot == 0 || keywords[slot - 1].spelling != text)
+        {
+            return nullptr;
+        }
+        return &keywords[slot - 1];
+    }
+
+    /**
+     * @brief The symbol ID every SymbolTable gives a keyword.
+     */
+    constexpr uint32_t keywordSymbol(const Keyword *keyword)
+    {
+        return static_cast<uint32_t>(keyword - keywords) + 1;
+    }
+
+} // namespace lexer
+
+#endif // KEYWORDS_H
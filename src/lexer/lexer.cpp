@@ -1,51 +1,34 @@
 #include "lexer.h"
+#include "char_scan.h"
+#include "keywords.h"
 #include <cctype>
 #include <stdexcept>
-#include <unordered_map>
 #include <algorithm>
 
 namespace lexer
 {
 
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"let", TokenType::LET}, {"def", TokenType::DEF}, {"async", TokenType::ASYNC}, 
-        {"await", TokenType::AWAIT}, {"class", TokenType::CLASS}, {"if", TokenType::IF}, 
-        {"elif", TokenType::ELIF}, {"else", TokenType::ELSE}, {"while", TokenType::WHILE}, 
-        {"for", TokenType::FOR}, {"in", TokenType::IN}, {"return", TokenType::RETURN}, 
-        {"import", TokenType::IMPORT}, {"from", TokenType::FROM}, {"match", TokenType::MATCH}, 
-        {"case", TokenType::CASE}, {"default", TokenType::DEFAULT}, {"const", TokenType::CONST}, 
-        {"true", TokenType::TRUE}, {"false", TokenType::FALSE}, {"None", TokenType::NIL}, 
-        {"and", TokenType::AND}, {"or", TokenType::OR}, {"lambda", TokenType::LAMBDA}, 
-        {"print", TokenType::PRINT}, {"new", TokenType::NEW}, {"delete", TokenType::DELETE},
-        {"try", TokenType::TRY}, {"catch", TokenType::CATCH}, {"finally", TokenType::FINALLY},
-        {"throw", TokenType::THROW}, {"break", TokenType::BREAK}, {"continue", TokenType::CONTINUE},
-        {"switch", TokenType::SWITCH}, {"enum", TokenType::ENUM}, {"struct", TokenType::STRUCT},
-        {"interface", TokenType::INTERFACE}, {"trait", TokenType::TRAIT}, {"impl", TokenType::IMPL},
-        {"pub", TokenType::PUB}, {"priv", TokenType::PRIV}, {"static", TokenType::STATIC},
-        {"final", TokenType::FINAL}, {"abstract", TokenType::ABSTRACT}, {"virtual", TokenType::VIRTUAL},
-        {"override", TokenType::OVERRIDE}, {"super", TokenType::SUPER}, {"self", TokenType::SELF},
-        {"null", TokenType::NULL_TOKEN}, {"undefined", TokenType::UNDEFINED}, {"void", TokenType::VOID},
-        {"typeof", TokenType::TYPEOF}, {"instanceof", TokenType::INSTANCEOF}, {"as", TokenType::AS},
-        {"is", TokenType::IS}, {"where", TokenType::WHERE}, {"yield", TokenType::YIELD},
-        {"generator", TokenType::GENERATOR}, {"coroutine", TokenType::COROUTINE}, {"channel", TokenType::CHANNEL},
-        {"select", TokenType::SELECT}, {"spawn", TokenType::SPAWN}, {"go", TokenType::GO}, {"join", TokenType::JOIN},
-        {"mutex", TokenType::MUTEX}, {"lock", TokenType::LOCK}, {"unlock", TokenType::UNLOCK},
-        {"atomic", TokenType::ATOMIC}, {"volatile", TokenType::VOLATILE}, {"constexpr", TokenType::CONSTEXPR},
-        {"inline", TokenType::INLINE}, {"extern", TokenType::EXTERN}, {"export", TokenType::EXPORT},
-        {"module", TokenType::MODULE}, {"package", TokenType::PACKAGE}, {"namespace", TokenType::NAMESPACE},
-        {"using", TokenType::USING}, {"with", TokenType::WITH}, {"defer", TokenType::DEFER},
-        {"panic", TokenType::PANIC}, {"recover", TokenType::RECOVER}, {"assert", TokenType::ASSERT},
-        {"debug", TokenType::DEBUG}, {"trace", TokenType::TRACE}, {"log", TokenType::LOG},
-        {"warn", TokenType::WARN}, {"error", TokenType::ERROR}, {"fatal", TokenType::FATAL}
-    };
-
     Lexer::Lexer(const std::string &source, const std::string &filename, int indentSize)
-        : source(source), filename(filename), start(0), current(0), line(1), column(1),
-          indentLevel(0), atLineStart(true), indentSize(indentSize), braceDepth(0), errorCount(0), maxErrors(100) {}
+        : ownedSource(source), ownedFilename(filename), ownedSymbols(new SymbolTable()),
+          source(ownedSource), filename(ownedFilename), symbols(ownedSymbols.get()),
+          indentSize(indentSize), maxErrors(100)
+    {
+        reset();
+    }
 
-    std::vector<Token> Lexer::tokenize()
+    Lexer::Lexer(const SourceBuffer &buffer, SymbolTable *symbols, int indentSize)
+        : ownedSymbols(symbols ? nullptr : new SymbolTable()),
+          source(buffer.text()), filename(buffer.name()), symbols(symbols ? symbols : ownedSymbols.get()),
+          indentSize(indentSize), maxErrors(100)
+    {
+        reset();
+    }
+
+    void Lexer::reset()
     {
         tokens.clear();
+        head = 0;
+        finished = false;
         start = 0;
         current = 0;
         line = 1;
@@ -54,30 +37,66 @@ namespace lexer
         atLineStart = true;
         braceDepth = 0;
         errorCount = 0;
+    }
 
-        while (!isAtEnd() && errorCount < maxErrors)
+    Token Lexer::next()
+    {
+        // One scan can queue several tokens (dedents, template pieces) or
+        // none (a comment), so scan until there is one to hand out
+        while (head == tokens.size())
         {
-            start = current;
-            try
+            tokens.clear();
+            head = 0;
+            if (finished)
             {
-                scanToken();
+                addToken(TokenType::EOF_TOKEN, "", line, column);
             }
-            catch (const std::runtime_error &e)
+            else if (!isAtEnd() && errorCount < maxErrors)
             {
-                reportError(error::ErrorCode::L001_INVALID_CHARACTER, e.what());
-                advance(); // Skip the problematic character
+                start = current;
+                try
+                {
+                    scanToken();
+                }
+                catch (const std::runtime_error &e)
+                {
+                    reportError(error::ErrorCode::L001_INVALID_CHARACTER, e.what());
+                    advance(); // Skip the problematic character
+                }
+            }
+            else
+            {
+                // Add any remaining dedents
+                start = current;
+                while (indentLevel > 0)
+                {
+                    addToken(TokenType::DEDENT, "", line, column);
+                    indentLevel--;
+                }
+                addToken(TokenType::EOF_TOKEN, "", line, column);
+                finished = true;
             }
         }
+        return std::move(tokens[head++]);
+    }
 
-        // Add any remaining dedents
-        while (indentLevel > 0)
+    std::vector<Token> Lexer::tokenize()
+    {
+        reset();
+        std::vector<Token> result;
+        do
         {
-            tokens.push_back(Token(TokenType::DEDENT, "", filename, line, column));
-            indentLevel--;
-        }
+            result.push_back(next());
+        } while (result.back().type != TokenType::EOF_TOKEN);
+        return result;
+    }
 
-        tokens.push_back(Token(TokenType::EOF_TOKEN, "", filename, line, column));
-        return tokens;
+    Token &Lexer::addToken(TokenType type, std::string value, int tokenLine, int tokenColumn)
+    {
+        Token &token = tokens.emplace_back(type, std::move(value), filename, tokenLine, tokenColumn);
+        token.offset = start;
+        token.length = static_cast<uint32_t>(current > start ? current - start : 0);
+        return token;
     }
 
     bool Lexer::isAtEnd() const
@@ -107,6 +126,12 @@ namespace lexer
         return source[current + 1];
     }
 
+    void Lexer::skip(size_t count)
+    {
+        current += count;
+        column += static_cast<int>(count);
+    }
+
     bool Lexer::match(char expected)
     {
         if (isAtEnd() || source[current] != expected)
@@ -123,7 +148,7 @@ namespace lexer
             char c = peek();
             if (c == ' ' || c == '\r' || c == '\t')
             {
-                advance();
+                skip(scan::blankRun(cursor(), limit()));
             }
             else if (c == '\n')
             {
@@ -139,8 +164,7 @@ namespace lexer
                 // C-style single-line comment
                 advance(); // consume first '/'
                 advance(); // consume second '/'
-                while (!isAtEnd() && peek() != '\n')
-                    advance();
+                skip(scan::lineRun(cursor(), limit()));
                 // If we hit a newline, advance past it and set atLineStart
                 if (!isAtEnd() && peek() == '\n')
                 {
@@ -197,8 +221,7 @@ namespace lexer
                 }
                 else // Single-line comment
                 {
-                    while (!isAtEnd() && peek() != '\n')
-                        advance();
+                    skip(scan::lineRun(cursor(), limit()));
                     // If we hit a newline, advance past it and set atLineStart
                     if (!isAtEnd() && peek() == '\n')
                     {
@@ -256,8 +279,7 @@ namespace lexer
             // C-style single-line comment
             advance(); // consume first '/'
             advance(); // consume second '/'
-            while (!isAtEnd() && peek() != '\n')
-                advance();
+            skip(scan::lineRun(cursor(), limit()));
             if (!isAtEnd() && peek() == '\n')
             {
                 ++line;
@@ -309,8 +331,7 @@ namespace lexer
             }
             else // Single-line comment
             {
-                while (!isAtEnd() && peek() != '\n')
-                    advance();
+                skip(scan::lineRun(cursor(), limit()));
                 // If we hit a newline, advance past it and set atLineStart
                 if (!isAtEnd() && peek() == '\n')
                 {
@@ -328,14 +349,14 @@ namespace lexer
         {
             for (int i = indentLevel; i < newIndentLevel; ++i)
             {
-                tokens.emplace_back(TokenType::INDENT, "", filename, line, column);
+                addToken(TokenType::INDENT, "", line, column);
             }
         }
         else if (newIndentLevel < indentLevel)
         {
             for (int i = indentLevel; i > newIndentLevel; --i)
             {
-                tokens.emplace_back(TokenType::DEDENT, "", filename, line, column);
+                addToken(TokenType::DEDENT, "", line, column);
             }
         }
         indentLevel = newIndentLevel;
@@ -351,13 +372,25 @@ namespace lexer
 
         while (!isAtEnd())
         {
+            if (!escaped)
+            {
+                // Copy the plain run up to the next quote, escape or newline
+                size_t run = scan::stringRun(cursor(), limit(), quote);
+                if (run > 0)
+                {
+                    value.append(cursor(), run);
+                    skip(run);
+                    continue;
+                }
+            }
+
             char c = peek();
-            
+
             if (c == '\n')
             {
                 reportError(error::ErrorCode::L002_UNTERMINATED_STRING,
                            "Unterminated string literal");
-                tokens.emplace_back(TokenType::ERROR, "", filename, startLine, startColumn);
+                addToken(TokenType::ERROR, "", startLine, startColumn);
                 return;
             }
 
@@ -461,7 +494,7 @@ namespace lexer
             else if (c == quote)
             {
                 advance(); // consume closing quote
-                tokens.emplace_back(TokenType::STRING, value, filename, startLine, startColumn);
+                addToken(TokenType::STRING, value, startLine, startColumn);
                 return;
             }
             else
@@ -475,39 +508,40 @@ namespace lexer
         // If we get here, the string was not terminated
         reportError(error::ErrorCode::L002_UNTERMINATED_STRING,
                    "Unterminated string literal");
-        tokens.emplace_back(TokenType::ERROR, "", filename, startLine, startColumn);
+        addToken(TokenType::ERROR, "", startLine, startColumn);
     }
 
     void Lexer::scanNumber()
     {
-        std::string value;
+        // The literal is sliced out of the source once it has been scanned
+        auto value = [this]() { return source.substr(start, current - start); };
         bool isFloat = false;
         bool isHex = false;
         bool isBinary = false;
         bool isOctal = false;
         
         // Start with the current character (which was peeked at)
-        value += advance();
+        advance();
         
         // Check for hex, binary, or octal prefixes
-        if (value == "0" && !isAtEnd()) {
+        if (value() == "0" && !isAtEnd()) {
             char next = peek();
             if (next == 'x' || next == 'X') {
                 isHex = true;
-                value += advance();
+                advance();
                 if (!std::isxdigit(peek())) {
                     reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                                "Invalid hexadecimal number");
-                    tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                    addToken(TokenType::ERROR, std::string(value()), line, column - value().length());
                     return;
                 }
             } else if (next == 'b' || next == 'B') {
                 isBinary = true;
-                value += advance();
+                advance();
                 if (peek() != '0' && peek() != '1') {
                     reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                                "Invalid binary number");
-                    tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                    addToken(TokenType::ERROR, std::string(value()), line, column - value().length());
                     return;
                 }
             } else if (std::isdigit(next) && next != '0') {
@@ -518,19 +552,19 @@ namespace lexer
         // Scan digits
         if (isHex) {
             while (std::isxdigit(peek())) {
-                value += advance();
+                advance();
             }
         } else if (isBinary) {
             while (peek() == '0' || peek() == '1') {
-                value += advance();
+                advance();
             }
         } else if (isOctal) {
             while (std::isdigit(peek()) && peek() < '8') {
-                value += advance();
+                advance();
             }
         } else {
             while (std::isdigit(peek())) {
-                value += advance();
+                advance();
             }
         }
 
@@ -538,10 +572,10 @@ namespace lexer
         if (!isHex && !isBinary && !isOctal && peek() == '.' && std::isdigit(peekNext()))
         {
             isFloat = true;
-            value += advance();
+            advance();
             while (std::isdigit(peek()))
             {
-                value += advance();
+                advance();
             }
         }
 
@@ -549,18 +583,18 @@ namespace lexer
         if (!isHex && !isBinary && !isOctal && (peek() == 'e' || peek() == 'E'))
         {
             isFloat = true;
-            value += advance();
+            advance();
             if (peek() == '+' || peek() == '-') {
-                value += advance();
+                advance();
             }
             if (!std::isdigit(peek())) {
                 reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                            "Invalid exponent in number");
-                tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                addToken(TokenType::ERROR, std::string(value()), line, column - value().length());
                 return;
             }
             while (std::isdigit(peek())) {
-                value += advance();
+                advance();
             }
         }
 
@@ -569,40 +603,41 @@ namespace lexer
             char suffix = peek();
             if (suffix == 'f' || suffix == 'F') {
                 isFloat = true;
-                value += advance();
+                advance();
             } else if (suffix == 'l' || suffix == 'L') {
-                value += advance();
+                advance();
             } else if (suffix == 'u' || suffix == 'U') {
-                value += advance();
+                advance();
             }
         }
 
         if (isFloat) {
-            tokens.emplace_back(TokenType::FLOAT64, value, filename, line, column - value.length());
+            addToken(TokenType::FLOAT64, std::string(value()), line, column - value().length());
         } else {
-            tokens.emplace_back(TokenType::INT, value, filename, line, column - value.length());
+            addToken(TokenType::INT, std::string(value()), line, column - value().length());
         }
     }
 
     void Lexer::scanIdentifier()
     {
-        std::string value;
-        // Start with the current character (which was peeked at)
-        value += advance();
-        // Continue scanning the rest of the identifier
-        while (std::isalnum(peek()) || peek() == '_')
+        // The first character was peeked at and is a letter or '_'
+        advance();
+        skip(scan::identifierRun(cursor(), limit()));
+
+        std::string_view text = source.substr(start, current - start);
+        TokenType type = TokenType::IDENTIFIER;
+        uint32_t symbol;
+        if (const Keyword *keyword = findKeyword(text))
         {
-            value += advance();
+            type = keyword->type;
+            symbol = keywordSymbol(keyword);
         }
-        
-        // Check for keywords
-        TokenType type = TokenType::IDENTIFIER;
-        auto it = keywords.find(value);
-        if (it != keywords.end()) {
-            type = it->second;
+        else
+        {
+            symbol = symbols->intern(text);
         }
-        
-        tokens.emplace_back(type, value, filename, line, column - value.length());
+        Token &token = addToken(type, std::string(text), line, column - text.length());
+        token.symbol = symbol;
     }
 
     void Lexer::scanToken()
@@ -614,9 +649,7 @@ namespace lexer
             handleIndentation();
             atLineStart = false;
             // Skip any remaining whitespace after indentation
-            while (peek() == ' ' || peek() == '\r' || peek() == '\t') {
-                advance();
-            }
+            skip(scan::blankRun(cursor(), limit()));
             // If we hit a newline, it's a blank line - skip it and try again
             if (peek() == '\n') {
                 advance();
@@ -657,104 +690,107 @@ namespace lexer
         switch (c)
         {
         case '(':
-            tokens.emplace_back(TokenType::LEFT_PAREN, "(", filename, line, column - 1);
+            addToken(TokenType::LEFT_PAREN, "(", line, column - 1);
             break;
         case ')':
-            tokens.emplace_back(TokenType::RIGHT_PAREN, ")", filename, line, column - 1);
+            addToken(TokenType::RIGHT_PAREN, ")", line, column - 1);
             break;
         case '{':
             braceDepth++;  // Entering a brace block
-            tokens.emplace_back(TokenType::LEFT_BRACE, "{", filename, line, column - 1);
+            addToken(TokenType::LEFT_BRACE, "{", line, column - 1);
             break;
         case '}':
             braceDepth--;  // Exiting a brace block
-            tokens.emplace_back(TokenType::RIGHT_BRACE, "}", filename, line, column - 1);
+            addToken(TokenType::RIGHT_BRACE, "}", line, column - 1);
             break;
         case '[':
-            tokens.emplace_back(TokenType::LEFT_BRACKET, "[", filename, line, column - 1);
+            addToken(TokenType::LEFT_BRACKET, "[", line, column - 1);
             break;
         case ']':
-            tokens.emplace_back(TokenType::RIGHT_BRACKET, "]", filename, line, column - 1);
+            addToken(TokenType::RIGHT_BRACKET, "]", line, column - 1);
             break;
         case ',':
-            tokens.emplace_back(TokenType::COMMA, ",", filename, line, column - 1);
+            addToken(TokenType::COMMA, ",", line, column - 1);
             break;
         case '.':
             if (match('.')) {
                 if (match('.')) {
-                    tokens.emplace_back(TokenType::ELLIPSIS, "...", filename, line, column - 3);
+                    addToken(TokenType::ELLIPSIS, "...", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::RANGE, "..", filename, line, column - 2);
+                    addToken(TokenType::RANGE, "..", line, column - 2);
                 }
             } else {
-                tokens.emplace_back(TokenType::DOT, ".", filename, line, column - 1);
+                addToken(TokenType::DOT, ".", line, column - 1);
             }
             break;
         case ';':
-            tokens.emplace_back(TokenType::SEMI_COLON, ";", filename, line, column - 1);
+            addToken(TokenType::SEMI_COLON, ";", line, column - 1);
             break;
         case ':':
             if (match(':'))
             {
-                tokens.emplace_back(TokenType::DOUBLE_COLON, "::", filename, line, column - 2);
+                addToken(TokenType::DOUBLE_COLON, "::", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::COLON, ":", filename, line, column - 1);
+                addToken(TokenType::COLON, ":", line, column - 1);
             }
             break;
+        case '@':
+            addToken(TokenType::AT, "@", line, column - 1);
+            break;
         case '+':
             if (match('='))
             {
-                tokens.emplace_back(TokenType::PLUS_EQUAL, "+=", filename, line, column - 2);
+                addToken(TokenType::PLUS_EQUAL, "+=", line, column - 2);
             }
             else if (match('+'))
             {
-                tokens.emplace_back(TokenType::INCREMENT, "++", filename, line, column - 2);
+                addToken(TokenType::INCREMENT, "++", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::PLUS, "+", filename, line, column - 1);
+                addToken(TokenType::PLUS, "+", line, column - 1);
             }
             break;
         case '-':
             if (match('<'))
             {
-                tokens.emplace_back(TokenType::CHANNEL_RECEIVE, "-<", filename, line, column - 2);
+                addToken(TokenType::CHANNEL_RECEIVE, "-<", line, column - 2);
             }
             else if (match('='))
             {
-                tokens.emplace_back(TokenType::MINUS_EQUAL, "-=", filename, line, column - 2);
+                addToken(TokenType::MINUS_EQUAL, "-=", line, column - 2);
             }
             else if (match('-'))
             {
-                tokens.emplace_back(TokenType::DECREMENT, "--", filename, line, column - 2);
+                addToken(TokenType::DECREMENT, "--", line, column - 2);
             }
             else if (match('>'))
             {
-                tokens.emplace_back(TokenType::ARROW, "->", filename, line, column - 2);
+                addToken(TokenType::ARROW, "->", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::MINUS, "-", filename, line, column - 1);
+                addToken(TokenType::MINUS, "-", line, column - 1);
             }
             break;
         case '*':
             if (match('='))
             {
-                tokens.emplace_back(TokenType::STAR_EQUAL, "*=", filename, line, column - 2);
+                addToken(TokenType::STAR_EQUAL, "*=", line, column - 2);
             }
             else if (match('*'))
             {
                 if (match('=')) {
-                    tokens.emplace_back(TokenType::POWER_EQUAL, "**=", filename, line, column - 3);
+                    addToken(TokenType::POWER_EQUAL, "**=", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::POWER, "**", filename, line, column - 2);
+                    addToken(TokenType::POWER, "**", line, column - 2);
                 }
             }
             else
             {
-                tokens.emplace_back(TokenType::STAR, "*", filename, line, column - 1);
+                addToken(TokenType::STAR, "*", line, column - 1);
             }
             break;
         case '/':
@@ -762,8 +798,7 @@ namespace lexer
             {
                 // Single-line comment - should have been handled in skipWhitespace
                 // but handle it here just in case
-                while (!isAtEnd() && peek() != '\n')
-                    advance();
+                skip(scan::lineRun(cursor(), limit()));
                 break;
             }
             else if (match('*'))
@@ -788,144 +823,144 @@ namespace lexer
             }
             else if (match('='))
             {
-                tokens.emplace_back(TokenType::SLASH_EQUAL, "/=", filename, line, column - 2);
+                addToken(TokenType::SLASH_EQUAL, "/=", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::SLASH, "/", filename, line, column - 1);
+                addToken(TokenType::SLASH, "/", line, column - 1);
             }
             break;
         case '%':
             if (match('='))
             {
-                tokens.emplace_back(TokenType::PERCENT_EQUAL, "%=", filename, line, column - 2);
+                addToken(TokenType::PERCENT_EQUAL, "%=", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::PERCENT, "%", filename, line, column - 1);
+                addToken(TokenType::PERCENT, "%", line, column - 1);
             }
             break;
         case '=':
             if (match('='))
             {
                 if (match('=')) {
-                    tokens.emplace_back(TokenType::STRICT_EQUAL, "===", filename, line, column - 3);
+                    addToken(TokenType::STRICT_EQUAL, "===", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::EQUAL_EQUAL, "==", filename, line, column - 2);
+                    addToken(TokenType::EQUAL_EQUAL, "==", line, column - 2);
                 }
             }
             else
             {
-                tokens.emplace_back(TokenType::EQUAL, "=", filename, line, column - 1);
+                addToken(TokenType::EQUAL, "=", line, column - 1);
             }
             break;
         case '!':
             if (match('='))
             {
                 if (match('=')) {
-                    tokens.emplace_back(TokenType::STRICT_NOT_EQUAL, "!==", filename, line, column - 3);
+                    addToken(TokenType::STRICT_NOT_EQUAL, "!==", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::BANG_EQUAL, "!=", filename, line, column - 2);
+                    addToken(TokenType::BANG_EQUAL, "!=", line, column - 2);
                 }
             }
             else
             {
-                tokens.emplace_back(TokenType::BANG, "!", filename, line, column - 1);
+                addToken(TokenType::BANG, "!", line, column - 1);
             }
             break;
         case '<':
             if (match('-'))
             {
-                tokens.emplace_back(TokenType::CHANNEL_SEND, "<-", filename, line, column - 2);
+                addToken(TokenType::CHANNEL_SEND, "<-", line, column - 2);
             }
             else if (match('='))
             {
-                tokens.emplace_back(TokenType::LESS_EQUAL, "<=", filename, line, column - 2);
+                addToken(TokenType::LESS_EQUAL, "<=", line, column - 2);
             }
             else if (match('<'))
             {
                 if (match('=')) {
-                    tokens.emplace_back(TokenType::LEFT_SHIFT_EQUAL, "<<=", filename, line, column - 3);
+                    addToken(TokenType::LEFT_SHIFT_EQUAL, "<<=", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::LEFT_SHIFT, "<<", filename, line, column - 2);
+                    addToken(TokenType::LEFT_SHIFT, "<<", line, column - 2);
                 }
             }
             else
             {
-                tokens.emplace_back(TokenType::LESS, "<", filename, line, column - 1);
+                addToken(TokenType::LESS, "<", line, column - 1);
             }
             break;
         case '>':
             if (match('='))
             {
-                tokens.emplace_back(TokenType::GREATER_EQUAL, ">=", filename, line, column - 2);
+                addToken(TokenType::GREATER_EQUAL, ">=", line, column - 2);
             }
             else if (match('>'))
             {
                 if (match('=')) {
-                    tokens.emplace_back(TokenType::RIGHT_SHIFT_EQUAL, ">>=", filename, line, column - 3);
+                    addToken(TokenType::RIGHT_SHIFT_EQUAL, ">>=", line, column - 3);
                 } else {
-                    tokens.emplace_back(TokenType::RIGHT_SHIFT, ">>", filename, line, column - 2);
+                    addToken(TokenType::RIGHT_SHIFT, ">>", line, column - 2);
                 }
             }
             else
             {
-                tokens.emplace_back(TokenType::GREATER, ">", filename, line, column - 1);
+                addToken(TokenType::GREATER, ">", line, column - 1);
             }
             break;
         case '&':
             if (match('&'))
             {
-                tokens.emplace_back(TokenType::AND, "&&", filename, line, column - 2);
+                addToken(TokenType::AND, "&&", line, column - 2);
             }
             else if (match('='))
             {
-                tokens.emplace_back(TokenType::BITWISE_AND_EQUAL, "&=", filename, line, column - 2);
+                addToken(TokenType::BITWISE_AND_EQUAL, "&=", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::BITWISE_AND, "&", filename, line, column - 1);
+                addToken(TokenType::BITWISE_AND, "&", line, column - 1);
             }
             break;
         case '|':
             if (match('|'))
             {
-                tokens.emplace_back(TokenType::OR, "||", filename, line, column - 2);
+                addToken(TokenType::OR, "||", line, column - 2);
             }
             else if (match('='))
             {
-                tokens.emplace_back(TokenType::BITWISE_OR_EQUAL, "|=", filename, line, column - 2);
+                addToken(TokenType::BITWISE_OR_EQUAL, "|=", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::BITWISE_OR, "|", filename, line, column - 1);
+                addToken(TokenType::BITWISE_OR, "|", line, column - 1);
             }
             break;
         case '^':
             if (match('='))
             {
-                tokens.emplace_back(TokenType::BITWISE_XOR_EQUAL, "^=", filename, line, column - 2);
+                addToken(TokenType::BITWISE_XOR_EQUAL, "^=", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::BITWISE_XOR, "^", filename, line, column - 1);
+                addToken(TokenType::BITWISE_XOR, "^", line, column - 1);
             }
             break;
         case '~':
-            tokens.emplace_back(TokenType::BITWISE_NOT, "~", filename, line, column - 1);
+            addToken(TokenType::BITWISE_NOT, "~", line, column - 1);
             break;
         case '?':
             if (match('.'))
             {
-                tokens.emplace_back(TokenType::SAFE_ACCESS, "?.", filename, line, column - 2);
+                addToken(TokenType::SAFE_ACCESS, "?.", line, column - 2);
             }
             else if (match('?'))
             {
-                tokens.emplace_back(TokenType::NULL_COALESCE, "??", filename, line, column - 2);
+                addToken(TokenType::NULL_COALESCE, "??", line, column - 2);
             }
             else
             {
-                tokens.emplace_back(TokenType::QUESTION, "?", filename, line, column - 1);
+                addToken(TokenType::QUESTION, "?", line, column - 1);
             }
             break;
         case '"':
@@ -938,7 +973,7 @@ namespace lexer
         default:
             reportError(error::ErrorCode::L001_INVALID_CHARACTER,
                        "Unexpected character: " + std::string(1, c));
-            tokens.emplace_back(TokenType::ERROR, std::string(1, c), filename, line, column - 1);
+            addToken(TokenType::ERROR, std::string(1, c), line, column - 1);
             break;
         }
     }
@@ -957,7 +992,7 @@ namespace lexer
                 // Template interpolation
                 advance(); // consume '$'
                 advance(); // consume '{'
-                tokens.emplace_back(TokenType::TEMPLATE_START, value, filename, startLine, startColumn);
+                addToken(TokenType::TEMPLATE_START, value, startLine, startColumn);
                 value.clear();
                 
                 // Parse the expression inside ${}
@@ -980,7 +1015,7 @@ namespace lexer
                 
                 if (braceCount == 0) {
                     advance(); // consume closing '}'
-                    tokens.emplace_back(TokenType::TEMPLATE_EXPR, expr, filename, line, column - expr.length() - 1);
+                    addToken(TokenType::TEMPLATE_EXPR, expr, line, column - expr.length() - 1);
                     startLine = line;
                     startColumn = column;
                 }
@@ -1020,25 +1055,19 @@ namespace lexer
         }
 
         advance(); // consume closing backtick
-        tokens.emplace_back(TokenType::TEMPLATE_END, value, filename, startLine, startColumn);
+        addToken(TokenType::TEMPLATE_END, value, startLine, startColumn);
     }
 
     void Lexer::reportError(error::ErrorCode code, const std::string& message)
     {
         errorCount++;
-        errorHandler.reportError(code, message, filename, line, column, error::ErrorSeverity::ERROR);
+        errorHandler.reportError(code, message, std::string(filename), line, column, error::ErrorSeverity::ERROR);
         
         if (errorCount >= maxErrors) {
             errorHandler.reportError(error::ErrorCode::L004_TOO_MANY_ERRORS,
                                    "Too many lexer errors, stopping tokenization",
-                                   filename, line, column, error::ErrorSeverity::FATAL);
+                                   std::string(filename), line, column, error::ErrorSeverity::FATAL);
         }
     }
 
-    Token Lexer::makeToken(TokenType type, const std::string &value)
-    {
-        return Token(type, value.empty() ? source.substr(start, current - start) : value,
-                     filename, line, column - (value.empty() ? (current - start) : value.length()));
-    }
-
 } // namespace lexer
@@ -2,8 +2,11 @@
 #define LEXER_H
 
 #include "token.h"
+#include "source_manager.h"
+#include "symbol_table.h"
 #include "../error/error_handler.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -11,11 +14,14 @@ namespace lexer {
 
     /**
      * @brief Lexer class for tokenizing Tocin source code.
+     *
+     * Tokens are produced on demand by next(), so a parser pulling from the
+     * lexer never holds more than the tokens it is looking at.
      */
     class Lexer {
     public:
         /**
-         * @brief Constructs a lexer.
+         * @brief Constructs a lexer over a copy of the source.
          * @param source The source code to tokenize.
          * @param filename The source file name.
          * @param indentSize The number of spaces per indentation level (default 4).
@@ -23,17 +29,45 @@ namespace lexer {
         Lexer(const std::string& source, const std::string& filename, int indentSize = 4);
 
         /**
-         * @brief Tokenizes the source code.
+         * @brief Constructs a lexer reading a source buffer in place.
+         * @param buffer The source; it must outlive the lexer and its tokens.
+         * @param symbols The table to intern names into, or nullptr for one
+         *                owned by the lexer.
+         * @param indentSize The number of spaces per indentation level (default 4).
+         */
+        explicit Lexer(const SourceBuffer& buffer, SymbolTable* symbols = nullptr, int indentSize = 4);
+
+        Lexer(const Lexer&) = delete;
+        Lexer& operator=(const Lexer&) = delete;
+
+        /**
+         * @brief Scans the next token.
+         * @return The token; EOF_TOKEN once the source is exhausted, and
+         *         again on every later call.
+         */
+        Token next();
+
+        /**
+         * @brief Tokenizes the whole source code from the beginning.
          * @return A vector of tokens.
          */
         std::vector<Token> tokenize();
 
+        /**
+         * @brief The table identifiers and keywords are interned into.
+         */
+        const SymbolTable& getSymbols() const { return *symbols; }
+
     private:
         bool isAtEnd() const;
         char advance();
         char peek() const;
         char peekNext() const;
         bool match(char expected);
+        // Moves past `count` characters known not to include a newline
+        void skip(size_t count);
+        const char* cursor() const { return source.data() + current; }
+        const char* limit() const { return source.data() + source.size(); }
         void skipWhitespace();
         void handleIndentation();
         void scanToken();
@@ -42,11 +76,18 @@ namespace lexer {
         void scanIdentifier();
         void scanTemplateLiteral();
         void reportError(error::ErrorCode code, const std::string& message);
-        Token makeToken(TokenType type, const std::string& value = "");
+        void reset();
+        Token& addToken(TokenType type, std::string value, int tokenLine, int tokenColumn);
 
-        std::string source;
-        std::string filename;
-        std::vector<Token> tokens;
+        std::string ownedSource;     // Copy made by the string constructor
+        std::string ownedFilename;
+        std::unique_ptr<SymbolTable> ownedSymbols;
+        std::string_view source;
+        std::string_view filename;
+        SymbolTable* symbols;
+        std::vector<Token> tokens;   // Scanned but not yet returned by next()
+        size_t head;                 // Next of them to return
+        bool finished;               // EOF_TOKEN has been queued
         size_t start;
         size_t current;
         int line;
@@ -0,0 +1,82 @@
+#include "source_manager.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lexer
+{
+
+    SourceBuffer::~SourceBuffer()
+    {
+#ifndef _WIN32
+        if (mapping)
+        {
+            munmap(mapping, mappingSize);
+        }
+#endif
+    }
+
+    const SourceBuffer* SourceManager::load(const std::string &path)
+    {
+        std::unique_ptr<SourceBuffer> buffer(new SourceBuffer(path));
+
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            close(fd);
+            return nullptr;
+        }
+        // An empty file cannot be mapped; it simply has no text
+        if (info.st_size > 0)
+        {
+            size_t size = static_cast<size_t>(info.st_size);
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(fd);
+                return nullptr;
+            }
+            // The lexer reads front to back exactly once
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            buffer->mapping = mapping;
+            buffer->mappingSize = size;
+            buffer->contents = std::string_view(static_cast<const char*>(mapping), size);
+        }
+        close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            return nullptr;
+        }
+        buffer->owned.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        buffer->contents = buffer->owned;
+#endif
+
+        buffers.push_back(std::move(buffer));
+        return buffers.back().get();
+    }
+
+    const SourceBuffer& SourceManager::add(std::string name, std::string text)
+    {
+        std::unique_ptr<SourceBuffer> buffer(new SourceBuffer(std::move(name)));
+        buffer->owned = std::move(text);
+        buffer->contents = buffer->owned;
+        buffers.push_back(std::move(buffer));
+        return *buffers.back();
+    }
+
+} // namespace lexer
@@ -0,0 +1,89 @@
+#ifndef SOURCE_MANAGER_H
+#define SOURCE_MANAGER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lexer {
+
+    /**
+     * @brief The text of one source file, mapped into memory or owned.
+     *
+     * Lexers read a buffer in place and tokens refer back to it by offset,
+     * so the text is never copied. Buffers are owned by a SourceManager and
+     * stay at the same address until it is destroyed.
+     */
+    class SourceBuffer {
+    public:
+        ~SourceBuffer();
+
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+        /**
+         * @brief The name tokens report as their file name.
+         */
+        std::string_view name() const { return path; }
+
+        /**
+         * @brief The whole source text.
+         */
+        std::string_view text() const { return contents; }
+
+        /**
+         * @brief Whether the text is a memory mapping of the file.
+         */
+        bool isMapped() const { return mapping != nullptr; }
+
+    private:
+        friend class SourceManager;
+
+        explicit SourceBuffer(std::string path) : path(std::move(path)) {}
+
+        std::string path;
+        std::string owned;           // Text not backed by a file mapping
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        std::string_view contents;
+    };
+
+    /**
+     * @brief Loads and owns the source buffers of a compilation.
+     *
+     * Files are mapped read-only with mmap where available, so loading a
+     * multi-megabyte file costs no copy and no allocation proportional to
+     * its size. Text that does not come from a file (the REPL, generated
+     * code) is added as an owned buffer.
+     */
+    class SourceManager {
+    public:
+        SourceManager() = default;
+
+        SourceManager(const SourceManager&) = delete;
+        SourceManager& operator=(const SourceManager&) = delete;
+
+        /**
+         * @brief Maps a file into memory.
+         * @param path The file to load; also the buffer's name.
+         * @return The buffer, or nullptr if the file cannot be read.
+         */
+        const SourceBuffer* load(const std::string& path);
+
+        /**
+         * @brief Adds source text that is not read from a file.
+         * @param name The name tokens report as their file name.
+         * @param text The source text.
+         * @return The buffer.
+         */
+        const SourceBuffer& add(std::string name, std::string text);
+
+    private:
+        std::vector<std::unique_ptr<SourceBuffer>> buffers;
+    };
+
+} // namespace lexer
+
+#endif // SOURCE_MANAGER_H
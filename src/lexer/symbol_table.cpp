@@ -0,0 +1,96 @@
+#include "symbol_table.h"
+#include "keywords.h"
+#include <cstring>
+
+namespace lexer
+{
+
+    SymbolTable::SymbolTable() : slots(256, 0)
+    {
+        names.push_back(std::string_view());
+        hashes.push_back(0);
+        for (const auto &keyword : keywords)
+        {
+            uint32_t symbol = intern(keyword.spelling);
+            types.resize(symbol + 1, TokenType::IDENTIFIER);
+            types[symbol] = keyword.type;
+        }
+    }
+
+    uint32_t SymbolTable::intern(std::string_view text)
+    {
+        uint32_t textHash = hash(text);
+        size_t slot = find(text, textHash);
+        if (slots[slot] != 0)
+        {
+            return slots[slot];
+        }
+        if ((names.size() + 1) * 2 > slots.size())
+        {
+            grow();
+            slot = find(text, textHash);
+        }
+        spellings.emplace_back(text);
+        uint32_t symbol = static_cast<uint32_t>(names.size());
+        names.push_back(spellings.back());
+        hashes.push_back(textHash);
+        slots[slot] = symbol;
+        return symbol;
+    }
+
+    uint32_t SymbolTable::hash(std::string_view text)
+    {
+        // Identifiers are short: mix them in eight-byte words
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ text.size();
+        const char *p = text.data();
+        size_t n = text.size();
+        while (n >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 31;
+            p += 8;
+            n -= 8;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, p, n);
+        h = (h ^ tail) * 0x94D049BB133111EBull;
+        h ^= h >> 29;
+        return static_cast<uint32_t>(h);
+    }
+
+    size_t SymbolTable::find(std::string_view text, uint32_t textHash) const
+    {
+        size_t mask = slots.size() - 1;
+        for (size_t slot = textHash & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t symbol = slots[slot];
+            if (symbol == 0 || (hashes[symbol] == textHash && names[symbol] == text))
+            {
+                return slot;
+            }
+        }
+    }
+
+    void SymbolTable::grow()
+    {
+        std::vector<uint32_t> old(slots.size() * 2, 0);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (uint32_t symbol : old)
+        {
+            if (symbol == 0)
+            {
+                continue;
+            }
+            size_t slot = hashes[symbol] & mask;
+            while (slots[slot] != 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = symbol;
+        }
+    }
+
+} // namespace lexer
@@ -0,0 +1,65 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include "token.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lexer {
+
+    /**
+     * @brief Interns identifier and keyword spellings to integer IDs.
+     *
+     * Every table starts with the keywords, so a keyword's ID is the same
+     * in all of them and a single lookup tells the lexer both the symbol
+     * and whether it is reserved. ID 0 means "no symbol". A table is not
+     * thread safe; give each concurrently running lexer its own.
+     */
+    class SymbolTable {
+    public:
+        SymbolTable();
+
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        /**
+         * @brief Returns the ID of a spelling, adding it if it is new.
+         */
+        uint32_t intern(std::string_view text);
+
+        /**
+         * @brief The spelling of an ID returned by intern().
+         */
+        std::string_view name(uint32_t symbol) const { return names[symbol]; }
+
+        /**
+         * @brief The keyword token type of a symbol, or IDENTIFIER.
+         */
+        TokenType keyword(uint32_t symbol) const
+        {
+            return symbol < types.size() ? types[symbol] : TokenType::IDENTIFIER;
+        }
+
+        size_t size() const { return names.size(); }
+
+    private:
+        static uint32_t hash(std::string_view text);
+        // Slot holding `text`, or the empty slot where it would go
+        size_t find(std::string_view text, uint32_t textHash) const;
+        void grow();
+
+        std::deque<std::string> spellings; // Stable storage the views below point into
+        std::vector<std::string_view> names;
+        std::vector<uint32_t> hashes;       // Indexed by ID
+        std::vector<TokenType> types;       // Indexed by the keywords' IDs
+        // Open addressing with linear probing; holds IDs, 0 when empty.
+        // Kept at most half full.
+        std::vector<uint32_t> slots;
+    };
+
+} // namespace lexer
+
+#endif // SYMBOL_TABLE_H
@@ -18,6 +18,7 @@ namespace lexer {
         case TokenType::DOT: typeStr = "DOT"; break;
         case TokenType::SEMI_COLON: typeStr = "SEMI_COLON"; break;
         case TokenType::COLON: typeStr = "COLON"; break;
+        case TokenType::AT: typeStr = "AT"; break;
         case TokenType::PLUS: typeStr = "PLUS"; break;
         case TokenType::PLUS_EQUAL: typeStr = "PLUS_EQUAL"; break;
         case TokenType::MINUS: typeStr = "MINUS"; break;
@@ -1,6 +1,8 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -26,6 +28,7 @@ namespace lexer
         DOT,
         SEMI_COLON,
         COLON,
+        AT,
 
         // One or two character tokens
         PLUS,
@@ -230,6 +233,9 @@ namespace lexer
         std::string_view filename;
         int line;
         int column;
+        size_t offset = 0;   // Start of the lexeme in the source buffer
+        uint32_t length = 0; // Length of the lexeme in the source buffer
+        uint32_t symbol = 0; // Interned ID of an identifier or keyword, else 0
     };
 
 } // namespace lexer
@@ -2,7 +2,11 @@
 #define LLVM_SHIM_H
 
 // LLVM shim header to handle different LLVM versions and include paths
-#if __has_include(<llvm/Support/Host.h>)
+// Host.h moved to TargetParser in LLVM 17
+#if __has_include(<llvm/TargetParser/Host.h>)
+#include <llvm/TargetParser/Host.h>
+#define LLVM_HOST_HEADER_AVAILABLE 1
+#elif __has_include(<llvm/Support/Host.h>)
 #include <llvm/Support/Host.h>
 #define LLVM_HOST_HEADER_AVAILABLE 1
 #else
@@ -13,12 +17,14 @@
 
 // If Host.h is not available, provide minimal fallbacks
 #if !LLVM_HOST_HEADER_AVAILABLE
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
 namespace llvm {
 namespace sys {
     inline std::string getDefaultTargetTriple() { return "x86_64-unknown-linux-gnu"; }
     inline std::string getProcessTriple() { return getDefaultTargetTriple(); }
-    inline std::string getHostCPUName() { return "generic"; }
-    inline std::string getHostCPUFeatures() { return ""; }
+    inline StringRef getHostCPUName() { return "generic"; }
+    inline bool getHostCPUFeatures(StringMap<bool> &) { return false; }
 } // namespace sys
 } // namespace llvm
 #endif
@@ -18,12 +18,6 @@
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/MC/TargetRegistry.h>
-#include <llvm/Transforms/InstCombine/InstCombine.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/Scalar/GVN.h>
-#include <llvm/Analysis/LoopAnalysisManager.h>
-#include <llvm/Analysis/CGSCCPassManager.h>
-#include <llvm/Passes/PassBuilder.h>
 
 // Conditionally include Python
 #ifdef WITH_PYTHON
@@ -39,6 +33,11 @@
 #include "codegen/ir_generator.h"
 #include "error/error_handler.h"
 #include "compiler/compilation_context.h"
+#include "compiler/advanced_optimizations.h"
+#include "compiler/repl_session.h"
+#include "compiler/compilation_cache.h"
+#include "compiler/build_driver.h"
+#include "compiler/compiler.h"
 // Include the feature integration header
 #include "type/feature_integration.h"
 
@@ -113,6 +112,7 @@ public:
         bool dumpIR;
         bool optimize;
         int optimizationLevel;
+        int sizeLevel; // 1 = -Os, 2 = -Oz
         std::string outputFile;
         bool enableFFI;
         bool enableConcurrency;
@@ -122,36 +122,52 @@ public:
         bool enableDebugger;
         bool enableWASM;
         std::string target;
+        std::string cpu; // --cpu/--march; "native" = build host
         bool enablePackageManager;
+        bool useCache;
+        std::string cacheDir; // Empty = CompilationCache::defaultDirectory()
+        unsigned jobs;        // Modules built at once; 0 = one per core
+        bool thinLTO;         // Optimize across modules at link time
+        std::string profileGenerate; // Raw profile path to instrument for; empty = off
+        std::string profileUse;      // Indexed profile to optimize with; empty = off
+        bool runJIT;                 // Run main in-process after building
 
         CompilationOptions()
-            : dumpIR(false), optimize(false), optimizationLevel(2), outputFile(""),
+            : dumpIR(false), optimize(true), optimizationLevel(2), sizeLevel(0), outputFile(""),
               enableFFI(true), enableConcurrency(true), enableAdvancedFeatures(true),
               enableMacros(true), enableAsync(true), enableDebugger(false),
-              enableWASM(false), target("native"), enablePackageManager(true) {}
+              enableWASM(false), target("native"), cpu("generic"), enablePackageManager(true),
+              useCache(true), cacheDir(""), jobs(0), thinLTO(false), profileGenerate(""), profileUse(""), runJIT(false) {}
     };
 
     bool compile(const std::string &source, const std::string &filename,
                  const CompilationOptions &options = CompilationOptions())
     {
-        std::string processedSource = source;
-        
+        lexer::SourceManager sources;
+        return compile(sources.add(filename, source), options);
+    }
+
+    bool compile(const lexer::SourceBuffer &source,
+                 const CompilationOptions &options = CompilationOptions())
+    {
+        const lexer::SourceBuffer *processedSource = &source;
+        std::string filename(source.name());
+
         // Process macros if enabled
         if (options.enableMacros) {
-            processedSource = processMacros(source, filename);
+            processedSource = &processMacros(source);
         }
 
-        // Lexical analysis
-        lexer::Lexer lexer(processedSource, filename, 4);
-        std::vector<lexer::Token> tokens = lexer.tokenize();
-
-        if (errorHandler.hasFatalErrors())
+        // Native builds go through the build driver, which follows imports
+        // and builds each module on its own, in parallel and from the cache
+        if (!(options.target == "wasm" && options.enableWASM))
         {
-            return false;
+            return buildNative(*processedSource, options);
         }
 
-        // Parsing
-        parser::Parser parser(tokens);
+        // Lexical analysis and parsing; the parser pulls tokens as it goes
+        lexer::Lexer lexer(*processedSource, nullptr, 4);
+        parser::Parser parser(lexer);
         ast::StmtPtr program = parser.parse();
 
         if (errorHandler.hasFatalErrors() || !program)
@@ -171,53 +187,88 @@ public:
             return false;
         }
 
-        // Generate code based on target
-        if (options.target == "wasm" && options.enableWASM) {
-            return compileToWASM(program, filename, options);
-        } else {
-            return compileToNative(program, filename, options);
-        }
+        return compileToWASM(program, filename, options);
     }
 
-    bool compileToNative(ast::StmtPtr program, const std::string& filename, 
-                        const CompilationOptions& options)
+    bool buildNative(const lexer::SourceBuffer &source, const CompilationOptions &options)
     {
-        // IR generation
-        llvm::LLVMContext context;
-        auto module = std::make_unique<llvm::Module>(filename, context);
+        std::string profileError;
+        if (!options.profileUse.empty() &&
+            !tocin::optimization::PGOManager::checkProfile(options.profileUse, profileError))
+        {
+            errorHandler.reportError(error::ErrorCode::I003_READ_ERROR,
+                                     "Cannot use profile: " + profileError,
+                                     std::string(source.name()), 0, 0);
+            return false;
+        }
 
-        codegen::IRGenerator generator(context, std::move(module), errorHandler);
+        compiler::CompilationCache cache(cacheDirectory(options));
+        compiler::BuildDriver::Options buildOptions;
+        buildOptions.jobs = options.jobs;
+        buildOptions.searchPaths = compiler::BuildDriver::defaultSearchPaths();
+        if (options.useCache)
+        {
+            buildOptions.cache = &cache;
+            buildOptions.cacheKey = cacheKeyOptions(options);
+        }
+        if (options.optimize)
+        {
+            bool thinLTO = options.thinLTO && (options.optimizationLevel > 0 || options.sizeLevel > 0);
+            buildOptions.optimize = [this, &options, thinLTO](llvm::Module &module)
+            {
+                optimizeModule(module, options, thinLTO);
+            };
+            buildOptions.thinLTO = thinLTO;
+            buildOptions.optimizationLevel = options.sizeLevel > 0 ? 2 : options.optimizationLevel;
+            buildOptions.cpu = tocin::optimization::resolveTargetCPU(options.cpu);
+        }
 
-        // Generate LLVM IR from the AST
-        auto generatedModule = generator.generate(program);
-        if (errorHandler.hasFatalErrors() || !generatedModule)
+        compiler::BuildDriver driver(errorHandler, std::move(buildOptions));
+        if (!driver.build(source))
         {
             return false;
         }
-
-        // Verify the module
-        std::string verifierErrors;
-        llvm::raw_string_ostream verifierStream(verifierErrors);
-        if (llvm::verifyModule(*generatedModule, &verifierStream))
+        llvm::Module *program = driver.link();
+        if (!program || !emitNative(*program, std::string(source.name()), options))
         {
-            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
-                                     "Invalid LLVM IR generated: " + verifierErrors,
-                                     filename, 0, 0);
             return false;
         }
-
-        // Optimize if requested
-        if (options.optimize && !errorHandler.hasFatalErrors())
+        if (options.runJIT)
         {
-            optimizeModule(*generatedModule, options.optimizationLevel);
+            return runJIT(driver, options);
         }
+        return true;
+    }
+
+    // Runs the linked program on the same lazy ORC JIT as compiler::Compiler
+    bool runJIT(compiler::BuildDriver& driver, const CompilationOptions& options)
+    {
+        compiler::CompilationOptions jitOptions;
+        jitOptions.optimize = options.optimize;
+        jitOptions.optimizationLevel = options.optimizationLevel;
+        jitOptions.sizeLevel = options.sizeLevel;
+        jitOptions.cpu = options.cpu;
+        jitOptions.runJIT = true;
+
+        auto [context, module] = driver.releaseLinked();
+        compiler::Compiler jit(errorHandler);
+        jit.adoptModule(std::move(context), std::move(module), jitOptions);
+        exitCode = jit.executeJIT();
+        return !errorHandler.hasFatalErrors();
+    }
 
+    // What main returned under --jit
+    int getExitCode() const { return exitCode; }
+
+    bool emitNative(llvm::Module& module, const std::string& filename,
+                    const CompilationOptions& options)
+    {
         // Dump IR if requested
         if (options.dumpIR)
         {
             std::string irOutput;
             llvm::raw_string_ostream irStream(irOutput);
-            irStream << *generatedModule;
+            irStream << module;
             std::cout << irOutput << std::endl;
         }
 
@@ -240,7 +291,7 @@ public:
                 return false;
             }
 
-            outputFile << *generatedModule;
+            outputFile << module;
         }
 
         return !errorHandler.hasFatalErrors();
@@ -362,6 +413,20 @@ public:
 #endif
     }
 
+    /**
+     * @brief Starts an interactive session that runs each input as it is typed.
+     */
+    std::unique_ptr<compiler::ReplSession> startRepl(const CompilationOptions &options)
+    {
+        compiler::CompilationOptions sessionOptions;
+        sessionOptions.optimize = options.optimize;
+        sessionOptions.optimizationLevel = options.optimizationLevel;
+        sessionOptions.sizeLevel = options.sizeLevel;
+        sessionOptions.cpu = options.cpu;
+        sessionOptions.dumpIR = options.dumpIR;
+        return std::make_unique<compiler::ReplSession>(errorHandler, &featureManager, sessionOptions);
+    }
+
     // Async methods
     template<typename T>
     runtime::Future<T> createAsync(std::function<T()> func) {
@@ -376,6 +441,7 @@ public:
 private:
     error::ErrorHandler &errorHandler;
     type_checker::FeatureManager featureManager;
+    int exitCode = 0;
     std::unique_ptr<compiler::MacroSystem> macroSystem;
     std::unique_ptr<runtime::AsyncSystem> asyncSystem;
 #ifdef WITH_DEBUGGER
@@ -393,53 +459,100 @@ private:
         // FFI initialization is handled by the relevant modules if available
     }
 
-    std::string processMacros(const std::string& source, const std::string& filename) {
+    static std::string cacheDirectory(const CompilationOptions& options)
+    {
+        return options.cacheDir.empty() ? compiler::CompilationCache::defaultDirectory() : options.cacheDir;
+    }
+
+    static compiler::CacheKeyOptions cacheKeyOptions(const CompilationOptions& options)
+    {
+        auto cpu = tocin::optimization::resolveTargetCPU(options.cpu);
+        compiler::CacheKeyOptions key;
+        key.optimize = options.optimize;
+        key.optimizationLevel = options.optimizationLevel;
+        key.sizeLevel = options.sizeLevel;
+        key.target = options.target;
+        key.triple = llvm::sys::getDefaultTargetTriple();
+        key.cpu = cpu.name;
+        key.features = cpu.features;
+        for (bool flag : {options.enableFFI, options.enableConcurrency, options.enableAdvancedFeatures,
+                          options.enableMacros, options.enableAsync, options.enableDebugger, options.thinLTO})
+        {
+            key.flags += flag ? '1' : '0';
+        }
+        // A new profile changes the code even when the source does not
+        if (!options.profileGenerate.empty())
+        {
+            key.profile = "generate:" + options.profileGenerate;
+        }
+        else if (!options.profileUse.empty())
+        {
+            auto digest = llvm::sys::fs::md5_contents(options.profileUse);
+            key.profile = "use:" + (digest ? std::string(digest->digest()) : options.profileUse);
+        }
+        return key;
+    }
+
+    const lexer::SourceBuffer& processMacros(const lexer::SourceBuffer& source) {
         // Process macros in the source code
         // This would expand macros before compilation
         return source; // Placeholder
     }
 
-    void optimizeModule(llvm::Module &module, int level)
+    void optimizeModule(llvm::Module &module, const CompilationOptions &options, bool thinLTO = false)
     {
-        // Create a function pass manager
-        llvm::PassBuilder passBuilder;
-        llvm::LoopAnalysisManager LAM;
-        llvm::FunctionAnalysisManager FAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-
-        // Register all the basic analyses with the managers
-        passBuilder.registerModuleAnalyses(MAM);
-        passBuilder.registerCGSCCAnalyses(CGAM);
-        passBuilder.registerFunctionAnalyses(FAM);
-        passBuilder.registerLoopAnalyses(LAM);
-        passBuilder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+        int level = options.optimizationLevel;
+        int sizeLevel = options.sizeLevel;
 
-        // Create the optimization pipeline based on optimization level
-        llvm::ModulePassManager MPM;
-        if (level == 0)
+        // Optimize for the host; the target machine gives the vectorizers
+        // and unroller their cost model
+        auto cpu = tocin::optimization::resolveTargetCPU(options.cpu);
+        auto targetMachine = createHostTargetMachine(level, sizeLevel, cpu);
+        if (targetMachine)
         {
-            // O0 - No optimization
-            MPM = passBuilder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+            module.setTargetTriple(targetMachine->getTargetTriple().getTriple());
+            module.setDataLayout(targetMachine->createDataLayout());
         }
-        else if (level == 1)
+        tocin::optimization::applyTargetCPU(module, cpu);
+
+        tocin::optimization::AdvancedOptimizationPipeline pipeline;
+        pipeline.setOptimizationLevel(level);
+        pipeline.setSizeLevel(sizeLevel);
+        pipeline.setTargetMachine(targetMachine.get());
+        // The standard pipeline already inlines, vectorizes and unrolls;
+        // the hand-rolled IPO and loop phases would only duplicate it
+        pipeline.enableIPO(false);
+        pipeline.enablePolyhedral(false);
+        pipeline.enableLTO(thinLTO);
+        if (!options.profileGenerate.empty())
         {
-            // O1 - Basic optimizations
-            MPM = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1);
+            pipeline.setProfileGenerate(options.profileGenerate);
         }
-        else if (level == 2)
+        else if (!options.profileUse.empty())
         {
-            // O2 - Default optimizations
-            MPM = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+            pipeline.setProfileUse(options.profileUse);
         }
-        else if (level == 3)
+        pipeline.optimize(&module);
+    }
+
+    std::unique_ptr<llvm::TargetMachine> createHostTargetMachine(
+        int level, int sizeLevel, const tocin::optimization::TargetCPU &cpu)
+    {
+        std::string targetTriple = llvm::sys::getDefaultTargetTriple();
+        std::string error;
+        auto target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
+        if (!target)
         {
-            // O3 - Aggressive optimizations
-            MPM = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Failed to lookup target: " + error,
+                                     "", 0, 0, error::ErrorSeverity::WARNING);
+            return nullptr;
         }
 
-        // Run the optimizations
-        MPM.run(module, MAM);
+        llvm::TargetOptions targetOptions;
+        return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+            targetTriple, cpu.name, cpu.features, targetOptions, llvm::Reloc::Model::PIC_, std::nullopt,
+            tocin::optimization::codeGenOptLevel(level, sizeLevel)));
     }
 };
 
@@ -453,8 +566,20 @@ void displayUsage()
               << "  --help                 Display this help message\n"
               << "  --dump-ir              Dump LLVM IR to stdout\n"
               << "  -O0, -O1, -O2, -O3     Set optimization level (default: -O2)\n"
+              << "  -Os, -Oz               Optimize for size (-Oz: smallest, no vectorization)\n"
               << "  -o <file>              Write output to <file>\n"
+              << "  --jit                  Run the program's main after building it\n"
               << "  --target <target>      Set compilation target (native, wasm)\n"
+              << "  --cpu <name>           Tune for and use the ISA of <name> (\"native\" = this machine)\n"
+              << "  -march=<name>          Same as --cpu <name>\n"
+              << "  --cache-dir <dir>      Keep compiled modules in <dir> (default: $TOCIN_CACHE_DIR or the user cache)\n"
+              << "  --no-cache             Always compile from source\n"
+              << "  -j <n>, --jobs <n>     Build up to <n> modules at once (default: one per core)\n"
+              << "  --thin-lto             Inline and optimize across modules at link time\n"
+              << "  --profile-generate[=<dir>]\n"
+              << "                         Instrument for PGO; runs write <dir>/default_%m.profraw\n"
+              << "                         (link with clang -fprofile-generate, index with llvm-profdata merge)\n"
+              << "  --profile-use=<file>   Optimize with an indexed profile (.profdata)\n"
               << "  --no-ffi               Disable FFI support\n"
               << "  --no-concurrency       Disable concurrency features\n"
               << "  --no-advanced          Disable advanced language features\n"
@@ -488,7 +613,6 @@ void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandl
 {
     std::string line;
     EnhancedCompiler::CompilationOptions options;
-    options.dumpIR = true;
     options.enableFFI = true;
     options.enableConcurrency = true;
     options.enableAdvancedFeatures = true;
@@ -497,12 +621,11 @@ void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandl
     options.optimize = true;
     options.optimizationLevel = 2;
 
-    // Initialize REPL state
-    static int replCounter = 0;
-    std::string replState;
+    // Each line is compiled on its own against what earlier lines defined
+    auto session = compiler.startRepl(options);
 
     std::cout << "Tocin Enhanced REPL (type 'exit' to quit, 'clear' to reset)\n"
-              << "Commands: debug, package, async, macro\n> ";
+              << "Commands: debug, package, async, macro, ir\n> ";
 
     while (std::getline(std::cin, line))
     {
@@ -511,8 +634,7 @@ void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandl
         if (line == "clear")
         {
             errorHandler.clearErrors();
-            replState.clear();
-            replCounter = 0;
+            session->reset();
             std::cout << "> ";
             continue;
         }
@@ -538,6 +660,12 @@ void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandl
             std::cout << "> ";
             continue;
         }
+        if (line == "ir") {
+            session->setDumpIR(!session->dumpsIR());
+            std::cout << "IR dump " << (session->dumpsIR() ? "on" : "off") << "\n";
+            std::cout << "> ";
+            continue;
+        }
 
         // Trim whitespace
         line.erase(0, line.find_first_not_of(" \t\r\n"));
@@ -549,47 +677,16 @@ void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandl
             continue;
         }
 
-        // Create a proper module for each REPL input
-        std::string moduleSource;
-        
-        // Handle variable declarations and expressions
-        if (line.find("let ") == 0 || line.find("const ") == 0)
-        {
-            // Variable declaration
-            if (line.back() != ';')
-                line += ";";
-            moduleSource = replState + "\n" + line;
-        }
-        else if (line.find("def ") == 0 || line.find("class ") == 0 || 
-                 line.find("trait ") == 0 || line.find("import ") == 0)
-        {
-            // Definition or import statement
-            moduleSource = replState + "\n" + line;
-        }
-        else
-        {
-            // Expression - wrap in a main function if needed
-            if (line.back() != ';')
-                line += ";";
-            
-            // Create a temporary function to evaluate the expression
-            std::string funcName = "repl_expr_" + std::to_string(replCounter++);
-            moduleSource = replState + "\n" +
-                         "def " + funcName + "() {\n" +
-                         "    " + line + "\n" +
-                         "}\n" +
-                         funcName + "();";
-        }
+        // Definitions and imports stand as typed; variable declarations and
+        // expressions are statements and need their terminator
+        bool isDefinition = line.find("def ") == 0 || line.find("class ") == 0 ||
+                            line.find("trait ") == 0 || line.find("import ") == 0;
+        if (!isDefinition && line.back() != ';')
+            line += ";";
 
-        // Compile the current state
-        if (compiler.compile(moduleSource, "<repl>", options))
-        {
-            // Update REPL state with successful compilation
-            replState = moduleSource;
-        }
-        else
+        if (!session->evaluate(line))
         {
-            // Clear errors but keep the previous state
+            // Errors are reported; the session keeps what earlier lines defined
             errorHandler.clearErrors();
         }
 
@@ -662,14 +759,62 @@ int main(int argc, char *argv[])
             options.optimize = true;
             options.optimizationLevel = 3;
         }
+        else if (arg == "-Os" || arg == "-Oz")
+        {
+            options.optimize = true;
+            options.optimizationLevel = 2;
+            options.sizeLevel = arg == "-Os" ? 1 : 2;
+        }
         else if (arg == "-o" && i + 1 < argc)
         {
             options.outputFile = argv[++i];
         }
+        else if (arg == "--jit")
+        {
+            options.runJIT = true;
+        }
         else if (arg == "--target" && i + 1 < argc)
         {
             options.target = argv[++i];
         }
+        else if (arg == "--cpu" && i + 1 < argc)
+        {
+            options.cpu = argv[++i];
+        }
+        else if (arg.rfind("--cpu=", 0) == 0 || arg.rfind("--march=", 0) == 0 ||
+                 arg.rfind("-march=", 0) == 0)
+        {
+            options.cpu = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg == "--cache-dir" && i + 1 < argc)
+        {
+            options.cacheDir = argv[++i];
+        }
+        else if (arg == "--no-cache")
+        {
+            options.useCache = false;
+        }
+        else if (arg == "--profile-generate" || arg.rfind("--profile-generate=", 0) == 0)
+        {
+            std::string directory = arg == "--profile-generate" ? "." : arg.substr(arg.find('=') + 1);
+            options.profileGenerate = tocin::optimization::PGOManager::rawProfilePath(directory);
+        }
+        else if (arg == "--profile-use" && i + 1 < argc)
+        {
+            options.profileUse = argv[++i];
+        }
+        else if (arg.rfind("--profile-use=", 0) == 0)
+        {
+            options.profileUse = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg == "--thin-lto" || arg == "-flto=thin")
+        {
+            options.thinLTO = true;
+        }
+        else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc)
+        {
+            options.jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
         else if (arg == "--no-ffi")
         {
             options.enableFFI = false;
@@ -726,21 +871,26 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // Read the source file
-    std::ifstream file(filename);
-    if (!file.is_open())
+    // Instrumented code calls into the profile runtime, which only a
+    // native link brings in
+    if (options.runJIT && !options.profileGenerate.empty())
+    {
+        std::cerr << "Error: --profile-generate cannot be combined with --jit.\n";
+        return 1;
+    }
+
+    // Map the source file; the lexer reads it in place
+    lexer::SourceManager sources;
+    const lexer::SourceBuffer *source = sources.load(filename);
+    if (!source)
     {
         errorHandler.reportError(error::ErrorCode::I001_FILE_NOT_FOUND,
                                  "Could not open file: " + filename);
         return 1;
     }
 
-    std::string source((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
-    file.close();
-
     // Compile the source
-    if (!compiler.compile(source, filename, options))
+    if (!compiler.compile(*source, options))
     {
         return 1;
     }
@@ -750,5 +900,5 @@ int main(int argc, char *argv[])
     Py_Finalize();
 #endif
 
-    return 0;
+    return compiler.getExitCode();
 }
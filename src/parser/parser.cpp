@@ -6,8 +6,17 @@ namespace parser
 {
 
     Parser::Parser(const std::vector<lexer::Token> &tokens)
-        : tokens(tokens), current(0) {
+        : lexer_(nullptr), tokens(tokens), next(0), arena_(std::make_shared<ast::Arena>()) {
         errors_.clear();
+        currentToken = nextToken();
+        first = currentToken;
+    }
+
+    Parser::Parser(lexer::Lexer &lexer)
+        : lexer_(&lexer), next(0), arena_(std::make_shared<ast::Arena>()) {
+        errors_.clear();
+        currentToken = nextToken();
+        first = currentToken;
     }
 
     ast::StmtPtr Parser::parse()
@@ -32,8 +41,8 @@ namespace parser
             }
 
             // Otherwise, create a block statement
-            return std::make_shared<ast::BlockStmt>(
-                tokens.empty() ? lexer::Token(lexer::TokenType::EOF_TOKEN, "", "", 0, 0) : tokens[0],
+            return make<ast::BlockStmt>(
+                first,
                 std::move(statements));
         }
         catch (const std::exception &e)
@@ -57,6 +66,10 @@ namespace parser
             {
                 return functionDeclaration();
             }
+            if (match(lexer::TokenType::AT))
+            {
+                return decoratedDeclaration();
+            }
             if (match(lexer::TokenType::CLASS))
             {
                 return classDeclaration();
@@ -93,7 +106,23 @@ namespace parser
             initializer = expression();
         }
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after variable declaration");
-        return std::make_shared<ast::VariableStmt>(name, name.value, type, initializer, isConstant);
+        return make<ast::VariableStmt>(name, name.value, type, initializer, isConstant);
+    }
+
+    ast::StmtPtr Parser::decoratedDeclaration()
+    {
+        std::vector<std::string> decorators;
+        do
+        {
+            decorators.push_back(consume(lexer::TokenType::IDENTIFIER, "Expected decorator name after '@'").value);
+        } while (match(lexer::TokenType::AT));
+        if (!match(lexer::TokenType::DEF) && !match(lexer::TokenType::ASYNC))
+        {
+            error(peek(), "Expected function declaration after decorator");
+        }
+        auto function = std::static_pointer_cast<ast::FunctionStmt>(functionDeclaration());
+        function->decorators = std::move(decorators);
+        return function;
     }
 
     ast::StmtPtr Parser::functionDeclaration()
@@ -115,12 +144,12 @@ namespace parser
         }
         else
         {
-            returnType = std::make_shared<ast::SimpleType>(
+            returnType = make<ast::SimpleType>(
                 lexer::Token(lexer::TokenType::NIL, "None", "", 0, 0));
         }
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' before function body");
         auto body = blockStmt();
-        return std::make_shared<ast::FunctionStmt>(name, name.value, parameters, returnType, body, isAsync);
+        return make<ast::FunctionStmt>(name, name.value, parameters, returnType, body, isAsync);
     }
 
     ast::StmtPtr Parser::classDeclaration()
@@ -145,7 +174,7 @@ namespace parser
             }
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after class body");
-        return std::make_shared<ast::ClassStmt>(name, name.value, fields, methods);
+        return make<ast::ClassStmt>(name, name.value, fields, methods);
     }
 
     ast::StmtPtr Parser::statement()
@@ -173,7 +202,7 @@ namespace parser
     {
         auto expr = expression();
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after expression");
-        return std::make_shared<ast::ExpressionStmt>(expr->token, expr);
+        return make<ast::ExpressionStmt>(expr->token, expr);
     }
 
     ast::StmtPtr Parser::ifStmt()
@@ -195,7 +224,7 @@ namespace parser
             consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after else");
             elseBranch = blockStmt();
         }
-        return std::make_shared<ast::IfStmt>(condition->token, condition, thenBranch, elifBranches, elseBranch);
+        return make<ast::IfStmt>(condition->token, condition, thenBranch, elifBranches, elseBranch);
     }
 
     ast::StmtPtr Parser::whileStmt()
@@ -203,7 +232,7 @@ namespace parser
         auto condition = expression();
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after while condition");
         auto body = blockStmt();
-        return std::make_shared<ast::WhileStmt>(condition->token, condition, body);
+        return make<ast::WhileStmt>(condition->token, condition, body);
     }
 
     ast::StmtPtr Parser::forStmt()
@@ -218,7 +247,7 @@ namespace parser
         auto iterable = expression();
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after for iterable");
         auto body = blockStmt();
-        return std::make_shared<ast::ForStmt>(variable, variable.value, variableType, iterable, body);
+        return make<ast::ForStmt>(variable, variable.value, variableType, iterable, body);
     }
 
     ast::StmtPtr Parser::blockStmt()
@@ -229,7 +258,7 @@ namespace parser
             statements.push_back(declaration());
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after block");
-        return std::make_shared<ast::BlockStmt>(previous(), statements);
+        return make<ast::BlockStmt>(previous(), statements);
     }
 
     ast::StmtPtr Parser::returnStmt()
@@ -241,14 +270,20 @@ namespace parser
             value = expression();
         }
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after return value");
-        return std::make_shared<ast::ReturnStmt>(keyword, value);
+        return make<ast::ReturnStmt>(keyword, value);
     }
 
     ast::StmtPtr Parser::importStmt()
     {
         auto module = consume(lexer::TokenType::IDENTIFIER, "Expected module name");
+        // Dotted paths name modules in subdirectories: import math.basic;
+        std::string moduleName = module.value;
+        while (match(lexer::TokenType::DOT))
+        {
+            moduleName += "." + consume(lexer::TokenType::IDENTIFIER, "Expected module name after '.'").value;
+        }
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after import");
-        return std::make_shared<ast::ImportStmt>(module, module.value);
+        return make<ast::ImportStmt>(module, moduleName);
     }
 
     ast::StmtPtr Parser::matchStmt()
@@ -278,7 +313,7 @@ namespace parser
             }
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after match");
-        return std::make_shared<ast::MatchStmt>(value->token, value, cases, defaultCase);
+        return make<ast::MatchStmt>(value->token, value, cases, defaultCase);
     }
 
     ast::ExprPtr Parser::expression()
@@ -297,11 +332,11 @@ namespace parser
 
             if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr))
             {
-                return std::make_shared<ast::AssignExpr>(equals, var->name, value);
+                return make<ast::AssignExpr>(equals, var->name, value);
             }
             else if (auto get = std::dynamic_pointer_cast<ast::GetExpr>(expr))
             {
-                return std::make_shared<ast::SetExpr>(
+                return make<ast::SetExpr>(
                     equals, get->object, get->name, value);
             }
 
@@ -320,7 +355,7 @@ namespace parser
         {
             auto op = previous();
             auto right = andExpr();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -332,7 +367,7 @@ namespace parser
         {
             auto op = previous();
             auto right = equality();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -344,7 +379,7 @@ namespace parser
         {
             auto op = previous();
             auto right = comparison();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -357,7 +392,7 @@ namespace parser
         {
             auto op = previous();
             auto right = term();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -369,7 +404,7 @@ namespace parser
         {
             auto op = previous();
             auto right = factor();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -382,7 +417,7 @@ namespace parser
         {
             auto op = previous();
             auto right = unary();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -393,12 +428,12 @@ namespace parser
         {
             lexer::Token op = previous();
             ast::ExprPtr right = unary();
-            return std::make_shared<ast::UnaryExpr>(op, op, right);
+            return make<ast::UnaryExpr>(op, op, right);
         }
         if (match(lexer::TokenType::AWAIT))
         {
             auto expr = unary();
-            return std::make_shared<ast::AwaitExpr>(previous(), expr);
+            return make<ast::AwaitExpr>(previous(), expr);
         }
         if (match(lexer::TokenType::NEW))
         {
@@ -408,7 +443,9 @@ namespace parser
         {
             return deleteExpr();
         }
-        if (match(lexer::TokenType::CHANNEL_RECEIVE))
+        // The lexer emits `<-` as CHANNEL_SEND; in prefix position it can
+        // only be a receive
+        if (match(lexer::TokenType::CHANNEL_RECEIVE) || match(lexer::TokenType::CHANNEL_SEND))
         {
             return channelReceiveExpr();
         }
@@ -431,17 +468,17 @@ namespace parser
                     } while (match(lexer::TokenType::COMMA));
                 }
                 auto paren = consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after arguments");
-                expr = std::make_shared<ast::CallExpr>(paren, expr, arguments);
+                expr = make<ast::CallExpr>(paren, expr, arguments);
             }
             else if (match(lexer::TokenType::DOT))
             {
                 auto name = consume(lexer::TokenType::IDENTIFIER, "Expected property name after '.'");
-                expr = std::make_shared<ast::GetExpr>(name, expr, name.value);
+                expr = make<ast::GetExpr>(name, expr, name.value);
             }
             else if (match(lexer::TokenType::CHANNEL_SEND))
             {
                 auto value = expression();
-                expr = std::make_shared<ast::ChannelSendExpr>(previous(), expr, value);
+                expr = make<ast::ChannelSendExpr>(previous(), expr, value);
             }
             else
             {
@@ -455,39 +492,39 @@ namespace parser
     {
         if (match(lexer::TokenType::TRUE))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return make<ast::LiteralExpr>(
                 previous(), "true", ast::LiteralExpr::LiteralType::BOOLEAN);
         }
         if (match(lexer::TokenType::FALSE))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return make<ast::LiteralExpr>(
                 previous(), "false", ast::LiteralExpr::LiteralType::BOOLEAN);
         }
         if (match(lexer::TokenType::NIL))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return make<ast::LiteralExpr>(
                 previous(), "None", ast::LiteralExpr::LiteralType::NIL);
         }
         if (match(lexer::TokenType::INT) || match(lexer::TokenType::FLOAT64) ||
             match(lexer::TokenType::FLOAT32))
         {
             auto type = previous().type == lexer::TokenType::INT ? ast::LiteralExpr::LiteralType::INTEGER : ast::LiteralExpr::LiteralType::FLOAT;
-            return std::make_shared<ast::LiteralExpr>(previous(), previous().value, type);
+            return make<ast::LiteralExpr>(previous(), previous().value, type);
         }
         if (match(lexer::TokenType::STRING))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return make<ast::LiteralExpr>(
                 previous(), previous().value, ast::LiteralExpr::LiteralType::STRING);
         }
         if (match(lexer::TokenType::IDENTIFIER))
         {
-            return std::make_shared<ast::VariableExpr>(previous(), previous().value);
+            return make<ast::VariableExpr>(previous(), previous().value);
         }
         if (match(lexer::TokenType::LEFT_PAREN))
         {
             auto expr = expression();
             consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after expression");
-            return std::make_shared<ast::GroupingExpr>(expr->token, expr);
+            return make<ast::GroupingExpr>(expr->token, expr);
         }
         if (match(lexer::TokenType::LEFT_BRACKET))
         {
@@ -500,7 +537,7 @@ namespace parser
                 } while (match(lexer::TokenType::COMMA));
             }
             auto token = consume(lexer::TokenType::RIGHT_BRACKET, "Expected ']' after list");
-            return std::make_shared<ast::ListExpr>(token, elements);
+            return make<ast::ListExpr>(token, elements);
         }
         if (match(lexer::TokenType::LEFT_BRACE))
         {
@@ -516,7 +553,7 @@ namespace parser
                 } while (match(lexer::TokenType::COMMA));
             }
             auto token = consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after dictionary");
-            return std::make_shared<ast::DictionaryExpr>(token, entries);
+            return make<ast::DictionaryExpr>(token, entries);
         }
         if (match(lexer::TokenType::LAMBDA))
         {
@@ -530,11 +567,11 @@ namespace parser
             }
             else
             {
-                returnType = std::make_shared<ast::SimpleType>(
+                returnType = make<ast::SimpleType>(
                     lexer::Token(lexer::TokenType::NIL, "None", "", 0, 0));
             }
             auto body = expression();
-            return std::make_shared<ast::LambdaExpr>(previous(), parameters, returnType, body);
+            return make<ast::LambdaExpr>(previous(), parameters, returnType, body);
         }
         error(peek(), "Expected expression");
         throw std::runtime_error("Parse error");
@@ -542,6 +579,15 @@ namespace parser
 
     ast::TypePtr Parser::parseType()
     {
+        if (match(lexer::TokenType::CHANNEL))
+        {
+            // `channel` is a keyword, so channel<T> needs its own case
+            lexer::Token keyword = previous();
+            consume(lexer::TokenType::LESS, "Expected '<' after 'channel'");
+            auto elementType = parseType();
+            consume(lexer::TokenType::GREATER, "Expected '>' after channel element type");
+            return make<ast::ChannelType>(keyword, elementType);
+        }
         auto token = consume(lexer::TokenType::IDENTIFIER, "Expected type name");
         if (match(lexer::TokenType::LESS))
         {
@@ -551,7 +597,7 @@ namespace parser
                 typeArgs.push_back(parseType());
             } while (match(lexer::TokenType::COMMA));
             consume(lexer::TokenType::GREATER, "Expected '>' after type arguments");
-            return std::make_shared<ast::GenericType>(token, token.value, typeArgs);
+            return make<ast::GenericType>(token, token.value, typeArgs);
         }
         if (match(lexer::TokenType::LEFT_PAREN))
         {
@@ -566,18 +612,18 @@ namespace parser
             consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after function type parameters");
             consume(lexer::TokenType::ARROW, "Expected '->' in function type");
             auto returnType = parseType();
-            return std::make_shared<ast::FunctionType>(token, paramTypes, returnType);
+            return make<ast::FunctionType>(token, paramTypes, returnType);
         }
         if (match(lexer::TokenType::OR))
         {
-            std::vector<ast::TypePtr> types = {std::make_shared<ast::SimpleType>(token)};
+            std::vector<ast::TypePtr> types = {make<ast::SimpleType>(token)};
             do
             {
                 types.push_back(parseType());
             } while (match(lexer::TokenType::OR));
-            return std::make_shared<ast::UnionType>(token, types);
+            return make<ast::UnionType>(token, types);
         }
-        return std::make_shared<ast::SimpleType>(token);
+        return make<ast::SimpleType>(token);
     }
 
     std::vector<ast::Parameter> Parser::parseParameters()
@@ -594,7 +640,7 @@ namespace parser
                 {
                     error(peek(), "Failed to parse parameter type");
                     // Create a dummy type to avoid crash
-                    type = std::make_shared<ast::SimpleType>(
+                    type = make<ast::SimpleType>(
                         lexer::Token(lexer::TokenType::IDENTIFIER, "int", "", 0, 0));
                 }
                 parameters.emplace_back(name.value, type);
@@ -649,21 +695,33 @@ namespace parser
         return peek().type == type;
     }
 
-    lexer::Token Parser::advance()
+    const lexer::Token &Parser::advance()
     {
         if (!isAtEnd())
-            ++current;
+        {
+            previousToken = std::move(currentToken);
+            currentToken = nextToken();
+        }
         return previous();
     }
 
-    lexer::Token Parser::peek() const
+    const lexer::Token &Parser::peek() const
     {
-        return tokens[current];
+        return currentToken;
     }
 
-    lexer::Token Parser::previous() const
+    const lexer::Token &Parser::previous() const
     {
-        return tokens[current - 1];
+        return previousToken;
+    }
+
+    lexer::Token Parser::nextToken()
+    {
+        if (lexer_)
+            return lexer_->next();
+        if (next < tokens.size())
+            return std::move(tokens[next++]);
+        return lexer::Token(lexer::TokenType::EOF_TOKEN, "", "", 0, 0);
     }
 
     bool Parser::isAtEnd() const
@@ -671,7 +729,7 @@ namespace parser
         return peek().type == lexer::TokenType::EOF_TOKEN;
     }
 
-    lexer::Token Parser::consume(lexer::TokenType type, const std::string &message)
+    const lexer::Token &Parser::consume(lexer::TokenType type, const std::string &message)
     {
         if (check(type))
             return advance();
@@ -816,7 +874,7 @@ namespace parser
                 return nullptr;
             }
             
-            left = std::make_shared<ast::BinaryExpr>(op, left, op, right);
+            left = make<ast::BinaryExpr>(op, left, op, right);
         }
         
         return left;
@@ -868,17 +926,17 @@ namespace parser
         {
             ast::ExprPtr size = expression();
             consume(lexer::TokenType::RIGHT_BRACKET, "Expect ']' after array size.");
-            return std::make_shared<ast::NewExpr>(keyword, std::move(expr), std::move(size));
+            return make<ast::NewExpr>(keyword, std::move(expr), std::move(size));
         }
 
-        return std::make_shared<ast::NewExpr>(keyword, std::move(expr), nullptr);
+        return make<ast::NewExpr>(keyword, std::move(expr), nullptr);
     }
 
     ast::ExprPtr Parser::deleteExpr()
     {
         lexer::Token keyword = previous();
         ast::ExprPtr expr = primary();
-        return std::make_shared<ast::DeleteExpr>(keyword, std::move(expr));
+        return make<ast::DeleteExpr>(keyword, std::move(expr));
     }
 
     ast::StmtPtr Parser::goStmt()
@@ -892,7 +950,7 @@ namespace parser
         consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after goroutine expression");
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after goroutine statement");
         
-        return std::make_shared<ast::GoStmt>(keyword, expr);
+        return make<ast::GoStmt>(keyword, expr);
     }
 
     ast::StmtPtr Parser::selectStmt()
@@ -914,34 +972,47 @@ namespace parser
                 // Check if this is a send case (channel <- value)
                 auto firstExpr = expression();
                 
-                if (match(lexer::TokenType::CHANNEL_SEND))
+                if (auto sendExpr = std::dynamic_pointer_cast<ast::ChannelSendExpr>(firstExpr))
+                {
+                    // expression() already consumed the whole send
+                    channel = sendExpr->channel;
+                    value = sendExpr->value;
+                    isSend = true;
+                }
+                else if (match(lexer::TokenType::CHANNEL_SEND))
                 {
                     // This is a send case: channel <- value
                     channel = firstExpr;
                     value = expression();
                     isSend = true;
                 }
+                else if (auto receiveExpr = std::dynamic_pointer_cast<ast::ChannelReceiveExpr>(firstExpr))
+                {
+                    // Simple receive: <-channel
+                    channel = receiveExpr->channel;
+                }
+                else if (auto assignExpr = std::dynamic_pointer_cast<ast::AssignExpr>(firstExpr);
+                         assignExpr && std::dynamic_pointer_cast<ast::ChannelReceiveExpr>(assignExpr->value))
+                {
+                    // Assignment receive: value = <-channel
+                    value = assignExpr->target;
+                    channel = std::static_pointer_cast<ast::ChannelReceiveExpr>(assignExpr->value)->channel;
+                }
                 else
                 {
-                    // This is a receive case: <-channel or value := <-channel
-                    if (firstExpr->token.type == lexer::TokenType::CHANNEL_RECEIVE)
-                    {
-                        // Simple receive: <-channel
-                        channel = expression();
-                    }
-                    else
+                    // Assignment receive: value := <-channel
+                    value = firstExpr;
+                    if (!match(lexer::TokenType::CHANNEL_SEND))
                     {
-                        // Assignment receive: value := <-channel
-                        value = firstExpr;
                         consume(lexer::TokenType::CHANNEL_RECEIVE, "Expected '<-' for channel receive");
-                        channel = expression();
                     }
+                    channel = expression();
                 }
                 
                 consume(lexer::TokenType::COLON, "Expected ':' after case");
                 auto body = blockStmt();
                 
-                cases.emplace_back(channel, body, false);
+                cases.emplace_back(channel, body, false, value, isSend);
             }
             else if (match(lexer::TokenType::DEFAULT))
             {
@@ -959,7 +1030,7 @@ namespace parser
         }
         
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after select statement");
-        return std::make_shared<ast::SelectStmt>(keyword, cases);
+        return make<ast::SelectStmt>(keyword, cases);
     }
 
     ast::ExprPtr Parser::channelSendExpr()
@@ -968,7 +1039,7 @@ namespace parser
         consume(lexer::TokenType::CHANNEL_SEND, "Expected '<-' for channel send");
         auto value = expression();
         
-        return std::make_shared<ast::ChannelSendExpr>(previous(), channel, value);
+        return make<ast::ChannelSendExpr>(previous(), channel, value);
     }
 
     ast::ExprPtr Parser::channelReceiveExpr()
@@ -976,7 +1047,7 @@ namespace parser
         auto keyword = previous();
         auto channel = expression();
         
-        return std::make_shared<ast::ChannelReceiveExpr>(keyword, channel);
+        return make<ast::ChannelReceiveExpr>(keyword, channel);
     }
 
 } // namespace parser
@@ -2,6 +2,7 @@
 #define PARSER_H
 
 #include "../ast/ast.h"
+#include "../ast/arena.h"
 #include "../lexer/lexer.h"
 #include "../error/error_handler.h"
 #include <memory>
@@ -25,6 +26,12 @@ namespace parser
          */
         explicit Parser(const std::vector<lexer::Token> &tokens);
 
+        /**
+         * @brief Constructs a parser pulling tokens from a lexer as it goes.
+         * @param lexer The lexer; it must outlive the parser.
+         */
+        explicit Parser(lexer::Lexer &lexer);
+
         /**
          * @brief Parses the tokens into an AST.
          * @return The root statement of the AST.
@@ -59,6 +66,7 @@ namespace parser
     private:
         ast::StmtPtr declaration();
         ast::StmtPtr varDeclaration();
+        ast::StmtPtr decoratedDeclaration();
         ast::StmtPtr functionDeclaration();
         ast::StmtPtr classDeclaration();
         ast::StmtPtr statement();
@@ -93,15 +101,30 @@ namespace parser
 
         bool match(lexer::TokenType type);
         bool check(lexer::TokenType type) const;
-        lexer::Token advance();
-        lexer::Token peek() const;
-        lexer::Token previous() const;
+        const lexer::Token &advance();
+        const lexer::Token &peek() const;
+        const lexer::Token &previous() const;
         bool isAtEnd() const;
-        lexer::Token consume(lexer::TokenType type, const std::string &message);
+        const lexer::Token &consume(lexer::TokenType type, const std::string &message);
         void error(const lexer::Token &token, const std::string &message);
 
+        lexer::Token nextToken();
+
+        // Nodes of this unit are allocated from its arena
+        template <typename T, typename... Args>
+        std::shared_ptr<T> make(Args &&...args)
+        {
+            return ast::makeNode<T>(arena_, std::forward<Args>(args)...);
+        }
+
+        // Tokens come from the lexer, or from the vector when there is none
+        lexer::Lexer *lexer_;
         std::vector<lexer::Token> tokens;
-        size_t current;
+        size_t next;
+        lexer::Token first;
+        lexer::Token currentToken;
+        lexer::Token previousToken;
+        std::shared_ptr<ast::Arena> arena_;
         error::ErrorHandler errorHandler;
         std::vector<ErrorContext> errors_;
         
@@ -1,5 +1,6 @@
 #include "concurrency.h"
 #include <memory>
+#include <numeric>
 
 namespace runtime {
 
@@ -19,4 +20,263 @@ Scheduler& getScheduler() {
     return *global_scheduler;
 }
 
+namespace detail {
+
+TimerQueue& TimerQueue::instance() {
+    // Leaked so timers can still be cancelled during static destruction
+    static TimerQueue* queue = new TimerQueue();
+    return *queue;
+}
+
+TimerQueue::TimerQueue() {
+    std::thread([this] { run(); }).detach();
+}
+
+uint64_t TimerQueue::schedule(Clock::time_point deadline, std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t id = nextId++;
+    bool earliest = deadlines.empty() || deadline < deadlines.begin()->first;
+    deadlines.emplace(deadline, id);
+    callbacks.emplace(id, std::move(callback));
+    if (earliest) {
+        cv.notify_one();
+    }
+    return id;
+}
+
+bool TimerQueue::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = callbacks.find(id);
+    if (it == callbacks.end()) {
+        return false;
+    }
+    callbacks.erase(it);
+    // The stale deadline entry is skipped when it comes due
+    return true;
+}
+
+void TimerQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (deadlines.empty()) {
+            cv.wait(lock);
+            continue;
+        }
+        auto next = *deadlines.begin();
+        if (Clock::now() < next.first) {
+            cv.wait_until(lock, next.first);
+            continue;
+        }
+        deadlines.erase(deadlines.begin());
+        auto it = callbacks.find(next.second);
+        if (it == callbacks.end()) {
+            continue; // Cancelled
+        }
+        auto callback = std::move(it->second);
+        callbacks.erase(it);
+        callback();
+    }
+}
+
+namespace {
+
+uint32_t nextRandom() {
+    // Per-thread xorshift; only used to shuffle select cases
+    thread_local uint32_t state = static_cast<uint32_t>(
+        std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void yieldCaller() {
+    if (tocin::runtime::Fiber::current()) {
+        tocin::runtime::Fiber::yieldCurrent();
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+int Select::execute() {
+    if (cases.empty() && !hasDefault && !hasTimeout) {
+        // Nothing can ever fire: block forever, as Go does. A fiber stays
+        // suspended and gives its worker back; a thread sleeps.
+        detail::WaitContext context;
+        for (;;) {
+            context.wait();
+        }
+    }
+
+    auto deadline = detail::TimerQueue::Clock::now() + timeout;
+    std::vector<int> order(cases.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    for (bool contended = false;; ) {
+        if (contended) {
+            // Two selects on opposite ends of a channel can keep backing
+            // off from each other; let the other side win a round
+            detail::yieldCaller();
+        }
+
+        for (size_t i = order.size(); i > 1; --i) {
+            std::swap(order[i - 1], order[detail::nextRandom() % i]);
+        }
+
+        for (int index : order) {
+            ChannelResult result = cases[index]->poll();
+            if (result != ChannelResult::WouldBlock) {
+                cases[index]->finish(result == ChannelResult::Ok);
+                return index;
+            }
+        }
+
+        if (hasDefault) {
+            if (defaultHandler) {
+                defaultHandler();
+            }
+            return kDefaultCase;
+        }
+        if (hasTimeout && detail::TimerQueue::Clock::now() >= deadline) {
+            if (timeoutHandler) {
+                timeoutHandler();
+            }
+            return kTimeoutCase;
+        }
+
+        detail::WaitContext context;
+        for (int index : order) {
+            cases[index]->enqueue(&context, index);
+        }
+        uint64_t timer = 0;
+        if (hasTimeout) {
+            timer = detail::TimerQueue::instance().schedule(deadline, [&context] {
+                if (context.claim(kTimeoutCase)) {
+                    context.notify();
+                }
+            });
+        }
+
+        // Re-check after registering: an operation that completed before
+        // our waiters were visible would not have woken us
+        bool ready = std::any_of(order.begin(), order.end(), [&](int index) {
+            return cases[index]->ready(&context);
+        });
+        auto release = [&] {
+            if (timer) {
+                detail::TimerQueue::instance().cancel(timer);
+            }
+            for (auto& selectCase : cases) {
+                selectCase->cancel();
+            }
+        };
+        try {
+            if (!ready || !context.claim(kRetryCase)) {
+                context.wait();
+            }
+        } catch (...) {
+            release(); // Cancelled: the timer and waiters point at this frame
+            throw;
+        }
+        release();
+
+        int selected = context.selectedCase();
+        if (selected == kTimeoutCase) {
+            if (timeoutHandler) {
+                timeoutHandler();
+            }
+            return kTimeoutCase;
+        }
+        if (selected >= 0 && cases[selected]->handedOff()) {
+            cases[selected]->finish(true);
+            return selected;
+        }
+        // Woken by a buffered channel, by close(), or by our own re-check:
+        // the operation itself still has to be performed
+        contended = selected == kRetryCase;
+    }
+}
+
 } // namespace runtime
+
+namespace {
+
+// Generated code has no unwind tables, so a goroutine that stop() cancels
+// inside a C ABI call ends right here instead of unwinding through it
+template<typename Op>
+auto blockingCall(Op op) -> decltype(op()) {
+    try {
+        return op();
+    } catch (const tocin::runtime::FiberCancelled&) {
+    }
+    // Outside the handler so no exception stays active on this thread
+    tocin::runtime::Fiber::exitCurrent();
+}
+
+} // namespace
+
+extern "C" {
+
+using RuntimeChannel = runtime::Channel<void*>;
+
+void* runtime_channel_create(int64_t capacity) {
+    return new RuntimeChannel(capacity > 0 ? static_cast<size_t>(capacity) : 0);
+}
+
+bool runtime_channel_send(void* channel, void* value) {
+    return channel && blockingCall([&] { return static_cast<RuntimeChannel*>(channel)->send(value); });
+}
+
+void* runtime_channel_receive(void* channel) {
+    if (!channel) {
+        return nullptr;
+    }
+    auto value = blockingCall([&] { return static_cast<RuntimeChannel*>(channel)->receive(); });
+    return value ? *value : nullptr;
+}
+
+void runtime_channel_close(void* channel) {
+    if (channel) {
+        static_cast<RuntimeChannel*>(channel)->close();
+    }
+}
+
+int32_t runtime_select(TocinSelectCase* cases, int32_t count, bool hasDefault, int64_t timeoutNanos) {
+    return blockingCall([&]() -> int32_t {
+        runtime::Select select;
+        // Cases on a null channel can never fire, as in Go
+        std::vector<int32_t> caseIndex;
+        for (int32_t i = 0; i < count; ++i) {
+            TocinSelectCase* selectCase = &cases[i];
+            auto* channel = static_cast<RuntimeChannel*>(selectCase->channel);
+            if (!channel) {
+                continue;
+            }
+            caseIndex.push_back(i);
+            if (selectCase->isSend) {
+                select.onSend<void*>(*channel, selectCase->value, [selectCase](bool ok) {
+                    selectCase->ok = ok;
+                });
+            } else {
+                select.onReceive<void*>(*channel, [selectCase](std::optional<void*> value) {
+                    selectCase->value = value ? *value : nullptr;
+                    selectCase->ok = value.has_value();
+                });
+            }
+        }
+        if (hasDefault) {
+            select.onDefault();
+        }
+        if (timeoutNanos >= 0) {
+            select.onTimeout(std::chrono::nanoseconds(timeoutNanos));
+        }
+        int selected = select.execute();
+        return selected >= 0 ? caseIndex[selected] : selected;
+    });
+}
+
+} // extern "C"
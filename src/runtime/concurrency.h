@@ -14,6 +14,12 @@
 #include <vector>
 #include <chrono>
 #include <optional>
+#include <deque>
+#include <algorithm>
+#include <type_traits>
+#include <set>
+
+#include "lightweight_scheduler.h"
 
 namespace runtime {
 
@@ -24,73 +30,378 @@ template<typename T> class Promise;
 class Scheduler;
 
 /**
- * @brief Thread-safe channel implementation for Tocin
+ * @brief Outcome of a non-blocking channel operation
+ */
+enum class ChannelResult {
+    Ok,          // Value sent/received
+    WouldBlock,  // Operation would have to wait
+    Closed       // Channel is closed (and drained, for receives)
+};
+
+namespace detail {
+
+/**
+ * @brief Parking spot for one blocked channel operation or select
+ *
+ * Captures the calling fiber when there is one, so waiting suspends the
+ * goroutine and hands its worker back to the scheduler; plain threads
+ * block on a condition variable instead. Several channels may hold the
+ * same context (select): the first one to claim() it owns the wakeup.
+ */
+class WaitContext {
+public:
+    // Claimed by wait() itself when the scheduler cancels the fiber
+    static constexpr int kCancelledCase = -4;
+
+    WaitContext() {
+        if (auto* fiber = tocin::runtime::Fiber::current()) {
+            fiber_ = fiber->shared_from_this();
+        }
+    }
+
+    WaitContext(const WaitContext&) = delete;
+    WaitContext& operator=(const WaitContext&) = delete;
+
+    bool claim(int caseIndex) {
+        int expected = -1;
+        return selected.compare_exchange_strong(expected, caseIndex, std::memory_order_acq_rel);
+    }
+
+    int selectedCase() const {
+        return selected.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Wake the waiter; only the party that claimed the context calls this
+     */
+    void notify() {
+        if (fiber_) {
+            // The context may be gone as soon as signaled is set
+            auto fiber = fiber_;
+            signaled.store(true, std::memory_order_seq_cst);
+            fiber->wake();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled.store(true, std::memory_order_release);
+        cv.notify_one();
+    }
+
+    /**
+     * @brief Block until notify() has been called
+     *
+     * Throws tocin::runtime::FiberCancelled if the scheduler stops while
+     * the fiber waits; callers remove their waiters and rethrow.
+     */
+    void wait() {
+        if (fiber_) {
+            while (!signaled.load(std::memory_order_seq_cst)) {
+                if (fiber_->isCancelled()) {
+                    if (claim(kCancelledCase)) {
+                        throw tocin::runtime::FiberCancelled();
+                    }
+                    // Whoever claimed us notifies without blocking in between
+                    while (!signaled.load(std::memory_order_seq_cst)) {
+                        std::this_thread::yield();
+                    }
+                    return;
+                }
+                fiber_->suspend(&signaled);
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return signaled.load(std::memory_order_acquire); });
+    }
+
+private:
+    std::shared_ptr<tocin::runtime::Fiber> fiber_;
+    std::atomic<int> selected{-1};
+    std::atomic<bool> signaled{false};
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+/**
+ * @brief Entry in a channel wait queue (one per blocked operation/select case)
+ */
+template<typename T>
+struct ChannelWaiter {
+    WaitContext* context;
+    int caseIndex;
+    T* slot;         // Unbuffered handoff: receiver's destination / sender's source
+    bool completed;  // Set by the peer once the handoff is done
+};
+
+/**
+ * @brief Bounded lock-free MPMC ring (Vyukov), holding at most `capacity` items
+ *
+ * Uncontended (e.g. single producer/single consumer) pushes and pops are a
+ * load, an uncontended CAS and a store. The cell array is rounded up to a
+ * power of two; the logical capacity is enforced on the positions.
+ */
+template<typename T>
+class BoundedRing {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    size_t capacity;
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+
+public:
+    explicit BoundedRing(size_t cap) : capacity(cap) {
+        size_t size = 2;
+        while (size < cap) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedRing() {
+        T item;
+        while (tryPop(item)) {
+        }
+    }
+
+    template<typename U>
+    bool tryPush(U&& item) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            if (pos - dequeuePos.load(std::memory_order_acquire) >= capacity) {
+                return false; // Full
+            }
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (&cell.storage) T(std::forward<U>(item));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T* value = reinterpret_cast<T*>(&cell.storage);
+                    out = std::move(*value);
+                    value->~T();
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t size() const {
+        size_t enq = enqueuePos.load(std::memory_order_acquire);
+        size_t deq = dequeuePos.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    bool full() const { return size() >= capacity; }
+    bool empty() const { return size() == 0; }
+};
+
+} // namespace detail
+
+/**
+ * @brief Goroutine-aware channel implementation for Tocin
+ *
+ * Buffered channels keep values in a lock-free ring; the channel mutex is
+ * only taken when someone has to wait. Unbuffered channels (capacity 0)
+ * hand each value directly from sender to receiver. Blocked operations
+ * suspend the calling fiber (see LightweightScheduler) instead of the
+ * worker thread; callers outside a fiber block their OS thread.
  */
 template<typename T>
 class Channel {
 private:
-    std::queue<T> buffer;
+    using Waiter = detail::ChannelWaiter<T>;
+
     size_t capacity;
-    mutable std::mutex mutex;
-    std::condition_variable not_full;
-    std::condition_variable not_empty;
+    std::unique_ptr<detail::BoundedRing<T>> buffer;  // Null when unbuffered
+    mutable std::mutex mutex;                        // Guards the wait queues
+    std::deque<Waiter*> receivers;
+    std::deque<Waiter*> senders;
+    std::atomic<size_t> receiversWaiting{0};
+    std::atomic<size_t> sendersWaiting{0};
     std::atomic<bool> closed{false};
 
 public:
-    explicit Channel(size_t cap = 0) : capacity(cap) {}
+    explicit Channel(size_t cap = 0)
+        : capacity(cap),
+          buffer(cap > 0 ? std::make_unique<detail::BoundedRing<T>>(cap) : nullptr) {}
 
     using value_type = T;
 
     /**
-     * @brief Send a value to the channel
+     * @brief Send a value to the channel, waiting for room or a receiver
+     * @return false if the channel is closed
      */
     bool send(const T& value) {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        if (closed.load()) {
-            return false;
+        if (!buffer) {
+            return sendUnbuffered(value);
         }
-
-        // Wait if buffer is full (for bounded channels)
-        if (capacity > 0) {
-            not_full.wait(lock, [this] { return buffer.size() < capacity || closed.load(); });
+        for (;;) {
+            ChannelResult result = trySend(value);
+            if (result != ChannelResult::WouldBlock) {
+                return result == ChannelResult::Ok;
+            }
+            detail::WaitContext context;
+            Waiter waiter{&context, 0, nullptr, false};
+            enqueue(senders, sendersWaiting, &waiter);
+            // Re-check after announcing ourselves so a concurrent receive
+            // either sees the waiter or we see the room it made
+            result = trySend(value);
+            if (result != ChannelResult::WouldBlock) {
+                cancel(senders, sendersWaiting, &waiter);
+                return result == ChannelResult::Ok;
+            }
+            waitOrCancel(context, senders, sendersWaiting, &waiter);
         }
+    }
 
-        if (closed.load()) {
-            return false;
+    /**
+     * @brief Receive a value from the channel, waiting for one to arrive
+     * @return std::nullopt once the channel is closed and drained
+     */
+    std::optional<T> receive() {
+        T value{};
+        if (!buffer) {
+            return receiveUnbuffered(value) ? std::optional<T>(std::move(value)) : std::nullopt;
+        }
+        for (;;) {
+            ChannelResult result = tryReceive(value);
+            if (result != ChannelResult::WouldBlock) {
+                return result == ChannelResult::Ok ? std::optional<T>(std::move(value)) : std::nullopt;
+            }
+            detail::WaitContext context;
+            Waiter waiter{&context, 0, nullptr, false};
+            enqueue(receivers, receiversWaiting, &waiter);
+            result = tryReceive(value);
+            if (result != ChannelResult::WouldBlock) {
+                cancel(receivers, receiversWaiting, &waiter);
+                return result == ChannelResult::Ok ? std::optional<T>(std::move(value)) : std::nullopt;
+            }
+            waitOrCancel(context, receivers, receiversWaiting, &waiter);
         }
-
-        buffer.push(value);
-        not_empty.notify_one();
-        return true;
     }
 
     /**
-     * @brief Receive a value from the channel
+     * @brief Send without waiting
      */
-    std::optional<T> receive() {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        not_empty.wait(lock, [this] { return !buffer.empty() || closed.load(); });
-        
-        if (buffer.empty() && closed.load()) {
-            return std::nullopt;
+    ChannelResult trySend(const T& value) {
+        if (closed.load(std::memory_order_acquire)) {
+            return ChannelResult::Closed;
+        }
+        if (!buffer) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closed.load(std::memory_order_relaxed)) {
+                return ChannelResult::Closed;
+            }
+            Waiter* receiver = claimFirst(receivers, receiversWaiting);
+            if (!receiver) {
+                return ChannelResult::WouldBlock;
+            }
+            *receiver->slot = value;
+            receiver->completed = true;
+            lock.unlock();
+            receiver->context->notify();
+            return ChannelResult::Ok;
         }
+        if (!buffer->tryPush(value)) {
+            return ChannelResult::WouldBlock;
+        }
+        wakeOne(receivers, receiversWaiting);
+        if (!buffer->full()) {
+            // We may have absorbed a wakeup meant for another sender
+            wakeOne(senders, sendersWaiting);
+        }
+        return ChannelResult::Ok;
+    }
 
-        T value = buffer.front();
-        buffer.pop();
-        not_full.notify_one();
-        return value;
+    /**
+     * @brief Receive without waiting
+     */
+    ChannelResult tryReceive(T& out) {
+        if (!buffer) {
+            std::unique_lock<std::mutex> lock(mutex);
+            Waiter* sender = claimFirst(senders, sendersWaiting);
+            if (!sender) {
+                return closed.load(std::memory_order_relaxed) ? ChannelResult::Closed
+                                                              : ChannelResult::WouldBlock;
+            }
+            out = std::move(*sender->slot);
+            sender->completed = true;
+            lock.unlock();
+            sender->context->notify();
+            return ChannelResult::Ok;
+        }
+        if (!buffer->tryPop(out)) {
+            if (!closed.load(std::memory_order_acquire)) {
+                return ChannelResult::WouldBlock;
+            }
+            // Values sent before close() are still delivered
+            return buffer->tryPop(out) ? ChannelResult::Ok : ChannelResult::Closed;
+        }
+        wakeOne(senders, sendersWaiting);
+        if (!buffer->empty()) {
+            wakeOne(receivers, receiversWaiting);
+        }
+        return ChannelResult::Ok;
     }
 
     /**
-     * @brief Close the channel
+     * @brief Close the channel, waking every blocked sender and receiver
      */
     void close() {
-        std::unique_lock<std::mutex> lock(mutex);
-        closed.store(true);
-        not_empty.notify_all();
-        not_full.notify_all();
+        std::vector<Waiter*> woken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed.exchange(true)) {
+                return;
+            }
+            for (auto* queue : {&receivers, &senders}) {
+                for (Waiter* waiter : *queue) {
+                    if (waiter->context->claim(waiter->caseIndex)) {
+                        woken.push_back(waiter);
+                    }
+                }
+                queue->clear();
+            }
+            receiversWaiting.store(0);
+            sendersWaiting.store(0);
+        }
+        for (Waiter* waiter : woken) {
+            waiter->context->notify();
+        }
     }
 
     /**
@@ -104,8 +415,164 @@ public:
      * @brief Get current buffer size
      */
     size_t size() const {
+        return buffer ? buffer->size() : 0;
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    // Wait-queue access for Select; a registered waiter must be cancelled
+    // (or claimed by the channel) before its context goes away.
+    void enqueueReceiver(Waiter* waiter) { enqueue(receivers, receiversWaiting, waiter); }
+    void enqueueSender(Waiter* waiter) { enqueue(senders, sendersWaiting, waiter); }
+    bool cancelReceiver(Waiter* waiter) { return cancel(receivers, receiversWaiting, waiter); }
+    bool cancelSender(Waiter* waiter) { return cancel(senders, sendersWaiting, waiter); }
+    bool isUnbuffered() const { return !buffer; }
+
+    /**
+     * @brief True if a receive would not block right now
+     *
+     * Waiters belonging to `self` are ignored, so a select with both a
+     * send and a receive case on one unbuffered channel does not match
+     * itself.
+     */
+    bool readyToReceive(const detail::WaitContext* self = nullptr) const {
+        if (closed.load(std::memory_order_acquire)) {
+            return true;
+        }
+        return buffer ? !buffer->empty() : hasPeer(senders, self);
+    }
+
+    /**
+     * @brief True if a send would not block right now (closed counts as ready)
+     */
+    bool readyToSend(const detail::WaitContext* self = nullptr) const {
+        if (closed.load(std::memory_order_acquire)) {
+            return true;
+        }
+        return buffer ? !buffer->full() : hasPeer(receivers, self);
+    }
+
+private:
+    bool sendUnbuffered(const T& value) {
+        detail::WaitContext context;
+        T copy = value;
+        Waiter waiter{&context, 0, &copy, false};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closed.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (Waiter* receiver = claimFirst(receivers, receiversWaiting)) {
+                *receiver->slot = std::move(copy);
+                receiver->completed = true;
+                lock.unlock();
+                receiver->context->notify();
+                return true;
+            }
+            senders.push_back(&waiter);
+            sendersWaiting.fetch_add(1, std::memory_order_seq_cst);
+        }
+        waitOrCancel(context, senders, sendersWaiting, &waiter);
+        return waiter.completed;
+    }
+
+    bool receiveUnbuffered(T& out) {
+        detail::WaitContext context;
+        Waiter waiter{&context, 0, &out, false};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (Waiter* sender = claimFirst(senders, sendersWaiting)) {
+                out = std::move(*sender->slot);
+                sender->completed = true;
+                lock.unlock();
+                sender->context->notify();
+                return true;
+            }
+            if (closed.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            receivers.push_back(&waiter);
+            receiversWaiting.fetch_add(1, std::memory_order_seq_cst);
+        }
+        waitOrCancel(context, receivers, receiversWaiting, &waiter);
+        return waiter.completed;
+    }
+
+    bool hasPeer(const std::deque<Waiter*>& queue, const detail::WaitContext* self) const {
         std::lock_guard<std::mutex> lock(mutex);
-        return buffer.size();
+        return std::any_of(queue.begin(), queue.end(), [self](Waiter* waiter) {
+            return waiter->context != self && waiter->context->selectedCase() == -1;
+        });
+    }
+
+    // Pops waiters until one whose context we manage to claim; callers
+    // hold the mutex and notify the returned waiter after unlocking
+    Waiter* claimFirst(std::deque<Waiter*>& queue, std::atomic<size_t>& waiting) {
+        while (!queue.empty()) {
+            Waiter* waiter = queue.front();
+            queue.pop_front();
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+            if (waiter->context->claim(waiter->caseIndex)) {
+                return waiter;
+            }
+        }
+        return nullptr;
+    }
+
+    void enqueue(std::deque<Waiter*>& queue, std::atomic<size_t>& waiting, Waiter* waiter) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(waiter);
+            waiting.fetch_add(1, std::memory_order_seq_cst);
+        }
+        // Pairs with the fence in wakeOne()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // Returns true if the waiter was still queued. Otherwise someone
+    // claimed it, and the caller must wait() for the pending notify.
+    bool cancel(std::deque<Waiter*>& queue, std::atomic<size_t>& waiting, Waiter* waiter) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = std::find(queue.begin(), queue.end(), waiter);
+            if (it != queue.end()) {
+                queue.erase(it);
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        if (waiter->context->selectedCase() == waiter->caseIndex) {
+            waiter->context->wait();
+        }
+        return false;
+    }
+
+    // The waiter lives on the stack that a cancelled wait unwinds
+    void waitOrCancel(detail::WaitContext& context, std::deque<Waiter*>& queue,
+                      std::atomic<size_t>& waiting, Waiter* waiter) {
+        try {
+            context.wait();
+        } catch (...) {
+            cancel(queue, waiting, waiter);
+            throw;
+        }
+    }
+
+    void wakeOne(std::deque<Waiter*>& queue, std::atomic<size_t>& waiting) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        Waiter* waiter;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            waiter = claimFirst(queue, waiting);
+        }
+        if (waiter) {
+            waiter->context->notify();
+        }
     }
 };
 
@@ -443,47 +910,219 @@ public:
     }
 };
 
+namespace detail {
+
 /**
- * @brief Select statement implementation
+ * @brief Type-erased case of a Select (see ReceiveCase/SendCase below)
  */
-template<typename... Channels>
-class Select {
+class SelectCase {
+public:
+    virtual ~SelectCase() = default;
+
+    // Attempt the operation without waiting; Ok and Closed complete the case
+    virtual ChannelResult poll() = 0;
+    // True if poll() would not block right now; ignores waiters of `self`
+    virtual bool ready(const WaitContext* self) const = 0;
+    virtual void enqueue(WaitContext* context, int caseIndex) = 0;
+    virtual void cancel() = 0;
+    // True once an unbuffered peer has completed the handoff through our slot
+    virtual bool handedOff() const = 0;
+    virtual void finish(bool ok) = 0;
+};
+
+template<typename T>
+class ReceiveCase : public SelectCase {
+public:
+    ReceiveCase(Channel<T>& channel, std::function<void(std::optional<T>)> handler)
+        : channel(channel), handler(std::move(handler)) {}
+
+    ChannelResult poll() override { return channel.tryReceive(slot); }
+    bool ready(const WaitContext* self) const override { return channel.readyToReceive(self); }
+
+    void enqueue(WaitContext* context, int caseIndex) override {
+        waiter = ChannelWaiter<T>{context, caseIndex, &slot, false};
+        channel.enqueueReceiver(&waiter);
+        queued = true;
+    }
+
+    void cancel() override {
+        if (queued) {
+            channel.cancelReceiver(&waiter);
+            queued = false;
+        }
+    }
+
+    bool handedOff() const override { return waiter.completed; }
+
+    void finish(bool ok) override {
+        if (handler) {
+            handler(ok ? std::optional<T>(std::move(slot)) : std::nullopt);
+        }
+    }
+
 private:
-    std::tuple<Channels&...> channels;
-    std::function<void(size_t, typename std::tuple_element_t<0, std::tuple<Channels...>>::value_type)> onReceive;
-    std::function<void(size_t)> onSend;
+    Channel<T>& channel;
+    std::function<void(std::optional<T>)> handler;
+    T slot{};
+    ChannelWaiter<T> waiter{nullptr, 0, nullptr, false};
+    bool queued = false;
+};
 
+template<typename T>
+class SendCase : public SelectCase {
 public:
-    Select(std::tuple<Channels&...> chs, 
-           std::function<void(size_t, typename std::tuple_element_t<0, std::tuple<Channels...>>::value_type)> recv = nullptr,
-           std::function<void(size_t)> send = nullptr)
-        : channels(chs), onReceive(recv), onSend(send) {}
+    SendCase(Channel<T>& channel, T value, std::function<void(bool)> handler)
+        : channel(channel), value(std::move(value)), handler(std::move(handler)) {}
+
+    ChannelResult poll() override { return channel.trySend(value); }
+    bool ready(const WaitContext* self) const override { return channel.readyToSend(self); }
+
+    void enqueue(WaitContext* context, int caseIndex) override {
+        waiter = ChannelWaiter<T>{context, caseIndex, &value, false};
+        channel.enqueueSender(&waiter);
+        queued = true;
+    }
+
+    void cancel() override {
+        if (queued) {
+            channel.cancelSender(&waiter);
+            queued = false;
+        }
+    }
+
+    bool handedOff() const override { return waiter.completed; }
+
+    void finish(bool ok) override {
+        if (handler) {
+            handler(ok);
+        }
+    }
+
+private:
+    Channel<T>& channel;
+    T value;
+    std::function<void(bool)> handler;
+    ChannelWaiter<T> waiter{nullptr, 0, nullptr, false};
+    bool queued = false;
+};
+
+/**
+ * @brief Process-wide deadline queue used for select timeouts
+ *
+ * A single background thread fires callbacks at their deadline. Callbacks
+ * run with the queue locked, so once cancel() returns the callback has
+ * either finished or will never run; they must be short and must not
+ * call back into the queue.
+ */
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static TimerQueue& instance();
+
+    uint64_t schedule(Clock::time_point deadline, std::function<void()> callback);
 
     /**
-     * @brief Execute the select statement
+     * @brief Remove a pending timer
+     * @return false if it already fired
      */
-    int execute() {
-        // Simple implementation - in a real system you'd use proper event handling
-        size_t index = 0;
-        std::apply([this, &index](auto&... ch) {
-            // Try to receive from each channel
-            (tryReceive(ch, index++) || ...);
-        }, channels);
-        return -1; // No channel ready
-    }
+    bool cancel(uint64_t id);
 
 private:
-    template<typename Channel>
-    bool tryReceive(Channel& ch, size_t idx) {
-        auto value = ch.receive();
-        if (value.has_value()) {
-            if (onReceive) {
-                onReceive(idx, *value);
-            }
-            return true;
-        }
-        return false;
+    TimerQueue();
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::set<std::pair<Clock::time_point, uint64_t>> deadlines;
+    std::unordered_map<uint64_t, std::function<void()>> callbacks;
+    uint64_t nextId = 1;
+};
+
+} // namespace detail
+
+/**
+ * @brief Go-style select over any mix of channel sends and receives
+ *
+ * Ready cases are polled in a fresh random order on every attempt, so no
+ * case can starve another. If none is ready, execute() runs the default
+ * branch when there is one; otherwise it registers on the wait queue of
+ * every involved channel and suspends the calling fiber (or thread) until
+ * the first of them, or the timeout, fires.
+ *
+ * @code
+ *   Select select;
+ *   select.onReceive(results, [](std::optional<int> v) { ... })
+ *         .onSend(requests, job)
+ *         .onTimeout(std::chrono::milliseconds(50));
+ *   int chosen = select.execute();
+ * @endcode
+ */
+class Select {
+public:
+    static constexpr int kDefaultCase = -1;
+    static constexpr int kTimeoutCase = -2;
+
+    Select() = default;
+    Select(const Select&) = delete;
+    Select& operator=(const Select&) = delete;
+
+    /**
+     * @brief Add a receive case; the handler gets std::nullopt if the channel is closed
+     */
+    template<typename T>
+    Select& onReceive(Channel<T>& channel, std::function<void(std::optional<T>)> handler = nullptr) {
+        cases.push_back(std::make_unique<detail::ReceiveCase<T>>(channel, std::move(handler)));
+        return *this;
+    }
+
+    /**
+     * @brief Add a send case; the handler gets false if the channel is closed
+     */
+    template<typename T>
+    Select& onSend(Channel<T>& channel, T value, std::function<void(bool)> handler = nullptr) {
+        cases.push_back(std::make_unique<detail::SendCase<T>>(channel, std::move(value), std::move(handler)));
+        return *this;
+    }
+
+    /**
+     * @brief Run this instead of waiting when no case is ready
+     */
+    Select& onDefault(std::function<void()> handler = nullptr) {
+        hasDefault = true;
+        defaultHandler = std::move(handler);
+        return *this;
+    }
+
+    /**
+     * @brief Give up waiting after `timeout`
+     */
+    template<typename Rep, typename Period>
+    Select& onTimeout(const std::chrono::duration<Rep, Period>& timeout, std::function<void()> handler = nullptr) {
+        hasTimeout = true;
+        this->timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+        timeoutHandler = std::move(handler);
+        return *this;
     }
+
+    /**
+     * @brief Wait for one case to complete and run its handler
+     *
+     * With no cases, no default and no timeout it never returns.
+     * @return Index of the case in the order it was added, kDefaultCase or kTimeoutCase
+     */
+    int execute();
+
+private:
+    // Claimed by execute() itself when its re-check finds a ready case
+    static constexpr int kRetryCase = -3;
+
+    std::vector<std::unique_ptr<detail::SelectCase>> cases;
+    bool hasDefault = false;
+    std::function<void()> defaultHandler;
+    bool hasTimeout = false;
+    std::chrono::nanoseconds timeout{0};
+    std::function<void()> timeoutHandler;
 };
 
 // Global scheduler instance
@@ -525,4 +1164,36 @@ T await(Future<T>& future) {
 
 } // namespace runtime
 
+// C ABI used by generated code; channels carry pointer-sized words
+extern "C" {
+
+/**
+ * @brief One case of a compiled select statement
+ *
+ * Receive cases get the received word in `value`; `ok` is cleared when the
+ * operation completed because the channel was closed.
+ */
+struct TocinSelectCase {
+    void* channel;
+    void* value;
+    int32_t isSend;
+    int32_t ok;
+};
+
+void* runtime_channel_create(int64_t capacity);
+bool runtime_channel_send(void* channel, void* value);
+void* runtime_channel_receive(void* channel);
+void runtime_channel_close(void* channel);
+
+/**
+ * @brief Run a select over `count` cases
+ * @param timeoutNanos Negative for no timeout
+ * @return Index of the completed case, -1 for the default branch, -2 on timeout.
+ *         Never returns when every case channel is null and there is
+ *         neither a default nor a timeout.
+ */
+int32_t runtime_select(TocinSelectCase* cases, int32_t count, bool hasDefault, int64_t timeoutNanos);
+
+} // extern "C"
+
 #endif // TOCIN_CONCURRENCY_H
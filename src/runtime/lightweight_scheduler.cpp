@@ -1,7 +1,10 @@
 #include "lightweight_scheduler.h"
+#include "concurrency.h"
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <iostream>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -9,12 +12,148 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
-#include <ucontext.h>
 #include <pthread.h>
 #include <sched.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// Pick the context switch backend. The hand-written switch only saves the
+// callee-saved registers, which is all a cooperative switch needs and is an
+// order of magnitude cheaper than swapcontext (no signal mask syscall).
+#if defined(_WIN32)
+#define TOCIN_FIBER_WINDOWS 1
+#elif (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__) && \
+      !defined(TOCIN_FIBER_USE_UCONTEXT)
+#define TOCIN_FIBER_ASM 1
+#else
+#define TOCIN_FIBER_UCONTEXT 1
+#include <ucontext.h>
+#endif
+
+#if defined(__APPLE__)
+#define TOCIN_ASM_SYMBOL(name) "_" #name
+#define TOCIN_ASM_TYPE(name)
+#define TOCIN_ASM_SIZE(name)
+#else
+#define TOCIN_ASM_SYMBOL(name) #name
+#define TOCIN_ASM_TYPE(name) ".type " #name ", @function\n"
+#define TOCIN_ASM_SIZE(name) ".size " #name ", .-" #name "\n"
 #endif
 
+#ifdef TOCIN_FIBER_ASM
+extern "C" {
+// Saves the callee-saved registers on the current stack, stores the stack
+// pointer in *from and continues on the stack saved in to.
+void tocin_fiber_switch(void** from, void* to);
+// First frame of every fiber: calls entry(arg), which never returns.
+void tocin_fiber_trampoline();
+}
+
+#if defined(__x86_64__)
+// Frame layout, from the saved stack pointer upwards:
+//   [mxcsr | x87 cw] r15 r14 r13 r12 rbx rbp <return address>
+asm(".text\n"
+    ".globl " TOCIN_ASM_SYMBOL(tocin_fiber_switch) "\n"
+    TOCIN_ASM_TYPE(tocin_fiber_switch)
+    ".p2align 4\n"
+    TOCIN_ASM_SYMBOL(tocin_fiber_switch) ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    TOCIN_ASM_SIZE(tocin_fiber_switch)
+    ".globl " TOCIN_ASM_SYMBOL(tocin_fiber_trampoline) "\n"
+    TOCIN_ASM_TYPE(tocin_fiber_trampoline)
+    ".p2align 4\n"
+    TOCIN_ASM_SYMBOL(tocin_fiber_trampoline) ":\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    TOCIN_ASM_SIZE(tocin_fiber_trampoline));
+
+namespace {
+constexpr size_t kSwitchFrameWords = 8;
+constexpr size_t kArgSlot = 4;    // r12
+constexpr size_t kEntrySlot = 3;  // r13
+constexpr size_t kReturnSlot = 7;
+}
+#elif defined(__aarch64__)
+// Frame layout, from the saved stack pointer upwards:
+//   x19..x28 x29 x30 d8..d15
+asm(".text\n"
+    ".globl " TOCIN_ASM_SYMBOL(tocin_fiber_switch) "\n"
+    TOCIN_ASM_TYPE(tocin_fiber_switch)
+    ".p2align 4\n"
+    TOCIN_ASM_SYMBOL(tocin_fiber_switch) ":\n"
+    "    sub sp, sp, #0xa0\n"
+    "    stp x19, x20, [sp, #0x00]\n"
+    "    stp x21, x22, [sp, #0x10]\n"
+    "    stp x23, x24, [sp, #0x20]\n"
+    "    stp x25, x26, [sp, #0x30]\n"
+    "    stp x27, x28, [sp, #0x40]\n"
+    "    stp x29, x30, [sp, #0x50]\n"
+    "    stp d8, d9, [sp, #0x60]\n"
+    "    stp d10, d11, [sp, #0x70]\n"
+    "    stp d12, d13, [sp, #0x80]\n"
+    "    stp d14, d15, [sp, #0x90]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0x00]\n"
+    "    ldp x21, x22, [sp, #0x10]\n"
+    "    ldp x23, x24, [sp, #0x20]\n"
+    "    ldp x25, x26, [sp, #0x30]\n"
+    "    ldp x27, x28, [sp, #0x40]\n"
+    "    ldp x29, x30, [sp, #0x50]\n"
+    "    ldp d8, d9, [sp, #0x60]\n"
+    "    ldp d10, d11, [sp, #0x70]\n"
+    "    ldp d12, d13, [sp, #0x80]\n"
+    "    ldp d14, d15, [sp, #0x90]\n"
+    "    add sp, sp, #0xa0\n"
+    "    ret\n"
+    TOCIN_ASM_SIZE(tocin_fiber_switch)
+    ".globl " TOCIN_ASM_SYMBOL(tocin_fiber_trampoline) "\n"
+    TOCIN_ASM_TYPE(tocin_fiber_trampoline)
+    ".p2align 4\n"
+    TOCIN_ASM_SYMBOL(tocin_fiber_trampoline) ":\n"
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+    TOCIN_ASM_SIZE(tocin_fiber_trampoline));
+
+namespace {
+constexpr size_t kSwitchFrameWords = 20;
+constexpr size_t kArgSlot = 0;    // x19
+constexpr size_t kEntrySlot = 1;  // x20
+constexpr size_t kReturnSlot = 11; // x30
+}
+#endif
+#endif // TOCIN_FIBER_ASM
+
 namespace tocin {
 namespace runtime {
 
@@ -25,106 +164,504 @@ void fiberWrapper(Fiber* fiber);
 VOID CALLBACK fiberWrapperWindows(PVOID param);
 #endif
 
+namespace {
+thread_local Fiber* currentFiber = nullptr;
+thread_local Worker* currentWorker = nullptr;
+
+#ifdef TOCIN_FIBER_UCONTEXT
+// makecontext only passes int arguments, so the Fiber pointer is split in two
+void fiberWrapperUcontext(unsigned int hi, unsigned int lo) {
+    uintptr_t ptr = (static_cast<uintptr_t>(hi) << 32) | static_cast<uintptr_t>(lo);
+    fiberWrapper(reinterpret_cast<Fiber*>(ptr));
+}
+#endif
+}
+
+// ============================================================================
+// Fiber Implementation
+// ============================================================================
+
+// ============================================================================
+// FiberStackPool Implementation
+// ============================================================================
+
+namespace {
+
+constexpr size_t kNumSizeClasses = 10; // 16KB .. 8MB
+
+size_t sizeClassIndex(size_t size) {
+    size_t index = 0;
+    size_t classSize = FiberStackPool::kMinStackSize;
+    while (classSize < size && index + 1 < kNumSizeClasses) {
+        classSize <<= 1;
+        ++index;
+    }
+    return index;
+}
+
+// Keep roughly this many bytes of idle stacks per class before unmapping
+constexpr size_t kLocalCacheBytes = 1024 * 1024;
+constexpr size_t kSharedCacheBytes = 16 * 1024 * 1024;
+
+size_t cacheLimit(size_t stackSize, size_t budget) {
+    return std::max<size_t>(4, budget / stackSize);
+}
+
+size_t pageSize() {
+#ifdef _WIN32
+    return 4096;
+#else
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#endif
+}
+
+std::atomic<size_t> mappedStacks{0};
+
+FiberStackPool::Stack mapStack(size_t size) {
+    FiberStackPool::Stack stack;
+#ifndef _WIN32
+    size_t guard = pageSize();
+    void* mapping = mmap(nullptr, size + guard, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS
+#ifdef MAP_STACK
+                         | MAP_STACK
+#endif
+                         , -1, 0);
+    if (mapping == MAP_FAILED) {
+        return stack;
+    }
+    // Stacks grow down, so the guard page sits at the lowest address
+    if (mprotect(mapping, guard, PROT_NONE) != 0) {
+        munmap(mapping, size + guard);
+        return stack;
+    }
+    stack.base = static_cast<char*>(mapping) + guard;
+    stack.size = size;
+#else
+    stack.base = malloc(size);
+    if (!stack.base) {
+        return stack;
+    }
+    stack.size = size;
+#endif
+    mappedStacks.fetch_add(1, std::memory_order_relaxed);
+    return stack;
+}
+
+void unmapStack(FiberStackPool::Stack stack) {
+#ifndef _WIN32
+    size_t guard = pageSize();
+    munmap(static_cast<char*>(stack.base) - guard, stack.size + guard);
+#else
+    free(stack.base);
+#endif
+    mappedStacks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Second level shared by all threads
+struct SharedStackPool {
+    std::mutex mutex;
+    std::vector<FiberStackPool::Stack> classes[kNumSizeClasses];
+
+    ~SharedStackPool() {
+        for (auto& stacks : classes) {
+            for (auto& stack : stacks) {
+                unmapStack(stack);
+            }
+        }
+    }
+};
+
+SharedStackPool& sharedStackPool() {
+    static SharedStackPool* pool = new SharedStackPool(); // Outlives thread caches
+    return *pool;
+}
+
+// First level, owned by the calling thread (in practice: a worker)
+struct LocalStackCache {
+    std::vector<FiberStackPool::Stack> classes[kNumSizeClasses];
+
+    ~LocalStackCache() {
+        SharedStackPool& shared = sharedStackPool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (size_t i = 0; i < kNumSizeClasses; ++i) {
+            for (auto& stack : classes[i]) {
+                shared.classes[i].push_back(stack);
+            }
+        }
+    }
+};
+
+LocalStackCache& localStackCache() {
+    thread_local LocalStackCache cache;
+    return cache;
+}
+
+} // namespace
+
+size_t FiberStackPool::sizeClassFor(size_t requested) {
+    return kMinStackSize << sizeClassIndex(requested);
+}
+
+FiberStackPool::Stack FiberStackPool::acquire(size_t size) {
+    size_t index = sizeClassIndex(size);
+    auto& local = localStackCache().classes[index];
+    if (!local.empty()) {
+        Stack stack = local.back();
+        local.pop_back();
+        return stack;
+    }
+
+    {
+        SharedStackPool& shared = sharedStackPool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        auto& stacks = shared.classes[index];
+        if (!stacks.empty()) {
+            // Refill half the local cache in one go
+            size_t take = std::min(stacks.size(), cacheLimit(kMinStackSize << index, kLocalCacheBytes) / 2 + 1);
+            local.insert(local.end(), stacks.end() - take, stacks.end());
+            stacks.resize(stacks.size() - take);
+            Stack stack = local.back();
+            local.pop_back();
+            return stack;
+        }
+    }
+
+    return mapStack(kMinStackSize << index);
+}
+
+void FiberStackPool::release(Stack stack) {
+    if (!stack) {
+        return;
+    }
+    size_t index = sizeClassIndex(stack.size);
+    auto& local = localStackCache().classes[index];
+    if (local.size() < cacheLimit(stack.size, kLocalCacheBytes)) {
+        local.push_back(stack);
+        return;
+    }
+
+    {
+        SharedStackPool& shared = sharedStackPool();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (shared.classes[index].size() < cacheLimit(stack.size, kSharedCacheBytes)) {
+            shared.classes[index].push_back(stack);
+            return;
+        }
+    }
+
+    unmapStack(stack);
+}
+
+FiberStackPool::PoolStats FiberStackPool::getStats() {
+    PoolStats stats;
+    stats.mappedStacks = mappedStacks.load(std::memory_order_relaxed);
+    stats.cachedStacks = 0;
+    SharedStackPool& shared = sharedStackPool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (auto& stacks : shared.classes) {
+        stats.cachedStacks += stacks.size();
+    }
+    return stats;
+}
+
 // ============================================================================
 // Fiber Implementation
 // ============================================================================
 
-uint64_t Fiber::nextId_ = 1;
+std::atomic<uint64_t> Fiber::nextId_{1};
 
 Fiber::Fiber(FiberFunc func, size_t stackSize, Priority priority)
-    : id_(nextId_++)
+    : id_(nextId_.fetch_add(1, std::memory_order_relaxed))
     , func_(std::move(func))
     , state_(State::Ready)
+    , park_(ParkState::None)
+    , cancelled_(false)
+    , parkSlot_(0)
     , priority_(priority)
-    , stack_(nullptr)
-    , stackSize_(stackSize)
-    , context_(nullptr) {
-    
-    // Allocate stack
-    stack_ = malloc(stackSize_);
+    , scheduler_(nullptr)
+    , stackSize_(FiberStackPool::sizeClassFor(stackSize))
+    , context_(nullptr)
+    , callerContext_(nullptr) {
+    // The stack and initial context are set up lazily by the first resume(),
+    // on the worker that runs the fiber, so spawning stays allocation-light.
+}
+
+Fiber::~Fiber() {
+    releaseStack();
+}
+
+bool Fiber::prepareContext() {
+#if defined(TOCIN_FIBER_WINDOWS)
+    // Windows allocates and owns the fiber stack (with its own guard page)
+    context_ = CreateFiberEx(0, stackSize_, 0, fiberWrapperWindows, this);
+    if (!context_) {
+        return false;
+    }
+#else
+    stack_ = FiberStackPool::acquire(stackSize_);
     if (!stack_) {
-        throw std::bad_alloc();
+        return false;
     }
-    
-#ifndef _WIN32
-    // Initialize context (POSIX)
-    context_ = malloc(sizeof(ucontext_t));
-    ucontext_t* ctx = static_cast<ucontext_t*>(context_);
-    
-    // Get current context
+    uintptr_t top = reinterpret_cast<uintptr_t>(stack_.base) + stack_.size;
+
+#if defined(TOCIN_FIBER_ASM)
+    // Build an initial switch frame at the top of the stack so that the
+    // first switch "returns" into the trampoline with the callee-saved
+    // registers carrying the entry point and its argument.
+    top &= ~static_cast<uintptr_t>(15);
+    top -= 16;
+    void** frame = reinterpret_cast<void**>(top) - kSwitchFrameWords;
+    std::memset(frame, 0, kSwitchFrameWords * sizeof(void*));
+#if defined(__x86_64__)
+    // Default MXCSR and x87 control word
+    uint32_t fpState[2] = {0x1F80, 0x037F};
+    std::memcpy(frame, fpState, sizeof(fpState));
+#endif
+    frame[kArgSlot] = this;
+    frame[kEntrySlot] = reinterpret_cast<void*>(&fiberWrapper);
+    frame[kReturnSlot] = reinterpret_cast<void*>(&tocin_fiber_trampoline);
+    context_ = frame;
+#else
+    // Both contexts live at the top of the stack mapping itself
+    top -= 2 * sizeof(ucontext_t);
+    top &= ~static_cast<uintptr_t>(63);
+    ucontext_t* ctx = reinterpret_cast<ucontext_t*>(top);
+    ucontext_t* caller = ctx + 1;
     if (getcontext(ctx) == -1) {
-        free(stack_);
-        free(context_);
-        throw std::runtime_error("Failed to get context");
+        releaseStack();
+        return false;
     }
     
     // Set up stack
-    ctx->uc_stack.ss_sp = stack_;
-    ctx->uc_stack.ss_size = stackSize_;
+    ctx->uc_stack.ss_sp = stack_.base;
+    ctx->uc_stack.ss_size = top - reinterpret_cast<uintptr_t>(stack_.base);
     ctx->uc_stack.ss_flags = 0;
-    ctx->uc_link = nullptr;  // When fiber completes, return to main
+    ctx->uc_link = nullptr;  // fiberWrapper switches back explicitly
     
-    // Create context with our fiber function
-    // We need a wrapper function that takes no arguments
-    makecontext(ctx, reinterpret_cast<void(*)()>(fiberWrapper), 1, this);
-#else
-    // Windows fiber implementation
-    context_ = CreateFiber(stackSize_, fiberWrapperWindows, this);
-    if (!context_) {
-        free(stack_);
-        throw std::runtime_error("Failed to create Windows fiber");
-    }
+    uintptr_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(ctx, reinterpret_cast<void(*)()>(fiberWrapperUcontext), 2,
+                static_cast<unsigned int>(self >> 32),
+                static_cast<unsigned int>(self & 0xFFFFFFFFu));
+    context_ = ctx;
+    callerContext_ = caller;
 #endif
+#endif
+    return true;
 }
 
-Fiber::~Fiber() {
-    if (stack_) {
-        free(stack_);
-    }
+void Fiber::releaseStack() {
+#if defined(TOCIN_FIBER_WINDOWS)
     if (context_) {
-        free(context_);
+        DeleteFiber(context_);
     }
+#else
+    FiberStackPool::release(stack_);
+    stack_ = FiberStackPool::Stack();
+#endif
+    context_ = nullptr;
+    callerContext_ = nullptr;
 }
 
-void Fiber::resume() {
-    if (state_ == State::Completed) {
-        return;
+bool Fiber::resume() {
+    if (getState() == State::Completed) {
+        return true;
+    }
+
+    if (!context_ && !prepareContext()) {
+        return false; // No stack to run on yet; the fiber stays Ready
     }
     
-    state_ = State::Running;
+    state_.store(State::Running, std::memory_order_release);
     
-    // Execute fiber function
-    if (func_) {
-        func_();
-        complete();
+    Fiber* previous = currentFiber;
+    currentFiber = this;
+
+#if defined(TOCIN_FIBER_WINDOWS)
+    if (!IsThreadAFiber()) {
+        ConvertThreadToFiber(nullptr);
     }
+    callerContext_ = GetCurrentFiber();
+    SwitchToFiber(context_);
+#elif defined(TOCIN_FIBER_ASM)
+    tocin_fiber_switch(&callerContext_, context_);
+#else
+    swapcontext(static_cast<ucontext_t*>(callerContext_),
+                static_cast<ucontext_t*>(context_));
+#endif
+
+    currentFiber = previous;
+
+    if (getState() == State::Completed) {
+        // Off the fiber stack for good: recycle it on this worker
+        releaseStack();
+    }
+
+    if (exception_) {
+        std::exception_ptr ex = exception_;
+        exception_ = nullptr;
+        std::rethrow_exception(ex);
+    }
+    return true;
+}
+
+void Fiber::switchToCaller() {
+#if defined(TOCIN_FIBER_WINDOWS)
+    SwitchToFiber(callerContext_);
+#elif defined(TOCIN_FIBER_ASM)
+    tocin_fiber_switch(&context_, callerContext_);
+#else
+    swapcontext(static_cast<ucontext_t*>(context_),
+                static_cast<ucontext_t*>(callerContext_));
+#endif
 }
 
 void Fiber::yield() {
-    if (state_ == State::Running) {
-        state_ = State::Suspended;
+    if (currentFiber != this || getState() != State::Running) {
+        return;
+    }
+    state_.store(State::Ready, std::memory_order_release);
+    switchToCaller();
+}
+
+void Fiber::suspend(const std::atomic<bool>* wakeFlag) {
+    if (currentFiber != this || getState() != State::Running || isCancelled()) {
+        return; // Nobody resumes a cancelled fiber that parks
+    }
+    // The worker commits the park after the switch, once this stack is no
+    // longer in use; a wake() arriving before that is recorded as pending.
+    park_.store(ParkState::Parking, std::memory_order_seq_cst);
+    if (wakeFlag && wakeFlag->load(std::memory_order_seq_cst)) {
+        // Woken before we got going; a racing wake() may have marked the
+        // park pending, which we simply drop
+        park_.store(ParkState::None, std::memory_order_release);
+        return;
+    }
+    state_.store(State::Suspended, std::memory_order_release);
+    switchToCaller();
+}
+
+bool Fiber::commitPark() {
+    ParkState expected = ParkState::Parking;
+    if (park_.compare_exchange_strong(expected, ParkState::Parked,
+                                      std::memory_order_acq_rel)) {
+        return true;
+    }
+    // wake() ran while we were still switching out
+    park_.store(ParkState::None, std::memory_order_release);
+    state_.store(State::Ready, std::memory_order_release);
+    return false;
+}
+
+void Fiber::wake() {
+    ParkState current = park_.load(std::memory_order_acquire);
+    while (true) {
+        if (current == ParkState::Parking) {
+            if (park_.compare_exchange_weak(current, ParkState::WakePending,
+                                            std::memory_order_acq_rel)) {
+                return;
+            }
+        } else if (current == ParkState::Parked) {
+            if (park_.compare_exchange_weak(current, ParkState::None,
+                                            std::memory_order_acq_rel)) {
+                state_.store(State::Ready, std::memory_order_release);
+                if (scheduler_) {
+                    scheduler_->untrackParked(this);
+                    scheduler_->reschedule(shared_from_this());
+                }
+                return;
+            }
+        } else {
+            return; // Not suspended, or already woken
+        }
     }
 }
 
 void Fiber::complete() {
-    state_ = State::Completed;
+    state_.store(State::Completed, std::memory_order_release);
+}
+
+Fiber* Fiber::current() {
+    return currentFiber;
+}
+
+void Fiber::yieldCurrent() {
+    if (currentFiber) {
+        currentFiber->yield();
+    } else {
+        std::this_thread::yield();
+    }
 }
 
-// Static wrapper functions for fiber execution
+void Fiber::exitCurrent() {
+    Fiber* fiber = currentFiber;
+    fiber->complete();
+    fiber->switchToCaller();
+    std::abort(); // A completed fiber is never resumed
+}
+
+void Fiber::sleepFor(std::chrono::nanoseconds duration) {
+    if (!currentFiber) {
+        std::this_thread::sleep_for(duration);
+        return;
+    }
+    // Park until a timer wakes us, so the worker runs other fibers or
+    // goes idle meanwhile. The flag is shared because the timer may fire
+    // after a spurious wakeup has already let this frame move on.
+    auto fiber = currentFiber->shared_from_this();
+    auto fired = std::make_shared<std::atomic<bool>>(false);
+    auto deadline = ::runtime::detail::TimerQueue::Clock::now() + duration;
+    auto& timers = ::runtime::detail::TimerQueue::instance();
+    uint64_t timer = timers.schedule(deadline, [fiber, fired] {
+        fired->store(true, std::memory_order_seq_cst);
+        fiber->wake();
+    });
+    while (!fired->load(std::memory_order_seq_cst)) {
+        if (fiber->isCancelled()) {
+            timers.cancel(timer);
+            throw FiberCancelled();
+        }
+        fiber->suspend(fired.get());
+    }
+}
+
+// Static wrapper functions for fiber execution. These are the first frame
+// on the fiber stack and must never return: they switch back to the worker
+// for the last time once the fiber function has finished.
 #ifndef _WIN32
 void fiberWrapper(Fiber* fiber) {
-    if (fiber && fiber->func_) {
-        fiber->func_();
-        fiber->complete();
+    try {
+        if (fiber->func_) {
+            fiber->func_();
+        }
+    } catch (const FiberCancelled&) {
+        // Unwound by stop(); not an error
+    } catch (...) {
+        // Exceptions cannot unwind past the fiber stack; hand them to resume()
+        fiber->exception_ = std::current_exception();
     }
+    fiber->func_ = nullptr;
+    fiber->complete();
+    fiber->switchToCaller();
+    std::abort(); // A completed fiber is never resumed
 }
 #else
 VOID CALLBACK fiberWrapperWindows(PVOID param) {
     Fiber* fiber = static_cast<Fiber*>(param);
-    if (fiber && fiber->func_) {
-        fiber->func_();
-        fiber->complete();
+    try {
+        if (fiber->func_) {
+            fiber->func_();
+        }
+    } catch (const FiberCancelled&) {
+        // Unwound by stop(); not an error
+    } catch (...) {
+        fiber->exception_ = std::current_exception();
     }
+    fiber->func_ = nullptr;
+    fiber->complete();
+    fiber->switchToCaller();
+    std::abort();
 }
 #endif
 
@@ -132,21 +669,31 @@ VOID CALLBACK fiberWrapperWindows(PVOID param) {
 // Worker Implementation
 // ============================================================================
 
-Worker::Worker(size_t id, int numaNode, int cpuAffinity)
-    : id_(id)
+Worker::Worker(LightweightScheduler* scheduler, size_t id, int numaNode, int cpuAffinity)
+    : scheduler_(scheduler)
+    , id_(id)
     , numaNode_(numaNode)
     , cpuAffinity_(cpuAffinity)
+    , inboxPending_(false)
+    , scheduleTick_(0)
+    , rngState_(0x9E3779B97F4A7C15ull * (id + 1))
+    , parked_(0)
     , running_(false)
     , stopping_(false) {
     stats_.fibersExecuted = 0;
     stats_.fibersStolen = 0;
     stats_.idleTimeMs = 0;
     stats_.busyTimeMs = 0;
+    stats_.fibersFailed = 0;
 }
 
 Worker::~Worker() {
     stop();
     join();
+    
+    // Break the self-references of fibers that never ran
+    while (popLocal()) {
+    }
 }
 
 void Worker::start() {
@@ -161,6 +708,7 @@ void Worker::start() {
 
 void Worker::stop() {
     stopping_.store(true);
+    unpark();
 }
 
 void Worker::join() {
@@ -170,15 +718,176 @@ void Worker::join() {
 }
 
 void Worker::addFiber(std::shared_ptr<Fiber> fiber) {
-    queue_.push(fiber);
+    if (currentWorker == this) {
+        pushLocal(std::move(fiber));
+        // Our own deque grew: let a parked sibling come and steal
+        scheduler_->notifyWorkAvailable(nullptr);
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        inbox_.push_back(std::move(fiber));
+        inboxPending_.store(true, std::memory_order_release);
+    }
+    scheduler_->notifyWorkAvailable(this);
+}
+
+void Worker::pushLocal(std::shared_ptr<Fiber> fiber) {
+    Fiber* raw = fiber.get();
+    raw->queueRef_ = std::move(fiber);
+    queue_.pushPriority(raw, static_cast<int>(raw->getPriority()));
+}
+
+std::shared_ptr<Fiber> Worker::popLocal() {
+    Fiber* raw = queue_.pop();
+    return raw ? std::move(raw->queueRef_) : nullptr;
+}
+
+void Worker::drainInbox() {
+    if (!inboxPending_.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    std::vector<std::shared_ptr<Fiber>> pending;
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        pending.swap(inbox_);
+        inboxPending_.store(false, std::memory_order_relaxed);
+    }
+    for (auto& fiber : pending) {
+        pushLocal(std::move(fiber));
+    }
+}
+
+void Worker::takeAll(std::vector<std::shared_ptr<Fiber>>& out) {
+    drainInbox();
+    while (auto fiber = popLocal()) {
+        out.push_back(std::move(fiber));
+    }
+    for (auto& fiber : yielded_) {
+        out.push_back(std::move(fiber));
+    }
+    yielded_.clear();
+}
+
+std::shared_ptr<Fiber> Worker::takeFromInbox() {
+    if (!inboxPending_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(inboxMutex_);
+    if (inbox_.empty()) {
+        return nullptr;
+    }
+    auto fiber = std::move(inbox_.back());
+    inbox_.pop_back();
+    inboxPending_.store(!inbox_.empty(), std::memory_order_relaxed);
+    return fiber;
 }
 
 std::shared_ptr<Fiber> Worker::stealFiber() {
-    auto fiber = queue_.steal();
-    if (fiber) {
+    // A successful steal owns the slot, so taking the reference is safe
+    Fiber* raw = queue_.steal();
+    if (raw) {
+        return std::move(raw->queueRef_);
+    }
+    // The owner may be busy in a long fiber with a full inbox
+    return takeFromInbox();
+}
+
+std::shared_ptr<Fiber> Worker::stealFromVictims() {
+    auto& workers = scheduler_->workers_;
+    size_t count = workers.size();
+    if (count < 2) {
+        return nullptr;
+    }
+    
+    // Random starting victim, then sweep the rest so every queue is tried
+    rngState_ ^= rngState_ << 13;
+    rngState_ ^= rngState_ >> 7;
+    rngState_ ^= rngState_ << 17;
+    size_t start = rngState_ % count;
+    for (size_t i = 0; i < count; ++i) {
+        Worker* victim = workers[(start + i) % count].get();
+        if (victim == this) {
+            continue;
+        }
+        auto fiber = victim->stealFiber();
+        if (!fiber) {
+            continue;
+        }
         stats_.fibersStolen++;
+        
+        // Take up to half of what is left so we do not come straight back
+        size_t extra = std::min<size_t>(victim->queuedFibers() / 2, 32);
+        for (size_t n = 0; n < extra; ++n) {
+            Fiber* raw = victim->queue_.steal();
+            if (!raw) {
+                break;
+            }
+            stats_.fibersStolen++;
+            pushLocal(std::move(raw->queueRef_));
+        }
+        return fiber;
     }
-    return fiber;
+    return nullptr;
+}
+
+bool Worker::hasVisibleWork() const {
+    for (const auto& worker : scheduler_->workers_) {
+        if (!worker->queue_.isEmpty() || worker->inboxPending_.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Worker::park() {
+    // Announce first, then re-check for work; notifyWorkAvailable does the
+    // mirror image (publish work, then look for parked workers), so one of
+    // the two always sees the other and no wakeup is lost.
+    parked_.store(1, std::memory_order_seq_cst);
+    scheduler_->parkedWorkers_.fetch_add(1, std::memory_order_seq_cst);
+    
+    if (stopping_.load() || hasVisibleWork()) {
+        unpark();
+        return;
+    }
+    
+#ifdef __linux__
+    while (parked_.load(std::memory_order_acquire) == 1 && !stopping_.load()) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&parked_), FUTEX_WAIT_PRIVATE,
+                1, nullptr, nullptr, 0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(parkMutex_);
+    parkCV_.wait(lock, [this]() {
+        return parked_.load(std::memory_order_acquire) == 0 || stopping_.load();
+    });
+#endif
+    unpark();
+}
+
+bool Worker::unpark() {
+    if (parked_.load(std::memory_order_seq_cst) == 0 || parked_.exchange(0) == 0) {
+        return false;
+    }
+    scheduler_->parkedWorkers_.fetch_sub(1, std::memory_order_seq_cst);
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&parked_), FUTEX_WAKE_PRIVATE,
+            1, nullptr, nullptr, 0);
+#else
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+    }
+    parkCV_.notify_one();
+#endif
+    return true;
+}
+
+Worker* Worker::current() {
+    return currentWorker;
 }
 
 void Worker::setCPUAffinity(int cpu) {
@@ -210,62 +919,111 @@ void Worker::applyAffinity() {
 }
 
 void Worker::run() {
+    currentWorker = this;
+    
     // Apply CPU affinity if set
     applyAffinity();
     
-    auto lastActivity = std::chrono::high_resolution_clock::now();
-    bool wasIdle = false;
-    
     while (running_.load() && !stopping_.load()) {
         auto fiber = getNextFiber();
         
-        if (fiber) {
-            // Execute fiber
-            auto start = std::chrono::high_resolution_clock::now();
-            fiber->resume();
-            auto end = std::chrono::high_resolution_clock::now();
-            
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            stats_.busyTimeMs += duration.count();
-            
-            if (fiber->isCompleted()) {
-                stats_.fibersExecuted++;
-            } else {
-                // Re-queue if not completed
-                queue_.push(fiber);
+        // Spin briefly through the steal loop before going to sleep:
+        // bursty fan-out usually refills a queue within microseconds
+        for (int spin = 0; !fiber && spin < 64; ++spin) {
+            std::this_thread::yield();
+            fiber = getNextFiber();
+        }
+        
+        if (!fiber) {
+            auto idleStart = std::chrono::high_resolution_clock::now();
+            park();
+            auto idleEnd = std::chrono::high_resolution_clock::now();
+            stats_.idleTimeMs += std::chrono::duration_cast<std::chrono::milliseconds>(
+                idleEnd - idleStart).count();
+            continue;
+        }
+        
+        // Execute fiber. An exception escaping a goroutine ends only that
+        // goroutine; the worker thread and the completion count carry on.
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t releases = scheduler_->stackReleases_.load(std::memory_order_seq_cst);
+        bool ran = true;
+        try {
+            ran = fiber->resume();
+        } catch (const std::exception& e) {
+            std::cerr << "goroutine terminated by exception: " << e.what() << std::endl;
+            stats_.fibersFailed++;
+        } catch (...) {
+            std::cerr << "goroutine terminated by unknown exception" << std::endl;
+            stats_.fibersFailed++;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        if (!ran) {
+            // Out of stack memory: wait for a finishing fiber to give a
+            // stack back instead of retrying the allocator in a loop
+            scheduler_->waitForStack(std::move(fiber), releases);
+            continue;
+        }
+        
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        stats_.busyTimeMs += duration.count();
+        
+        switch (fiber->getState()) {
+        case Fiber::State::Completed:
+            stats_.fibersExecuted++;
+            // Its stack just went to this thread's cache, so run a fiber
+            // that is waiting for one here
+            if (auto waiter = scheduler_->onStackReleased()) {
+                pushLocal(std::move(waiter));
             }
-            
-            wasIdle = false;
-            lastActivity = end;
-        } else {
-            // Idle - track idle time
-            if (!wasIdle) {
-                wasIdle = true;
-                lastActivity = std::chrono::high_resolution_clock::now();
+            scheduler_->onFiberCompleted();
+            break;
+        case Fiber::State::Suspended:
+            // Parked fibers are owned by whatever will wake() them; the
+            // scheduler lists them until then for stop()
+            scheduler_->trackParked(fiber);
+            if (!fiber->commitPark()) {
+                scheduler_->untrackParked(fiber.get());
+                pushLocal(fiber);
             }
-            
-            // Brief sleep to avoid spinning
-            std::this_thread::sleep_for(std::chrono::microseconds(100));
-            
-            auto now = std::chrono::high_resolution_clock::now();
-            auto idleDuration = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastActivity);
-            stats_.idleTimeMs += idleDuration.count();
-            lastActivity = now;
+            break;
+        default:
+            // Yielded: queue_ pops LIFO, so park it behind the other
+            // runnable fibers instead
+            yielded_.push_back(fiber);
+            break;
         }
     }
     
+    currentWorker = nullptr;
     running_.store(false);
 }
 
 std::shared_ptr<Fiber> Worker::getNextFiber() {
+    // Check yielded fibers every so often so a stream of new work cannot
+    // starve them (same interval as Go's global run queue check)
+    if (!yielded_.empty() && ++scheduleTick_ % 61 == 0) {
+        auto fiber = yielded_.front();
+        yielded_.pop_front();
+        return fiber;
+    }
+
+    drainInbox();
+    
     // Try to get from own queue first
-    auto fiber = queue_.pop();
+    auto fiber = popLocal();
     if (fiber) {
         return fiber;
     }
+
+    if (!yielded_.empty()) {
+        fiber = yielded_.front();
+        yielded_.pop_front();
+        return fiber;
+    }
     
-    // If queue is empty, try work stealing is handled by scheduler
-    return nullptr;
+    return stealFromVictims();
 }
 
 // ============================================================================
@@ -281,7 +1039,10 @@ LightweightScheduler::LightweightScheduler(size_t numWorkers)
     , activeFibers_(0)
     , completedFibers_(0)
     , running_(false)
-    , fiberStackSize_(4096)
+    , parkedWorkers_(0)
+    , stackReleases_(0)
+    , stackWaiterCount_(0)
+    , fiberStackSize_(FiberStackPool::kDefaultStackSize)
     , numaAware_(false)
     , numNUMANodes_(0) {
     initialize(numWorkers);
@@ -307,34 +1068,26 @@ void LightweightScheduler::initialize(size_t numWorkers) {
         for (size_t i = 0; i < numWorkers; ++i) {
             int numaNode = i / workersPerNode;
             int cpuAffinity = numaNode * workersPerNode + (i % workersPerNode);
-            workers_.push_back(std::make_unique<Worker>(i, numaNode, cpuAffinity));
+            workers_.push_back(std::make_unique<Worker>(this, i, numaNode, cpuAffinity));
         }
     } else {
         for (size_t i = 0; i < numWorkers; ++i) {
-            workers_.push_back(std::make_unique<Worker>(i, -1, -1));
+            workers_.push_back(std::make_unique<Worker>(this, i, -1, -1));
         }
     }
 }
 
 void LightweightScheduler::start() {
-    if (running_.load()) {
+    // Generated code calls this on every launch, possibly concurrently
+    if (running_.exchange(true)) {
         return;
     }
     
-    running_.store(true);
-    
     // Start all workers
     for (auto& worker : workers_) {
         worker->start();
     }
-    
-    // Start load balancing thread
-    std::thread([this]() {
-        while (running_.load()) {
-            balanceLoad();
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    }).detach();
+
 }
 
 void LightweightScheduler::stop() {
@@ -349,6 +1102,81 @@ void LightweightScheduler::stop() {
     for (auto& worker : workers_) {
         worker->join();
     }
+
+    drainFibers();
+}
+
+void LightweightScheduler::drainFibers() {
+    // No worker runs fibers any more, but some are still mid-flight:
+    // parked on a channel, select or timer, or queued after a yield or
+    // wake. Their frames hold waiters that channels point into and a
+    // reference to the fiber itself, so dropping them would leak the
+    // fiber and its stack. Resume each one here, cancelled, so its
+    // blocking call throws FiberCancelled and the stack unwinds.
+    for (;;) {
+        std::vector<std::shared_ptr<Fiber>> pending;
+        for (auto& shard : parkedShards_) {
+            for (;;) {
+                std::unique_lock<std::mutex> lock(shard.mutex);
+                if (shard.fibers.empty()) {
+                    break;
+                }
+                auto fiber = shard.fibers.back();
+                Fiber::ParkState expected = Fiber::ParkState::Parked;
+                if (!fiber->park_.compare_exchange_strong(expected, Fiber::ParkState::None,
+                                                          std::memory_order_acq_rel)) {
+                    // A racing wake() owns it and is about to unlist it
+                    lock.unlock();
+                    std::this_thread::yield();
+                    continue;
+                }
+                shard.fibers.pop_back();
+                fiber->state_.store(Fiber::State::Ready, std::memory_order_release);
+                pending.push_back(std::move(fiber));
+            }
+        }
+        for (auto& worker : workers_) {
+            worker->takeAll(pending);
+        }
+        if (pending.empty()) {
+            return;
+        }
+
+        for (auto& fiber : pending) {
+            if (!fiber->context_) {
+                continue; // Never started: nothing to unwind
+            }
+            fiber->cancelled_.store(true, std::memory_order_release);
+            // A fiber that yields instead of blocking gets resumed again
+            while (!fiber->isCompleted()) {
+                try {
+                    fiber->resume();
+                } catch (...) {
+                    // Thrown while unwinding; the fiber is done either way
+                }
+            }
+            onFiberCompleted();
+        }
+    }
+}
+
+void LightweightScheduler::trackParked(const std::shared_ptr<Fiber>& fiber) {
+    auto& shard = parkedShards_[fiber->getId() % kParkedShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    fiber->parkSlot_ = shard.fibers.size();
+    shard.fibers.push_back(fiber);
+}
+
+void LightweightScheduler::untrackParked(Fiber* fiber) {
+    auto& shard = parkedShards_[fiber->getId() % kParkedShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    size_t slot = fiber->parkSlot_;
+    if (slot >= shard.fibers.size() || shard.fibers[slot].get() != fiber) {
+        return; // Not listed
+    }
+    std::swap(shard.fibers[slot], shard.fibers.back());
+    shard.fibers[slot]->parkSlot_ = slot;
+    shard.fibers.pop_back();
 }
 
 void LightweightScheduler::waitAll() {
@@ -358,6 +1186,71 @@ void LightweightScheduler::waitAll() {
     });
 }
 
+void LightweightScheduler::reschedule(std::shared_ptr<Fiber> fiber) {
+    size_t workerIdx = selectWorkerForFiber(fiber->getPriority());
+    workers_[workerIdx]->addFiber(std::move(fiber));
+}
+
+void LightweightScheduler::notifyWorkAvailable(Worker* preferred) {
+    // Pairs with the announce-then-recheck in Worker::park()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers_.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    
+    if (preferred && preferred->unpark()) {
+        return;
+    }
+    
+    // Wake one sleeper; it will steal whatever was just published
+    size_t count = workers_.size();
+    size_t start = nextWorker_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        Worker* worker = workers_[(start + i) % count].get();
+        if (worker != Worker::current() && worker->unpark()) {
+            return;
+        }
+    }
+}
+
+void LightweightScheduler::waitForStack(std::shared_ptr<Fiber> fiber, uint64_t releases) {
+    {
+        std::lock_guard<std::mutex> lock(stackWaitMutex_);
+        stackWaiters_.push_back(std::move(fiber));
+        stackWaiterCount_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    // A stack released while we were failing to get one may have found
+    // the list still empty; retry once rather than wait for the next one
+    if (stackReleases_.load(std::memory_order_seq_cst) != releases) {
+        if (auto waiter = onStackReleased()) {
+            reschedule(std::move(waiter));
+        }
+    }
+}
+
+std::shared_ptr<Fiber> LightweightScheduler::onStackReleased() {
+    stackReleases_.fetch_add(1, std::memory_order_seq_cst);
+    if (stackWaiterCount_.load(std::memory_order_seq_cst) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(stackWaitMutex_);
+    if (stackWaiters_.empty()) {
+        return nullptr;
+    }
+    auto fiber = std::move(stackWaiters_.front());
+    stackWaiters_.pop_front();
+    stackWaiterCount_.fetch_sub(1, std::memory_order_seq_cst);
+    return fiber;
+}
+
+void LightweightScheduler::onFiberCompleted() {
+    completedFibers_.fetch_add(1);
+    if (activeFibers_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        completionCV_.notify_all();
+    }
+}
+
 void LightweightScheduler::setMaxWorkers(size_t count) {
     if (running_.load()) {
         return; // Cannot change while running
@@ -368,7 +1261,8 @@ void LightweightScheduler::setMaxWorkers(size_t count) {
 }
 
 void LightweightScheduler::setFiberStackSize(size_t size) {
-    fiberStackSize_ = std::max(size, size_t(1024)); // Minimum 1KB
+    // Fibers draw from the pool class this size rounds up to
+    fiberStackSize_ = FiberStackPool::sizeClassFor(size);
 }
 
 LightweightScheduler::SchedulerStats LightweightScheduler::getStats() const {
@@ -461,6 +1355,13 @@ void LightweightScheduler::detectNUMATopology() {
 }
 
 size_t LightweightScheduler::selectWorkerForFiber(Fiber::Priority priority) {
+    // Spawned from one of our own workers: keep it on that worker's deque
+    // (no contention); parked siblings are woken to steal from it
+    Worker* self = Worker::current();
+    if (self && self->scheduler_ == this) {
+        return self->id_;
+    }
+    
     if (!numaAware_ || numNUMANodes_ <= 1) {
         // Simple round-robin
         return nextWorker_.fetch_add(1) % workers_.size();
@@ -481,26 +1382,6 @@ size_t LightweightScheduler::selectWorkerForFiber(Fiber::Priority priority) {
     return nextWorker_.fetch_add(1) % workers_.size();
 }
 
-void LightweightScheduler::balanceLoad() {
-    // Find busiest and least busy workers
-    if (workers_.size() < 2) {
-        return;
-    }
-    
-    // Simple work stealing: if a worker is idle, steal from busiest
-    for (size_t i = 0; i < workers_.size(); ++i) {
-        for (size_t j = 0; j < workers_.size(); ++j) {
-            if (i != j) {
-                auto fiber = workers_[j]->stealFiber();
-                if (fiber) {
-                    workers_[i]->addFiber(fiber);
-                    break; // Only steal one per round
-                }
-            }
-        }
-    }
-}
-
 LightweightScheduler& LightweightScheduler::instance() {
     static LightweightScheduler instance;
     return instance;
@@ -508,3 +1389,21 @@ LightweightScheduler& LightweightScheduler::instance() {
 
 } // namespace runtime
 } // namespace tocin
+
+extern "C" {
+
+void runtime_schedule_goroutine(void (*entry)(void*), void* env) {
+    auto& scheduler = tocin::runtime::LightweightScheduler::instance();
+    scheduler.start();
+    // Owned by the fiber so it is freed even if stop() ends it early
+    std::shared_ptr<void> owned(env, &std::free);
+    scheduler.go([entry, owned]() {
+        entry(owned.get());
+    });
+}
+
+void runtime_wait_all() {
+    tocin::runtime::LightweightScheduler::instance().waitAll();
+}
+
+} // extern "C"
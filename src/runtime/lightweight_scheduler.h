@@ -1,25 +1,80 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <memory>
 #include <cstdint>
+#include <type_traits>
+#include <chrono>
+#include <exception>
 
 namespace tocin {
 namespace runtime {
 
+class LightweightScheduler;
+
+/**
+ * @brief Pool of mmap'd fiber stacks with a PROT_NONE guard page
+ *
+ * Stacks are bucketed into power-of-two size classes. Each thread keeps a
+ * small freelist per class and spills to a shared pool, so spawning a fiber
+ * on a warm worker is a freelist pop and a stack overflow hits the guard
+ * page instead of the neighbouring heap block.
+ */
+class FiberStackPool {
+public:
+    struct Stack {
+        void* base = nullptr;  // Lowest usable address, just above the guard page
+        size_t size = 0;       // Usable bytes
+        explicit operator bool() const { return base != nullptr; }
+    };
+
+    static constexpr size_t kMinStackSize = 16 * 1024;
+    static constexpr size_t kDefaultStackSize = 64 * 1024;
+    static constexpr size_t kMaxStackSize = 8 * 1024 * 1024;
+
+    // Round a requested size up to its size class
+    static size_t sizeClassFor(size_t requested);
+
+    static Stack acquire(size_t size);
+    static void release(Stack stack);
+
+    struct PoolStats {
+        size_t mappedStacks;  // Stacks currently mapped, in use or cached
+        size_t cachedStacks;  // Stacks sitting in the shared pool
+    };
+    static PoolStats getStats();
+};
+
+/**
+ * @brief Thrown out of a blocking call when stop() unwinds a fiber
+ *
+ * Deliberately not a std::exception, so generic handlers in goroutine
+ * code do not swallow it; the fiber entry point catches it silently.
+ */
+struct FiberCancelled {};
+
 /**
  * @brief Lightweight Fiber/Coroutine implementation
  * 
- * Uses cooperative multitasking with ~4KB stack size instead of
- * OS threads (~1MB stack) to support millions of concurrent goroutines.
+ * Uses cooperative multitasking with small pooled stacks (64KB reserved by
+ * default, only touched pages are committed) instead of OS threads (~1MB
+ * stack) to support millions of concurrent goroutines.
+ *
+ * Each fiber runs on its own stack. resume() switches from the worker
+ * thread into the fiber, and yield()/suspend() switch back, so a fiber
+ * that blocks hands its worker to other fibers. Switching uses a
+ * hand-written routine on x86-64 and AArch64, Windows fibers on Windows
+ * and ucontext everywhere else.
  */
-class Fiber {
+class Fiber : public std::enable_shared_from_this<Fiber> {
 public:
     using FiberFunc = std::function<void()>;
     
@@ -38,20 +93,46 @@ public:
         Background = 4 // Lowest priority
     };
 
-    explicit Fiber(FiberFunc func, size_t stackSize = 4096, Priority priority = Priority::Normal);
+    explicit Fiber(FiberFunc func, size_t stackSize = FiberStackPool::kDefaultStackSize,
+                   Priority priority = Priority::Normal);
     ~Fiber();
 
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
     // Fiber control
-    void resume();
-    void yield();
+    // Worker side: run until the fiber yields, suspends or completes.
+    // Returns false without running if no stack could be allocated.
+    bool resume();
+    void yield();    // Fiber side: give the worker back, stay runnable
+    // Fiber side: give the worker back until wake() is called. If `wakeFlag`
+    // is given and already set once the fiber has announced itself as
+    // parking, it returns immediately (so a waker that sets the flag before
+    // calling wake() can never be missed).
+    void suspend(const std::atomic<bool>* wakeFlag = nullptr);
+    void wake();     // Any thread: make a suspended fiber runnable again
     void complete();
+    // Set by stop() before it unwinds the fiber; blocking calls check it
+    // and throw FiberCancelled instead of suspending
+    bool isCancelled() const { return cancelled_.load(std::memory_order_acquire); }
 
     // State management
-    State getState() const { return state_; }
-    bool isCompleted() const { return state_ == State::Completed; }
+    State getState() const { return state_.load(std::memory_order_acquire); }
+    bool isCompleted() const { return getState() == State::Completed; }
     uint64_t getId() const { return id_; }
     Priority getPriority() const { return priority_; }
     void setPriority(Priority priority) { priority_ = priority; }
+    LightweightScheduler* getScheduler() const { return scheduler_; }
+
+    // Fiber running on the calling thread, or nullptr outside a fiber
+    static Fiber* current();
+
+    // Yield/sleep the calling fiber; fall back to the OS thread outside a fiber
+    static void yieldCurrent();
+    static void sleepFor(std::chrono::nanoseconds duration);
+    // End the calling fiber without unwinding it, for callers whose frames
+    // cannot be unwound (generated code behind the C ABI)
+    [[noreturn]] static void exitCurrent();
 
     // Friend declarations for wrapper functions
 #ifndef _WIN32
@@ -61,27 +142,101 @@ public:
 #endif
 
 private:
+    friend class Worker;
+    friend class LightweightScheduler;
+
+    // Park protocol between suspend() and wake(); see lightweight_scheduler.cpp
+    enum class ParkState { None, Parking, Parked, WakePending };
+
+    void switchToCaller();
+    bool commitPark();
+    bool prepareContext();
+    void releaseStack();
+
     uint64_t id_;
     FiberFunc func_;
-    State state_;
+    std::atomic<State> state_;
+    std::atomic<ParkState> park_;
+    std::atomic<bool> cancelled_;
+    size_t parkSlot_;                 // Index in the scheduler's parked list
     Priority priority_;
-    void* stack_;
+    LightweightScheduler* scheduler_;
+    FiberStackPool::Stack stack_;     // Taken from the pool on first resume
     size_t stackSize_;
-    void* context_;
+    void* context_;        // Fiber's saved context
+    void* callerContext_;  // Context of the worker that resumed the fiber
+    std::exception_ptr exception_;
+    std::shared_ptr<Fiber> queueRef_; // Keeps the fiber alive while in a run queue
     
-    static uint64_t nextId_;
+    static std::atomic<uint64_t> nextId_;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque
+ *
+ * The owner pushes and pops at the bottom with plain loads and stores
+ * (a CAS is only needed when racing a thief for the last element);
+ * thieves take from the top with a single CAS. The ring buffer grows
+ * on demand and retired buffers are kept until destruction because a
+ * slow thief may still be reading from them. T must be trivially
+ * copyable (in practice a pointer).
+ */
+template<typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ChaseLevDeque slots are read racily and must be trivially copyable");
+public:
+    explicit ChaseLevDeque(size_t initialCapacity = 32);
+    ~ChaseLevDeque();
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner operations (bottom of deque)
+    void push(T item);
+    bool pop(T& item);
+
+    // Thief operations (top of deque)
+    bool steal(T& item);
+
+    size_t size() const;
+
+private:
+    struct Buffer {
+        explicit Buffer(size_t capacity)
+            : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+        ~Buffer() { delete[] slots; }
+
+        size_t capacity() const { return mask + 1; }
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T item) { slots[i & mask].store(item, std::memory_order_relaxed); }
+
+        size_t mask;
+        std::atomic<T>* slots;
+    };
+
+    Buffer* grow(Buffer* buffer, int64_t bottom, int64_t top);
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> retired_; // Owner-only
 };
 
 /**
  * @brief Work-stealing queue for efficient task distribution
  * 
  * Lock-free queue that allows workers to steal tasks from each other
- * for optimal load balancing. Now supports priority-based ordering.
+ * for optimal load balancing. Priorities map to a fixed array of
+ * Chase-Lev deques, so pushes and pops are O(1) and only contend on
+ * the last element of a lane.
  */
 template<typename T>
 class WorkStealingQueue {
 public:
-    WorkStealingQueue() : bottom_(0), top_(0) {}
+    static constexpr int kPriorityLevels = 5; // Matches Fiber::Priority
+
+    WorkStealingQueue() = default;
     
     // Owner operations (bottom of queue)
     void push(T item);
@@ -97,19 +252,9 @@ public:
     size_t size() const;
 
 private:
-    struct PriorityItem {
-        T item;
-        int priority;
-        size_t insertOrder;
-    };
-    
-    std::vector<T> items_;
-    std::vector<PriorityItem> priorityItems_;
-    std::atomic<size_t> bottom_;
-    std::atomic<size_t> top_;
-    std::atomic<size_t> insertCounter_;
-    std::mutex mutex_;
-    bool usePriority_;
+    static int clampPriority(int priority);
+
+    ChaseLevDeque<T> lanes_[kPriorityLevels];
 };
 
 /**
@@ -119,7 +264,7 @@ private:
  */
 class Worker {
 public:
-    explicit Worker(size_t id, int numaNode = -1, int cpuAffinity = -1);
+    Worker(LightweightScheduler* scheduler, size_t id, int numaNode = -1, int cpuAffinity = -1);
     ~Worker();
 
     // Worker control
@@ -127,9 +272,12 @@ public:
     void stop();
     void join();
     
-    // Task management
+    // Task management. addFiber may be called from any thread; fibers
+    // spawned by this worker's own thread go straight onto its deque.
     void addFiber(std::shared_ptr<Fiber> fiber);
     std::shared_ptr<Fiber> stealFiber();
+    size_t queuedFibers() const { return queue_.size(); }
+    static Worker* current();
     
     // NUMA and affinity
     void setCPUAffinity(int cpu);
@@ -143,20 +291,44 @@ public:
         uint64_t fibersStolen;
         uint64_t idleTimeMs;
         uint64_t busyTimeMs;
+        uint64_t fibersFailed;   // Ended by an uncaught exception
     };
     
     WorkerStats getStats() const { return stats_; }
 
 private:
+    friend class LightweightScheduler;
+
     void run();
     std::shared_ptr<Fiber> getNextFiber();
     void applyAffinity();
-    
+    void pushLocal(std::shared_ptr<Fiber> fiber);
+    std::shared_ptr<Fiber> popLocal();
+    void drainInbox();
+    void takeAll(std::vector<std::shared_ptr<Fiber>>& out); // Once stopped
+    std::shared_ptr<Fiber> takeFromInbox();
+    std::shared_ptr<Fiber> stealFromVictims();
+    bool hasVisibleWork() const;
+    void park();
+    bool unpark();
+    
+    LightweightScheduler* scheduler_;
     size_t id_;
     int numaNode_;
     int cpuAffinity_;
     std::unique_ptr<std::thread> thread_;
-    WorkStealingQueue<std::shared_ptr<Fiber>> queue_;
+    WorkStealingQueue<Fiber*> queue_;             // Owner pushes/pops, anyone steals
+    std::vector<std::shared_ptr<Fiber>> inbox_;   // Fibers handed over by other threads
+    std::mutex inboxMutex_;
+    std::atomic<bool> inboxPending_;
+    std::deque<std::shared_ptr<Fiber>> yielded_; // Owner-only FIFO of yielded fibers
+    uint64_t scheduleTick_;
+    uint64_t rngState_;               // xorshift state for victim selection
+    std::atomic<uint32_t> parked_;    // 1 while sleeping in park(); futex word on Linux
+#ifndef __linux__
+    std::mutex parkMutex_;
+    std::condition_variable parkCV_;
+#endif
     std::atomic<bool> running_;
     std::atomic<bool> stopping_;
     WorkerStats stats_;
@@ -166,7 +338,9 @@ private:
  * @brief Lightweight Goroutine Scheduler
  * 
  * Fiber-based scheduler supporting millions of concurrent goroutines
- * with work-stealing for optimal load balancing.
+ * with work-stealing for optimal load balancing. A worker that runs out
+ * of work steals from random victims, then parks until go() or a wake()
+ * hands it something to do.
  * Enhanced with priority-based scheduling and NUMA awareness.
  */
 class LightweightScheduler {
@@ -209,8 +383,20 @@ public:
     static LightweightScheduler& instance();
 
 private:
+    friend class Worker;
+    friend class Fiber;
+
     void initialize(size_t numWorkers);
-    void balanceLoad();
+    void reschedule(std::shared_ptr<Fiber> fiber);
+    void onFiberCompleted();
+    void notifyWorkAvailable(Worker* preferred);
+    // Fibers that could not get a stack wait here until one is released
+    void waitForStack(std::shared_ptr<Fiber> fiber, uint64_t releases);
+    std::shared_ptr<Fiber> onStackReleased();
+    // Parked fibers are listed so stop() can unwind the ones left over
+    void trackParked(const std::shared_ptr<Fiber>& fiber);
+    void untrackParked(Fiber* fiber);
+    void drainFibers();
     void detectNUMATopology();
     size_t selectWorkerForFiber(Fiber::Priority priority);
     
@@ -219,6 +405,18 @@ private:
     std::atomic<size_t> activeFibers_;
     std::atomic<size_t> completedFibers_;
     std::atomic<bool> running_;
+    std::atomic<size_t> parkedWorkers_;
+    std::atomic<uint64_t> stackReleases_;
+    std::atomic<size_t> stackWaiterCount_;
+    std::mutex stackWaitMutex_;
+    std::deque<std::shared_ptr<Fiber>> stackWaiters_;
+
+    static constexpr size_t kParkedShards = 16;
+    struct alignas(64) ParkedShard {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Fiber>> fibers;
+    };
+    ParkedShard parkedShards_[kParkedShards];
     size_t fiberStackSize_;
     bool numaAware_;
     size_t numNUMANodes_;
@@ -231,129 +429,151 @@ private:
 // Template implementations
 
 template<typename T>
-void WorkStealingQueue<T>::push(T item) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    items_.push_back(item);
-    bottom_.store(items_.size(), std::memory_order_release);
+ChaseLevDeque<T>::ChaseLevDeque(size_t initialCapacity)
+    : top_(0), bottom_(0) {
+    size_t capacity = 1;
+    while (capacity < initialCapacity) {
+        capacity <<= 1;
+    }
+    buffer_.store(new Buffer(capacity), std::memory_order_relaxed);
 }
 
 template<typename T>
-void WorkStealingQueue<T>::pushPriority(T item, int priority) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    size_t order = insertCounter_.fetch_add(1);
-    priorityItems_.push_back({item, priority, order});
-    
-    // Sort by priority (lower value = higher priority), then by insertion order
-    std::sort(priorityItems_.begin(), priorityItems_.end(),
-        [](const PriorityItem& a, const PriorityItem& b) {
-            if (a.priority != b.priority) return a.priority < b.priority;
-            return a.insertOrder < b.insertOrder;
-        });
-    
-    bottom_.store(priorityItems_.size(), std::memory_order_release);
+ChaseLevDeque<T>::~ChaseLevDeque() {
+    delete buffer_.load(std::memory_order_relaxed);
 }
 
 template<typename T>
-T WorkStealingQueue<T>::pop() {
-    size_t b = bottom_.load(std::memory_order_acquire) - 1;
-    bottom_.store(b, std::memory_order_release);
-    
-    size_t t = top_.load(std::memory_order_acquire);
-    
-    if (b < t) {
-        // Queue was empty
-        bottom_.store(t, std::memory_order_release);
-        return T();
+typename ChaseLevDeque<T>::Buffer* ChaseLevDeque<T>::grow(Buffer* buffer, int64_t bottom, int64_t top) {
+    Buffer* bigger = new Buffer(buffer->capacity() * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+        bigger->put(i, buffer->get(i));
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Try priority items first
-    if (!priorityItems_.empty()) {
-        T item = priorityItems_.back().item;
-        priorityItems_.pop_back();
-        bottom_.store(priorityItems_.size(), std::memory_order_release);
-        return item;
+    retired_.emplace_back(buffer);
+    buffer_.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+template<typename T>
+void ChaseLevDeque<T>::push(T item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<int64_t>(buffer->capacity()) - 1) {
+        buffer = grow(buffer, b, t);
     }
-    
-    // Fall back to regular items
-    if (b >= items_.size()) {
-        return T();
+    buffer->put(b, item);
+    bottom_.store(b + 1, std::memory_order_release);
+}
+
+template<typename T>
+bool ChaseLevDeque<T>::pop(T& item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    
+    if (t > b) {
+        // Queue was empty
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return false;
     }
     
-    T item = items_[b];
-    
-    if (b == t) {
+    item = buffer->get(b);
+    if (t == b) {
         // Last item - race with steal()
-        if (!top_.compare_exchange_strong(t, t + 1)) {
-            item = T(); // Lost race
-        }
-        bottom_.store(t + 1, std::memory_order_release);
+        bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return won;
     }
-    
-    return item;
+    return true;
 }
 
 template<typename T>
-T WorkStealingQueue<T>::steal() {
-    size_t t = top_.load(std::memory_order_acquire);
-    size_t b = bottom_.load(std::memory_order_acquire);
+bool ChaseLevDeque<T>::steal(T& item) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
     
     if (t >= b) {
-        return T(); // Queue is empty
-    }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Steal from priority items first (highest priority)
-    if (!priorityItems_.empty()) {
-        T item = priorityItems_.front().item;
-        priorityItems_.erase(priorityItems_.begin());
-        top_.fetch_add(1);
-        return item;
+        return false; // Queue is empty
     }
     
-    // Steal from regular items
-    if (t >= items_.size()) {
-        return T();
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    T candidate = buffer->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+        return false; // Lost race
     }
-    
-    T item = items_[t];
-    
-    if (!top_.compare_exchange_strong(t, t + 1)) {
-        return T(); // Lost race
+    item = candidate;
+    return true;
+}
+
+template<typename T>
+size_t ChaseLevDeque<T>::size() const {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+}
+
+template<typename T>
+int WorkStealingQueue<T>::clampPriority(int priority) {
+    return std::min(std::max(priority, 0), kPriorityLevels - 1);
+}
+
+template<typename T>
+void WorkStealingQueue<T>::push(T item) {
+    lanes_[static_cast<int>(Fiber::Priority::Normal)].push(item);
+}
+
+template<typename T>
+void WorkStealingQueue<T>::pushPriority(T item, int priority) {
+    lanes_[clampPriority(priority)].push(item);
+}
+
+template<typename T>
+T WorkStealingQueue<T>::pop() {
+    // Highest priority lane first (lower value = higher priority)
+    T item{};
+    for (auto& lane : lanes_) {
+        if (lane.pop(item)) {
+            return item;
+        }
     }
-    
-    return item;
+    return T();
+}
+
+template<typename T>
+T WorkStealingQueue<T>::steal() {
+    return stealPriority(kPriorityLevels - 1);
 }
 
 template<typename T>
 T WorkStealingQueue<T>::stealPriority(int minPriority) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
     // Find highest priority item that meets minimum priority requirement
-    for (auto it = priorityItems_.begin(); it != priorityItems_.end(); ++it) {
-        if (it->priority <= minPriority) {
-            T item = it->item;
-            priorityItems_.erase(it);
-            top_.fetch_add(1);
+    T item{};
+    for (int p = 0; p <= clampPriority(minPriority); ++p) {
+        if (lanes_[p].steal(item)) {
             return item;
         }
     }
-    
     return T();
 }
 
 template<typename T>
 bool WorkStealingQueue<T>::isEmpty() const {
-    return bottom_.load() <= top_.load();
+    return size() == 0;
 }
 
 template<typename T>
 size_t WorkStealingQueue<T>::size() const {
-    size_t b = bottom_.load();
-    size_t t = top_.load();
-    return b > t ? b - t : 0;
+    size_t total = 0;
+    for (const auto& lane : lanes_) {
+        total += lane.size();
+    }
+    return total;
 }
 
 template<typename Func, typename... Args>
@@ -374,15 +594,34 @@ uint64_t LightweightScheduler::goWithPriority(Fiber::Priority priority, Func&& f
         fiberStackSize_,
         priority
     );
+    fiber->scheduler_ = this;
+    activeFibers_.fetch_add(1);
     
     // Select worker based on priority and NUMA awareness
     size_t workerIdx = selectWorkerForFiber(priority);
     workers_[workerIdx]->addFiber(fiber);
     
-    activeFibers_.fetch_add(1);
-    
     return fiber->getId();
 }
 
 } // namespace runtime
 } // namespace tocin
+
+// C ABI used by generated code for `go` statements; both run on
+// LightweightScheduler::instance(), which is started on first use
+extern "C" {
+
+/**
+ * @brief Run entry(env) in a new goroutine
+ *
+ * `env` is the heap (malloc) closure environment of the call, or null;
+ * the runtime frees it once entry returns.
+ */
+void runtime_schedule_goroutine(void (*entry)(void*), void* env);
+
+/**
+ * @brief Block until every goroutine launched so far has finished
+ */
+void runtime_wait_all();
+
+} // extern "C"
@@ -265,6 +265,70 @@ bool native_dict_has(void* dict, const char* key) {
     return false;
 }
 
+// Numeric kernels
+//
+// target_clones emits one copy per ISA level plus an ifunc resolver that
+// picks the best one at load time, so these stay fast in binaries built for
+// a "generic" CPU. ifunc needs an ELF loader; elsewhere there is one copy.
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define TOCIN_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef TOCIN_MULTIVERSION
+#define TOCIN_MULTIVERSION
+#endif
+
+TOCIN_MULTIVERSION
+double native_vec_dot(const double* a, const double* b, int64_t n) {
+    // Independent partial sums so the loop vectorizes without -ffast-math
+    double sum[4] = {0.0, 0.0, 0.0, 0.0};
+    int64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        sum[0] += a[i] * b[i];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+TOCIN_MULTIVERSION
+void native_vec_axpy(double alpha, const double* x, double* y, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+TOCIN_MULTIVERSION
+void native_vec_add(const double* a, const double* b, double* out, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+TOCIN_MULTIVERSION
+void native_mat_mul(const double* a, const double* b, double* c,
+                    int64_t m, int64_t k, int64_t n) {
+    // i-k-j order keeps the inner loop a unit-stride axpy over rows of B and C
+    for (int64_t i = 0; i < m; ++i) {
+        double* row = c + i * n;
+        for (int64_t j = 0; j < n; ++j) {
+            row[j] = 0.0;
+        }
+        for (int64_t p = 0; p < k; ++p) {
+            double scale = a[i * k + p];
+            const double* bRow = b + p * n;
+            for (int64_t j = 0; j < n; ++j) {
+                row[j] += scale * bRow[j];
+            }
+        }
+    }
+}
+
 // Error handling
 void native_panic(const char* message) {
     std::cerr << "PANIC: " << (message ? message : "Unknown error") << std::endl;
@@ -49,30 +49,100 @@ extern "C"
      */
     void native_println(); // Prints a newline
 
-    // --- Basic Math (Example) ---
+    // --- Math ---
+    // Domain errors (sqrt of a negative, log of a non-positive, asin/acos
+    // outside [-1, 1]) return NaN rather than trapping.
+    double native_sqrt(double value);
+    double native_pow(double base, double exponent);
+    double native_log(double value);
+    double native_exp(double value);
+    double native_sin(double value);
+    double native_cos(double value);
+    double native_tan(double value);
+    double native_asin(double value);
+    double native_acos(double value);
+    double native_atan(double value);
+    bool native_is_nan(double value);
+    bool native_is_infinite(double value);
+    bool native_is_finite(double value);
+
+    // --- Strings ---
     /**
-     * @brief Calculates the square root of a double.
-     * @param value The number to take the square root of.
-     * @return The square root, or NaN for negative input.
+     * @brief Gets the length of a C string (0 for null).
      */
-    // double native_sqrt(double value);
+    int64_t native_string_length(const char *s);
 
-    // --- String Manipulation (Example - Requires Runtime Memory Management!) ---
     /**
      * @brief Concatenates two C strings.
-     * @param s1 The first string.
-     * @param s2 The second string.
      * @return A NEWLY ALLOCATED C string containing s1 followed by s2.
      * @warning The caller (Tocin runtime/GC) is responsible for freeing the returned memory!
      */
-    // const char* native_string_concat(const char* s1, const char* s2);
+    const char *native_string_concat(const char *s1, const char *s2);
+
+    /**
+     * @brief Number/string conversions. The to-string forms return newly
+     *        allocated strings; the parse forms return 0 on malformed input.
+     */
+    const char *native_int_to_string(int64_t value);
+    const char *native_float_to_string(double value);
+    int64_t native_string_to_int(const char *str);
+    double native_string_to_float(const char *str);
+
+    // --- Memory ---
+    void *native_malloc(size_t size);
+    void native_free(void *ptr);
+
+    // --- System ---
+    int64_t native_time(); // Milliseconds since the epoch
+    void native_sleep(int64_t milliseconds);
+    void native_exit(int64_t code);
+    int64_t native_random_int(int64_t min, int64_t max); // Inclusive range
+    double native_random_float(double min, double max);
+
+    // --- Collections ---
+    void *native_array_create(size_t size, size_t element_size);
+    void native_array_set(void *array, size_t index, void *value, size_t element_size);
+    void *native_array_get(void *array, size_t index, size_t element_size);
+    size_t native_array_length(void *array);
+    void *native_dict_create();
+    void native_dict_set(void *dict, const char *key, void *value);
+    void *native_dict_get(void *dict, const char *key);
+    bool native_dict_has(void *dict, const char *key);
+
+    // --- Errors ---
+    void native_panic(const char *message);
+    void native_assert(bool condition, const char *message);
+
+    // --- Numeric Kernels ---
+    // Hot loops behind the math/ml stdlib. Each one is compiled several
+    // times for different x86 ISA levels and the best clone for the running
+    // CPU is picked when the runtime is loaded, so a generic build still
+    // gets AVX2/AVX-512 code paths.
+
+    /**
+     * @brief Dot product of two double arrays.
+     * @param a First vector, @p n elements.
+     * @param b Second vector, @p n elements.
+     * @param n Element count.
+     */
+    double native_vec_dot(const double *a, const double *b, int64_t n);
+
+    /**
+     * @brief y[i] += alpha * x[i] for i in [0, n).
+     */
+    void native_vec_axpy(double alpha, const double *x, double *y, int64_t n);
+
+    /**
+     * @brief out[i] = a[i] + b[i] for i in [0, n). @p out may alias either input.
+     */
+    void native_vec_add(const double *a, const double *b, double *out, int64_t n);
 
     /**
-     * @brief Gets the length of a C string.
-     * @param s The string.
-     * @return The length of the string (number of bytes excluding null terminator).
+     * @brief Row-major C[m x n] = A[m x k] * B[k x n].
+     * @warning @p c must not alias @p a or @p b.
      */
-    // int64_t native_string_length(const char* s);
+    void native_mat_mul(const double *a, const double *b, double *c,
+                        int64_t m, int64_t k, int64_t n);
 
     // --- Add more native function declarations here ---
     // - File I/O (fopen, fclose, fread, fwrite, fseek, ftell etc.)
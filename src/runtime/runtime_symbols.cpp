@@ -0,0 +1,83 @@
+#include "runtime_symbols.h"
+#include "concurrency.h"
+#include "lightweight_scheduler.h"
+#include "native_functions.h"
+
+namespace runtime {
+
+#define TOCIN_RUNTIME_SYMBOL(fn) {#fn, reinterpret_cast<void*>(&fn)}
+
+const std::vector<RuntimeSymbol>& runtimeSymbols() {
+    static const std::vector<RuntimeSymbol> symbols = {
+        // I/O
+        TOCIN_RUNTIME_SYMBOL(native_print_string),
+        TOCIN_RUNTIME_SYMBOL(native_print_int),
+        TOCIN_RUNTIME_SYMBOL(native_print_float),
+        TOCIN_RUNTIME_SYMBOL(native_print_bool),
+        TOCIN_RUNTIME_SYMBOL(native_println),
+
+        // Math
+        TOCIN_RUNTIME_SYMBOL(native_sqrt),
+        TOCIN_RUNTIME_SYMBOL(native_pow),
+        TOCIN_RUNTIME_SYMBOL(native_log),
+        TOCIN_RUNTIME_SYMBOL(native_exp),
+        TOCIN_RUNTIME_SYMBOL(native_sin),
+        TOCIN_RUNTIME_SYMBOL(native_cos),
+        TOCIN_RUNTIME_SYMBOL(native_tan),
+        TOCIN_RUNTIME_SYMBOL(native_asin),
+        TOCIN_RUNTIME_SYMBOL(native_acos),
+        TOCIN_RUNTIME_SYMBOL(native_atan),
+        TOCIN_RUNTIME_SYMBOL(native_is_nan),
+        TOCIN_RUNTIME_SYMBOL(native_is_infinite),
+        TOCIN_RUNTIME_SYMBOL(native_is_finite),
+        TOCIN_RUNTIME_SYMBOL(native_vec_dot),
+        TOCIN_RUNTIME_SYMBOL(native_vec_axpy),
+        TOCIN_RUNTIME_SYMBOL(native_vec_add),
+        TOCIN_RUNTIME_SYMBOL(native_mat_mul),
+
+        // Strings
+        TOCIN_RUNTIME_SYMBOL(native_string_length),
+        TOCIN_RUNTIME_SYMBOL(native_string_concat),
+        TOCIN_RUNTIME_SYMBOL(native_int_to_string),
+        TOCIN_RUNTIME_SYMBOL(native_float_to_string),
+        TOCIN_RUNTIME_SYMBOL(native_string_to_int),
+        TOCIN_RUNTIME_SYMBOL(native_string_to_float),
+
+        // Memory and system
+        TOCIN_RUNTIME_SYMBOL(native_malloc),
+        TOCIN_RUNTIME_SYMBOL(native_free),
+        TOCIN_RUNTIME_SYMBOL(native_time),
+        TOCIN_RUNTIME_SYMBOL(native_sleep),
+        TOCIN_RUNTIME_SYMBOL(native_exit),
+        TOCIN_RUNTIME_SYMBOL(native_random_int),
+        TOCIN_RUNTIME_SYMBOL(native_random_float),
+
+        // Collections
+        TOCIN_RUNTIME_SYMBOL(native_array_create),
+        TOCIN_RUNTIME_SYMBOL(native_array_set),
+        TOCIN_RUNTIME_SYMBOL(native_array_get),
+        TOCIN_RUNTIME_SYMBOL(native_array_length),
+        TOCIN_RUNTIME_SYMBOL(native_dict_create),
+        TOCIN_RUNTIME_SYMBOL(native_dict_set),
+        TOCIN_RUNTIME_SYMBOL(native_dict_get),
+        TOCIN_RUNTIME_SYMBOL(native_dict_has),
+
+        // Errors
+        TOCIN_RUNTIME_SYMBOL(native_panic),
+        TOCIN_RUNTIME_SYMBOL(native_assert),
+
+        // Goroutines and channels
+        TOCIN_RUNTIME_SYMBOL(runtime_schedule_goroutine),
+        TOCIN_RUNTIME_SYMBOL(runtime_wait_all),
+        TOCIN_RUNTIME_SYMBOL(runtime_channel_create),
+        TOCIN_RUNTIME_SYMBOL(runtime_channel_send),
+        TOCIN_RUNTIME_SYMBOL(runtime_channel_receive),
+        TOCIN_RUNTIME_SYMBOL(runtime_channel_close),
+        TOCIN_RUNTIME_SYMBOL(runtime_select),
+    };
+    return symbols;
+}
+
+#undef TOCIN_RUNTIME_SYMBOL
+
+} // namespace runtime
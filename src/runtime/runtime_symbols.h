@@ -0,0 +1,27 @@
+#ifndef TOCIN_RUNTIME_SYMBOLS_H
+#define TOCIN_RUNTIME_SYMBOLS_H
+
+#include <vector>
+
+namespace runtime {
+
+/**
+ * @brief A C-ABI runtime entry point that generated code may call by name
+ */
+struct RuntimeSymbol {
+    const char* name;
+    void* address;
+};
+
+/**
+ * @brief Every native_* and runtime_* function in this binary
+ *
+ * The JIT defines these as absolute symbols, so JIT-compiled code binds
+ * straight to the runtime linked into the compiler instead of depending
+ * on the process exporting them dynamically.
+ */
+const std::vector<RuntimeSymbol>& runtimeSymbols();
+
+} // namespace runtime
+
+#endif // TOCIN_RUNTIME_SYMBOLS_H
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
 
 namespace type_checker {
 
@@ -519,7 +520,7 @@ ast::TypePtr OwnershipUtils::makeBorrowedType(ast::TypePtr type, bool isMutable)
 }
 
 std::string OwnershipUtils::generateLifetimeName() {
-    static int counter = 0;
+    static std::atomic<int> counter{0};
     return "'a" + std::to_string(counter++);
 }
 
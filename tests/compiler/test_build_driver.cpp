@@ -0,0 +1,121 @@
+// Build Driver Tests for Tocin Compiler
+
+#include "../../src/compiler/build_driver.h"
+#include "../test_runner.cpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace compiler;
+
+// A directory of source files under the system temp directory
+struct ScratchProject {
+    std::filesystem::path directory;
+
+    explicit ScratchProject(const std::string& name)
+        : directory(std::filesystem::temp_directory_path() / ("tocin_build_test_" + name)) {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+    ~ScratchProject() { std::filesystem::remove_all(directory); }
+
+    std::string write(const std::string& file, const std::string& source) const {
+        auto path = directory / file;
+        std::ofstream(path) << source;
+        return path.string();
+    }
+};
+
+BuildUnit* findUnit(const BuildDriver& driver, const std::string& name) {
+    for (BuildUnit* unit : driver.getOrder()) {
+        if (unit->name == name || std::filesystem::path(unit->name).filename() == name) {
+            return unit;
+        }
+    }
+    throw TestFailure("no unit named " + name);
+}
+
+size_t orderOf(const BuildDriver& driver, const BuildUnit* unit) {
+    const auto& order = driver.getOrder();
+    return std::find(order.begin(), order.end(), unit) - order.begin();
+}
+
+bool reported(const error::ErrorHandler& errors, error::ErrorCode code) {
+    const auto& all = errors.getErrors();
+    return std::any_of(all.begin(), all.end(), [code](const auto& e) { return e.code == code; });
+}
+
+TEST_CASE(build_driver_schedules_imports_in_waves) {
+    // main -> left, right -> base: a diamond three waves deep
+    ScratchProject project("waves");
+    project.write("base.to", "def base_value() -> int {\n    return 1;\n}\n");
+    project.write("left.to", "import base;\n\ndef left_value() -> int {\n    return 2;\n}\n");
+    project.write("right.to", "import base;\n\ndef right_value() -> int {\n    return 3;\n}\n");
+    std::string root = project.write("main.to",
+        "import left;\nimport right;\n\ndef main() -> int {\n    return 0;\n}\n");
+
+    error::ErrorHandler errors;
+    lexer::SourceManager sources;
+    BuildDriver::Options options;
+    options.jobs = 2;
+    BuildDriver driver(errors, options);
+    ASSERT_TRUE(driver.build(*sources.load(root)));
+
+    ASSERT_EQ(driver.getOrder().size(), 4u);
+    BuildUnit* base = findUnit(driver, "base");
+    BuildUnit* left = findUnit(driver, "left");
+    BuildUnit* right = findUnit(driver, "right");
+    BuildUnit* main = findUnit(driver, "main.to");
+    ASSERT_EQ(base->wave, 0u);
+    ASSERT_EQ(left->wave, 1u);
+    ASSERT_EQ(right->wave, 1u);
+    ASSERT_EQ(main->wave, 2u);
+
+    // Every unit comes after everything it imports
+    for (BuildUnit* unit : driver.getOrder()) {
+        for (BuildUnit* dependency : unit->dependencies) {
+            ASSERT_LT(orderOf(driver, dependency), orderOf(driver, unit));
+        }
+    }
+    ASSERT_EQ(base->dependencies.size(), 0u);
+    ASSERT_EQ(main->dependencies.size(), 2u);
+
+    // The diamond's base is built once and linked once
+    llvm::Module* program = driver.link();
+    ASSERT_TRUE(program != nullptr);
+    for (const char* name : {"main", "left_value", "right_value", "base_value"}) {
+        ASSERT_TRUE(program->getFunction(name) != nullptr);
+        ASSERT_FALSE(program->getFunction(name)->isDeclaration());
+    }
+}
+
+TEST_CASE(build_driver_rejects_import_cycles) {
+    ScratchProject project("cycle");
+    project.write("ping.to", "import pong;\n\ndef ping() -> int {\n    return 1;\n}\n");
+    project.write("pong.to", "import ping;\n\ndef pong() -> int {\n    return 2;\n}\n");
+    std::string root = project.write("main.to", "import ping;\n\ndef main() -> int {\n    return 0;\n}\n");
+
+    error::ErrorHandler errors;
+    lexer::SourceManager sources;
+    BuildDriver driver(errors, BuildDriver::Options());
+    ASSERT_FALSE(driver.build(*sources.load(root)));
+    ASSERT_TRUE(reported(errors, error::ErrorCode::M002_CIRCULAR_DEPENDENCY));
+
+    // Nothing was compiled, so there is nothing to link
+    for (BuildUnit* unit : driver.getOrder()) {
+        ASSERT_TRUE(unit->module == nullptr);
+    }
+}
+
+TEST_CASE(build_driver_fails_units_with_parse_errors) {
+    ScratchProject project("parse_error");
+    project.write("broken.to", "def broken( -> int {\n    return 1;\n}\n");
+    std::string root = project.write("main.to", "import broken;\n\ndef main() -> int {\n    return 0;\n}\n");
+
+    error::ErrorHandler errors;
+    lexer::SourceManager sources;
+    BuildDriver driver(errors, BuildDriver::Options());
+    ASSERT_FALSE(driver.build(*sources.load(root)));
+    // Discovery stops before anything is scheduled
+    ASSERT_TRUE(driver.getOrder().empty());
+}
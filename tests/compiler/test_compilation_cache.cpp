@@ -0,0 +1,142 @@
+// Compilation Cache Tests for Tocin Compiler
+
+#include "../../src/compiler/compilation_cache.h"
+#include "../test_runner.cpp"
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <filesystem>
+#include <functional>
+
+using namespace compiler;
+
+// A cache in a fresh directory under the system temp directory
+struct ScratchCache {
+    std::filesystem::path directory;
+    CompilationCache cache;
+
+    explicit ScratchCache(const std::string& name)
+        : directory(std::filesystem::temp_directory_path() / ("tocin_cache_test_" + name)),
+          cache((std::filesystem::remove_all(directory), directory.string())) {}
+    ~ScratchCache() { std::filesystem::remove_all(directory); }
+};
+
+// int twice(int x) { return x + x; } plus an internal helper
+std::unique_ptr<llvm::Module> createCachedModule(llvm::LLVMContext& context) {
+    auto module = std::make_unique<llvm::Module>("math.basic", context);
+    module->setSourceFileName("math/basic.to");
+    llvm::IRBuilder<> builder(context);
+    auto funcType = llvm::FunctionType::get(builder.getInt32Ty(), {builder.getInt32Ty()}, false);
+
+    auto twice = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, "twice", module.get());
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", twice));
+    builder.CreateRet(builder.CreateAdd(twice->getArg(0), twice->getArg(0)));
+
+    auto helper = llvm::Function::Create(funcType, llvm::Function::InternalLinkage, "helper", module.get());
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", helper));
+    builder.CreateRet(helper->getArg(0));
+    return module;
+}
+
+TEST_CASE(cache_round_trips_module_and_exports) {
+    ScratchCache scratch("round_trip");
+    llvm::LLVMContext context;
+    auto module = createCachedModule(context);
+    auto exports = CompilationCache::exportsOf(*module);
+    ASSERT_EQ(exports.exports, std::vector<std::string>{"twice"});
+
+    std::string key = CompilationCache::key("def twice(x: int) -> int { return x + x; }", CacheKeyOptions());
+    ASSERT_TRUE(scratch.cache.store(key, *module, exports, {"math.core", "io"}));
+
+    llvm::LLVMContext loadContext;
+    auto cached = scratch.cache.load(key, loadContext);
+    ASSERT_TRUE(cached.module != nullptr);
+    ASSERT_TRUE(cached.module->getFunction("twice") != nullptr);
+    ASSERT_FALSE(cached.module->getFunction("twice")->isDeclaration());
+    ASSERT_TRUE(cached.module->getFunction("helper") != nullptr);
+    ASSERT_EQ(cached.exports.name, std::string("math.basic"));
+    ASSERT_EQ(cached.exports.path, std::string("math/basic.to"));
+    ASSERT_EQ(cached.exports.exports, exports.exports);
+    ASSERT_EQ(cached.imports, (std::vector<std::string>{"math.core", "io"}));
+
+    // Another key is a miss
+    auto missing = scratch.cache.load(CompilationCache::key("", CacheKeyOptions()), loadContext);
+    ASSERT_TRUE(missing.module == nullptr);
+}
+
+TEST_CASE(cache_key_covers_every_option) {
+    const std::string source = "def main() -> int { return 0; }";
+    CacheKeyOptions base;
+    base.target = "native";
+    base.triple = "x86_64-unknown-linux-gnu";
+    base.cpu = "generic";
+    std::string baseKey = CompilationCache::key(source, base);
+    ASSERT_EQ(CompilationCache::key(source, base), baseKey);
+    ASSERT_NE(CompilationCache::key(source + " ", base), baseKey);
+
+    std::vector<std::function<void(CacheKeyOptions&)>> changes = {
+        [](CacheKeyOptions& o) { o.optimize = false; },
+        [](CacheKeyOptions& o) { o.optimizationLevel = 3; },
+        [](CacheKeyOptions& o) { o.sizeLevel = 1; },
+        [](CacheKeyOptions& o) { o.target = "wasm"; },
+        [](CacheKeyOptions& o) { o.triple = "aarch64-unknown-linux-gnu"; },
+        [](CacheKeyOptions& o) { o.cpu = "skylake"; },
+        [](CacheKeyOptions& o) { o.features = "+avx2"; },
+        [](CacheKeyOptions& o) { o.flags = "f"; },
+        [](CacheKeyOptions& o) { o.profile = "use:run.profdata"; },
+    };
+    for (const auto& change : changes) {
+        CacheKeyOptions options = base;
+        change(options);
+        ASSERT_NE(CompilationCache::key(source, options), baseKey);
+    }
+
+    // Adjacent fields are delimited, so text cannot move between them
+    CacheKeyOptions left = base, right = base;
+    left.cpu = "ab";
+    right.cpu = "a";
+    right.features = "b" + base.features;
+    ASSERT_NE(CompilationCache::key(source, left), CompilationCache::key(source, right));
+}
+
+TEST_CASE(cache_combine_follows_dependency_keys) {
+    std::string key = CompilationCache::key("import math.basic;", CacheKeyOptions());
+    std::string dependency = CompilationCache::key("def twice(x: int) -> int { return x + x; }", CacheKeyOptions());
+    std::string changed = CompilationCache::key("def twice(x: int) -> int { return 2 * x; }", CacheKeyOptions());
+
+    // A module without imports is named by its own key
+    ASSERT_EQ(CompilationCache::combine(key, {}), key);
+
+    std::string combined = CompilationCache::combine(key, {dependency});
+    ASSERT_NE(combined, key);
+    ASSERT_EQ(CompilationCache::combine(key, {dependency}), combined);
+    ASSERT_NE(CompilationCache::combine(key, {changed}), combined);
+    ASSERT_NE(CompilationCache::combine(key, {dependency, changed}), combined);
+}
+
+TEST_CASE(cache_round_trips_imports) {
+    ScratchCache scratch("imports");
+    std::string sourceKey = CompilationCache::key("import math.basic;\nimport io;", CacheKeyOptions());
+    std::vector<std::string> imports;
+    ASSERT_FALSE(scratch.cache.loadImports(sourceKey, imports));
+
+    ASSERT_TRUE(scratch.cache.storeImports(sourceKey, {"math.basic", "io"}));
+    ASSERT_TRUE(scratch.cache.loadImports(sourceKey, imports));
+    ASSERT_EQ(imports, (std::vector<std::string>{"math.basic", "io"}));
+
+    // No imports is recorded too, and replaces what the list held
+    std::string leafKey = CompilationCache::key("def main() -> int { return 0; }", CacheKeyOptions());
+    ASSERT_TRUE(scratch.cache.storeImports(leafKey, {}));
+    ASSERT_TRUE(scratch.cache.loadImports(leafKey, imports));
+    ASSERT_TRUE(imports.empty());
+}
+
+TEST_CASE(cache_without_directory_is_disabled) {
+    CompilationCache cache("");
+    llvm::LLVMContext context;
+    auto module = createCachedModule(context);
+    std::string key = CompilationCache::key("", CacheKeyOptions());
+    ASSERT_FALSE(cache.store(key, *module, CompilationCache::exportsOf(*module)));
+    ASSERT_TRUE(cache.load(key, context).module == nullptr);
+    ASSERT_FALSE(cache.storeImports(key, {}));
+}
@@ -1,10 +1,21 @@
 // Advanced Optimization Tests for Tocin Compiler
 
 #include "../../src/compiler/advanced_optimizations.h"
+#include "../../src/llvm_shim.h"
 #include "../test_runner.cpp"
 #include <llvm/IR/Module.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <cassert>
 
@@ -41,6 +52,92 @@ std::unique_ptr<llvm::Module> createTestModule() {
     return module;
 }
 
+// Helper to build a module from textual IR
+std::unique_ptr<llvm::Module> parseModule(llvm::LLVMContext& context, const char* name, const char* ir) {
+    llvm::SMDiagnostic diagnostic;
+    auto module = llvm::parseIR(llvm::MemoryBufferRef(ir, name), diagnostic, context);
+    if (!module) {
+        throw TestFailure(std::string(name) + ": " + diagnostic.getMessage().str());
+    }
+    return module;
+}
+
+// LTO inputs need a triple and data layout, which the pipeline takes from here
+llvm::TargetMachine* hostTargetMachine() {
+    static std::unique_ptr<llvm::TargetMachine> machine = [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        std::string triple = llvm::sys::getDefaultTargetTriple();
+        std::string error;
+        auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (!target) {
+            throw TestFailure("Failed to lookup target: " + error);
+        }
+        return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+            triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::Model::PIC_));
+    }();
+    return machine.get();
+}
+
+// Pre-link optimize a module and hand its summary to the optimizer, as
+// the build driver does for each compiled unit
+void addThinModule(WholeProgramOptimizer& wpo, const char* name, const char* ir) {
+    llvm::LLVMContext context;
+    auto module = parseModule(context, name, ir);
+    runStandardPipeline(*module, 2, 0, hostTargetMachine(), /*thinLTOPreLink=*/true);
+    wpo.addModule(name, WholeProgramOptimizer::summarize(*module));
+}
+
+size_t countInstructions(const llvm::Function& function, unsigned opcode) {
+    size_t count = 0;
+    for (const auto& block : function) {
+        for (const auto& instruction : block) {
+            if (instruction.getOpcode() == opcode) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Locals kept in entry-block allocas, the way the IR generator emits them
+const char* kAllocaLocals = R"(
+define i64 @scale(i64 %a, i64 %b) {
+entry:
+  %x = alloca i64
+  %y = alloca i64
+  store i64 %a, ptr %x
+  store i64 %b, ptr %y
+  %0 = load i64, ptr %x
+  %1 = load i64, ptr %y
+  %2 = mul i64 %0, %1
+  store i64 %2, ptr %x
+  %3 = load i64, ptr %x
+  ret i64 %3
+}
+)";
+
+const char* kHelperModule = R"(
+define i32 @helper(i32 %x) {
+  %r = mul i32 %x, 2
+  ret i32 %r
+}
+
+define i32 @unused(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+)";
+
+const char* kMainModule = R"(
+declare i32 @helper(i32)
+
+define i32 @main() {
+  %r = call i32 @helper(i32 21)
+  ret i32 %r
+}
+)";
+
 // Test implementations
 TEST_CASE(pgo_manager_init) {
     PGOManager pgo;
@@ -64,3 +161,95 @@ TEST_CASE(optimization_pipeline) {
     auto stats = pipeline.getStats();
     ASSERT_GE(stats.optimizationTimeMs, 0.0);
 }
+
+TEST_CASE(standard_pipeline_promotes_locals) {
+    llvm::LLVMContext context;
+    auto optimized = parseModule(context, "o2", kAllocaLocals);
+    runStandardPipeline(*optimized, 2);
+    ASSERT_EQ(countInstructions(*optimized->getFunction("scale"), llvm::Instruction::Alloca), 0u);
+
+    // -O0 leaves the stack slots for the debugger
+    auto unoptimized = parseModule(context, "o0", kAllocaLocals);
+    runStandardPipeline(*unoptimized, 0);
+    ASSERT_EQ(countInstructions(*unoptimized->getFunction("scale"), llvm::Instruction::Alloca), 2u);
+}
+
+TEST_CASE(thin_lto_inlines_across_modules) {
+    WholeProgramOptimizer wpo;
+    addThinModule(wpo, "helper", kHelperModule);
+    addThinModule(wpo, "main", kMainModule);
+    wpo.preserveSymbol("main");
+
+    llvm::LLVMContext context;
+    auto linked = wpo.performLTO(context);
+    ASSERT_TRUE(linked != nullptr);
+    llvm::Function* main = linked->getFunction("main");
+    ASSERT_TRUE(main != nullptr && !main->isDeclaration());
+    // helper was imported into main's module and inlined there
+    ASSERT_EQ(countInstructions(*main, llvm::Instruction::Call), 0u);
+}
+
+TEST_CASE(thin_lto_internalizes_unpreserved_exports) {
+    WholeProgramOptimizer wpo;
+    addThinModule(wpo, "helper", kHelperModule);
+    addThinModule(wpo, "main", kMainModule);
+    wpo.preserveSymbol("main");
+
+    llvm::LLVMContext context;
+    auto linked = wpo.performLTO(context);
+    ASSERT_TRUE(linked != nullptr);
+    ASSERT_TRUE(linked->getFunction("main")->hasExternalLinkage());
+    // No module and nothing outside the program calls unused, so it is
+    // internalized and then dropped as dead
+    llvm::Function* unused = linked->getFunction("unused");
+    ASSERT_TRUE(!unused || unused->isDeclaration() || unused->hasLocalLinkage());
+    ASSERT_GE(wpo.getStats().globalsOptimized, 2u);
+}
+
+TEST_CASE(thin_lto_rejects_duplicate_definitions) {
+    WholeProgramOptimizer wpo;
+    addThinModule(wpo, "first", kHelperModule);
+    addThinModule(wpo, "second", kHelperModule);
+
+    llvm::LLVMContext context;
+    ASSERT_TRUE(wpo.performLTO(context) == nullptr);
+    ASSERT_TRUE(wpo.getError().find("'helper' is already defined") != std::string::npos);
+}
+
+TEST_CASE(pgo_check_profile_rejects_missing_and_raw) {
+    std::string error;
+    auto directory = std::filesystem::temp_directory_path();
+    ASSERT_FALSE(PGOManager::checkProfile((directory / "tocin_missing.profdata").string(), error));
+    ASSERT_FALSE(error.empty());
+
+    // A raw profile straight from an instrumented run must be indexed first
+    auto raw = (directory / "tocin_test_default.profraw").string();
+    {
+        std::ofstream file(raw, std::ios::binary);
+        uint64_t magic = llvm::RawInstrProf::getMagic<uint64_t>();
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    }
+    error.clear();
+    ASSERT_FALSE(PGOManager::checkProfile(raw, error));
+    ASSERT_TRUE(error.find("raw profile") != std::string::npos);
+    std::filesystem::remove(raw);
+}
+
+TEST_CASE(pgo_pipeline_options_prefer_instrumentation) {
+    PGOManager pgo;
+    ASSERT_FALSE(pgo.pipelineOptions().has_value());
+
+    pgo.useProfile("run.profdata");
+    pgo.enableProfiling(PGOManager::rawProfilePath("profiles"));
+    auto options = pgo.pipelineOptions();
+    ASSERT_TRUE(options.has_value());
+    ASSERT_TRUE(options->Action == llvm::PGOOptions::IRInstr);
+    ASSERT_TRUE(options->AtomicCounterUpdate);
+    ASSERT_TRUE(options->ProfileFile.find("default_%m.profraw") != std::string::npos);
+
+    pgo.disableProfiling();
+    options = pgo.pipelineOptions();
+    ASSERT_TRUE(options.has_value());
+    ASSERT_TRUE(options->Action == llvm::PGOOptions::IRUse);
+    ASSERT_EQ(options->ProfileFile, std::string("run.profdata"));
+}
@@ -1,10 +1,18 @@
 // Lightweight Scheduler Tests for Tocin Compiler
 
 #include "../../src/runtime/lightweight_scheduler.h"
+#include "../../src/runtime/concurrency.h"
 #include <iostream>
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <stdexcept>
 
 using namespace tocin::runtime;
 
@@ -54,11 +62,441 @@ TEST(multiple_goroutines) {
     scheduler.stop();
 }
 
+TEST(yield_interleaves_on_one_worker) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<int> turn{0};
+    std::atomic<bool> ok{true};
+    for (int id = 0; id < 2; id++) {
+        scheduler.go([&turn, &ok, id]() {
+            for (int i = 0; i < 100; i++) {
+                // With a single worker both fibers only progress if yield
+                // really switches away
+                while (turn.load() % 2 != id) {
+                    Fiber::yieldCurrent();
+                }
+                turn++;
+            }
+            if (turn.load() < 199) ok = false;
+        });
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(turn.load(), 200);
+    ASSERT_TRUE(ok.load());
+    scheduler.stop();
+}
+
+TEST(suspend_releases_worker) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<Fiber*> waiter{nullptr};
+    std::shared_ptr<Fiber> parked;
+    std::atomic<int> stage{0};
+    scheduler.go([&]() {
+        Fiber* self = Fiber::current();
+        parked = self->shared_from_this();
+        waiter = self;
+        self->suspend();
+        stage = 2;
+    });
+    scheduler.go([&]() {
+        while (!waiter.load()) {
+            Fiber::yieldCurrent();
+        }
+        stage = 1;
+        waiter.load()->wake();
+    });
+    scheduler.waitAll();
+    ASSERT_EQ(stage.load(), 2);
+    scheduler.stop();
+}
+
+TEST(sleep_releases_worker) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<bool> sleeperDone{false};
+    std::atomic<bool> ranWhileSleeping{false};
+    auto start = std::chrono::steady_clock::now();
+    std::clock_t cpuStart = std::clock();
+    scheduler.go([&]() {
+        Fiber::sleepFor(std::chrono::milliseconds(200));
+        sleeperDone = true;
+    });
+    scheduler.go([&]() {
+        // The only worker is free while the other fiber sleeps
+        ranWhileSleeping = !sleeperDone.load();
+    });
+    scheduler.waitAll();
+    double cpuMs = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    ASSERT_TRUE(ranWhileSleeping.load());
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(200));
+    // A sleeper that spun on yield() would burn the whole 200ms
+    ASSERT_TRUE(cpuMs < 100.0);
+    scheduler.stop();
+}
+
+TEST(throwing_goroutine_completes) {
+    LightweightScheduler scheduler(1);
+    scheduler.setFiberStackSize(64 * 1024); // Unwinding needs real stack
+    scheduler.start();
+    std::atomic<int> after{0};
+    scheduler.go([]() { throw std::runtime_error("boom"); });
+    scheduler.go([&after]() { after++; });
+    // Returns only if the throwing fiber still counts as completed
+    scheduler.waitAll();
+    ASSERT_EQ(after.load(), 1);
+    scheduler.stop();
+}
+
+TEST(stack_pool_recycles) {
+    auto stack = FiberStackPool::acquire(20000);
+    ASSERT_EQ(stack.size, size_t(32 * 1024));
+    void* base = stack.base;
+    FiberStackPool::release(stack);
+    auto again = FiberStackPool::acquire(32 * 1024);
+    ASSERT_TRUE(again.base == base);
+    FiberStackPool::release(again);
+}
+
+TEST(default_stack_fits_stdio) {
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    std::atomic<int> written{0};
+    for (int i = 0; i < 64; i++) {
+        scheduler.go([&written, i]() {
+            char buffer[8192];
+            written += std::snprintf(buffer, sizeof(buffer), "%d %f %s", i, i * 0.5, "fiber");
+        });
+    }
+    scheduler.waitAll();
+    ASSERT_TRUE(written.load() > 0);
+    scheduler.stop();
+}
+
+TEST(chase_lev_each_item_once) {
+    ChaseLevDeque<intptr_t> deque(4); // Small so the buffer has to grow
+    const intptr_t numItems = 200000;
+    std::vector<std::atomic<int>> seen(numItems + 1);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; i++) {
+        thieves.emplace_back([&]() {
+            intptr_t item;
+            while (!done.load()) {
+                if (deque.steal(item)) seen[item]++;
+            }
+        });
+    }
+    intptr_t item;
+    for (intptr_t i = 1; i <= numItems; i++) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(item)) seen[item]++;
+    }
+    while (deque.pop(item)) seen[item]++;
+    done = true;
+    for (auto& t : thieves) t.join();
+    for (intptr_t i = 1; i <= numItems; i++) {
+        ASSERT_EQ(seen[i].load(), 1);
+    }
+}
+
+TEST(priority_lanes_pop_in_order) {
+    WorkStealingQueue<intptr_t> queue;
+    queue.pushPriority(4, 4);
+    queue.pushPriority(2, 2);
+    queue.pushPriority(0, 0);
+    ASSERT_EQ(queue.size(), size_t(3));
+    ASSERT_EQ(queue.pop(), 0);
+    ASSERT_EQ(queue.steal(), 2);
+    ASSERT_EQ(queue.stealPriority(3), 0); // Only Background left
+    ASSERT_EQ(queue.pop(), 4);
+    ASSERT_TRUE(queue.isEmpty());
+}
+
+TEST(fan_out_is_stolen) {
+    LightweightScheduler scheduler(4);
+    scheduler.start();
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    scheduler.go([&]() {
+        // Children land on the parent's deque; idle workers must steal them
+        for (int i = 0; i < 40; i++) {
+            scheduler.go([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+    });
+    scheduler.waitAll();
+    ASSERT_TRUE(threads.size() > 1);
+    scheduler.stop();
+}
+
+TEST(unbuffered_channel_ping_pong_on_one_worker) {
+    // Both goroutines share one worker, so this only finishes if a blocked
+    // send/receive suspends the fiber rather than the thread
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    runtime::Channel<int> ping(0), pong(0);
+    std::atomic<int> last{0};
+    scheduler.go([&]() {
+        for (int i = 0; i < 1000; i++) {
+            ping.send(i);
+            last = *pong.receive();
+        }
+        ping.close();
+    });
+    scheduler.go([&]() {
+        while (auto value = ping.receive()) {
+            pong.send(*value + 1);
+        }
+    });
+    scheduler.waitAll();
+    ASSERT_EQ(last.load(), 1000);
+    scheduler.stop();
+}
+
+TEST(buffered_channel_many_blocked_goroutines) {
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    runtime::Channel<int> channel(4);
+    std::atomic<long> sum{0};
+    const int producers = 500;
+    for (int p = 0; p < producers; p++) {
+        scheduler.go([&channel, p]() {
+            for (int i = 0; i < 10; i++) channel.send(p);
+        });
+    }
+    for (int c = 0; c < 100; c++) {
+        scheduler.go([&channel, &sum]() {
+            for (int i = 0; i < 50; i++) sum += *channel.receive();
+        });
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(sum.load(), 10L * producers * (producers - 1) / 2);
+    scheduler.stop();
+}
+
+TEST(channel_close_wakes_thread_receiver) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    runtime::Channel<int> channel(2);
+    scheduler.go([&channel]() {
+        channel.send(7);
+        Fiber::sleepFor(std::chrono::milliseconds(5));
+        channel.close();
+    });
+    // Called from a plain thread: blocks the thread, not a worker
+    auto first = channel.receive();
+    auto second = channel.receive();
+    ASSERT_TRUE(first.has_value() && *first == 7);
+    ASSERT_TRUE(!second.has_value());
+    ASSERT_TRUE(channel.trySend(1) == runtime::ChannelResult::Closed);
+    scheduler.waitAll();
+    scheduler.stop();
+}
+
+TEST(select_default_and_fair_order) {
+    runtime::Channel<int> a(1), b(1);
+    ASSERT_EQ(runtime::Select().onReceive(a).onDefault().execute(), runtime::Select::kDefaultCase);
+    int counts[2] = {0, 0};
+    for (int i = 0; i < 2000; i++) {
+        a.trySend(1);
+        b.trySend(2);
+        runtime::Select select;
+        select.onReceive(a).onReceive(b);
+        counts[select.execute()]++;
+    }
+    // Both cases are always ready; a fixed poll order would starve one
+    ASSERT_TRUE(counts[0] > 800 && counts[1] > 800);
+}
+
+TEST(select_send_and_timeout) {
+    runtime::Channel<int> channel(0);
+    auto start = std::chrono::steady_clock::now();
+    int chosen = runtime::Select().onSend(channel, 1).onTimeout(std::chrono::milliseconds(20)).execute();
+    ASSERT_EQ(chosen, runtime::Select::kTimeoutCase);
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+    std::thread receiver([&]() { ASSERT_EQ(*channel.receive(), 7); });
+    bool sent = false;
+    runtime::Select select;
+    select.onSend(channel, 7, [&](bool ok) { sent = ok; });
+    ASSERT_EQ(select.execute(), 0);
+    ASSERT_TRUE(sent);
+    receiver.join();
+}
+
+TEST(select_fan_in_on_one_worker) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    runtime::Channel<int> left(0), right(2), quit(0);
+    std::atomic<int> received{0};
+    scheduler.go([&]() {
+        for (;;) {
+            runtime::Select select;
+            bool done = false;
+            select.onReceive<int>(left, [&](std::optional<int>) { received++; })
+                  .onReceive<int>(right, [&](std::optional<int>) { received++; })
+                  .onReceive<int>(quit, [&](std::optional<int>) { done = true; });
+            select.execute();
+            if (done) break;
+        }
+        int value;
+        while (right.tryReceive(value) == runtime::ChannelResult::Ok) received++;
+    });
+    scheduler.go([&]() {
+        for (int i = 0; i < 500; i++) {
+            left.send(i);
+            right.send(i);
+        }
+        // Unbuffered: returns once the select has taken it; anything left
+        // in `right` is drained afterwards
+        quit.send(0);
+    });
+    scheduler.waitAll();
+    ASSERT_EQ(received.load(), 1000);
+    scheduler.stop();
+}
+
+TEST(select_against_select) {
+    // Opposite ends of an unbuffered channel, both sides selecting
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    runtime::Channel<int> channel(0);
+    std::atomic<long> sum{0};
+    scheduler.go([&]() {
+        for (int i = 1; i <= 2000; i++) {
+            runtime::Select().onSend(channel, i).execute();
+        }
+    });
+    scheduler.go([&]() {
+        for (int i = 0; i < 2000; i++) {
+            runtime::Select().onReceive<int>(channel, [&](std::optional<int> v) { sum += *v; }).execute();
+        }
+    });
+    scheduler.waitAll();
+    ASSERT_EQ(sum.load(), 2000L * 2001 / 2);
+    scheduler.stop();
+}
+
+TEST(c_abi_goroutines) {
+    // What compiled `go f(x)` statements do: heap env, then join at exit
+    static std::atomic<long> sum{0};
+    struct Env { long value; };
+    for (long i = 1; i <= 1000; i++) {
+        Env* env = static_cast<Env*>(std::malloc(sizeof(Env)));
+        env->value = i;
+        runtime_schedule_goroutine([](void* raw) { sum += static_cast<Env*>(raw)->value; }, env);
+    }
+    runtime_wait_all();
+    ASSERT_EQ(sum.load(), 1000L * 1001 / 2);
+}
+
+TEST(c_abi_select_on_null_channels_blocks) {
+    // Go blocks forever here; the fiber must park, not take the process down
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<bool> otherRan{false};
+    std::atomic<bool> returned{false};
+    scheduler.go([&returned]() {
+        TocinSelectCase cases[1] = {};
+        runtime_select(cases, 1, false, -1);
+        returned = true;
+    });
+    scheduler.go([&otherRan]() { otherRan = true; });
+    for (int i = 0; i < 100 && !otherRan.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(otherRan.load());
+    ASSERT_TRUE(!returned.load());
+    scheduler.stop();
+}
+
+TEST(stop_unwinds_blocked_fibers) {
+    // Fibers still blocked when the scheduler stops are unwound, not leaked
+    struct Guard {
+        std::atomic<int>& count;
+        ~Guard() { count++; }
+    };
+    std::atomic<int> unwound{0};
+    std::atomic<int> blocked{0};
+    std::atomic<bool> returned{false};
+    std::vector<std::weak_ptr<Fiber>> fibers;
+    std::mutex fibersMutex;
+    runtime::Channel<int> unbuffered;
+    runtime::Channel<int> full(1);
+    full.send(0);
+    {
+        LightweightScheduler scheduler(2);
+        scheduler.start();
+        auto spawn = [&](std::function<void()> body) {
+            scheduler.go([&, body]() {
+                {
+                    std::lock_guard<std::mutex> lock(fibersMutex);
+                    fibers.push_back(Fiber::current()->shared_from_this());
+                }
+                Guard guard{unwound};
+                blocked++;
+                body();
+                returned = true;
+            });
+        };
+        spawn([&]() { unbuffered.receive(); });
+        spawn([&]() { full.send(1); });
+        spawn([&]() {
+            runtime::Select select;
+            select.onReceive(unbuffered).onTimeout(std::chrono::hours(1));
+            select.execute();
+        });
+        spawn([]() { Fiber::sleepFor(std::chrono::hours(1)); });
+        spawn([]() {
+            TocinSelectCase cases[1] = {};
+            runtime_select(cases, 1, false, -1);
+        });
+        while (blocked.load() < 5) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        scheduler.stop();
+        ASSERT_TRUE(!returned.load());
+    }
+    // The C ABI goroutine ends without unwinding generated frames
+    ASSERT_EQ(unwound.load(), 4);
+    for (auto& fiber : fibers) {
+        ASSERT_TRUE(fiber.expired());
+    }
+    // The channels no longer point into the dead stacks
+    ASSERT_EQ(full.receive().value_or(-1), 0);
+    ASSERT_TRUE(unbuffered.trySend(1) == runtime::ChannelResult::WouldBlock);
+}
+
 int main() {
     std::cout << "=== Lightweight Scheduler Tests ===\n\n";
     RUN_TEST(scheduler_init);
     RUN_TEST(single_goroutine);
     RUN_TEST(multiple_goroutines);
+    RUN_TEST(yield_interleaves_on_one_worker);
+    RUN_TEST(suspend_releases_worker);
+    RUN_TEST(sleep_releases_worker);
+    RUN_TEST(throwing_goroutine_completes);
+    RUN_TEST(stack_pool_recycles);
+    RUN_TEST(default_stack_fits_stdio);
+    RUN_TEST(chase_lev_each_item_once);
+    RUN_TEST(priority_lanes_pop_in_order);
+    RUN_TEST(fan_out_is_stolen);
+    RUN_TEST(unbuffered_channel_ping_pong_on_one_worker);
+    RUN_TEST(buffered_channel_many_blocked_goroutines);
+    RUN_TEST(channel_close_wakes_thread_receiver);
+    RUN_TEST(select_default_and_fair_order);
+    RUN_TEST(select_send_and_timeout);
+    RUN_TEST(select_fan_in_on_one_worker);
+    RUN_TEST(select_against_select);
+    RUN_TEST(c_abi_goroutines);
+    RUN_TEST(c_abi_select_on_null_channels_blocks);
+    RUN_TEST(stop_unwinds_blocked_fibers);
     std::cout << "\n=== All tests passed! ===\n";
     return 0;
 }
@@ -1,5 +1,7 @@
 #include "test_framework.h"
 #include "../src/lexer/lexer.h"
+#include "../src/lexer/char_scan.h"
+#include "../src/lexer/keywords.h"
 
 using namespace lexer;
 
@@ -39,3 +41,67 @@ TEST(Lexer, TokenizeIdentifiers) {
     
     ASSERT_TRUE(tokens.size() >= 3);
 }
+
+TEST(Lexer, PullMatchesTokenize) {
+    std::string source = "def f(a: int) -> int {\n    return a + 1;\n}\n";
+    lexer::Lexer whole(source, "test.to");
+    auto tokens = whole.tokenize();
+
+    lexer::SourceManager sources;
+    lexer::Lexer pulled(sources.add("test.to", source));
+    for (const auto& expected : tokens) {
+        Token token = pulled.next();
+        ASSERT_TRUE(token.type == expected.type);
+        ASSERT_EQ(expected.value, token.value);
+        ASSERT_EQ(expected.offset, token.offset);
+    }
+    ASSERT_TRUE(pulled.next().type == TokenType::EOF_TOKEN);
+}
+
+TEST(Lexer, InternsIdentifiersAndKeywords) {
+    lexer::SymbolTable symbols;
+    lexer::SourceManager sources;
+    lexer::Lexer lexer(sources.add("test.to", "foo let foo bar"), &symbols);
+
+    Token first = lexer.next();
+    Token keyword = lexer.next();
+    Token again = lexer.next();
+    Token other = lexer.next();
+    ASSERT_TRUE(keyword.type == TokenType::LET);
+    ASSERT_EQ(symbols.intern("let"), keyword.symbol);
+    ASSERT_EQ(first.symbol, again.symbol);
+    ASSERT_NE(first.symbol, other.symbol);
+    ASSERT_EQ(std::string("foo"), std::string(symbols.name(first.symbol)));
+}
+
+TEST(Lexer, ScansRunsAcrossVectorBlocks) {
+    // Lengths straddle the 16- and 32-byte blocks and the scalar tail
+    for (size_t length = 1; length < 80; ++length) {
+        std::string name(length, 'a');
+        name[length / 2] = '_';
+        std::string text = name + " \t\r";
+        ASSERT_EQ(length, scan::identifierRun(text.data(), text.data() + text.size()));
+        ASSERT_EQ(size_t(3), scan::blankRun(text.data() + length, text.data() + text.size()));
+
+        std::string body(length, 'x');
+        std::string quoted = body + "\\\"";
+        ASSERT_EQ(length, scan::stringRun(quoted.data(), quoted.data() + quoted.size(), '"'));
+    }
+}
+
+TEST(Lexer, FindsKeywordsByPerfectHash) {
+    for (const auto& keyword : keywords) {
+        const Keyword* found = findKeyword(keyword.spelling);
+        ASSERT_TRUE(found == &keyword);
+    }
+    ASSERT_TRUE(findKeyword("lets") == nullptr);
+    ASSERT_TRUE(findKeyword("x") == nullptr);
+    ASSERT_TRUE(findKeyword("instanceofx") == nullptr);
+
+    std::string source = "let value = " + std::string(40, 'n') + " # comment\n";
+    lexer::Lexer lexer(source, "test.to");
+    auto tokens = lexer.tokenize();
+    ASSERT_TRUE(tokens[0].type == TokenType::LET);
+    ASSERT_TRUE(tokens[1].type == TokenType::IDENTIFIER);
+    ASSERT_EQ(std::string(40, 'n'), tokens[3].value);
+}
@@ -50,3 +50,52 @@ TEST(Parser, ParseBinaryExpression) {
     auto ast = parser.parse();
     ASSERT_TRUE(ast != nullptr);
 }
+
+TEST(Parser, TreeOutlivesParser) {
+    lexer::SourceManager sources;
+    ast::StmtPtr ast;
+    {
+        lexer::Lexer lexer(sources.add("test.to", "def f(a: int) -> int { return a + 1; }\nreturn f(2);"));
+        parser::Parser parser(lexer);
+        ast = parser.parse();
+    }
+    // The nodes' arena is kept alive by the nodes themselves
+    auto block = std::dynamic_pointer_cast<ast::BlockStmt>(ast);
+    ASSERT_TRUE(block != nullptr);
+    ASSERT_EQ(size_t(2), block->statements.size());
+    ASSERT_TRUE(std::dynamic_pointer_cast<ast::FunctionStmt>(block->statements[0]) != nullptr);
+}
+
+TEST(Parser, ArenaAllocatesAligned) {
+    auto arena = std::make_shared<ast::Arena>();
+    for (size_t i = 1; i < 200; ++i) {
+        void* p = arena->allocate(i * 7, i % 2 ? 8 : 16);
+        ASSERT_TRUE(reinterpret_cast<uintptr_t>(p) % (i % 2 ? 8 : 16) == 0);
+    }
+    void* large = arena->allocate(ast::Arena::kBlockSize * 2, 8);
+    ASSERT_TRUE(large != nullptr);
+    ASSERT_TRUE(arena->bytesReserved() >= arena->bytesUsed());
+}
+
+TEST(Parser, ParseDottedImport) {
+    lexer::SourceManager sources;
+    lexer::Lexer lexer(sources.add("test.to", "import math.basic;\n"));
+    parser::Parser parser(lexer);
+
+    auto import = std::dynamic_pointer_cast<ast::ImportStmt>(parser.parse());
+    ASSERT_TRUE(import != nullptr);
+    ASSERT_EQ(std::string("math.basic"), import->moduleName);
+}
+
+TEST(Parser, ParseChannelTypeAndReceive) {
+    lexer::SourceManager sources;
+    lexer::Lexer lexer(sources.add("test.to", "let ch: channel<int> = <-channels;\n"));
+    parser::Parser parser(lexer);
+
+    auto variable = std::dynamic_pointer_cast<ast::VariableStmt>(parser.parse());
+    ASSERT_TRUE(variable != nullptr);
+    auto channelType = std::dynamic_pointer_cast<ast::ChannelType>(variable->type);
+    ASSERT_TRUE(channelType != nullptr);
+    ASSERT_EQ(std::string("int"), channelType->elementType->toString());
+    ASSERT_TRUE(std::dynamic_pointer_cast<ast::ChannelReceiveExpr>(variable->initializer) != nullptr);
+}